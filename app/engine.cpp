@@ -517,22 +517,33 @@ void Engine::onFileComplete(const newsflash::ui::file& f)
 
     path = QDir(path).absolutePath();
     path = QDir::toNativeSeparators(path);
-    DEBUG("File complete \"%1/%2\" damaged: %3 binary: %4",
-        path, name, f.damaged, f.binary);
+    DEBUG("File complete \"%1/%2\" damaged: %3 binary: %4 verified: %5",
+        path, name, f.damaged, f.binary, f.verified);
 
     app::FileInfo file;
     file.binary  = f.binary;
     file.damaged = f.damaged;
+    file.verified = f.verified;
     file.name    = name;
     file.path    = path;
     file.size    = f.size;
     file.type    = findFileType(file.name);
 
-    if (f.damaged)
+    if (f.damaged && !f.damaged_slices.empty())
+    {
+        WARN("\"%1\" is damaged. %2 par2 blocks don't match.", file.name, f.damaged_slices.size());
+        NOTE("\"%1\" is damaged.", file.name);
+    }
+    else if (f.damaged)
     {
         WARN("\"%1\" is damaged.", file.name);
         NOTE("\"%1\" is damaged.", file.name);
     }
+    else if (f.verified)
+    {
+        INFO("\"%1\" is complete and verified.", file.name);
+        NOTE("\"%1\" is complete.", file.name);
+    }
     else
     {
         INFO("\"%1\" is complete.", file.name);
@@ -45,6 +45,10 @@ namespace app
         // true if data is binary.
         bool binary;
 
+        // true if the data was verified against the par2
+        // checksums while it was being downloaded.
+        bool verified;
+
         FileType type;
     };
 
@@ -28,13 +28,16 @@
 #  include <QFileInfo>
 #  include <QDir>
 #  include <QCoreApplication>
+#  include <QTimer>
 #include "newsflash/warnpop.h"
 
 #include <limits>
+#include <thread>
 
 #include "engine/nntp.h"
 #include "engine/utf8.h"
 #include "engine/iso_8859_15.h"
+#include "engine/update.h"
 #include "stringlib/string.h"
 #include "newsgroup.h"
 #include "eventlog.h"
@@ -206,16 +209,20 @@ NewsGroup::NewsGroup() : task_(0)
     QObject::connect(g_engine, SIGNAL(actionKilled(quint32)),
         this, SLOT(actionKilled(quint32)));
 
-    // loader callback
-    index_.on_load = [this] (std::size_t key, std::size_t idx) {
+    // loader callback. the index has the row of the article 
+    // in the volume columns which tells us the catalog index.
+    index_.on_load = [this] (std::size_t key, std::size_t row) {
         auto& c = catalogs_[key];
-        return c.load(catalog::index_t{idx});
+        const auto& view = columnViews_[key];
+        return c.load(catalog::index_t{view.slot(row)});
     };
-    index_.on_filter = [this](const Article& article) {
-        if (!show_these_filetypes_.test(article.type()))
+    // the filter runs on the columns so that it doesn't need
+    // to load the articles.
+    index_.on_filter_columns = [this](std::size_t key, const newsflash::column_view& c, std::size_t row) {
+        if (!show_these_filetypes_.test(c.type(row)))
             return false;
 
-        const auto bits = article.bits();
+        const auto bits = c.bits(row);
         if (!show_these_fileflags_.test(FileFlag::broken) &&
             bits.test(FileFlag::broken))
             return false;
@@ -223,28 +230,38 @@ NewsGroup::NewsGroup() : task_(0)
             bits.test(FileFlag::deleted))
             return false;
 
-        const auto date = article.pubdate();
+        const auto date = c.pubdate(row);
         if (date < min_show_pubdate_ || date > max_show_pubdate_)
             return false;
 
-        const auto size = article.bytes();
+        const auto size = c.bytes(row);
         if (size < min_show_file_size_ || size > max_show_file_size_)
             return false;
 
         if (string_matcher_utf8_.empty())
             return true;
 
-        const auto& subject = article.subject();
-        if (article.is_utf8_enabled() && string_matcher_case_sensitive_)
+        // most rows are ruled out by the text index without
+        // looking at the subject at all.
+        if (!isTextCandidate(string_matches_, key, row))
+            return false;
+
+        const auto subject = c.subject(row);
+        const auto utf8 = bits.test(FileFlag::enable_utf8);
+        if (utf8 && string_matcher_case_sensitive_)
             return string_matcher_utf8_.search(subject.c_str(), subject.size());
 
-        const auto& wide = toString(subject, article.is_utf8_enabled());
+        const auto& wide = toString(subject, utf8);
         if (string_matcher_case_sensitive_)
             return (bool)wide.contains(match_string_wide_, Qt::CaseSensitive);
 
         return (bool)wide.contains(match_string_wide_, Qt::CaseInsensitive);
 
     };
+    // the filter only reads the columns and the filter settings
+    // so it can be evaluated on all the cores.
+    index_.set_filter_threads(std::thread::hardware_concurrency());
+
     numSelected_ = 0;
     show_these_filetypes_.set_from_value(~0);
     show_these_fileflags_.set_from_value(~0);
@@ -265,6 +282,14 @@ NewsGroup::~NewsGroup()
     {
         cat.close();
     }
+    for (auto& cols : columnFiles_)
+    {
+        cols.close();
+    }
+    for (auto& text : textFiles_)
+    {
+        text.close();
+    }
 
     for (const auto& b : blocks_)
     {
@@ -279,6 +304,12 @@ NewsGroup::~NewsGroup()
         {
             INFO("Purged %1", b.file);
         }
+        QString cols = b.file;
+        cols.replace(cols.size() - 4, 4, ".col");
+        QFile::remove(cols);
+        QString text = b.file;
+        text.replace(text.size() - 4, 4, ".fts");
+        QFile::remove(text);
     }
 
     DEBUG("Newsgroup deleted");
@@ -500,6 +531,84 @@ void NewsGroup::sort(int column, Qt::SortOrder order)
     DEBUG("Sorting done!");
 }
 
+void NewsGroup::applyFilter()
+{
+    // the filter is evaluated in batches from the event loop so that the
+    // GUI stays responsive on large groups. if the filter is changed 
+    // while the previous filtering is still going on it's started over.
+    const auto running = index_.is_filtering();
+
+    string_matches_.clear();
+    if (!string_matcher_utf8_.empty())
+        findTextMatches(match_string_wide_, string_matches_);
+
+    index_.filter_begin();
+
+    if (!running)
+        QTimer::singleShot(0, this, SLOT(filterNext()));
+}
+
+bool NewsGroup::mayContain(const QString& str, std::size_t index)
+{
+    if (str != find_string_)
+    {
+        find_string_ = str;
+        find_matches_.clear();
+        findTextMatches(str, find_matches_);
+    }
+    return isTextCandidate(find_matches_, index_.key(index), index_.row(index));
+}
+
+void NewsGroup::findTextMatches(const QString& str, std::vector<TextMatch>& matches) const
+{
+    const auto& utf8 = toUtf8(str);
+
+    matches.resize(textViews_.size());
+    for (std::size_t i=0; i<textViews_.size(); ++i)
+    {
+        const auto& view = textViews_[i];
+        auto& match = matches[i];
+        match.numRows  = view.rows();
+        match.narrowed = view.find_substring(utf8, match.rows);
+    }
+}
+
+// static
+bool NewsGroup::isTextCandidate(const std::vector<TextMatch>& matches, std::size_t key, std::size_t row)
+{
+    // the rows added after the text index was saved are not in it.
+    if (key >= matches.size())
+        return true;
+    const auto& match = matches[key];
+    if (!match.narrowed || row >= match.numRows)
+        return true;
+    return std::binary_search(match.rows.begin(), match.rows.end(), std::uint32_t(row));
+}
+
+void NewsGroup::filterNext()
+{
+    // 250k items is some tens of milliseconds on the columns
+    // unless the subjects need to be matched.
+    const std::size_t FilterBatchSize = 250000;
+
+    if (!index_.is_filtering())
+        return;
+
+    if (!index_.filter_next(FilterBatchSize))
+    {
+        onFilterProgress(index_.filter_progress(), index_.real_size());
+        QTimer::singleShot(0, this, SLOT(filterNext()));
+        return;
+    }
+
+    QAbstractTableModel::beginResetModel();
+    index_.filter_apply();
+    QAbstractTableModel::reset();
+    QAbstractTableModel::endResetModel();
+
+    onFilterComplete();
+}
+
 bool NewsGroup::init(QString path, QString name)
 {
     DEBUG("Init data for %1 from %2", name, path);
@@ -521,7 +630,6 @@ bool NewsGroup::init(QString path, QString name)
     for (const auto& file : files)
     {
         Block block;
-        block.prevOffset = 0;
         block.prevSize   = 0;
         block.file       = joinPath(dataPath, file);
         block.state      = State::UnLoaded;
@@ -529,6 +637,10 @@ bool NewsGroup::init(QString path, QString name)
         block.purge      = false;
         blocks_.push_back(block);
         catalogs_.emplace_back();
+        columnFiles_.emplace_back();
+        columnViews_.emplace_back();
+        textFiles_.emplace_back();
+        textViews_.emplace_back();
     }
 
     return true;
@@ -619,6 +731,7 @@ void NewsGroup::killSelected(const QModelIndexList& list)
         auto article  = index_[row];
         auto deletion = article.is_deleted();
         article.set_bits(FileFlag::deleted, !deletion);
+        index_.set_bits(row, FileFlag::deleted, !deletion);
         //article.save();
     }
     if (!showDeleted())
@@ -671,6 +784,7 @@ void NewsGroup::bookmark(const QModelIndexList& list)
         auto article  = index_[row];
         auto bookmark = article.is_bookmarked();
         article.set_bits(FileFlag::bookmarked, !bookmark);
+        index_.set_bits(row, FileFlag::bookmarked, !bookmark);
     }
 
     const auto first = QAbstractTableModel::index(minRow, 0);
@@ -740,6 +854,7 @@ void NewsGroup::download(const QModelIndexList& list, quint32 acc, const QString
 
         pack.push_back(nzb);
         article.set_bits(FileFlag::downloaded, true);
+        index_.set_bits(row, FileFlag::downloaded, true);
         //article.save();
     }
 
@@ -908,12 +1023,15 @@ void NewsGroup::newHeaderDataAvailable(const QString& group, const QString& file
 
         Block block;
         block.prevSize   = 0;
-        block.prevOffset = 0;
         block.state      = newData ? State::Loaded : State::UnLoaded;
         block.file       = file;
         block.index      = catalogs_.size();
         block.purge      = false;
         catalogs_.emplace_back();
+        columnFiles_.emplace_back();
+        columnViews_.emplace_back();
+        textFiles_.emplace_back();
+        textViews_.emplace_back();
 
 #ifdef NEWSFLASH_DEBUG
         ASSERT(std::is_sorted(std::begin(blocks_), std::end(blocks_),
@@ -1010,25 +1128,75 @@ void NewsGroup::loadData(Block& block, bool guiLoad)
 
     auto& db = catalogs_[block.index];
     db.open(narrow(block.file));
+
+    // the index sorts and filters on the columns that are written
+    // next to the catalog. the columns can have rows that are not yet
+    // in the catalog, but if they have fewer rows (the data was written 
+    // by an older version) the engine builds them from the catalog.
+    QString colFile = block.file;
+    colFile.replace(colFile.size() - 4, 4, ".col");
+
+    auto& cols = columnFiles_[block.index];
+    auto& view = columnViews_[block.index];
+    view = newsflash::column_view();
+    if (QFileInfo(colFile).size() >= newsflash::COLUMN_HEAP)
+    {
+        cols.open(narrow(colFile));
+        view = newsflash::column_view(cols.map_ptr(0, cols.size()), cols.size());
+    }
+    // the text index is mapped again every time since the update
+    // replaces the file when it has more rows.
+    QString textFile = block.file;
+    textFile.replace(textFile.size() - 4, 4, ".fts");
+
+    auto& text = textFiles_[block.index];
+    textViews_[block.index] = newsflash::text_view();
+    text.close();
+
+    if (view.rows() < db.size())
+    {
+        DEBUG("Building columns for %1", block.file);
+
+        // the columns are written by the update that might be storing 
+        // into this volume right now, so they're built through it.
+        cols.close();
+        if (newsflash::update::build_columns(narrow(block.file)))
+        {
+            // the text index was removed with the old rows.
+            for (auto* matches : {&string_matches_, &find_matches_})
+            {
+                if (block.index < matches->size())
+                    (*matches)[block.index].narrowed = false;
+            }
+        }
+
+        cols.open(narrow(colFile));
+        view = newsflash::column_view(cols.map_ptr(0, cols.size()), cols.size());
+    }
+    index_.set_columns(block.index, view);
+
+    if (QFileInfo(textFile).size() > 0)
+    {
+        text.open(narrow(textFile));
+        textViews_[block.index] = newsflash::text_view(text.map_ptr(0, text.size()), text.size());
+    }
+
     if (db.size() == block.prevSize)
         return;
 
     QAbstractTableModel::beginResetModel();
 
-    DEBUG("Block %1 is at offset %2", block.file, block.prevOffset);
+    DEBUG("Block %1 has %2 articles", block.file, block.prevSize);
     DEBUG("Index has %1 articles. Loading more...", index_.size());
 
     std::size_t curItem  = 0;
-    std::size_t numItems = db.size();
+    std::size_t numItems = db.size() - block.prevSize;
 
-    // load all the articles, starting at the latest offset that we know off.
-    auto beg = db.begin(block.prevOffset);
-    auto end = db.end();
-    for (; beg != end; ++beg, ++curItem)
+    // the rows are in the same order as the articles in the catalog
+    // so the new articles are the rows after the ones we already have.
+    for (std::size_t row=block.prevSize; row<db.size(); ++row, ++curItem)
     {
-        const auto& article  = *beg;
-
-        index_.insert(article, block.index, article.index());
+        index_.insert(block.index, row);
 
         if (guiLoad)
         {
@@ -1038,13 +1206,7 @@ void NewsGroup::loadData(Block& block, bool guiLoad)
 
     DEBUG("Load done. Index now has %1 articles", index_.size());
 
-    // save the database and the current offset
-    // when new data is added to the same database
-    // we reload the db and then use the current latest
-    // index to start loading the objects.
-    block.prevOffset = beg.offset();
-    block.prevSize   = db.size();
-    DEBUG("Block %1 is at new offset %2", block.file, block.prevOffset);
+    block.prevSize = db.size();
 
     QAbstractTableModel::reset();
     QAbstractTableModel::endResetModel();
@@ -37,6 +37,8 @@
 #include "engine/filebuf.h"
 #include "engine/filemap.h"
 #include "engine/catalog.h"
+#include "engine/columns.h"
+#include "engine/text_index.h"
 #include "engine/index.h"
 #include "engine/idlist.h"
 #include "engine/bitflag.h"
@@ -76,6 +78,8 @@ namespace app
         std::function<void (std::size_t curBlock, std::size_t numBlocks)> onLoadBegin;
         std::function<void (std::size_t curItem, std::size_t numMitems)> onLoadProgress;
         std::function<void (std::size_t curBlock, std::size_t numBlocks)> onLoadComplete;
+        std::function<void (std::size_t curItem, std::size_t numItems)> onFilterProgress;
+        std::function<void ()> onFilterComplete;
         std::function<void ()> onKilled;
 
         // QAbstractTableModel
@@ -154,19 +158,14 @@ namespace app
 
         }
 
-        void applyFilter()
-        {
-            //CALLGRIND_START_INSTRUMENTATION;
-            //CALLGRIND_ZERO_STATS;
-
-            QAbstractTableModel::beginResetModel();
-            index_.filter();
-            QAbstractTableModel::reset();
-            QAbstractTableModel::endResetModel();
+        // start filtering the items with the current filter settings.
+        // the model is reset once the filtering is done.
+        void applyFilter();
 
-            //CALLGRIND_DUMP_STATS_AT("applyFilter");
-            //CALLGRIND_STOP_INSTRUMENTATION;
-        }
+        // check the text index whether the subject of the item can
+        // contain the string. if this returns false the string is 
+        // not in the subject, otherwise the subject needs to be checked.
+        bool mayContain(const QString& str, std::size_t index);
 
         QAbstractTableModel* getVolumeList();
 
@@ -179,6 +178,9 @@ namespace app
         void updateCompleted(const app::HeaderInfo& info);
         void actionKilled(quint32 action);
 
+    private slots:
+        void filterNext();
+
     private:
         struct Block;
         void loadData(Block& block, bool guiLoad);
@@ -187,6 +189,18 @@ namespace app
             return show_these_fileflags_.test(newsflash::fileflag::deleted);
         }
 
+        // the rows in a volume that can have a string according to
+        // the text index. the index covers the first numRows rows
+        // and if narrowed is false it couldn't tell anything.
+        struct TextMatch {
+            bool narrowed;
+            std::uint32_t numRows;
+            newsflash::text_view::rowset rows;
+        };
+        void findTextMatches(const QString& str, std::vector<TextMatch>& matches) const;
+
+        static bool isTextCandidate(const std::vector<TextMatch>& matches, std::size_t key, std::size_t row);
+
         using catalog = newsflash::catalog<newsflash::filemap>;
         using index   = newsflash::index<newsflash::filemap>;
         using idlist  = newsflash::idlist<newsflash::filemap>;
@@ -197,7 +211,6 @@ namespace app
 
         struct Block {
             std::size_t prevSize;
-            std::size_t prevOffset;
             std::size_t index;
             QString file;
             State state;
@@ -209,6 +222,10 @@ namespace app
 
         std::deque<Block> blocks_;
         std::deque<catalog> catalogs_;
+        std::deque<newsflash::filemap> columnFiles_;
+        std::deque<newsflash::column_view> columnViews_;
+        std::deque<newsflash::filemap> textFiles_;
+        std::deque<newsflash::text_view> textViews_;
         index index_;
         idlist idlist_;
 
@@ -229,6 +246,11 @@ namespace app
         QString      match_string_wide_;
         str::string_matcher<> string_matcher_utf8_;
         bool string_matcher_case_sensitive_;
+        std::vector<TextMatch> string_matches_;
+
+        // the text index matches for the last finder string.
+        QString find_string_;
+        std::vector<TextMatch> find_matches_;
 
     };
 } // app
\ No newline at end of file
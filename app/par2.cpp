@@ -83,6 +83,8 @@ void Par2::recover(const Archive& arc, const Settings& s)
     args << "r";
     if (s.purgeOnSuccess)
         args << "-p";
+    if (s.numThreads)
+        args << QString("-t%1").arg(s.numThreads);
 
     args << arc.file;
     args << "./*"; // scan extra files
@@ -0,0 +1,321 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#define LOGTAG "par2"
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <QMetaObject>
+#include <newsflash/warnpop.h>
+#include <vector>
+#include <set>
+#include <string>
+#include "eventlog.h"
+#include "format.h"
+#include "debug.h"
+#include "par2library.h"
+
+// par2cmdline.h pulls in the std namespace, keep it last.
+#include "par2cmdline.h"
+
+namespace app
+{
+
+// runs on the recovery thread (and the par2 worker threads) and posts
+// the events to the Par2Library object on its own thread.
+class Par2Library::Listener : public Par2RepairerListener
+{
+public:
+    Listener(Par2Library* owner, const std::atomic<bool>& cancel) 
+        : owner_(owner), cancel_(cancel), loading_(false), repaired_(false)
+    {}
+
+    virtual void LoadingFile(const std::string& name) override
+    {
+        loading_ = true;
+        post(name, FileType::Parity, FileState::Loading);
+    }
+    virtual void LoadedFile(const std::string& name, u32, u32) override
+    {
+        loading_ = false;
+        post(name, FileType::Parity, FileState::Loaded);
+    }
+    virtual void ScanProgress(const std::string& name, u32 fraction) override
+    {
+        // the repairer doesn't announce the files it scans, so a file
+        // is listed when its first progress report comes in. Several files
+        // can be scanned at once so remember each one that was listed.
+        if (!loading_ && scanning_.insert(name).second)
+            post(name, FileType::Target, FileState::Scanning);
+        QMetaObject::invokeMethod(owner_, "scanProgress", Qt::QueuedConnection,
+            Q_ARG(QString, widen(name)), Q_ARG(int, fraction / 10));
+    }
+    virtual void TargetVerified(const std::string& name, TargetStatus status, u32, u32) override
+    {
+        FileState state = FileState::Missing;
+        switch (status)
+        {
+            case tsMissing:  state = FileState::Missing;  break;
+            case tsEmpty:    state = FileState::Empty;    break;
+            case tsComplete: state = FileState::Complete; break;
+            case tsDamaged:  state = FileState::Damaged;  break;
+        }
+        post(name, FileType::Target, state);
+    }
+    virtual void DataFound(const std::string& name, const std::string&, bool) override
+    {
+        post(name, FileType::Target, FileState::Found);
+    }
+    virtual void RepairProgress(const std::string& step, u32 fraction) override
+    {
+        repaired_ = true;
+        QMetaObject::invokeMethod(owner_, "repairProgress", Qt::QueuedConnection,
+            Q_ARG(QString, widen(step)), Q_ARG(int, fraction / 10));
+    }
+    virtual bool Cancelled() override
+    { return cancel_; }
+
+    bool repaired() const 
+    { return repaired_; }
+
+private:
+    typedef ParityChecker::FileType FileType;
+    typedef ParityChecker::FileState FileState;
+
+    void post(const std::string& name, FileType type, FileState state)
+    {
+        QMetaObject::invokeMethod(owner_, "fileUpdate", Qt::QueuedConnection,
+            Q_ARG(QString, widen(name)), Q_ARG(int, (int)type), Q_ARG(int, (int)state));
+    }
+private:
+    Par2Library* owner_;
+    const std::atomic<bool>& cancel_;
+    std::set<std::string> scanning_;
+    bool loading_;
+    bool repaired_;
+};
+
+Par2Library::Par2Library() : cancel_(false), running_(false)
+{}
+
+Par2Library::~Par2Library()
+{
+    Q_ASSERT(!running_ && 
+        "Current archive is still being processed."
+        "We should either wait for its completion or stop it.");
+
+    // don't leave the thread behind if we're torn down anyway.
+    if (thread_.joinable())
+    {
+        cancel_ = true;
+        thread_.join();
+    }
+}
+
+void Par2Library::recover(const Archive& arc, const Settings& s)
+{
+    Q_ASSERT(!running_ &&
+        "we already have a current recovery being processed.");
+
+    if (s.writeLogFile)
+    {
+        const auto file = arc.path + "/repair.log";
+        logFile_.setFileName(file);
+        logFile_.open(QIODevice::Append | QIODevice::WriteOnly);
+        if (!logFile_.isOpen())
+        {
+            WARN("Unable to write par2 log file %1, %2", file, logFile_.error());
+        }
+    }
+
+    current_ = arc;
+    cancel_  = false;
+    running_ = true;
+    thread_  = std::thread(&Par2Library::run, this, narrow(arc.file), narrow(arc.path), s);
+
+    DEBUG("Started par2 recovery %1", arc.file);
+}
+
+void Par2Library::stop()
+{
+    if (!running_)
+        return;
+
+    DEBUG("Stopping par2 recovery %1", current_.file);
+
+    // the repairer polls the flag and bails out shortly,
+    // after which recoveryDone completes the archive.
+    current_.state = Archive::Status::Stopped;
+    cancel_ = true;
+
+    if (logFile_.isOpen())
+    {
+        logFile_.write("*** Terminated by user. ***\n");
+        logFile_.close();
+    }
+}
+
+bool Par2Library::isRunning() const
+{
+    return running_;
+}
+
+void Par2Library::fileUpdate(QString name, int type, int state)
+{
+    ParityChecker::File file;
+    file.name  = name;
+    file.type  = (FileType)type;
+    file.state = (FileState)state;
+
+    if (logFile_.isOpen())
+    {
+        static const char* names[] = {
+            "Loading", "Loaded", "Scanning", "Missing", "Found", "Empty", "Damaged", "Complete"
+        };
+        const auto line = toLatin(QString("%1 - %2\n").arg(name).arg(names[state]));
+        logFile_.write(line.data());
+    }
+    onUpdateFile(current_, std::move(file));
+}
+
+void Par2Library::scanProgress(QString name, int done)
+{
+    onScanProgress(current_, name, done);
+}
+
+void Par2Library::repairProgress(QString step, int done)
+{
+    onRepairProgress(current_, step, done);
+}
+
+void Par2Library::recoveryDone(bool success, QString message)
+{
+    DEBUG("par2 result %1 message %2", success, message);
+
+    thread_.join();
+    running_ = false;
+
+    if (current_.state != Archive::Status::Stopped)
+    {
+        current_.message = message;
+        current_.state   = success ? Archive::Status::Success :
+            Archive::Status::Failed;
+
+        if (logFile_.isOpen())
+        {
+            const auto msg = toLatin(message);
+            logFile_.write(msg.data());
+            logFile_.write("\n");
+        }
+    }
+    if (logFile_.isOpen())
+    {
+        logFile_.flush();
+        logFile_.close();
+    }
+    onReady(current_);
+}
+
+void Par2Library::run(std::string file, std::string path, Settings settings)
+{
+    // the same command line the external par2 would get. the repairer
+    // resolves the files against the directory of the par2 file.
+    std::vector<std::string> args;
+    args.push_back("par2");
+    args.push_back("r");
+    args.push_back("-q");
+    args.push_back("-q");
+    if (settings.purgeOnSuccess)
+        args.push_back("-p");
+    if (settings.numThreads)
+        args.push_back("-t" + std::to_string(settings.numThreads));
+    args.push_back(path + "/" + file);
+    args.push_back(path + "/*");
+
+    std::vector<char*> argv;
+    for (auto& arg : args)
+        argv.push_back(&arg[0]);
+
+    bool success = false;
+    QString message;
+
+    CommandLine cmd;
+    if (!cmd.Parse((int)argv.size(), &argv[0]))
+    {
+        message = "Invalid par2 command line";
+    }
+    else
+    {
+        Listener listener(this, cancel_);
+        Result result = eLogicError;
+
+        // par1 recovery doesn't report progress, only the result.
+        if (cmd.GetVersion() == CommandLine::verPar1)
+        {
+            Par1Repairer repairer;
+            result = repairer.Process(cmd, true);
+        }
+        else
+        {
+            Par2Repairer repairer;
+            repairer.SetListener(&listener);
+            result = repairer.Process(cmd, true);
+        }
+
+        switch (result)
+        {
+            case eSuccess:
+                success = true;
+                message = listener.repaired() 
+                    ? "Repair complete" 
+                    : "Repair is not required";
+                break;
+            case eRepairPossible:
+                message = "Repair is possible";
+                break;
+            case eRepairNotPossible:
+                message = "Repair is not possible";
+                break;
+            case eInvalidCommandLineArguments:
+                message = "Invalid par2 command line";
+                break;
+            case eInsufficientCriticalData:
+                message = "Main packet not found";
+                break;
+            case eRepairFailed:
+                message = "Repair failed";
+                break;
+            case eFileIOError:
+                message = "File IO error";
+                break;
+            case eLogicError:
+                message = "Internal error";
+                break;
+            case eMemoryError:
+                message = "Out of memory";
+                break;
+        }
+    }
+
+    QMetaObject::invokeMethod(this, "recoveryDone", Qt::QueuedConnection,
+        Q_ARG(bool, success), Q_ARG(QString, message));
+}
+
+} // app
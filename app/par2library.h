@@ -0,0 +1,71 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <QObject>
+#  include <QString>
+#  include <QFile>
+#include <newsflash/warnpop.h>
+#include <atomic>
+#include <thread>
+#include "paritychecker.h"
+#include "archive.h"
+
+namespace app
+{
+    // implementation of parity checking using the par2cmdline code
+    // linked into the application. The recovery runs on a background thread
+    // and its progress is delivered back to the thread that called recover()
+    // through queued slot invocations, so the callbacks need no locking.
+    class Par2Library : public QObject, public ParityChecker
+    {
+        Q_OBJECT
+
+    public:
+        Par2Library();
+       ~Par2Library();
+
+        virtual void recover(const Archive& arc, const Settings& s);
+        virtual void stop();
+        virtual bool isRunning() const;
+
+    private slots:
+        void fileUpdate(QString name, int type, int state);
+        void scanProgress(QString name, int done);
+        void repairProgress(QString step, int done);
+        void recoveryDone(bool success, QString message);
+
+    private:
+        class Listener;
+
+        void run(std::string file, std::string path, Settings settings);
+
+    private:
+        std::thread thread_;
+        std::atomic<bool> cancel_;
+        QFile logFile_;
+        bool running_;
+    private:
+        Archive current_;
+    };
+} // app
@@ -78,6 +78,9 @@ namespace app
         struct Settings {
             bool writeLogFile;
             bool purgeOnSuccess;
+            // number of threads to use for verifying and repairing.
+            // 0 means one per processor.
+            unsigned numThreads;
         };
 
         // list a new file in the parity process.
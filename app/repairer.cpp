@@ -441,6 +441,7 @@ Repairer::Repairer(std::unique_ptr<ParityChecker> engine) : engine_(std::move(en
     writeLogs_ = true;
     purgePars_ = false;
     enabled_   = true;
+    numThreads_ = 0;
 }
 
 Repairer::~Repairer()
@@ -594,6 +595,9 @@ void Repairer::setWriteLogs(bool onOff)
 void Repairer::setPurgePars(bool onOff)
 { purgePars_ = onOff; }
 
+void Repairer::setNumThreads(unsigned num)
+{ numThreads_ = num; }
+
 std::size_t Repairer::numRepairs() const 
 {
     return list_->numRepairs();
@@ -621,6 +625,7 @@ void Repairer::startNextRecovery()
     ParityChecker::Settings settings;
     settings.purgeOnSuccess = purgePars_;
     settings.writeLogFile   = writeLogs_;
+    settings.numThreads     = numThreads_;
 
     auto& arc = list_->getRecovery(index);
     arc.state = Archive::Status::Active;
@@ -84,6 +84,9 @@ namespace app
 
         void setPurgePars(bool onOff);
 
+        // set the number of threads used for repairing, 0 for one per processor.
+        void setNumThreads(unsigned num);
+
         std::size_t numRepairs() const;
 
         const Archive& getRecovery(const QModelIndex&) const;
@@ -126,6 +129,7 @@ namespace app
         bool writeLogs_;
         bool purgePars_;
         bool enabled_;
+        unsigned numThreads_;
     };
 
 } // app
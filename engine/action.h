@@ -25,6 +25,7 @@
 #include <memory>
 #include <atomic>
 #include <string>
+#include <chrono>
 #include "logging.h"
 
 namespace newsflash
@@ -46,13 +47,13 @@ namespace newsflash
 
             // dispatch the action to a single thread with affinity to the
             // action id. this means that all actions with single_thread
-            // affinity and with the same id will execute in the same thread.
+            // affinity and with the same id and shard will execute in the same thread.
             single_thread
         };
 
         virtual ~action() = default;
 
-        action(affinity a = affinity::any_thread) : owner_(0), affinity_(a)
+        action(affinity a = affinity::any_thread) : owner_(0), shard_(0), affinity_(a), next_completed_(nullptr)
         {
             static std::atomic<std::size_t> id(1);
             id_ = id++;
@@ -104,10 +105,19 @@ namespace newsflash
         std::size_t get_id() const
         { return id_; }
 
+        // get the shard of the action.
+        std::size_t get_shard() const
+        { return shard_; }
+
         // set the action id
         void set_owner(std::size_t id) 
         { owner_ = id;}
 
+        // set the shard. single_thread actions from the same owner 
+        // but with different shards may execute in different threads.
+        void set_shard(std::size_t shard)
+        { shard_ = shard; }
+
         // set the thread affinity.
         void set_affinity(affinity aff)
         { affinity_ = aff; }
@@ -122,10 +132,16 @@ namespace newsflash
     private:
         std::exception_ptr exptr_;
         std::size_t owner_;
+        std::size_t shard_;
         std::size_t id_;        
         std::shared_ptr<logger> log_;
     private:
         affinity affinity_;
+    private:
+        friend class completion_queue;
+        // link and timestamp for the completion queue.
+        action* next_completed_;
+        std::chrono::steady_clock::time_point completed_;
     };
     
 } // newsflash
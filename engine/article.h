@@ -38,9 +38,13 @@
 #include "nntp.h"
 #include "utf8.h"
 #include "iso_8859_15.h"
+#include "xover.h"
 
 namespace newsflash
 {
+    // every article record on the disk ends with this magic value.
+    const std::uint32_t ARTICLE_MAGIC = 0xc0febabe;
+
     template<typename Storage>
     class article
     {
@@ -52,39 +56,34 @@ namespace newsflash
 
         bool parse(const char* overview, std::size_t len)
         {
-            const auto& pair = nntp::parse_overview(overview, len);
-            if (!pair.first)
+            xover_header header;
+            if (!xover_parser::parse_line(overview, len, header))
                 return false;
 
-            const auto& data = pair.second;
-            if (data.subject.len == 0 || data.subject.len > 512)
-                return false;
-            if (data.author.len == 0)
-                return false;
+            parse(header);
+            return true;
+        }
 
-            const auto& part = nntp::parse_part(data.subject.start, data.subject.len);
-            if (part.first)
+        // setup the article from a header that has been parsed
+        // and validated by the xover_parser.
+        void parse(const xover_header& header)
+        {
+            const auto& subject = header.subject;
+            const auto& author  = header.author;
+
+            if (header.has_parts)
             {
-                if (part.second.numerator > part.second.denominator)
-                    return false;
                 m_parts_avail = 1;
-                m_partno      = part.second.numerator;
-                m_parts_total = part.second.denominator;
+                m_partno      = header.partno;
+                m_parts_total = header.parts_total;
                 m_bits.set(fileflag::broken, (m_parts_avail != m_parts_total));
             }
 
-            const auto date = nntp::parse_date(data.date.start, data.date.len);
-            if (!date.first)
-                return false;
-
-            m_pubdate = nntp::timevalue(date.second);
+            m_pubdate = header.pubdate;
 
-            const auto binary = nntp::is_binary_post(data.subject.start, data.subject.len);
-            if (binary)
+            if (header.binary)
             {
-                const auto& filename = nntp::find_filename(data.subject.start, data.subject.len);
-                if (!filename.empty())
-                    m_type = find_filetype(filename);
+                m_type = header.type;
                 m_bits.set(fileflag::binary);
             }
 
@@ -98,27 +97,24 @@ namespace newsflash
             // if the subject string is well formed UTF-8 we're going to store it as is
             // otherwise we expect that it's in extended latin. (actually according to spec
             // latin-1 but in reality this isn't the case)
-            if (utf8::is_well_formed(data.subject.start, data.subject.start + data.subject.len))
-                m_subject = std::string{data.subject.start, data.subject.len};
-            else  m_subject = ISO_8859_15_to_utf8(data.subject.start, data.subject.len);
+            if (utf8::is_well_formed(subject.start, subject.start + subject.len))
+                m_subject = std::string{subject.start, subject.len};
+            else  m_subject = ISO_8859_15_to_utf8(subject.start, subject.len);
 
-            if (utf8::is_well_formed(data.author.start, data.author.start + data.author.len))
-                m_author  = std::string{data.author.start, data.author.len};
-            else m_author = ISO_8859_15_to_utf8(data.author.start, data.author.len);
+            if (utf8::is_well_formed(author.start, author.start + author.len))
+                m_author  = std::string{author.start, author.len};
+            else m_author = ISO_8859_15_to_utf8(author.start, author.len);
 
-            m_number  = nntp::to_int<std::uint64_t>(data.number.start, data.number.len);
-            m_bytes   = nntp::to_int<std::uint32_t>(data.bytecount.start, data.bytecount.len);
+            m_number  = header.number;
+            m_bytes   = header.bytes;
 
             // with the addition of utf-8 in the subject line we must cater for cases
             // where existing data is updated. so instead of calculating the hash from the utf-8
             // subject line we do it as before, i.e. from the subject line.
-            //m_hash    = nntp::hashvalue(m_subject.c_str(), m_subject.size());
-            m_hash = nntp::hashvalue(data.subject.start, data.subject.len);
+            m_hash = header.hash;
 
             if (m_author.size() > 64)
                 m_author.resize(64);
-
-            return true;
         }
 
         // load the article data from the specified offset in the storage object.
@@ -154,6 +150,15 @@ namespace newsflash
         {
             auto buffer = storage.load(offset, size_on_disk(), Storage::buf_write);
             auto out = buffer.begin();
+            save(out);
+            buffer.flush();
+        }
+
+        // save the article into a buffer at the output position.
+        // the buffer needs to have room for size_on_disk() bytes.
+        template<typename Iterator>
+        void save(Iterator& out) const
+        {
             write(out, m_index);
             write(out, m_bytes);
             write(out, m_idbkey);
@@ -166,6 +171,48 @@ namespace newsflash
             write(out, m_subject);
             write(out, m_author);
             write(out, MAGIC);
+        }
+
+        // save only the part information (bytes, message id key and the part counts)
+        // at the location of a previously saved article. the flags are normally
+        // not written since the user can change them through a mapped view
+        // in the meanwhile. if the broken flag needs to be saved the flags 
+        // are read back first and only the broken flag is changed.
+        void save_parts(std::size_t offset, Storage& storage, bool save_broken_flag) const
+        {
+            const auto start = offset + sizeof(m_index);
+            const auto parts = sizeof(m_bytes) + 
+                sizeof(m_idbkey) + 
+                sizeof(m_parts_avail) + 
+                sizeof(m_parts_total);
+            const auto flags = sizeof(m_number) + 
+                sizeof(m_pubdate) + 
+                sizeof(m_bits);
+            if (!save_broken_flag)
+            {
+                auto buffer = storage.load(start, parts, Storage::buf_write);
+                auto out = buffer.begin();
+                write(out, m_bytes);
+                write(out, m_idbkey);
+                write(out, m_parts_avail);
+                write(out, m_parts_total);
+                buffer.flush();
+                return;
+            }
+
+            auto buffer = storage.load(start, parts + flags, Storage::buf_read | Storage::buf_write);
+            auto it = buffer.begin() + parts + sizeof(m_number) + sizeof(m_pubdate);
+            bitflag<fileflag, std::uint8_t> bits;
+            read(it, bits);
+            bits.set(fileflag::broken, m_bits.test(fileflag::broken));
+
+            auto out = buffer.begin();
+            write(out, m_bytes);
+            write(out, m_idbkey);
+            write(out, m_parts_avail);
+            write(out, m_parts_total);
+            out += sizeof(m_number) + sizeof(m_pubdate);
+            write(out, bits);
             buffer.flush();
         }
 
@@ -294,6 +341,11 @@ namespace newsflash
         {
             m_bits.set(flag, on_off);
         }
+        void set_parts(std::uint16_t avail, std::uint16_t total)
+        {
+            m_parts_avail = avail;
+            m_parts_total = total;
+        }
         void set_idbkey(std::uint32_t key)
         {
             m_idbkey = key;
@@ -376,8 +428,8 @@ namespace newsflash
             s = std::string(ptr, len);
         }
 
-        template<typename Value>
-        void write(iterator& it, const Value& val) const
+        template<typename Iterator, typename Value>
+        void write(Iterator& it, const Value& val) const
         {
             // this should be std::is_trivially_copyable (not available in gcc 4.9.2)
             static_assert(std::is_standard_layout<Value>::value, "");
@@ -387,14 +439,16 @@ namespace newsflash
                 *it++ = p[i];
         }
 
-        void write(iterator& it, const str::string_view& str) const
+        template<typename Iterator>
+        void write(Iterator& it, const str::string_view& str) const
         {
             const std::uint16_t len = str.size();
             write(it, len);
             std::copy(str.begin(), str.end(), it);
             it += len;
         }
-        void write(iterator& it, const std::string& str) const
+        template<typename Iterator>
+        void write(Iterator& it, const std::string& str) const
         {
             const std::uint16_t len = str.size();
             write(it, len);
@@ -425,7 +479,63 @@ namespace newsflash
     };
 
     template<typename T>
-    const std::uint32_t article<T>::MAGIC = 0xc0febabe;
+    const std::uint32_t article<T>::MAGIC = ARTICLE_MAGIC;
+
+    // check whether there's a complete article record at the offset
+    // in the storage without loading the article. returns the size of
+    // the record on the disk or 0 if the record is not complete (for example
+    // when the write was torn by a crash). the slot index and the publishing 
+    // date of the article are returned in index and pubdate.
+    template<typename Storage>
+    std::size_t scan_article(Storage& storage, std::size_t offset, std::uint32_t& index, std::time_t& pubdate)
+    {
+        // see article::save for the layout.
+        const std::size_t index_pos   = 0;
+        const std::size_t pubdate_pos = 4 + 4 + 4 + 2 + 2 + 8;
+        const std::size_t subject_pos = pubdate_pos + sizeof(std::time_t) + 1 + 1;
+
+        const auto size = storage.size();
+        if (offset >= size)
+            return 0;
+
+        const auto avail = size - offset;
+        auto buffer = storage.load(offset, std::min<std::size_t>(avail, 1024), Storage::buf_read);
+        const auto* base = (const char*)buffer.address();
+
+        const auto read_len = [&](std::size_t pos) {
+            std::uint16_t len;
+            std::memcpy(&len, base + pos, sizeof(len));
+            return std::size_t(len);
+        };
+
+        if (subject_pos + 2 > buffer.length())
+            return 0;
+        const auto author_pos = subject_pos + 2 + read_len(subject_pos);
+        if (author_pos + 2 > avail)
+            return 0;
+        if (author_pos + 2 > buffer.length())
+        {
+            buffer = storage.load(offset, author_pos + 2, Storage::buf_read);
+            base   = (const char*)buffer.address();
+        }
+        const auto length = author_pos + 2 + read_len(author_pos) + sizeof(ARTICLE_MAGIC);
+        if (length > avail)
+            return 0;
+        if (length > buffer.length())
+        {
+            buffer = storage.load(offset, length, Storage::buf_read);
+            base   = (const char*)buffer.address();
+        }
+
+        std::uint32_t magic;
+        std::memcpy(&magic, base + length - sizeof(magic), sizeof(magic));
+        if (magic != ARTICLE_MAGIC)
+            return 0;
+
+        std::memcpy(&index, base + index_pos, sizeof(index));
+        std::memcpy(&pubdate, base + pubdate_pos, sizeof(pubdate));
+        return length;
+    }
 
 
     // we can optimize article object for a specific storage type.
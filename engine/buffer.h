@@ -21,10 +21,10 @@
 
 #include <newsflash/config.h>
 #include <stdexcept>
-#include <vector>
 #include <cstdint>
 #include <cassert>
 #include <cstring>
+#include "bufferpool.h"
 #include "utility.h"
 
 namespace newsflash
@@ -44,11 +44,11 @@ namespace newsflash
 
         using u8 = char;
 
-        buffer(std::size_t initial_capacity) : size_(0), content_start_(0), content_length_(0),
+        // the buffer storage comes from the bufferpool and is not
+        // initialized. the capacity may be rounded up by the pool.
+        buffer(std::size_t initial_capacity) : buffer_(initial_capacity), size_(0), content_start_(0), content_length_(0),
             content_type_(type::none), content_status_(status::none)
-        {
-            buffer_.resize(initial_capacity);
-        }
+        {}
 
         buffer() : size_(0), content_start_(0), content_length_(0),
             content_type_(type::none), content_status_(status::none)
@@ -62,8 +62,10 @@ namespace newsflash
             content_type_   = other.content_type_;
             content_status_ = other.content_status_;
         }
-        buffer(const buffer& other) : buffer_(other.buffer_)
+        buffer(const buffer& other) : buffer_(other.buffer_.size())
         {
+            if (other.size_)
+                std::memcpy(buffer_.data(), other.buffer_.data(), other.size_);
             size_ = other.size_;
             content_start_  = other.content_start_;
             content_length_ = other.content_length_;
@@ -73,15 +75,15 @@ namespace newsflash
 
         // return content pointer to the start of the body/payload data
         const u8* content() const
-        { return &buffer_[content_start_]; }
+        { return buffer_.data() + content_start_; }
 
         // return head pointer to the start of the whole buffer
         const u8* head() const
-        { return &buffer_[0]; }
+        { return buffer_.data(); }
 
         // return back pointer for writing data 
         u8* back() 
-        { return &buffer_[size_]; }
+        { return buffer_.data() + size_; }
 
         // after writing to the back() pointer, commit the number
         // of bytes written
@@ -105,10 +107,10 @@ namespace newsflash
 
         void allocate(std::size_t capacity)
         {
-            if (capacity < buffer_.size())
+            if (capacity <= buffer_.size())
                 return;
 
-            buffer_.resize(capacity);
+            buffer_.grow(capacity, size_);
         }
 
         void clear()
@@ -126,13 +128,13 @@ namespace newsflash
             //const auto bytes_to_copy = point;
             const auto bytes_to_move = size_ - point;
 
-            std::memmove(&buffer_[0], &buffer_[point], bytes_to_move);
+            std::memmove(buffer_.data(), buffer_.data() + point, bytes_to_move);
             size_ = bytes_to_move;
             return;
         }
 
         // split the buffer into two buffers at the specified splitpoint.
-        // the size, capacity and the contents of the split buffer are those
+        // the size and the contents of the split buffer are those
         // of this buffer from 0 to splitpoint.
         // after the split the contents of this buffer are shifted to 0 
         // and current size is decreased by splitpoint bytes.
@@ -143,10 +145,28 @@ namespace newsflash
             const auto bytes_to_copy = splitpoint;
             const auto bytes_to_move = size_ - splitpoint;
 
+            // if most of the data goes into the split buffer (such as
+            // when a whole article body has been received) the split buffer
+            // takes over the storage and only the remaining bytes are
+            // copied into new storage of the same capacity.
+            if (bytes_to_move < bytes_to_copy)
+            {
+                buffer ret;
+                ret.buffer_.swap(buffer_);
+                ret.size_ = bytes_to_copy;
+
+                buffer_ = block(ret.buffer_.size());
+                if (bytes_to_move)
+                    std::memcpy(buffer_.data(), ret.buffer_.data() + splitpoint, bytes_to_move);
+                size_ = bytes_to_move;
+                return ret;
+            }
+
             buffer ret(bytes_to_copy);
 
-            std::memcpy(&ret.buffer_[0],&buffer_[0], bytes_to_copy);
-            std::memmove(&buffer_[0], &buffer_[splitpoint], bytes_to_move);
+            if (bytes_to_copy)
+                std::memcpy(ret.buffer_.data(), buffer_.data(), bytes_to_copy);
+            std::memmove(buffer_.data(), buffer_.data() + splitpoint, bytes_to_move);
 
             ret.size_ = bytes_to_copy;
             size_ = bytes_to_move;
@@ -220,7 +240,9 @@ namespace newsflash
             if (this == &other)
                 return *this;
 
-            buffer_ = other.buffer_;
+            buffer_ = block(other.buffer_.size());
+            if (other.size_)
+                std::memcpy(buffer_.data(), other.buffer_.data(), other.size_);
             size_   = other.size_;
             content_start_  = other.content_start_;
             content_length_ = other.content_length_;
@@ -230,7 +252,7 @@ namespace newsflash
         }
 
     private:
-        std::vector<u8> buffer_;
+        block buffer_;
         std::size_t size_;
         std::size_t content_start_;
         std::size_t content_length_;
@@ -0,0 +1,257 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/thread/tss.hpp>
+#include <newsflash/warnpop.h>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#include "bufferpool.h"
+
+namespace {
+
+// the size classes cover the typical yEnc encoded and decoded article
+// sizes, the receive buffers and the larger listing/overview buffers.
+const std::size_t size_classes[] = {
+    384 * 1024,
+    512 * 1024,
+    640 * 1024,
+    800 * 1024,
+    1024 * 1024,
+    2048 * 1024,
+    4096 * 1024
+};
+
+const std::size_t num_classes = sizeof(size_classes) / sizeof(size_classes[0]);
+
+// allocations smaller than this are not worth pooling.
+const std::size_t min_pooled_size = 64 * 1024;
+
+// number of blocks per class a thread keeps to itself before
+// returning them to the global free list.
+const std::size_t max_thread_blocks = 2;
+
+// number of bytes per class kept in the global free list before
+// the blocks are given back to the system.
+const std::size_t max_global_bytes = 32 * 1024 * 1024;
+
+std::size_t find_class(std::size_t size)
+{
+    for (std::size_t i=0; i<num_classes; ++i)
+    {
+        if (size <= size_classes[i])
+            return i;
+    }
+    return num_classes;
+}
+
+std::atomic<std::uint64_t> g_hits;
+std::atomic<std::uint64_t> g_misses;
+std::atomic<std::uint64_t> g_resident;
+std::atomic<std::uint64_t> g_peak;
+
+void* system_allocate(std::size_t size)
+{
+    void* ptr = std::malloc(size);
+    if (ptr == nullptr)
+        throw std::bad_alloc();
+
+    const auto resident = (g_resident += size);
+    auto peak = g_peak.load();
+    while (resident > peak && !g_peak.compare_exchange_weak(peak, resident))
+        ;
+
+    ++g_misses;
+    return ptr;
+}
+
+void system_free(void* ptr, std::size_t size)
+{
+    std::free(ptr);
+    g_resident -= size;
+}
+
+struct global_list {
+    std::mutex mutex;
+    std::vector<void*> blocks[num_classes];
+};
+
+// the global list is never destroyed since the thread caches
+// may still return blocks to it while the process is exiting.
+global_list& get_global_list()
+{
+    static global_list* list = new global_list;
+    return *list;
+}
+
+void global_push(std::size_t index, void* ptr)
+{
+    auto& global = get_global_list();
+    {
+        std::lock_guard<std::mutex> lock(global.mutex);
+        auto& list = global.blocks[index];
+        if (list.size() * size_classes[index] < max_global_bytes)
+        {
+            list.push_back(ptr);
+            return;
+        }
+    }
+    system_free(ptr, size_classes[index]);
+}
+
+void* global_pop(std::size_t index)
+{
+    auto& global = get_global_list();
+
+    std::lock_guard<std::mutex> lock(global.mutex);
+    auto& list = global.blocks[index];
+    if (list.empty())
+        return nullptr;
+
+    void* ptr = list.back();
+    list.pop_back();
+    return ptr;
+}
+
+struct thread_cache {
+    std::vector<void*> blocks[num_classes];
+
+   ~thread_cache()
+    {
+        for (std::size_t i=0; i<num_classes; ++i)
+        {
+            for (void* ptr : blocks[i])
+                global_push(i, ptr);
+        }
+    }
+};
+
+// the blocks are returned to the global list when the thread exits.
+// like the global list this is never destroyed so that buffers freed
+// during the static destruction still have somewhere to go.
+thread_cache& get_thread_cache()
+{
+    static boost::thread_specific_ptr<thread_cache>* tss =
+        new boost::thread_specific_ptr<thread_cache>;
+    if (!tss->get())
+        tss->reset(new thread_cache);
+    return *tss->get();
+}
+
+} // namespace
+
+namespace newsflash
+{
+namespace bufferpool
+{
+
+void* allocate(std::size_t size, std::size_t& capacity)
+{
+    if (size < min_pooled_size)
+    {
+        capacity = size;
+        void* ptr = std::malloc(size);
+        if (ptr == nullptr)
+            throw std::bad_alloc();
+        return ptr;
+    }
+
+    const auto index = find_class(size);
+    if (index == num_classes)
+    {
+        capacity = size;
+        return system_allocate(size);
+    }
+    capacity = size_classes[index];
+
+    auto& cache = get_thread_cache();
+    auto& list  = cache.blocks[index];
+    if (!list.empty())
+    {
+        void* ptr = list.back();
+        list.pop_back();
+        ++g_hits;
+        return ptr;
+    }
+
+    void* ptr = global_pop(index);
+    if (ptr)
+    {
+        ++g_hits;
+        return ptr;
+    }
+    return system_allocate(capacity);
+}
+
+void deallocate(void* ptr, std::size_t capacity)
+{
+    if (capacity < min_pooled_size)
+    {
+        std::free(ptr);
+        return;
+    }
+
+    const auto index = find_class(capacity);
+    if (index == num_classes)
+    {
+        system_free(ptr, capacity);
+        return;
+    }
+
+    auto& cache = get_thread_cache();
+    auto& list  = cache.blocks[index];
+    if (list.size() < max_thread_blocks)
+    {
+        list.push_back(ptr);
+        return;
+    }
+    global_push(index, ptr);
+}
+
+stats get_stats()
+{
+    stats ret;
+    ret.hits   = g_hits;
+    ret.misses = g_misses;
+    ret.resident_bytes = g_resident;
+    ret.peak_resident_bytes = g_peak;
+    return ret;
+}
+
+} // bufferpool
+
+void block::grow(std::size_t size, std::size_t keep)
+{
+    if (size <= size_)
+        return;
+
+    block next(size);
+    if (keep)
+        std::memcpy(next.data_, data_, keep);
+    swap(next);
+}
+
+} // newsflash
@@ -0,0 +1,127 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+
+namespace newsflash
+{
+    // pool of large memory blocks for the NNTP data buffers.
+    // the allocations are rounded up to a size class and the freed
+    // blocks are cached first in a per thread cache and then in a global
+    // free list from where any thread can pick them up again.
+    // this way a block allocated by a connection thread and freed
+    // by a decoding thread finds its way back to the connection thread.
+    // small allocations are not pooled.
+    namespace bufferpool
+    {
+        struct stats {
+            // number of allocations served from the cached blocks.
+            std::uint64_t hits;
+            // number of allocations that went to the system allocator.
+            std::uint64_t misses;
+            // bytes currently allocated from the system
+            // including the blocks cached in the pool.
+            std::uint64_t resident_bytes;
+            // the highest value of resident_bytes so far.
+            std::uint64_t peak_resident_bytes;
+        };
+
+        // allocate a block of at least size bytes. the memory is not
+        // initialized. the actual size of the block is stored in capacity
+        // and must be passed to deallocate when the block is freed.
+        void* allocate(std::size_t size, std::size_t& capacity);
+
+        // return a block back to the pool.
+        void deallocate(void* ptr, std::size_t capacity);
+
+        // get the current pool statistics.
+        stats get_stats();
+
+    } // bufferpool
+
+    // a block of memory allocated from the bufferpool.
+    // the block is returned to the pool when the object is destroyed.
+    class block
+    {
+    public:
+        block() : data_(nullptr), size_(0)
+        {}
+
+        explicit
+        block(std::size_t size) : data_(nullptr), size_(0)
+        {
+            if (size)
+                data_ = static_cast<char*>(bufferpool::allocate(size, size_));
+        }
+
+        block(block&& other) : data_(other.data_), size_(other.size_)
+        {
+            other.data_ = nullptr;
+            other.size_ = 0;
+        }
+
+       ~block()
+        {
+            if (data_)
+                bufferpool::deallocate(data_, size_);
+        }
+
+        block& operator=(block&& other)
+        {
+            block tmp(std::move(*this));
+            swap(other);
+            return *this;
+        }
+
+        // grow the block to at least size bytes keeping the
+        // first keep bytes of the current contents.
+        void grow(std::size_t size, std::size_t keep);
+
+        void swap(block& other)
+        {
+            std::swap(data_, other.data_);
+            std::swap(size_, other.size_);
+        }
+
+        char* data()
+        { return data_; }
+
+        const char* data() const
+        { return data_; }
+
+        // the size (capacity) of the block.
+        std::size_t size() const
+        { return size_; }
+
+    private:
+        block(const block&) = delete;
+        block& operator=(const block&) = delete;
+
+    private:
+        char* data_;
+        std::size_t size_;
+    };
+
+} // newsflash
@@ -22,11 +22,13 @@
 
 #include <newsflash/config.h>
 #include <algorithm>
+#include <vector>
 #include <iterator>
 #include <stdexcept>
 #include <limits>
 #include <string>
 #include <cstdint>
+#include <cstddef>
 #include <cassert>
 #include <cstring>
 #include <ctime>
@@ -135,6 +137,7 @@ namespace newsflash
             header_.last    = std::numeric_limits<std::time_t>::min();
             header_.first   = std::numeric_limits<std::time_t>::max();
             std::memset(header_.table, 0, sizeof(header_.table));            
+            reset();
         }
 
         // open existing catalog for reading and writing
@@ -142,6 +145,7 @@ namespace newsflash
         void open(std::string file)
         {
             Storage::open(file);
+            reset();
             if (Storage::size())
             {
                 const auto buff = Storage::load(0, sizeof(header_),Storage::buf_read);
@@ -149,9 +153,22 @@ namespace newsflash
 
                 if (header_.cookie != MAGIC)
                     throw std::runtime_error("incorrect catalog header");
-                if (header_.version != VERSION)
+                if (header_.version != VERSION && header_.version != 2)
                     throw std::runtime_error("incorrect catalog version");
+
+                // version 2 has no log, the whole header was written
+                // every time the data was written. 
+                if (header_.version == VERSION)
+                    replay();
+
+                disk_version_ = header_.version;
             }
+            else
+            {
+                // new file, the whole table needs to be written.
+                std::fill(dirty_.begin(), dirty_.end(), true);
+            }
+            written_ = header_.offset;
         }
 
         iterator begin(offset_t offset) 
@@ -176,6 +193,8 @@ namespace newsflash
             ASSERT(offset.value < header_.offset);
 
             const auto off = offset.value + sizeof(header_);
+            if (off >= written_)
+                return *find_pending(off);
 
             article<Storage> a;
             a.load(off, *this);
@@ -188,6 +207,8 @@ namespace newsflash
             ASSERT(index.value < CATALOG_SIZE);
 
             const auto off = header_.table[index.value];
+            if (off >= written_)
+                return *find_pending(off);
 
             article<Storage> a;
             a.load(off, *this);
@@ -198,17 +219,9 @@ namespace newsflash
         void append(const article<Storage>& a)
         {            
             ASSERT(header_.size < CATALOG_SIZE);
+            ASSERT(header_.table[header_.size] == 0);
 
-            const auto off = header_.offset;
-            const auto idx = header_.size;
-
-            a.save(off, *this);
-
-            header_.table[idx] = off;
-            header_.size++;
-            header_.offset += a.size_on_disk();
-            header_.first = std::min(a.pubdate(), header_.first);
-            header_.last  = std::max(a.pubdate(), header_.last);
+            append_pending(a, header_.size);
         }
 
         // insert article at the specified index.
@@ -217,13 +230,7 @@ namespace newsflash
             ASSERT(i.value < CATALOG_SIZE);
             ASSERT(header_.table[i.value] == 0);
 
-            a.save(header_.offset, *this);
-            
-            header_.table[i.value] = header_.offset;
-            header_.offset += a.size_on_disk();
-            header_.size++;
-            header_.first = std::min(a.pubdate(), header_.first);
-            header_.last  = std::max(a.pubdate(), header_.last);            
+            append_pending(a, i.value);
             assert(header_.size < CATALOG_SIZE);
         }
 
@@ -232,16 +239,99 @@ namespace newsflash
         {
             ASSERT(i.value < CATALOG_SIZE);
             ASSERT(header_.table[i.value] != 0);
-            a.save(header_.table[i.value], *this);
+
+            const auto off = header_.table[i.value];
+            if (off >= written_)
+            {
+                auto* p = find_pending(off);
+                ASSERT(p->size_on_disk() == a.size_on_disk());
+                *p = a;
+                p->set_index(i.value);
+                return;
+            }
+            a.save(off, *this);
+        }
+
+        // update the part information of the article at the specified index.
+        // the rest of the article data on the disk is not touched except for 
+        // the broken flag when requested.
+        void update_parts(const article<Storage>& a, index_t i, bool update_broken)
+        {
+            ASSERT(i.value < CATALOG_SIZE);
+            ASSERT(header_.table[i.value] != 0);
+
+            const auto off = header_.table[i.value];
+            if (off >= written_)
+            {
+                auto* p = find_pending(off);
+                p->set_bytes(a.bytes());
+                p->set_idbkey(a.idbkey());
+                p->set_parts(a.num_parts_avail(), a.num_parts_total());
+                if (update_broken)
+                    p->set_bits(fileflag::broken, a.is_broken());
+                return;
+            }
+            a.save_parts(off, *this, update_broken);
         }
 
+        // write the pending articles to the end of the log in one go
+        // and checkpoint the header when enough articles have been 
+        // added to the log since the previous checkpoint.
         void flush()
         {
-            auto buff = Storage::load(0, sizeof(header_), Storage::buf_write);
-            auto beg  = (const typename Storage::byte*)&header_;
-            auto end  = beg + sizeof(header_);
-            std::copy(beg, end, buff.begin());
+            write_pending();
+
+            if (disk_version_ != VERSION || log_size_ >= CHECKPOINT_INTERVAL)
+                checkpoint();
+        }
+
+        // write the pending articles and the header to the disk. 
+        // after a checkpoint the log is empty.
+        void checkpoint()
+        {
+            write_pending();
+
+            // the articles must be on the disk before the table refers to them,
+            // and the table must be there before the head moves the start of
+            // the log past the articles. if we crash in between the old head
+            // is still there and the log is replayed over the table.
+            Storage::sync();
+
+            const auto table_start = offsetof(header, table);
+            const auto entry_size  = sizeof(header_.table[0]);
+
+            for (std::size_t page=0; page<dirty_.size(); )
+            {
+                if (!dirty_[page])
+                {
+                    ++page;
+                    continue;
+                }
+                // coalesce the consecutive dirty pages into one write.
+                const auto first = page;
+                while (page < dirty_.size() && dirty_[page])
+                    dirty_[page++] = false;
+
+                const auto first_entry = first * TABLE_PAGE_SIZE;
+                const auto last_entry  = std::min<std::size_t>(page * TABLE_PAGE_SIZE, CATALOG_SIZE);
+                const auto bytes = (last_entry - first_entry) * entry_size;
+
+                auto buff = Storage::load(table_start + first_entry * entry_size, bytes, Storage::buf_write);
+                const auto beg = (const typename Storage::byte*)&header_.table[first_entry];
+                std::copy(beg, beg + bytes, buff.begin());
+                buff.flush();
+            }
+            Storage::sync();
+
+            header_.version = VERSION;
+
+            auto buff = Storage::load(0, table_start, Storage::buf_write);
+            const auto beg = (const typename Storage::byte*)&header_;
+            std::copy(beg, beg + table_start, buff.begin());
             buff.flush();
+
+            disk_version_ = VERSION;
+            log_size_ = 0;
         }
 
         std::uint32_t size() const 
@@ -265,9 +355,113 @@ namespace newsflash
             return header_.table[i.value] == 0;
         }
 
+    private:
+        void reset()
+        {
+            pending_.clear();
+            pending_offsets_.clear();
+            dirty_.assign((CATALOG_SIZE + TABLE_PAGE_SIZE - 1) / TABLE_PAGE_SIZE, false);
+            disk_version_ = 0;
+            log_size_     = 0;
+            written_      = header_.offset;
+            truncated_    = false;
+        }
+
+        // the articles that have been added after the last checkpoint
+        // are in the log following the checkpointed data. each article
+        // knows its slot so the table can be rebuilt from the log. 
+        // an incomplete article ends the log. if we crashed after the
+        // table was written but before the head was the slots already
+        // refer to the articles in the log.
+        void replay()
+        {
+            const auto end = Storage::size();
+            auto offset = std::size_t(header_.offset);
+            while (offset < end)
+            {
+                std::uint32_t index;
+                std::time_t pubdate;
+                const auto length = scan_article<Storage>(*this, offset, index, pubdate);
+                if (length == 0)
+                    break;
+                if (index >= CATALOG_SIZE)
+                    break;
+                if (header_.table[index] && header_.table[index] != offset)
+                    break;
+
+                header_.table[index] = offset;
+                header_.size++;
+                header_.first = std::min(pubdate, header_.first);
+                header_.last  = std::max(pubdate, header_.last);
+                dirty_[index / TABLE_PAGE_SIZE] = true;
+                offset += length;
+                log_size_++;
+            }
+            header_.offset = offset;
+        }
+
+        void append_pending(const article<Storage>& a, std::size_t index)
+        {
+            const auto off = header_.offset;
+
+            pending_.push_back(a);
+            pending_.back().set_index(index);
+            pending_offsets_.push_back(off);
+
+            header_.table[index] = off;
+            header_.offset += a.size_on_disk();
+            header_.size++;
+            header_.first = std::min(a.pubdate(), header_.first);
+            header_.last  = std::max(a.pubdate(), header_.last);
+            dirty_[index / TABLE_PAGE_SIZE] = true;
+            log_size_++;
+        }
+
+        article<Storage>* find_pending(std::size_t offset)
+        {
+            auto it = std::lower_bound(pending_offsets_.begin(), pending_offsets_.end(), offset);
+            ASSERT(it != pending_offsets_.end() && *it == offset);
+            return &pending_[it - pending_offsets_.begin()];
+        }
+
+        void write_pending()
+        {
+            // whatever is in the file after the last complete article 
+            // is the remains of a torn write. get rid of it so that it 
+            // doesn't get mixed up with the new articles.
+            if (!truncated_)
+            {
+                if (Storage::size() > written_)
+                    Storage::resize(written_);
+                truncated_ = true;
+            }
+            if (pending_.empty())
+                return;
+
+            const auto bytes = header_.offset - written_;
+            auto buff = Storage::load(written_, bytes, Storage::buf_write);
+            auto out  = buff.begin();
+            for (const auto& a : pending_)
+                a.save(out);
+            buff.flush();
+
+            written_ = header_.offset;
+            pending_.clear();
+            pending_offsets_.clear();
+        }
+
     private:
         static const std::uint32_t MAGIC   {0xdeadbabe};
-        static const std::uint32_t VERSION {2};
+
+        // version 3 appends the articles to a log and only 
+        // checkpoints the header (with the slot table) every now and then.
+        static const std::uint32_t VERSION {3};
+
+        // the number of articles in the log before a checkpoint.
+        static const std::size_t CHECKPOINT_INTERVAL = 10000;
+
+        // the slot table is written in pages of this many entries.
+        static const std::size_t TABLE_PAGE_SIZE = 1024;
 
         struct header {
             std::uint32_t cookie;
@@ -279,5 +473,23 @@ namespace newsflash
             std::uint32_t table[CATALOG_SIZE];
         };
         header header_;
+
+        // the articles that are not yet written and their offsets.
+        std::vector<article<Storage>> pending_;
+        std::vector<std::size_t> pending_offsets_;
+
+        // table pages that have changed since the last checkpoint.
+        std::vector<bool> dirty_;
+
+        // the version of the header on the disk.
+        std::uint32_t disk_version_;
+
+        // the number of articles in the log.
+        std::size_t log_size_;
+
+        // the end of the data that is written to the file.
+        std::size_t written_;
+
+        bool truncated_;
     };
 } // newsflash
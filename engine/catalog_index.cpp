@@ -0,0 +1,195 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <stdexcept>
+#include <fstream>
+#include <cassert>
+#include "catalog_index.h"
+#include "bigfile.h"
+#include "utf8.h"
+
+namespace {
+    const std::uint32_t MAGIC   = 0xbabe1dec;
+    const std::uint32_t VERSION = 2;
+
+    struct header {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t volume_size;
+        std::uint32_t num_entries;
+        std::uint64_t volume_bytes;
+    };
+
+    // keep the load factor under 3/4 so that the probe sequences stay short.
+    bool is_full(std::size_t size, std::size_t capacity)
+    {
+        return (size + 1) * 4 > capacity * 3;
+    }
+
+} // namespace
+
+namespace newsflash
+{
+
+catalog_index::catalog_index() : size_(0)
+{}
+
+catalog_index::entry* catalog_index::find(std::uint64_t fingerprint)
+{
+    assert(fingerprint);
+
+    if (table_.empty())
+        return nullptr;
+
+    const auto mask = table_.size() - 1;
+    for (auto i = fingerprint & mask; ; i = (i + 1) & mask)
+    {
+        auto& e = table_[i];
+        if (e.fingerprint == fingerprint)
+            return &e;
+        if (e.fingerprint == 0)
+            return nullptr;
+    }
+    return nullptr;
+}
+
+catalog_index::entry& catalog_index::insert(std::uint64_t fingerprint)
+{
+    assert(fingerprint);
+    assert(find(fingerprint) == nullptr);
+
+    if (is_full(size_, table_.size()))
+        grow();
+
+    const auto mask = table_.size() - 1;
+    auto i = fingerprint & mask;
+    while (table_[i].fingerprint)
+        i = (i + 1) & mask;
+
+    auto& e = table_[i];
+    e = entry {};
+    e.fingerprint = fingerprint;
+    ++size_;
+    return e;
+}
+
+bool catalog_index::load(const std::string& file, std::uint32_t volume_size, std::uint64_t volume_bytes)
+{
+    clear();
+
+#if defined(LINUX_OS)
+    std::ifstream in(file, std::ios::in | std::ios::binary);
+#elif defined(WINDOWS_OS)
+    std::ifstream in(utf8::decode(file), std::ios::in | std::ios::binary);
+#endif
+    if (!in.is_open())
+        return false;
+
+    header head = {};
+    in.read((char*)&head, sizeof(head));
+
+    bool valid = in.good() &&
+        head.magic == MAGIC &&
+        head.version == VERSION &&
+        head.volume_size == volume_size &&
+        head.volume_bytes == volume_bytes;
+
+    if (valid)
+    {
+        std::vector<entry> entries(head.num_entries);
+        if (head.num_entries)
+            in.read((char*)&entries[0], entries.size() * sizeof(entry));
+        valid = in.good();
+        if (valid)
+        {
+            for (const auto& e : entries)
+            {
+                if (e.fingerprint == 0 || find(e.fingerprint))
+                {
+                    valid = false;
+                    break;
+                }
+                insert(e.fingerprint) = e;
+            }
+        }
+    }
+    in.close();
+
+    // once the volume has been modified the index on the disk is stale,
+    // and it's only written back on commit. if we crash in between the
+    // stale index must not be used.
+    bigfile::erase(file);
+
+    if (!valid)
+        clear();
+    return valid;
+}
+
+void catalog_index::save(const std::string& file, std::uint32_t volume_size, std::uint64_t volume_bytes) const
+{
+#if defined(LINUX_OS)
+    std::ofstream out(file, std::ios::out | std::ios::binary | std::ios::trunc);
+#elif defined(WINDOWS_OS)
+    std::ofstream out(utf8::decode(file), std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+    if (!out.is_open())
+        throw std::runtime_error("unable to open: " + file);
+
+    header head;
+    head.magic        = MAGIC;
+    head.version      = VERSION;
+    head.volume_size  = volume_size;
+    head.num_entries  = std::uint32_t(size_);
+    head.volume_bytes = volume_bytes;
+    out.write((const char*)&head, sizeof(head));
+
+    // only the used entries are written, the table is rebuilt on load.
+    for (const auto& e : table_)
+    {
+        if (e.fingerprint)
+            out.write((const char*)&e, sizeof(e));
+    }
+    out.close();
+    if (out.fail())
+        throw std::runtime_error("failed to write: " + file);
+}
+
+void catalog_index::clear()
+{
+    table_.clear();
+    size_ = 0;
+}
+
+void catalog_index::grow()
+{
+    std::vector<entry> old;
+    old.swap(table_);
+    table_.resize(old.empty() ? 1024 : old.size() * 2, entry {});
+    size_ = 0;
+
+    for (const auto& e : old)
+    {
+        if (e.fingerprint)
+            insert(e.fingerprint) = e;
+    }
+}
+
+} // newsflash
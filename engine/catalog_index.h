@@ -0,0 +1,89 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <vector>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace newsflash
+{
+    // resident index of the articles stored in a catalog volume.
+    // maps the fingerprint of the subject line (without the part count)
+    // to the catalog slot of the article together with the part bookkeeping
+    // that is needed to combine a new part into the article. 
+    // this lets update combine the parts without reading the stored articles
+    // back from the disk.
+    //
+    // the index is saved next to the volume and it's only trusted when it
+    // agrees with the article count and the data size of the volume. 
+    class catalog_index
+    {
+    public:
+        struct entry {
+            std::uint64_t fingerprint;
+            std::uint64_t number;
+            std::uint32_t hash;
+            std::uint32_t slot;
+            std::uint32_t bytes;
+            std::uint32_t idbkey;
+            std::uint16_t parts_avail;
+            std::uint16_t parts_total;
+            // the row of the article in the volume columns.
+            std::uint32_t row;
+        };
+
+        catalog_index();
+
+        // find the entry with the given fingerprint. returns nullptr 
+        // if there's no such entry.
+        entry* find(std::uint64_t fingerprint);
+
+        // insert a new entry for the given fingerprint. 
+        // the fingerprint must not be in the index already.
+        entry& insert(std::uint64_t fingerprint);
+
+        // load the index from the file. returns false if the file
+        // doesn't exist or doesn't match the volume (given by the article
+        // count and the data size) in which case the index is left empty.
+        // the file is removed after loading since it's no longer valid once 
+        // the volume gets modified. call save to write it back.
+        bool load(const std::string& file, std::uint32_t volume_size, std::uint64_t volume_bytes);
+
+        // save the index to the file.
+        void save(const std::string& file, std::uint32_t volume_size, std::uint64_t volume_bytes) const;
+
+        void clear();
+
+        std::size_t size() const
+        { return size_; }
+
+    private:
+        void grow();
+
+    private:
+        std::vector<entry> table_;
+        std::size_t size_;
+    };
+
+} // newsflash
@@ -0,0 +1,464 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <map>
+#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include "stringlib/string_view.h"
+#include "bitflag.h"
+#include "filetype.h"
+#include "catalog.h"
+
+namespace newsflash
+{
+    // the columns of a catalog volume are stored in a sidecar file next
+    // to the volume. the file has a fixed width array for each column
+    // with a row for every article in the volume in the order the articles
+    // were added to the volume, followed by a heap for the strings.
+    // the arrays don't depend on the length of the strings so they can
+    // be mapped and addressed directly.
+    enum {
+        COLUMN_PAGE_SIZE   = 4096,
+        COLUMN_SLOT        = 16,
+        COLUMN_PUBDATE     = COLUMN_SLOT        + 4 * CATALOG_SIZE,
+        COLUMN_BYTES       = COLUMN_PUBDATE     + 8 * CATALOG_SIZE,
+        COLUMN_PARTS_AVAIL = COLUMN_BYTES       + 4 * CATALOG_SIZE,
+        COLUMN_PARTS_TOTAL = COLUMN_PARTS_AVAIL + 2 * CATALOG_SIZE,
+        COLUMN_SUBJECT     = COLUMN_PARTS_TOTAL + 2 * CATALOG_SIZE,
+        COLUMN_AUTHOR      = COLUMN_SUBJECT     + 4 * CATALOG_SIZE,
+        COLUMN_BITS        = COLUMN_AUTHOR      + 4 * CATALOG_SIZE,
+        COLUMN_TYPE        = COLUMN_BITS        + 1 * CATALOG_SIZE,
+        COLUMN_END         = COLUMN_TYPE        + 1 * CATALOG_SIZE,
+        // the heap starts on a page of its own.
+        COLUMN_HEAP        = (COLUMN_END + COLUMN_PAGE_SIZE - 1) / COLUMN_PAGE_SIZE * COLUMN_PAGE_SIZE
+    };
+
+    struct column_header {
+        std::uint32_t cookie;
+        std::uint32_t version;
+        // the number of rows in the columns.
+        std::uint32_t rows;
+        // the end of the string heap.
+        std::uint32_t heap;
+    };
+
+    static_assert(sizeof(column_header) == COLUMN_SLOT, "");
+
+    // read access to the columns of a volume when the file is mapped
+    // into memory. the article data can be sorted and filtered without
+    // loading the articles from the catalog.
+    class column_view
+    {
+    public:
+        static const std::uint32_t MAGIC   = 0xc01face5;
+        static const std::uint32_t VERSION = 1;
+
+        column_view() : base_(nullptr), size_(0), rows_(0)
+        {}
+
+        // create a view to the column data at base. if the data is 
+        // not valid the view has no rows.
+        column_view(void* base, std::size_t size) : base_((unsigned char*)base), size_(size), rows_(0)
+        {
+            if (size_ < COLUMN_HEAP)
+                return;
+
+            column_header header;
+            std::memcpy(&header, base_, sizeof(header));
+            if (header.cookie != MAGIC || header.version != VERSION)
+                return;
+            if (header.heap > size_)
+                return;
+            rows_ = header.rows;
+        }
+
+        // the number of rows in the columns.
+        std::uint32_t rows() const
+        { return rows_; }
+
+        // the catalog index of the article on the row.
+        std::uint32_t slot(std::size_t row) const
+        { return column<std::uint32_t>(COLUMN_SLOT)[row]; }
+
+        std::time_t pubdate(std::size_t row) const
+        { return (std::time_t)column<std::int64_t>(COLUMN_PUBDATE)[row]; }
+
+        std::uint32_t bytes(std::size_t row) const
+        { return column<std::uint32_t>(COLUMN_BYTES)[row]; }
+
+        std::uint16_t num_parts_avail(std::size_t row) const
+        { return column<std::uint16_t>(COLUMN_PARTS_AVAIL)[row]; }
+
+        std::uint16_t num_parts_total(std::size_t row) const
+        { return column<std::uint16_t>(COLUMN_PARTS_TOTAL)[row]; }
+
+        bitflag<fileflag, std::uint8_t> bits(std::size_t row) const
+        { return bitflag<fileflag, std::uint8_t>(column<std::uint8_t>(COLUMN_BITS)[row]); }
+
+        filetype type(std::size_t row) const
+        { return (filetype)column<std::uint8_t>(COLUMN_TYPE)[row]; }
+
+        bool test(std::size_t row, fileflag flag) const
+        { return bits(row).test(flag); }
+
+        str::string_view subject(std::size_t row) const
+        { return string(column<std::uint32_t>(COLUMN_SUBJECT)[row]); }
+
+        str::string_view author(std::size_t row) const
+        { return string(column<std::uint32_t>(COLUMN_AUTHOR)[row]); }
+
+        // the flags are written straight to the mapped file.
+        void set_bits(std::size_t row, fileflag flag, bool on_off)
+        {
+            auto* p = (std::uint8_t*)(base_ + COLUMN_BITS) + row;
+            bitflag<fileflag, std::uint8_t> bits(*p);
+            bits.set(flag, on_off);
+            *p = bits.value();
+        }
+
+    private:
+        template<typename T>
+        const T* column(std::size_t offset) const
+        { return (const T*)(base_ + offset); }
+
+        str::string_view string(std::uint32_t offset) const
+        {
+            std::uint16_t len;
+            std::memcpy(&len, base_ + offset, sizeof(len));
+            return str::string_view((const char*)base_ + offset + sizeof(len), len);
+        }
+
+    private:
+        unsigned char* base_;
+        std::size_t size_;
+        std::uint32_t rows_;
+    };
+
+    // write the columns of a volume. the changes are collected in 
+    // pages in memory and written out on flush. the flags are the 
+    // exception since they're changed through the mapping by the
+    // readers, so they're kept per row and written byte by byte.
+    template<typename Storage>
+    class columns : public Storage
+    {
+    public:
+        columns()
+        {
+            clear();
+        }
+
+        // open the column file for writing. if the file doesn't 
+        // contain valid columns it's started from scratch.
+        void open(std::string file)
+        {
+            Storage::open(file);
+            clear();
+
+            if (Storage::size() < COLUMN_HEAP)
+                return;
+
+            column_header header;
+            const auto buff = Storage::load(0, sizeof(header), Storage::buf_read);
+            std::memcpy(&header, buff.address(), sizeof(header));
+            if (header.cookie != column_view::MAGIC || header.version != column_view::VERSION)
+                return;
+
+            header_ = header;
+            disk_rows_ = header.rows;
+            disk_heap_ = header.heap;
+        }
+
+        // forget all the rows.
+        void clear()
+        {
+            header_.cookie  = column_view::MAGIC;
+            header_.version = column_view::VERSION;
+            header_.rows    = 0;
+            header_.heap    = COLUMN_HEAP;
+            disk_rows_ = 0;
+            disk_heap_ = COLUMN_HEAP;
+            pages_.clear();
+            bits_.clear();
+            heap_.clear();
+            changed_ = false;
+        }
+
+        // drop the rows after the given number of rows.
+        void truncate(std::uint32_t rows)
+        {
+            ASSERT(rows <= header_.rows);
+            header_.rows = rows;
+            disk_rows_ = std::min(disk_rows_, rows);
+            changed_   = true;
+        }
+
+        std::uint32_t rows() const 
+        { return header_.rows; }
+
+        // add the article to the next row. returns the row.
+        template<typename Article>
+        std::uint32_t append(const Article& a)
+        {
+            ASSERT(header_.rows < CATALOG_SIZE);
+
+            const std::size_t row = header_.rows++;
+            put(COLUMN_SLOT + row * 4, std::uint32_t(a.index()));
+            put(COLUMN_PUBDATE + row * 8, std::int64_t(a.pubdate()));
+            put(COLUMN_BYTES + row * 4, std::uint32_t(a.bytes()));
+            put(COLUMN_PARTS_AVAIL + row * 2, std::uint16_t(a.num_parts_avail()));
+            put(COLUMN_PARTS_TOTAL + row * 2, std::uint16_t(a.num_parts_total()));
+            put(COLUMN_SUBJECT + row * 4, push_string(a.subject().c_str(), a.subject().size()));
+            put(COLUMN_AUTHOR + row * 4, push_string(a.author().c_str(), a.author().size()));
+            put_bits(std::uint32_t(row), a.bits().value(), 0xff);
+            put(COLUMN_TYPE + row, std::uint8_t(a.type()));
+            return std::uint32_t(row);
+        }
+
+        // update the part information on the row. the other flags
+        // than broken are left alone since they might be changed by 
+        // someone else through a mapping to the file.
+        template<typename Article>
+        void update_parts(std::uint32_t row, const Article& a, bool update_broken)
+        {
+            ASSERT(row < header_.rows);
+
+            put(COLUMN_BYTES + row * 4, std::uint32_t(a.bytes()));
+            put(COLUMN_PARTS_AVAIL + row * 2, std::uint16_t(a.num_parts_avail()));
+            put(COLUMN_PARTS_TOTAL + row * 2, std::uint16_t(a.num_parts_total()));
+            if (update_broken)
+            {
+                bitflag<fileflag, std::uint8_t> mask;
+                mask.set(fileflag::broken);
+                put_bits(row, a.bits().value(), mask.value());
+            }
+        }
+
+        // write the changes to the file. the header goes last
+        // so that the rows in the header are always complete.
+        void flush()
+        {
+            if (!changed_)
+                return;
+
+            if (!heap_.empty())
+            {
+                auto buff = Storage::load(disk_heap_, heap_.size(), Storage::buf_write);
+                std::copy(heap_.begin(), heap_.end(), buff.begin());
+                buff.flush();
+                heap_.clear();
+            }
+            write_bits();
+
+            std::memcpy(page(0), &header_, sizeof(header_));
+
+            auto it = pages_.upper_bound(0);
+            while (it != pages_.end())
+            {
+                // coalesce the consecutive pages into one write.
+                auto end = it;
+                std::size_t count = 0;
+                while (end != pages_.end() && end->first == it->first + count)
+                {
+                    ++end;
+                    ++count;
+                }
+                write_pages(it, end, count);
+                it = end;
+            }
+            write_pages(pages_.begin(), pages_.upper_bound(0), 1);
+
+            pages_.clear();
+            disk_rows_ = header_.rows;
+            disk_heap_ = header_.heap;
+            changed_   = false;
+        }
+
+    private:
+        using page_t = std::vector<unsigned char>;
+        using page_iterator = typename std::map<std::size_t, page_t>::iterator;
+
+        // the flag bits of a row and the mask of the bits that are changed.
+        struct bits_t {
+            std::uint8_t value;
+            std::uint8_t mask;
+        };
+
+        template<typename T>
+        void put(std::size_t offset, T value)
+        {
+            // the columns are aligned so that a value never crosses a page.
+            std::memcpy(page(offset), &value, sizeof(value));
+            changed_ = true;
+        }
+
+        void put_bits(std::uint32_t row, std::uint8_t value, std::uint8_t mask)
+        {
+            auto it = bits_.find(row);
+            if (it == bits_.end())
+                it = bits_.insert(std::make_pair(row, bits_t{0, 0})).first;
+
+            auto& bits = it->second;
+            bits.value = (bits.value & ~mask) | (value & mask);
+            bits.mask |= mask;
+            changed_ = true;
+        }
+
+        std::uint32_t push_string(const char* str, std::size_t len)
+        {
+            len = std::min<std::size_t>(len, std::numeric_limits<std::uint16_t>::max());
+
+            const auto offset = header_.heap;
+            const auto len16  = std::uint16_t(len);
+            heap_.insert(heap_.end(), (const unsigned char*)&len16, (const unsigned char*)&len16 + sizeof(len16));
+            heap_.insert(heap_.end(), str, str + len);
+            header_.heap += sizeof(len16) + len;
+            return offset;
+        }
+
+        // get a pointer to the byte at the offset in the fixed size area.
+        unsigned char* page(std::size_t offset)
+        {
+            ASSERT(offset < COLUMN_HEAP);
+            ASSERT(offset < COLUMN_BITS || offset >= COLUMN_TYPE);
+
+            const auto number = offset / COLUMN_PAGE_SIZE;
+            const auto start  = number * COLUMN_PAGE_SIZE;
+
+            auto it = pages_.find(number);
+            if (it == pages_.end())
+            {
+                it = pages_.insert(std::make_pair(number, page_t(COLUMN_PAGE_SIZE, 0))).first;
+                if (has_data(start))
+                {
+                    const auto buff = Storage::load(start, COLUMN_PAGE_SIZE, Storage::buf_read);
+                    std::copy(buff.begin(), buff.end(), it->second.begin());
+                }
+            }
+            return &it->second[offset - start];
+        }
+
+        // check whether the page starting at the offset has any
+        // rows that have been written to the disk. 
+        bool has_data(std::size_t start) const
+        {
+            static const std::size_t columns[][2] = {
+                {COLUMN_SLOT, 4}, {COLUMN_PUBDATE, 8}, {COLUMN_BYTES, 4},
+                {COLUMN_PARTS_AVAIL, 2}, {COLUMN_PARTS_TOTAL, 2},
+                {COLUMN_SUBJECT, 4}, {COLUMN_AUTHOR, 4},
+                {COLUMN_BITS, 1}, {COLUMN_TYPE, 1}, {COLUMN_END, 0}
+            };
+            if (start < COLUMN_SLOT)
+                return disk_heap_ != COLUMN_HEAP || disk_rows_ != 0;
+
+            // the page can cross into the next column.
+            const auto end = start + COLUMN_PAGE_SIZE;
+            for (std::size_t i=0; columns[i][1]; ++i)
+            {
+                const auto col_beg = columns[i][0];
+                const auto col_end = columns[i+1][0];
+                if (end <= col_beg || start >= col_end)
+                    continue;
+                if (start < col_beg + disk_rows_ * columns[i][1])
+                    return true;
+            }
+            return false;
+        }
+
+        void write_pages(page_iterator beg, page_iterator end, std::size_t count)
+        {
+            if (beg == end)
+                return;
+
+            // the pages are never written over the flags since that
+            // would revert the flags changed after the page was read.
+            const std::size_t start = beg->first * COLUMN_PAGE_SIZE;
+            const std::size_t stop  = start + count * COLUMN_PAGE_SIZE;
+
+            page_t data;
+            data.reserve(count * COLUMN_PAGE_SIZE);
+            for (; beg != end; ++beg)
+                data.insert(data.end(), beg->second.begin(), beg->second.end());
+
+            write_range(data, start, start, std::min<std::size_t>(stop, COLUMN_BITS));
+            write_range(data, start, std::max<std::size_t>(start, COLUMN_TYPE), stop);
+        }
+
+        void write_range(const page_t& data, std::size_t start, std::size_t beg, std::size_t end)
+        {
+            if (beg >= end)
+                return;
+            auto buff = Storage::load(beg, end - beg, Storage::buf_write);
+            std::copy(data.begin() + (beg - start), data.begin() + (end - start), buff.begin());
+            buff.flush();
+        }
+
+        // write the flags of the new rows in runs and merge the changes
+        // to the old rows with the flags on the disk one byte at a time
+        // in the same way the catalog updates the flags of an article.
+        void write_bits()
+        {
+            auto it = bits_.begin();
+            while (it != bits_.end())
+            {
+                const auto row = it->first;
+                if (row < disk_rows_)
+                {
+                    auto buff = Storage::load(COLUMN_BITS + row, 1, Storage::buf_read | Storage::buf_write);
+                    auto& byte = *buff.begin();
+                    byte = (byte & ~it->second.mask) | (it->second.value & it->second.mask);
+                    buff.flush();
+                    ++it;
+                    continue;
+                }
+                std::vector<std::uint8_t> run;
+                for (; it != bits_.end() && it->first == row + run.size(); ++it)
+                    run.push_back(it->second.value);
+
+                auto buff = Storage::load(COLUMN_BITS + row, run.size(), Storage::buf_write);
+                std::copy(run.begin(), run.end(), buff.begin());
+                buff.flush();
+            }
+            bits_.clear();
+        }
+
+    private:
+        column_header header_;
+        // the rows and the end of the heap on the disk.
+        std::uint32_t disk_rows_;
+        std::uint32_t disk_heap_;
+        // the changed pages of the fixed size area except the flags.
+        std::map<std::size_t, page_t> pages_;
+        // the changed flags by row.
+        std::map<std::uint32_t, bits_t> bits_;
+        // the strings that are not yet written to the heap.
+        std::vector<unsigned char> heap_;
+        bool changed_;
+    };
+
+} // newsflash
@@ -0,0 +1,125 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <algorithm>
+#include <chrono>
+#include "completion_queue.h"
+#include "action.h"
+
+namespace newsflash
+{
+
+completion_queue::completion_queue() : head_(nullptr), notify_pending_(false), num_notifications_(0),
+    num_actions_(0), total_latency_us_(0), max_latency_us_(0)
+{}
+
+completion_queue::~completion_queue()
+{
+    drain();
+    while (!batch_.empty())
+    {
+        delete batch_.front();
+        batch_.pop();
+    }
+}
+
+bool completion_queue::push(action* a)
+{
+    a->completed_      = std::chrono::steady_clock::now();
+    a->next_completed_ = head_.load(std::memory_order_relaxed);
+    while (!head_.compare_exchange_weak(a->next_completed_, a,
+        std::memory_order_release, std::memory_order_relaxed))
+        ;
+
+    // the flag is raised after the action is visible in the list,
+    // so if the consumer has lowered the flag it will find the action
+    // in the list on the next drain or we notify again.
+    if (notify_pending_.exchange(true))
+        return false;
+
+    num_notifications_++;
+    return true;
+}
+
+std::unique_ptr<action> completion_queue::pop()
+{
+    if (batch_.empty())
+        drain();
+    if (batch_.empty())
+        return nullptr;
+
+    std::unique_ptr<action> next(batch_.front());
+    batch_.pop();
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(now - next->completed_).count();
+    num_actions_++;
+    total_latency_us_ += latency;
+    max_latency_us_    = std::max<std::uint64_t>(max_latency_us_, latency);
+    return next;
+}
+
+bool completion_queue::suspend()
+{
+    if (batch_.empty())
+        return false;
+
+    // the pending notification might be the one that got the consumer
+    // here, so always ask for a new one. until the batch is drained 
+    // the producers have nothing to notify about.
+    notify_pending_.store(true);
+
+    num_notifications_++;
+    return true;
+}
+
+completion_queue::stats completion_queue::get_stats() const
+{
+    stats ret;
+    ret.num_actions       = num_actions_;
+    ret.num_notifications = num_notifications_;
+    ret.total_latency_us  = total_latency_us_;
+    ret.max_latency_us    = max_latency_us_;
+    return ret;
+}
+
+void completion_queue::drain()
+{
+    // lower the flag first, any action pushed after this will
+    // raise it again and request a new notification.
+    notify_pending_.store(false);
+
+    action* list = head_.exchange(nullptr, std::memory_order_acquire);
+
+    // the list is in reverse completion order.
+    action* prev = nullptr;
+    while (list)
+    {
+        action* next = list->next_completed_;
+        list->next_completed_ = prev;
+        prev = list;
+        list = next;
+    }
+    for (; prev; prev = prev->next_completed_)
+        batch_.push(prev);
+}
+
+} // newsflash
@@ -0,0 +1,97 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <atomic>
+#include <memory>
+#include <queue>
+#include <cstdint>
+
+namespace newsflash
+{
+    class action;
+
+    // completion queue for passing the completed actions from the
+    // worker threads (multiple producers) to the engine (single consumer).
+    // pushing an action is lock free and the actions are taken out
+    // in batches so that the consumer doesn't need to synchronize
+    // with the producers for every action. 
+    // the notifications are coalesced so that there's at most 
+    // one pending notification at any time.
+    class completion_queue
+    {
+    public:
+        struct stats {
+            // number of actions handled by the consumer.
+            std::uint64_t num_actions;
+
+            // number of notifications requested by the producers.
+            std::uint64_t num_notifications;
+
+            // the total and maximum time in microseconds from
+            // an action being completed to it being taken out of the queue.
+            std::uint64_t total_latency_us;
+            std::uint64_t max_latency_us;
+        };
+
+        completion_queue();
+       ~completion_queue();
+
+        // push a completed action into the queue. thread safe.
+        // returns true if the consumer should be notified, i.e. there
+        // wasn't a notification pending already.
+        bool push(action* a);
+
+        // take the next completed action. if there are no more actions
+        // in the current batch all the actions completed so far are
+        // taken out of the queue as the new batch. 
+        // returns nullptr when no actions are available.
+        // this may only be called by the single consumer.
+        std::unique_ptr<action> pop();
+
+        // the consumer stops taking actions before the current batch
+        // is done. the producers won't notify about the actions in the
+        // batch so returns true if the consumer should be notified to
+        // come back for them. this may only be called by the consumer.
+        bool suspend();
+
+        // get the queue statistics. this may only be called
+        // by the consumer.
+        stats get_stats() const;
+
+    private:
+        void drain();
+
+    private:
+        // the producers push into a lifo list. 
+        std::atomic<action*> head_;
+        std::atomic<bool> notify_pending_;
+        std::atomic<std::uint64_t> num_notifications_;
+
+        // the consumer's current batch in completion order.
+        std::queue<action*> batch_;
+        std::uint64_t num_actions_;
+        std::uint64_t total_latency_us_;
+        std::uint64_t max_latency_us_;
+    };
+
+} // newsflash
@@ -28,6 +28,8 @@
 #include <cassert>
 #include <atomic>
 #include <map>
+#include <limits>
+#include <algorithm>
 #include "connection.h"
 #include "tcpsocket.h"
 #include "sslsocket.h"
@@ -38,6 +40,7 @@
 #include "event.h"
 #include "socketapi.h"
 #include "throttle.h"
+#include "pipeline_controller.h"
 
 namespace newsflash
 {
@@ -61,6 +64,11 @@ struct connection::state {
     bool compression;
     double bps;
     throttle* pthrottle;
+    pipeline_controller control;
+    // the controller decisions for reading outside the connection.
+    std::atomic<std::size_t> depth;
+    std::atomic<std::size_t> batch;
+    std::atomic<std::uint32_t> rtt;
     boost::random::mt19937 random; // std::rand is not MT safe.
 
     void do_auth(std::string& user, std::string& pass) const
@@ -121,43 +129,201 @@ std::string connection::resolve::describe() const
     return "Resolve " + state_->hostname;
 }
 
-connection::connect::connect(std::shared_ptr<state> s) : state_(s)
+connection::ioaction::ioaction(std::shared_ptr<state> s, std::chrono::seconds timeout, bool cancelable) 
+    : state_(s), timeout_(timeout)
+{
+    wait_.socket  = false;
+    wait_.read    = false;
+    wait_.write   = false;
+    wait_.socket_handle = 0;
+    wait_.event   = false;
+    wait_.event_handle  = 0;
+    wait_.timeout = std::chrono::milliseconds(0);
+    cancelable_   = cancelable;
+    canceled_     = false;
+    nonblocking_  = false;
+    complete_     = false;
+    send_         = true;
+    parse_        = true;
+}
+
+void connection::ioaction::xperform()
+{
+    // the timeout period begins when the action is first performed
+    // not when it's created.
+    if (activity_ == clock::time_point())
+        reset_timeout();
+
+    for (;;)
+    {
+        if (step())
+        {
+            complete_ = true;
+            return;
+        }
+        if (nonblocking_)
+            return;
+
+        // the step will check what happened once we wake up.
+        auto& socket = state_->socket;
+        auto& cancel = state_->cancel;
+        if (wait_.socket && wait_.event)
+        {
+            auto ready    = socket->wait(wait_.read, wait_.write);
+            auto canceled = cancel->wait();
+            newsflash::wait_for(ready, canceled, wait_.timeout);
+        }
+        else if (wait_.socket)
+        {
+            auto ready = socket->wait(wait_.read, wait_.write);
+            newsflash::wait_for(ready, wait_.timeout);
+        }
+        else
+        {
+            std::this_thread::sleep_for(wait_.timeout);
+        }
+    }
+}
+
+std::size_t connection::ioaction::receive(buffer& buff)
+{
+    return recv(buff, std::numeric_limits<std::size_t>::max());
+}
+
+bool connection::ioaction::transact(buffer& recvbuf, buffer& out)
+{
+    auto& session = state_->session;
+
+    if (send_)
+    {
+        session->send_next();
+        send_ = false;
+        reset_timeout();
+    }
+
+    // only feed the session when there's new data, a partial 
+    // response doesn't complete by parsing it again.
+    for (;;)
+    {
+        if (parse_ && session->recv_next(recvbuf, out))
+        {
+            send_ = true;
+            return true;
+        }
+        parse_ = false;
+
+        if (canceled())
+            return false;
+
+        if (!receive(recvbuf))
+            return false;
+
+        parse_ = true;
+    }
+}
+
+std::size_t connection::ioaction::recv(buffer& buff, std::size_t max)
+{
+    auto& socket = state_->socket;
+
+    if (buff.full())
+        buff.allocate(buff.size() * 2);
+
+    const auto avail = std::min(buff.available(), max);
+    const auto bytes = socket->try_recv(buff.back(), avail);
+    if (bytes < 0)
+        throw exception(connection::error::network, "connection was closed unexpectedly");
+    else if (bytes == 0)
+    {
+        if (timed_out())
+            throw exception(connection::error::timeout, "connection timeout");
+
+        wait_socket();
+        return 0;
+    }
+
+    buff.append(bytes);
+    reset_timeout();
+    return bytes;
+}
+
+void connection::ioaction::wait_socket()
+{
+    auto& socket = state_->socket;
+    auto& cancel = state_->cancel;
+
+    const bool write = socket->wants_write();
+    const auto ready = socket->wait(!write, write);
+    const auto spent = clock::now() - activity_;
+    const auto left  = spent < timeout_ ? timeout_ - spent : clock::duration(0);
+
+    wait_.socket  = true;
+    wait_.read    = !write;
+    wait_.write   = write;
+    wait_.socket_handle = ready.native_handle();
+    wait_.event   = cancelable_;
+    wait_.event_handle  = cancel->wait().native_handle();
+    // round up, a zero timeout means no timeout.
+    wait_.timeout = std::chrono::duration_cast<std::chrono::milliseconds>(left) + std::chrono::milliseconds(1);
+}
+
+void connection::ioaction::wait_timer(std::chrono::milliseconds ms)
+{
+    wait_.socket  = false;
+    wait_.event   = false;
+    wait_.timeout = ms + std::chrono::milliseconds(1);
+}
+
+bool connection::ioaction::canceled()
+{
+    if (cancelable_ && !canceled_)
+        canceled_ = state_->cancel->is_set();
+    return canceled_;
+}
+
+connection::connect::connect(std::shared_ptr<state> s) : ioaction(s, std::chrono::seconds(10), true)
 {
     if (state_->ssl)
         state_->socket.reset(new sslsocket);
     else state_->socket.reset(new tcpsocket);
+
+    connecting_ = false;
 }
 
-void connection::connect::xperform()
+bool connection::connect::step()
 {
     std::lock_guard<std::mutex> lock(state_->mutex);
 
-    LOG_I("Connecting to ", ipv4{state_->addr}, ", ", state_->port);
-
     const auto& socket = state_->socket;
-    const auto& cancel = state_->cancel;
-    const auto addr = state_->addr;
-    const auto port = state_->port;
 
-    // first begin connection (async)
-    socket->begin_connect(addr, port);
+    if (!connecting_)
+    {
+        LOG_I("Connecting to ", ipv4{state_->addr}, ", ", state_->port);
 
-    // wait for completion or cancellation event.
-    // when an async socket connect is performed the socket will become writeable
-    // once the connection is established.
-    auto connected = socket->wait(false, true);
-    auto canceled  = cancel->wait();
-    if (!newsflash::wait_for(connected, canceled, std::chrono::seconds(10)))
-        throw exception(error::timeout, "connection attempt timed out");
-    if (canceled)
+        // first begin connection (async)
+        socket->begin_connect(state_->addr, state_->port);
+        connecting_ = true;
+    }
+
+    if (canceled())
     {
         LOG_D("Connection was canceled");
-        return;
+        return true;
     }
 
-    socket->complete_connect();
+    // when an async socket connect is performed the socket will become writeable
+    // once the connection is established. with SSL the handshake follows.
+    if (!socket->try_complete_connect())
+    {
+        if (timed_out())
+            throw exception(error::timeout, "connection attempt timed out");
+
+        wait_socket();
+        return false;
+    }
 
     LOG_I("Socket connection ready!");
+    return true;
 }
 
 std::string connection::connect::describe() const
@@ -165,7 +331,7 @@ std::string connection::connect::describe() const
     return str("Connect to ", ipv4{state_->addr}, ":", state_->port);
 }
 
-connection::initialize::initialize(std::shared_ptr<state> s) : state_(s)
+connection::initialize::initialize(std::shared_ptr<state> s) : ioaction(s, std::chrono::seconds(5), true)
 {
     state_->session.reset(new session);
 
@@ -182,6 +348,8 @@ connection::initialize::initialize(std::shared_ptr<state> s) : state_(s)
 
     state_->session->enable_pipelining(s->pipelining);
     state_->session->enable_compression(s->compression);
+
+    started_ = false;
 }
 
 std::string connection::initialize::describe() const
@@ -189,51 +357,37 @@ std::string connection::initialize::describe() const
     return "Initialize NNTP session";
 }
 
-void connection::initialize::xperform()
+bool connection::initialize::step()
 {
     std::lock_guard<std::mutex> lock(state_->mutex);
 
-    LOG_I("Initializing NNTP session");
-    LOG_I("Enable gzip compress: ", state_->compression);
-    LOG_I("Enable pipelining: ", state_->pipelining);
-
     auto& session = state_->session;
-    auto& socket  = state_->socket;
-    auto& cancel  = state_->cancel;
-
-    // begin new session
-    session->start();
 
-    newsflash::buffer buff(1024);
-    newsflash::buffer temp;
+    if (!started_)
+    {
+        LOG_I("Initializing NNTP session");
+        LOG_I("Enable gzip compress: ", state_->compression);
+        LOG_I("Enable pipelining: ", state_->pipelining);
+
+        // begin new session
+        session->start();
+        buff_ = buffer(1024);
+        started_ = true;
+    }
 
     // while there are pending commands in the session we read
     // data from the socket into the buffer and then feed the buffer
     // into the session to update the session state.
-    while (session->send_next())
+    while (session->pending())
     {
-        do
+        if (!transact(buff_, temp_))
         {
-            // wait for data or cancellation
-            auto received = socket->wait(true, false);
-            auto canceled = cancel->wait();
-            if (!newsflash::wait_for(received, canceled, std::chrono::seconds(5)))
-                throw exception(connection::error::timeout, "connection timeout");
-            if (canceled)
-            {
-                LOG_D("Initialize was canceled");
-                return;
-            }
-
-            // readsome data
-            const auto bytes = socket->recvsome(buff.back(), buff.available());
-            if (bytes == 0)
-                throw exception(connection::error::network, "socket was closed unexpectedly");
-
-            // commit
-            buff.append(bytes);
+            if (!canceled())
+                return false;
+
+            LOG_D("Initialize was canceled");
+            return true;
         }
-        while (!session->recv_next(buff, temp));
     }
 
     // check for errors
@@ -245,30 +399,28 @@ void connection::initialize::xperform()
         throw exception(connection::error::no_permission, "no permission");
 
     LOG_I("NNTP Session ready");
-
+    return true;
 }
 
-connection::execute::execute(std::shared_ptr<state> s, std::shared_ptr<cmdlist> cmd, std::size_t tid) : state_(s), cmds_(cmd), tid_(tid)
+connection::execute::execute(std::shared_ptr<state> s, std::shared_ptr<cmdlist> cmd, std::size_t tid) 
+    : ioaction(s, std::chrono::seconds(30), true), cmds_(cmd), tid_(tid)
 {
-    bytes_   = 0;
-    content_ = 0;
+    bytes_     = 0;
+    content_   = 0;
+    configure_ = 0;
+    accum_     = 0;
+    response_  = 0;
+    first_     = false;
+    phase_     = phase::begin;
 }
 
-void connection::execute::xperform()
+bool connection::execute::step()
 {
     std::lock_guard<std::mutex> lock(state_->mutex);
 
     auto& session  = state_->session;
-    auto& cancel   = state_->cancel;
-    auto& socket   = state_->socket;
-    auto* throttle = state_->pthrottle;
     auto& cmdlist  = cmds_;
 
-    LOG_D("Execute cmdlist ", cmdlist->id());
-    LOG_D("Cmdlist has ", cmdlist->num_data_commands(), " data commands");
-
-    newsflash::buffer recvbuf(MB(4));
-
     // the cmdlist contains a list of commands
     // we pass the session object to the cmdlist to allow
     // it to submit a request into the session.
@@ -277,166 +429,179 @@ void connection::execute::xperform()
     // it into the session in order to update the session state.
     // once a command is completed we pass the output buffer
     // to the cmdlist so that it can update its own state.
-    if (cmdlist->is_canceled())
+    for (;;)
     {
-        LOG_D("Cmdlist was canceled");
-        return;
-    }
+        switch (phase_)
+        {
+            case phase::begin:
+                LOG_D("Execute cmdlist ", cmdlist->id());
+                LOG_D("Cmdlist has ", cmdlist->num_data_commands(), " data commands");
 
-    if (cmdlist->needs_to_configure())
-    {
-        bool configure_success = false;
+                if (cmdlist->is_canceled())
+                {
+                    LOG_D("Cmdlist was canceled");
+                    return true;
+                }
 
-        for (std::size_t i=0; ; ++i)
-        {
-            if (!cmdlist->submit_configure_command(i, *session))
-                break;
+                // the receive buffer grows as needed when a response doesn't fit.
+                // completed responses take over the buffer storage (see buffer::split)
+                // so keep this close to a typical article size.
+                recvbuf_ = buffer(MB(1));
 
-            if (!session->pending()) {
-                configure_success = true;
+                phase_ = cmdlist->needs_to_configure() ? phase::configure : phase::submit;
                 break;
-            }
 
-            newsflash::buffer config(KB(1));
+            case phase::configure:
+                if (!cmdlist->submit_configure_command(configure_, *session))
+                {
+                    LOG_E("Cmdlist session configuration failed");
+                    return true;
+                }
+                if (!session->pending())
+                {
+                    phase_ = phase::submit;
+                    break;
+                }
+                timeout_ = std::chrono::seconds(10);
+                output_  = buffer(KB(1));
+                phase_   = phase::configure_recv;
+                break;
 
-            while (session->send_next())
-            {
-                do
+            case phase::configure_recv:
+                if (session->pending())
                 {
-                    auto received = socket->wait(true, false);
-                    auto canceled = cancel->wait();
-                    if (!newsflash::wait_for(received, canceled, std::chrono::seconds(10)))
-                        throw exception(connection::error::timeout, "connection timeout");
-                    else if (canceled)
-                        return;
-
-                    const auto bytes = socket->recvsome(recvbuf.back(), recvbuf.available());
-                    if (bytes == 0)
-                        throw exception(connection::error::network, "connection was closed unexpectedly");
-
-                    recvbuf.append(bytes);
+                    if (!transact(recvbuf_, output_))
+                        return canceled();
+                    break;
+                }
+                else
+                {
+                    const auto err = session->get_error();
+                    if (err == session::error::authentication_rejected)
+                        throw exception(connection::error::authentication_rejected, "authentication rejected");
+                    else if (err == session::error::no_permission)
+                        throw exception(connection::error::no_permission, "no permission");
+
+                    if (cmdlist->receive_configure_buffer(configure_, std::move(output_)))
+                    {
+                        phase_ = phase::submit;
+                        break;
+                    }
+                    ++configure_;
+                    phase_ = phase::configure;
                 }
-                while (!session->recv_next(recvbuf, config));
-            }
-
-            const auto err = session->get_error();
-            if (err == session::error::authentication_rejected)
-                throw exception(connection::error::authentication_rejected, "authentication rejected");
-            else if (err == session::error::no_permission)
-                throw exception(connection::error::no_permission, "no permission");
-
-            if (cmdlist->receive_configure_buffer(i, std::move(config)))
-            {
-                configure_success = true;
                 break;
-            }
-        }
-        if (!configure_success)
-        {
-            LOG_E("Cmdlist session configuration failed");
-            return;
-        }
-    } // needs to configure
 
-    if (cmdlist->is_canceled())
-    {
-        LOG_D("Cmdlist was canceled");
-        return;
-    }
+            case phase::submit:
+                if (cmdlist->is_canceled())
+                {
+                    LOG_D("Cmdlist was canceled");
+                    return true;
+                }
 
-    LOG_I("Submit data commands");
+                LOG_I("Submit data commands");
 
-    cmdlist->submit_data_commands(*session);
+                cmdlist->submit_data_commands(*session);
+                session->set_pipeline_depth(state_->control.depth());
 
-    LOG_FLUSH();
+                LOG_FLUSH();
 
-    state_->bps = 0;
+                state_->bps = 0;
+                timeout_  = std::chrono::seconds(30);
+                start_    = clock::now();
+                last_     = start_;
+                first_    = false;
+                accum_    = 0;
+                response_ = 0;
+                output_   = buffer();
+                phase_    = phase::transfer;
+                break;
 
-    using clock = std::chrono::steady_clock;
+            case phase::transfer:
+                if (!session->pending())
+                {
+                    LOG_I("Cmdlist complete");
+                    return true;
+                }
+                if (!transact(recvbuf_, output_))
+                    return canceled();
 
-    const auto start = clock::now();
+                content_ += output_.content_length();
 
-    std::uint64_t accum = 0;
+                measure();
 
-    while (session->pending())
-    {
-        newsflash::buffer content(MB(4));
+                // todo: is this oK? (in case when quota finishes..??)
+                if (session->get_error() != session::error::none)
+                    throw exception(connection::error::no_permission, "no permission");
 
-        session->send_next();
-        do
-        {
-            auto canceled = cancel->wait();
-            if (newsflash::wait_for(canceled, std::chrono::milliseconds(0)))
-                return;
-
-            if (!socket->can_recv())
-            {
-                // wait for data or cancellation
-                auto received = socket->wait(true, false);
-                auto canceled = cancel->wait();
-                if (!newsflash::wait_for(received, canceled, std::chrono::seconds(30)))
-                    throw exception(connection::error::timeout, "connection timeout");
-                else if (canceled)
-                    return;
-            }
-
-            auto quota = throttle->give_quota();
-            while (!quota)
-            {
-                const auto ms = state_->random() % 50;
-                std::this_thread::sleep_for(std::chrono::milliseconds(ms));
-                quota = throttle->give_quota();
-            }
-
-            std::size_t avail = std::min(recvbuf.available(), quota);
-
-            // readsome
-            const auto bytes = socket->recvsome(recvbuf.back(), avail);
-            if (bytes == 0)
-                throw exception(connection::error::network, "connection was closed unexpectedly");
-
-            //LOG_D("Quota ", quota, " avail ", recvbuf.available(), " recvd ", bytes);
-
-            throttle->accumulate(bytes, quota);
-
-            recvbuf.append(bytes);
-            accum += bytes;
-
-            const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start);
-            const auto seconds = ms.count() / 1000.0;
-            const auto bps = accum / seconds;
-            state_->bps    = 0.05 * bps + (0.95 * state_->bps);
-            state_->bytes += bytes;
-            bytes_ += bytes;
+                cmdlist->receive_data_buffer(std::move(output_));
+                output_ = buffer();
+
+                // if the session is pipelined there's no way to stop the data transmission
+                // of already pipelined commands other than by doing a hard socket reset.
+                // if the session is not pipelined we can just exit the reading loop after
+                // a complete command is completed and we can maintain the socket/session.
+                if (cmdlist->is_canceled())
+                {
+                    LOG_D("Cmdlist was canceled");
+
+                    if (state_->pipelining)
+                        throw exception(connection::error::pipeline_reset, "pipeline reset");
+
+                    session->clear();
+                    return true;
+                }
+                break;
         }
-        while (!session->recv_next(recvbuf, content));
+    }
+}
 
-        content_ += content.content_length();
+std::size_t connection::execute::receive(buffer& buff)
+{
+    // the configure responses are not throttled.
+    if (phase_ != phase::transfer)
+        return ioaction::receive(buff);
+
+    auto* throttle = state_->pthrottle;
 
-        // todo: is this oK? (in case when quota finishes..??)
-        const auto err = session->get_error();
-        if (err != session::error::none)
-            throw exception(connection::error::no_permission, "no permission");
+    const auto quota = throttle->give_quota();
+    if (!quota)
+    {
+        // out of bandwidth quota, try again a little later. 
+        // waiting for quota doesn't count as a connection timeout.
+        reset_timeout();
+        wait_timer(std::chrono::milliseconds(state_->random() % 50));
+        return 0;
+    }
 
-        cmdlist->receive_data_buffer(std::move(content));
+    const auto bytes = recv(buff, quota);
 
-        // if the session is pipelined there's no way to stop the data transmission
-        // of already pipelined commands other than by doing a hard socket reset.
-        // if the session is not pipelined we can just exit the reading loop after
-        // a complete command is completed and we can maintain the socket/session.
-        if (cmdlist->is_canceled())
-        {
-            LOG_D("Cmdlist was canceled");
+    throttle->accumulate(bytes, quota);
+    if (!bytes)
+        return 0;
 
-            if (state_->pipelining)
-                throw exception(connection::error::pipeline_reset, "pipeline reset");
+    accum_ += bytes;
 
-            session->clear();
-            return;
-        }
+    // the pipeline is empty when the cmdlist begins so the
+    // first data to arrive completes a full round trip.
+    if (!first_)
+    {
+        const auto now = clock::now();
+        state_->control.sample_rtt(std::chrono::duration_cast<pipeline_controller::duration>(now - start_));
+        last_  = now;
+        first_ = true;
     }
 
-    LOG_I("Cmdlist complete");
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(clock::now() - start_);
+    const auto seconds = ms.count() / 1000.0;
+    if (seconds > 0)
+    {
+        const auto bps = accum_ / seconds;
+        state_->bps    = 0.05 * bps + (0.95 * state_->bps);
+    }
+    state_->bytes += bytes;
+    bytes_ += bytes;
+    return bytes;
 }
 
 std::string connection::execute::describe() const
@@ -444,51 +609,84 @@ std::string connection::execute::describe() const
     return "Execute cmdlist";
 }
 
-connection::disconnect::disconnect(std::shared_ptr<state> s) : state_(s)
-{}
+void connection::execute::measure()
+{
+    // the bytes received since the previous response make up this response.
+    // some of the next response might already be included but that
+    // evens out over the responses.
+    const auto now   = clock::now();
+    const auto bytes = accum_ - response_;
+    state_->control.sample_response(bytes, 
+        std::chrono::duration_cast<pipeline_controller::duration>(now - last_));
+    response_ = accum_;
+    last_     = now;
+
+    const auto& control = state_->control;
+    state_->session->set_pipeline_depth(control.depth());
+    state_->depth = state_->pipelining ? control.depth() : 1;
+    state_->batch = control.batch_size();
+    state_->rtt   = std::chrono::duration_cast<std::chrono::milliseconds>(control.rtt()).count();
+}
 
-void connection::disconnect::xperform()
+connection::disconnect::disconnect(std::shared_ptr<state> s) : ioaction(s, std::chrono::seconds(1), false)
 {
-    std::lock_guard<std::mutex> lock(state_->mutex);
+    started_ = false;
+    quit_    = false;
+}
 
-    LOG_I("Disconnect");
+bool connection::disconnect::step()
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
 
     auto& session = state_->session;
     auto& socket  = state_->socket;
 
-    // if the connection is disconnecting while there are pending
-    // transactions in the session we're just simply going to close the socket
-    // and not perform a clean protocol shutdown.
-    if (!session->pending())
+    if (!started_)
     {
-        newsflash::buffer buff(64);
-        newsflash::buffer temp;
+        LOG_I("Disconnect");
 
-        session->quit();
-        session->send_next();
-        do
+        // if the connection is disconnecting while there are pending
+        // transactions in the session we're just simply going to close the socket
+        // and not perform a clean protocol shutdown.
+        quit_ = !session->pending();
+        if (quit_)
         {
-            // wait for data, if no response then khtx bye whatever, we're done anyway
-            auto received = socket->wait(true, false);
-            if (!newsflash::wait_for(received, std::chrono::seconds(1)))
-                break;
-            if (buff.available() == 0)
-                buff.allocate(buff.size() + 64);
+            buff_ = buffer(64);
+            session->quit();
+            session->send_next();
+        }
+        started_ = true;
+    }
 
-            const auto bytes = socket->recvsome(buff.back(), buff.available());
-            if (bytes == 0)
-            {
-                LOG_D("Received socket close");
-                break;
-            }
-            buff.append(bytes);
+    while (quit_ && !session->recv_next(buff_, temp_))
+    {
+        if (buff_.full())
+            buff_.allocate(buff_.size() + 64);
+
+        const auto bytes = socket->try_recv(buff_.back(), buff_.available());
+        if (bytes < 0)
+        {
+            LOG_D("Received socket close");
+            break;
+        }
+        else if (bytes > 0)
+        {
+            buff_.append(bytes);
+            continue;
         }
-        while (!session->recv_next(buff, temp));
+
+        // wait for data, if no response then khtx bye whatever, we're done anyway
+        if (timed_out())
+            break;
+
+        wait_socket();
+        return false;
     }
 
     socket->close();
 
     LOG_D("Disconnect complete");
+    return true;
 }
 
 std::string connection::disconnect::describe() const
@@ -496,39 +694,32 @@ std::string connection::disconnect::describe() const
     return "Disconnect";
 }
 
-connection::ping::ping(std::shared_ptr<state> s) : state_(s)
-{}
+connection::ping::ping(std::shared_ptr<state> s) : ioaction(s, std::chrono::seconds(4), false)
+{
+    started_ = false;
+}
 
-void connection::ping::xperform()
+bool connection::ping::step()
 {
     std::lock_guard<std::mutex> lock(state_->mutex);
 
-    LOG_D("Perform ping");
-
     auto& session = state_->session;
-    auto& socket  = state_->socket;
-
-    newsflash::buffer buff(64);
-    newsflash::buffer temp;
 
-    session->ping();
-    while (session->pending())
+    if (!started_)
     {
-        session->send_next();
-        do
-        {
-            auto received = socket->wait(true, false);
-            if (!newsflash::wait_for(received, std::chrono::seconds(4)))
-                throw exception(connection::error::timeout, "connection timeout (no ping)");
+        LOG_D("Perform ping");
 
-            const auto bytes = socket->recvsome(buff.back(), buff.available());
-            if (bytes == 0)
-                throw exception(connection::error::network, "connection was closed unexpectedly");
+        session->ping();
+        buff_ = buffer(64);
+        started_ = true;
+    }
 
-            buff.append(bytes);
-        }
-        while (!session->recv_next(buff, temp));
+    while (session->pending())
+    {
+        if (!transact(buff_, temp_))
+            return false;
     }
+    return true;
 }
 
 std::string connection::ping::describe() const
@@ -549,6 +740,9 @@ std::unique_ptr<action> connection::connect(spec s)
     state_->compression = s.enable_compression;
     state_->pipelining = s.enable_pipelining;
     state_->bps = 0;
+    state_->depth = s.enable_pipelining ? state_->control.depth() : 1;
+    state_->batch = state_->control.batch_size();
+    state_->rtt   = 0;
     state_->cancel.reset(new event);
     state_->cancel->reset();
     state_->pthrottle = s.pthrottle;
@@ -615,4 +809,13 @@ std::uint32_t connection::current_speed_bps() const
 std::uint64_t connection::num_bytes_transferred() const
 { return state_->bytes; }
 
+std::uint32_t connection::current_rtt_ms() const
+{ return state_->rtt; }
+
+std::size_t connection::current_pipeline_depth() const
+{ return state_->depth; }
+
+std::size_t connection::current_batch_size() const
+{ return state_->batch; }
+
 } // newsflash
@@ -27,7 +27,10 @@
 #include <string>
 #include <memory>
 #include <cstdint>
+#include <chrono>
 #include "action.h"
+#include "buffer.h"
+#include "reactor.h"
 
 namespace newsflash
 {
@@ -78,40 +81,115 @@ namespace newsflash
             std::shared_ptr<state> state_;
         };
 
-        // perform socket connect 
-        class connect : public action
+        // base class for the actions that perform I/O on the connection socket.
+        // the action is performed in non-blocking steps so that it can be
+        // multiplexed on a reactor. when not running on a reactor the
+        // action waits by itself in between the steps.
+        class ioaction : public action, public reactor::operation
         {
         public:
-            connect(std::shared_ptr<state> s);
+            ioaction(std::shared_ptr<state> s, std::chrono::seconds timeout, bool cancelable);
+
+            virtual void set_nonblocking(bool on_off) override
+            { nonblocking_ = on_off; }
+
+            virtual bool is_complete() const override
+            { return complete_; }
+
+            virtual reactor::wait get_wait() const override
+            { return wait_; }
+
+        protected:
+            using clock = std::chrono::steady_clock;
 
             virtual void xperform() override;
 
+            // perform the next step. returns true when the action is complete.
+            // otherwise the step must set what it's waiting for before returning.
+            virtual bool step() = 0;
+
+            // receive data into the buffer. the default is to receive
+            // as much as is available. returns the number of bytes received
+            // or 0 if the action needs to wait.
+            virtual std::size_t receive(buffer& buff);
+
+            // send the pending commands and read data until the next response
+            // has been completed into out. returns false if the action needs to wait.
+            bool transact(buffer& recvbuf, buffer& out);
+
+            // receive at most max bytes into the buffer. the buffer is grown
+            // if it's full. returns the number of bytes received or 0 in which case
+            // the action is set to wait for the socket. throws on timeout 
+            // or if the connection was closed.
+            std::size_t recv(buffer& buff, std::size_t max);
+
+            // wait for the socket to become ready for the operation it needs
+            // or the cancellation (when cancelable) or the timeout.
+            void wait_socket();
+
+            // wait for the given time only.
+            void wait_timer(std::chrono::milliseconds ms);
+
+            // restart the timeout period.
+            void reset_timeout()
+            { activity_ = clock::now(); }
+
+            // returns true if there has been no activity during the timeout period.
+            bool timed_out() const
+            { return clock::now() - activity_ >= timeout_; }
+
+            // returns true if the cancellation event has been set 
+            // and the action is cancelable.
+            bool canceled();
+
+        protected:
+            std::shared_ptr<state> state_;
+            std::chrono::seconds timeout_;
+        private:
+            reactor::wait wait_;
+            clock::time_point activity_;
+            bool cancelable_;
+            bool canceled_;
+            bool nonblocking_;
+            bool complete_;
+            bool send_;
+            bool parse_;
+        };
+
+        // perform socket connect 
+        class connect : public ioaction
+        {
+        public:
+            connect(std::shared_ptr<state> s);
+
             virtual std::string describe() const override;            
         private:
-            std::shared_ptr<state> state_;
+            virtual bool step() override;
+        private:
+            bool connecting_;
         };
 
         // perform nntp init
-        class initialize : public action
+        class initialize : public ioaction
         {
         public:
             initialize(std::shared_ptr<state> s);
 
-            virtual void xperform() override;
-
             virtual std::string describe() const override;
         private:
-            std::shared_ptr<state> state_;
+            virtual bool step() override;
+        private:
+            buffer buff_;
+            buffer temp_;
+            bool started_;
         };
 
         // execute cmdlist 
-        class execute : public action
+        class execute : public ioaction
         {
         public:
             execute(std::shared_ptr<state> s, std::shared_ptr<cmdlist> cmds, std::size_t tid);
 
-            virtual void xperform() override;
-
             virtual std::string describe() const override;
 
             std::shared_ptr<cmdlist> get_cmdlist() const
@@ -131,37 +209,61 @@ namespace newsflash
             { return content_; }
 
         private:
-            std::shared_ptr<state> state_;
+            virtual bool step() override;
+            virtual std::size_t receive(buffer& buff) override;
+
+            // feed the pipeline controller with a completed response.
+            void measure();
+
+        private:
+            enum class phase {
+                begin, configure, configure_recv, submit, transfer
+            };
+
             std::shared_ptr<cmdlist> cmds_;
             std::size_t tid_;
             std::size_t bytes_;
             std::size_t content_;
+            std::size_t configure_;
+            std::uint64_t accum_;
+            std::uint64_t response_;
+            clock::time_point start_;
+            clock::time_point last_;
+            bool first_;
+            buffer recvbuf_;
+            buffer output_;
+            phase phase_;
         };
 
-        class disconnect : public action
+        class disconnect : public ioaction
         {
         public:
             disconnect(std::shared_ptr<state> s);
 
-            virtual void xperform() override;
-
             virtual std::string describe() const override;
             
         private:
-            std::shared_ptr<state> state_;
+            virtual bool step() override;
+        private:
+            buffer buff_;
+            buffer temp_;
+            bool started_;
+            bool quit_;
         };
 
-        class ping : public action
+        class ping : public ioaction
         {
         public:
             ping(std::shared_ptr<state> s);
 
-            virtual void xperform() override;
-
             virtual std::string describe() const override;
 
         private:
-            std::shared_ptr<state> state_;
+            virtual bool step() override;
+        private:
+            buffer buff_;
+            buffer temp_;
+            bool started_;
         };
 
         struct spec {
@@ -203,6 +305,16 @@ namespace newsflash
         std::uint32_t current_speed_bps() const;
 
         std::uint64_t num_bytes_transferred() const;
+
+        // the measured round trip time in milliseconds.
+        std::uint32_t current_rtt_ms() const;
+
+        // the number of commands currently kept in the pipeline.
+        std::size_t current_pipeline_depth() const;
+
+        // the number of data commands that a cmdlist executed 
+        // on this connection should have.
+        std::size_t current_batch_size() const;
     private:
         std::shared_ptr<state> state_;
 
@@ -0,0 +1,96 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include "cpu.h"
+
+#if defined(NEWSFLASH_X86) && defined(__MSVC__)
+#  include <intrin.h>
+#endif
+
+namespace {
+
+#if defined(NEWSFLASH_X86)
+
+struct cpu_features {
+    bool sse2;
+    bool ssse3;
+    bool sse41;
+    bool pclmul;
+    bool avx2;
+
+    cpu_features()
+    {
+    #if defined(__MSVC__)
+        int info[4] = {0};
+        __cpuid(info, 0);
+        const int max = info[0];
+
+        __cpuid(info, 1);
+        sse2   = (info[3] & (1 << 26)) != 0;
+        ssse3  = (info[2] & (1 << 9))  != 0;
+        sse41  = (info[2] & (1 << 19)) != 0;
+        pclmul = (info[2] & (1 << 1))  != 0;
+
+        // avx2 requires that the OS saves the ymm registers (osxsave + xcr0)
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        avx2 = false;
+        if (max >= 7 && osxsave && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+    #else
+        __builtin_cpu_init();
+        sse2   = __builtin_cpu_supports("sse2");
+        ssse3  = __builtin_cpu_supports("ssse3");
+        sse41  = __builtin_cpu_supports("sse4.1");
+        pclmul = __builtin_cpu_supports("pclmul");
+        avx2   = __builtin_cpu_supports("avx2");
+    #endif
+    }
+};
+
+#endif // NEWSFLASH_X86
+
+} // namespace
+
+namespace newsflash
+{
+
+bool has_cpu_feature(cpu_feature feature)
+{
+#if defined(NEWSFLASH_X86)
+    static const cpu_features cpu;
+
+    switch (feature)
+    {
+        case cpu_feature::sse2:   return cpu.sse2;
+        case cpu_feature::ssse3:  return cpu.ssse3;
+        case cpu_feature::sse41:  return cpu.sse41;
+        case cpu_feature::pclmul: return cpu.pclmul;
+        case cpu_feature::avx2:   return cpu.avx2;
+    }
+#endif
+    return false;
+}
+
+} // newsflash
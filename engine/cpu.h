@@ -0,0 +1,49 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#  define NEWSFLASH_X86
+#endif
+
+// gcc and clang only allow intrinsics for instruction sets that the
+// translation unit is compiled for unless the function is explicitly
+// marked with a matching target. this lets us keep the default build
+// flags and select the implementation at runtime.
+#if defined(__MSVC__)
+#  define NEWSFLASH_TARGET(x)
+#else
+#  define NEWSFLASH_TARGET(x) __attribute__((target(x)))
+#endif
+
+namespace newsflash
+{
+    // instruction set extensions used by the vectorized code paths.
+    enum class cpu_feature {
+        sse2, ssse3, sse41, pclmul, avx2
+    };
+
+    // returns true if the current CPU (and OS) supports the feature.
+    bool has_cpu_feature(cpu_feature feature);
+
+} // newsflash
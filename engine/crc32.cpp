@@ -0,0 +1,267 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <cassert>
+#include "cpu.h"
+#include "crc32.h"
+
+#if defined(NEWSFLASH_X86)
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+// reflected CRC-32 polynomial
+const std::uint32_t POLY = 0xedb88320;
+
+// slice-by-8 lookup tables. table[0] is the classic byte-at-a-time table,
+// table[k][n] is the crc of byte n followed by k zero bytes.
+struct crc_tables {
+    std::uint32_t table[8][256];
+
+    // x^(2^n) mod P for the crc combining
+    std::uint32_t x2n[32];
+
+    crc_tables();
+} tables;
+
+// multiply a and b modulo the crc polynomial.
+std::uint32_t multmodp(std::uint32_t a, std::uint32_t b)
+{
+    std::uint32_t m = std::uint32_t(1) << 31;
+    std::uint32_t p = 0;
+    for (;;)
+    {
+        if (a & m)
+        {
+            p ^= b;
+            if ((a & (m - 1)) == 0)
+                break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ POLY : b >> 1;
+    }
+    return p;
+}
+
+// compute x^(n * 2^k) mod P
+std::uint32_t x2nmodp(std::uint64_t n, unsigned k)
+{
+    std::uint32_t p = std::uint32_t(1) << 31; // x^0 == 1
+    while (n)
+    {
+        if (n & 1)
+            p = multmodp(tables.x2n[k & 31], p);
+        n >>= 1;
+        k++;
+    }
+    return p;
+}
+
+crc_tables::crc_tables()
+{
+    for (std::uint32_t n=0; n<256; ++n)
+    {
+        std::uint32_t c = n;
+        for (int k=0; k<8; ++k)
+            c = (c & 1) ? (c >> 1) ^ POLY : c >> 1;
+        table[0][n] = c;
+    }
+    for (std::uint32_t n=0; n<256; ++n)
+    {
+        std::uint32_t c = table[0][n];
+        for (int k=1; k<8; ++k)
+        {
+            c = table[0][c & 0xff] ^ (c >> 8);
+            table[k][n] = c;
+        }
+    }
+
+    std::uint32_t p = std::uint32_t(1) << 30; // x^1
+    x2n[0] = p;
+    for (int n=1; n<32; ++n)
+        x2n[n] = p = multmodp(p, p);
+}
+
+// process the data 8 bytes at a time. the crc is the raw (inverted) crc register.
+std::uint32_t crc32_slice8(std::uint32_t crc, const unsigned char* buf, std::size_t len)
+{
+    const auto& t = tables.table;
+
+    while (len && ((std::uintptr_t)buf & 7))
+    {
+        crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+        --len;
+    }
+    while (len >= 8)
+    {
+        // the loads are done byte by byte in order to be
+        // independent of the platform endianness.
+        const std::uint32_t lo = crc ^ (buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((std::uint32_t)buf[3] << 24));
+        crc = t[7][lo & 0xff] ^ t[6][(lo >> 8) & 0xff] ^ t[5][(lo >> 16) & 0xff] ^ t[4][lo >> 24] ^
+              t[3][buf[4]] ^ t[2][buf[5]] ^ t[1][buf[6]] ^ t[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+    while (len--)
+        crc = t[0][(crc ^ *buf++) & 0xff] ^ (crc >> 8);
+    return crc;
+}
+
+#if defined(NEWSFLASH_X86)
+
+// fold 64 bytes at a time with carry-less multiplication.
+// "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction",
+// Gopal et al, Intel 2009. the constants are for the bit reflected domain.
+// len must be at least 64 and a multiple of 16.
+NEWSFLASH_TARGET("pclmul,sse4.1")
+std::uint32_t crc32_fold(std::uint32_t crc, const unsigned char* buf, std::size_t len)
+{
+    const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i k5k0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+    __m128i x1 = _mm_loadu_si128((const __m128i*)(buf + 0x00));
+    __m128i x2 = _mm_loadu_si128((const __m128i*)(buf + 0x10));
+    __m128i x3 = _mm_loadu_si128((const __m128i*)(buf + 0x20));
+    __m128i x4 = _mm_loadu_si128((const __m128i*)(buf + 0x30));
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+    buf += 64;
+    len -= 64;
+
+    // fold 4 x 128 bits in parallel
+    while (len >= 64)
+    {
+        const __m128i x5 = _mm_clmulepi64_si128(x1, k1k2, 0x00);
+        const __m128i x6 = _mm_clmulepi64_si128(x2, k1k2, 0x00);
+        const __m128i x7 = _mm_clmulepi64_si128(x3, k1k2, 0x00);
+        const __m128i x8 = _mm_clmulepi64_si128(x4, k1k2, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k1k2, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, k1k2, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, k1k2, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, k1k2, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(buf + 0x00)));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(buf + 0x10)));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(buf + 0x20)));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(buf + 0x30)));
+        buf += 64;
+        len -= 64;
+    }
+
+    // fold into 128 bits
+    __m128i x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // fold the remaining 16 byte blocks
+    while (len >= 16)
+    {
+        x5 = _mm_clmulepi64_si128(x1, k3k4, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, k3k4, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128((const __m128i*)buf)), x5);
+        buf += 16;
+        len -= 16;
+    }
+
+    // fold 128 bits to 64 bits
+    x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+    x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, mask);
+    x1 = _mm_clmulepi64_si128(x1, k5k0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // barrett reduction to 32 bits
+    x2 = _mm_and_si128(x1, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x10);
+    x2 = _mm_and_si128(x2, mask);
+    x2 = _mm_clmulepi64_si128(x2, poly, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return _mm_extract_epi32(x1, 1);
+}
+
+std::uint32_t crc32_pclmul(std::uint32_t crc, const unsigned char* buf, std::size_t len)
+{
+    if (len >= 64)
+    {
+        const auto chunk = len & ~std::size_t(15);
+        crc  = crc32_fold(crc, buf, chunk);
+        buf += chunk;
+        len -= chunk;
+    }
+    return crc32_slice8(crc, buf, len);
+}
+
+#endif // NEWSFLASH_X86
+
+using crc32_func = std::uint32_t (*)(std::uint32_t, const unsigned char*, std::size_t);
+
+crc32_func get_crc32_func(newsflash::crc32_kernel k)
+{
+#if defined(NEWSFLASH_X86)
+    if (k == newsflash::crc32_kernel::pclmul)
+        return &crc32_pclmul;
+#endif
+    return &crc32_slice8;
+}
+
+bool has_pclmul()
+{
+    return newsflash::has_cpu_feature(newsflash::cpu_feature::pclmul) &&
+           newsflash::has_cpu_feature(newsflash::cpu_feature::sse41);
+}
+
+} // namespace
+
+namespace newsflash
+{
+
+std::uint32_t crc32(std::uint32_t crc, const void* data, std::size_t len)
+{
+    static const crc32_func func = get_crc32_func(has_pclmul() ?
+        crc32_kernel::pclmul : crc32_kernel::slice8);
+
+    return ~func(~crc, (const unsigned char*)data, len);
+}
+
+std::uint32_t crc32(std::uint32_t crc, const void* data, std::size_t len, crc32_kernel k)
+{
+    assert(k == crc32_kernel::slice8 || has_pclmul());
+
+    return ~get_crc32_func(k)(~crc, (const unsigned char*)data, len);
+}
+
+std::uint32_t crc32_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t len2)
+{
+    return multmodp(x2nmodp(len2, 3), crc1) ^ crc2;
+}
+
+} // newsflash
@@ -0,0 +1,43 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <cstdint>
+#include <cstddef>
+
+namespace newsflash
+{
+    // CRC-32 (IEEE 802.3) as used by yEnc, zlib and boost::crc_32_type.
+    // Update the given crc with len bytes of data. The initial crc value is 0.
+    std::uint32_t crc32(std::uint32_t crc, const void* data, std::size_t len);
+
+    // Combine the crc1 of a first block of data with the crc2 of a second
+    // block of len2 bytes into the crc of the concatenated data.
+    std::uint32_t crc32_combine(std::uint32_t crc1, std::uint32_t crc2, std::uint64_t len2);
+
+    // the crc32 implementation. only for testing.
+    enum class crc32_kernel {
+        slice8, pclmul
+    };
+    std::uint32_t crc32(std::uint32_t crc, const void* data, std::size_t len, crc32_kernel k);
+
+} // newsflash
@@ -22,10 +22,16 @@
 #include <string>
 #include <atomic>
 #include <vector>
+#include <map>
+#include <memory>
 #include <cassert>
+#include <cstring>
 #include "bigfile.h"
+#include "buffer.h"
+#include "crc32.h"
 #include "action.h"
 #include "filesys.h"
+#include "par2.h"
 
 namespace newsflash
 {
@@ -37,9 +43,10 @@ namespace newsflash
         public:
             // note that there's a little hack here and the offset is offset by +1
             // so that we're using 0 for indicating that offset is not being used at all.
-            write(std::size_t offset, 
-                std::vector<char> data, std::shared_ptr<datafile> file) : offset_(offset),
-                data_(std::move(data)), file_(file)
+            // the content of the buffer is written to the file.
+            write(std::size_t offset,
+                buffer data, std::shared_ptr<datafile> file) : offset_(offset),
+                verify_offset_(offset), data_(std::move(data)), file_(file)
             {
             #ifdef NEWSFLASH_DEBUG
                 file_->num_writes_++;
@@ -47,6 +54,20 @@ namespace newsflash
                 set_affinity(affinity::single_thread);
             }
 
+            write(std::size_t offset,
+                const std::vector<char>& data, std::shared_ptr<datafile> file) : offset_(offset),
+                verify_offset_(offset), data_(data.size()), file_(file)
+            {
+                if (!data.empty())
+                    std::memcpy(data_.back(), data.data(), data.size());
+                data_.append(data.size());
+                data_.set_content_length(data.size());
+            #ifdef NEWSFLASH_DEBUG
+                file_->num_writes_++;
+            #endif
+                set_affinity(affinity::single_thread);
+            }
+
            ~write()
             {
             #ifdef NEWSFLASH_DEBUG
@@ -67,20 +88,34 @@ namespace newsflash
                 if (offset_)
                     file_->big_.seek(offset_-1);
 
-                file_->big_.write(&data_[0], data_.size());
+                file_->big_.write(data_.content(), data_.content_length());
+
+                // the data is at hand anyway so check it against the par2
+                // slice checksums here instead of reading the file back later.
+                if (verify_offset_ && file_->verifier_)
+                    file_->verifier_->write(verify_offset_-1, data_.content(), data_.content_length());
             }
             std::size_t get_write_size() const 
-            { return data_.size(); }
+            { return data_.content_length(); }
+
+            // set the (real, not +1) offset of the content in the file for
+            // the par2 verification when the write itself appends. this is the
+            // case for single part yEnc binaries which have no offset but
+            // still start at the beginning of the file.
+            void set_verify_offset(std::size_t offset)
+            { verify_offset_ = offset + 1; }
 
         private:
             std::size_t offset_;
-            std::vector<char> data_;
+            std::size_t verify_offset_;
+            buffer data_;
             std::shared_ptr<datafile> file_;
         };
 
         // open datafile to an existing file
         datafile(std::string filepath, std::string filename, std::string dataname, bool bin) : discard_(false),
-            filepath_(std::move(filepath)), filename_(std::move(filename)), dataname_(std::move(dataname)), binary_(bin), finalsize_(0)
+            filepath_(std::move(filepath)), filename_(std::move(filename)), dataname_(std::move(dataname)), binary_(bin), finalsize_(0),
+            binarysize_(0), binarycrc_(0)
         {
             big_.open(fs::joinpath(filepath_, filename_));
 
@@ -92,7 +127,7 @@ namespace newsflash
 
         // create a new data file possibly overwriting existing files.
         datafile(std::string path, std::string binaryname, std::size_t size, bool bin, bool overwrite) : 
-            discard_(false), binary_(bin), finalsize_(0)
+            discard_(false), binary_(bin), finalsize_(0), binarysize_(size), binarycrc_(0)
         {
             std::string file;
             std::string name;
@@ -169,6 +204,48 @@ namespace newsflash
         bool is_open() const
         { return big_.is_open(); }
 
+        // record the crc of a part of the binary written at the given offset.
+        // once all the parts are available the crc of the whole binary can
+        // be computed from the parts without reading the file back.
+        void add_part_crc(std::uint64_t offset, std::uint64_t size, std::uint32_t crc)
+        { parts_[offset] = part {size, crc}; }
+
+        // set the expected crc of the whole binary.
+        void set_binary_crc(std::uint32_t crc)
+        { binarycrc_ = crc; }
+
+        // returns true if the crc combined from the parts doesn't match
+        // the expected crc of the whole binary. if the expected crc is not
+        // known or the parts don't cover the whole binary returns false.
+        bool has_crc_mismatch() const
+        {
+            if (!binarycrc_ || parts_.empty())
+                return false;
+
+            std::uint64_t end = 0;
+            std::uint32_t crc = 0;
+            for (const auto& p : parts_)
+            {
+                if (p.first != end)
+                    return false;
+                crc  = crc32_combine(crc, p.second.crc, p.second.size);
+                end += p.second.size;
+            }
+            if (end != binarysize_)
+                return false;
+
+            return crc != binarycrc_;
+        }
+
+        // verify the file content against the slice checksums of a par2 set
+        // as it's being written. this should be set before any content is written.
+        void set_verifier(std::unique_ptr<par2_verifier> verifier)
+        { verifier_ = std::move(verifier); }
+
+        // get the verifier if any.
+        const par2_verifier* verifier() const 
+        { return verifier_.get(); }
+
     private:
         friend class write;
 
@@ -182,6 +259,16 @@ namespace newsflash
         std::atomic<std::size_t> num_writes_;
     #endif
         std::uint64_t finalsize_;
+    private:
+        struct part {
+            std::uint64_t size;
+            std::uint32_t crc;
+        };
+        std::map<std::uint64_t, part> parts_;
+        std::uint64_t binarysize_;
+        std::uint32_t binarycrc_;
+    private:
+        std::unique_ptr<par2_verifier> verifier_;
     };
 
 } // newsflash
@@ -20,9 +20,7 @@
 
 #include <newsflash/config.h>
 
-#include <newsflash/warnpush.h>
-#  include <boost/crc.hpp>
-#include <newsflash/warnpop.h>
+#include <cstring>
 
 #include "decode.h"
 #include "linebuffer.h"
@@ -50,6 +48,34 @@ std::string to_utf8(const std::string& str)
     return utf8::encode(wide);
 }
 
+// decode the yEnc data that begins at the current iterator position
+// and move the iterator to the end of the decoded data. the crc of the
+// decoded data is computed while decoding.
+newsflash::buffer decode_yenc_data(const char* data, std::size_t len, nntp::bodyiter& beg, std::uint32_t& crc)
+{
+    const auto pos = beg.position();
+
+    newsflash::buffer buff(len - pos);
+    const auto ret = yenc::decode_buffer(data + pos, len - pos, buff.back(), crc);
+    buff.append(ret.written);
+    buff.set_content_length(ret.written);
+
+    beg = nntp::bodyiter(data, pos + ret.consumed, len);
+    return buff;
+}
+
+// uudecoded binaries are small and rare so they're decoded
+// into a vector first and then copied into the binary buffer.
+newsflash::buffer make_binary(const std::vector<char>& data)
+{
+    newsflash::buffer buff(data.size());
+    if (!data.empty())
+        std::memcpy(buff.back(), data.data(), data.size());
+    buff.append(data.size());
+    buff.set_content_length(data.size());
+    return buff;
+}
+
 } // namespace
 
 namespace newsflash
@@ -59,6 +85,8 @@ decode::decode(buffer&& data) : data_(std::move(data))
 {
     binary_offset_ = 0;
     binary_size_   = 0;
+    crc32_         = 0;
+    binary_crc32_  = 0;
     encoding_      = encoding::unknown;
     multipart_     = false;
     first_part_    = false;
@@ -168,9 +196,8 @@ std::size_t decode::decode_yenc_single(const char* data, std::size_t len)
     if (!header.first)
         throw exception("broken or missing yenc header");
 
-    std::vector<char> buff;
-    buff.reserve(header.second.size);
-    yenc::decode(beg, end, std::back_inserter(buff));
+    std::uint32_t crc = 0;
+    auto buff = decode_yenc_data(data, len, beg, crc);
 
     const auto footer = yenc::parse_footer(beg, end);
     if (!footer.first)
@@ -179,7 +206,9 @@ std::size_t decode::decode_yenc_single(const char* data, std::size_t len)
     binary_        = std::move(buff);
     binary_name_   = to_utf8(header.second.name);
     binary_offset_ = 0;
-    binary_size_   = binary_.size();
+    binary_size_   = binary_.content_length();
+    crc32_         = crc;
+    binary_crc32_  = footer.second.crc32;
     multipart_     = false;
     first_part_    = true;
     last_part_     = true;
@@ -188,14 +217,12 @@ std::size_t decode::decode_yenc_single(const char* data, std::size_t len)
 
     if (footer.second.crc32)
     {
-        boost::crc_32_type crc;
-        crc.process_bytes(binary_.data(), binary_.size());
-        if (footer.second.crc32 != crc.checksum())
+        if (footer.second.crc32 != crc)
             errors_.set(error::crc_mismatch);
 
         if (footer.second.size != header.second.size)
             errors_.set(error::size_mismatch);
-        if (footer.second.size != binary_.size())
+        if (footer.second.size != binary_.content_length())
             errors_.set(error::size_mismatch);
     }
     return beg.position();
@@ -218,9 +245,8 @@ std::size_t decode::decode_yenc_multi(const char* data, std::size_t len)
     const auto offset = part.second.begin - 1;
     const auto size = part.second.end - offset;
 
-    std::vector<char> buff;
-    buff.reserve(size);
-    yenc::decode(beg, end, std::back_inserter(buff));
+    std::uint32_t crc = 0;
+    auto buff = decode_yenc_data(data, len, beg, crc);
 
     const auto footer = yenc::parse_footer(beg, end);
     if (!footer.first)
@@ -230,6 +256,8 @@ std::size_t decode::decode_yenc_multi(const char* data, std::size_t len)
     binary_name_   = to_utf8(header.second.name);
     binary_offset_ = offset;
     binary_size_   = header.second.size;
+    crc32_         = crc;
+    binary_crc32_  = footer.second.crc32;
     multipart_     = true;
     first_part_    = header.second.part == 1;
     last_part_     = (header.second.part == header.second.total);
@@ -238,13 +266,10 @@ std::size_t decode::decode_yenc_multi(const char* data, std::size_t len)
 
     if (footer.second.pcrc32)
     {
-        boost::crc_32_type crc;
-        crc.process_bytes(binary_.data(), binary_.size());
-
-        if (footer.second.pcrc32 != crc.checksum())
+        if (footer.second.pcrc32 != crc)
             errors_.set(error::crc_mismatch);
 
-        if (size != binary_.size())
+        if (size != binary_.content_length())
             errors_.set(error::size_mismatch);
     }
 
@@ -268,7 +293,7 @@ std::size_t decode::decode_uuencode_single(const char* data, std::size_t len)
     // then there's no end in this chunk.
     const bool parse_end_success = uuencode::parse_end(beg, end);
 
-    binary_        = std::move(buff);
+    binary_        = make_binary(buff);
     binary_name_   = to_utf8(header.second.file);
     binary_offset_ = 0;
     binary_size_   = 0;
@@ -300,7 +325,7 @@ std::size_t decode::decode_uuencode_multi(const char* data, std::size_t len)
     // see comments in uuencode_single
     const bool parse_end_success = uuencode::parse_end(beg, end);
 
-    binary_        = std::move(buff);
+    binary_        = make_binary(buff);
     binary_offset_ = 0; // we have no idea about the offset, uuencode doesn't have it.
     binary_size_   = 0;
     multipart_     = true;
@@ -24,6 +24,7 @@
 #include <stdexcept>
 #include <string>
 #include <vector>
+#include <cstdint>
 
 #include "action.h"
 #include "buffer.h"
@@ -74,10 +75,11 @@ namespace newsflash
         std::vector<char>&& get_text_data_move() 
         { return std::move(text_); }
 
-        // get the binary content (if any)
-        //std::vector<char>&& get_binary_data() &&
+        // get the binary content (if any). the binary data is
+        // the content of the buffer.
+        //buffer&& get_binary_data() &&
 
-        std::vector<char>&& get_binary_data_move()
+        buffer&& get_binary_data_move()
         { return std::move(binary_); }
 
         const 
@@ -85,7 +87,7 @@ namespace newsflash
         { return text_; }
 
         const 
-        std::vector<char>& get_binary_data() const //&
+        buffer& get_binary_data() const //&
         { return binary_; }
 
 
@@ -102,6 +104,16 @@ namespace newsflash
         std::size_t get_binary_size() const 
         { return binary_size_; }
 
+        // get the crc32 of the decoded binary data. in case of a multipart
+        // binary this is the crc of the current part only.
+        std::uint32_t get_crc32() const
+        { return crc32_; }
+
+        // get the crc32 of the *whole* binary if the encoding provided it,
+        // otherwise 0.
+        std::uint32_t get_binary_crc32() const
+        { return binary_crc32_; }
+
         // get the binary file name in UTF-8
         std::string get_binary_name() const 
         { return binary_name_; }
@@ -136,10 +148,12 @@ namespace newsflash
     private:
         buffer data_;
         std::vector<char> text_;
-        std::vector<char> binary_;
+        buffer binary_;
         std::size_t binary_offset_;
         std::size_t binary_size_;
         std::string binary_name_;
+        std::uint32_t crc32_;
+        std::uint32_t binary_crc32_;
     private:
         encoding encoding_;
     private:
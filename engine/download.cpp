@@ -36,6 +36,7 @@
 #include "settings.h"
 #include "datafile.h"
 #include "cmdlist.h"
+#include "par2.h"
 
 namespace newsflash
 {
@@ -48,6 +49,7 @@ download::download(std::vector<std::string> groups, std::vector<std::string> art
     discardtext_  = false;
     yenc_         = false;
     decode_jobs_  = articles_.size();
+    batch_size_   = 10;
 
     const auto pos = name.find("yEnc");
     if (pos != std::string::npos)
@@ -62,15 +64,11 @@ std::shared_ptr<cmdlist> download::create_commands()
     if (articles_.empty())
         return nullptr;
 
-    // take the next list of articles to be downloaded
-    // if each article is about half a meg then this is
-    // about 5 megs. if we're running on a 50mbit/s LAN
-    // at full throttle it will take about a second to download
-    //const std::size_t num_articles_per_cmdlist = 10;
-
-    const std::size_t num_articles_per_cmdlist = 10;
+    // take the next list of articles to be downloaded.
+    // the batch size is picked by the connection so that the
+    // cmdlist takes a couple of seconds to download. 
     const std::size_t num_articles = std::min(articles_.size(), 
-        num_articles_per_cmdlist);
+        batch_size_);
 
     auto beg = std::begin(articles_);
     auto end = std::begin(articles_);
@@ -105,7 +103,7 @@ void download::commit()
 {
     if (!stash_.empty())
     {
-        std::shared_ptr<datafile> file = create_file(stash_name_, 0);
+        std::shared_ptr<datafile> file = create_file(stash_name_, 0, false);
 
         // collect the stuff from the stash.
         for (auto& p : stash_)
@@ -139,7 +137,7 @@ void download::complete(action& act, std::vector<std::unique_ptr<action>>& next)
     auto name   = dec->get_binary_name();
 
     // process the binary data.
-    if (!binary.empty())
+    if (binary.content_length())
     {
         const auto enc = dec->get_encoding();
         if (enc == decode::encoding::yenc)
@@ -149,8 +147,14 @@ void download::complete(action& act, std::vector<std::unique_ptr<action>>& next)
                 dec->get_binary_offset() + 1 : 0;
             const auto size = dec->get_binary_size();
 
-            std::shared_ptr<datafile> file = create_file(name, size);
-            std::unique_ptr<action> write(new datafile::write(offset, std::move(binary), file));
+            std::shared_ptr<datafile> file = create_file(name, size, true);
+            file->add_part_crc(dec->get_binary_offset(), binary.content_length(), dec->get_crc32());
+            if (dec->get_binary_crc32())
+                file->set_binary_crc(dec->get_binary_crc32());
+
+            std::unique_ptr<datafile::write> write(new datafile::write(offset, std::move(binary), file));
+            if (!dec->has_offset())
+                write->set_verify_offset(0);
             next.push_back(std::move(write));
         }
         else if (enc == decode::encoding::uuencode)
@@ -197,7 +201,7 @@ void download::complete(action& act, std::vector<std::unique_ptr<action>>& next)
             }
             else
             {
-                std::shared_ptr<datafile> file= create_file(name, 0);
+                std::shared_ptr<datafile> file= create_file(name, 0, false);
                 std::unique_ptr<action> write(new datafile::write(0, std::move(binary), file));
                 next.push_back(std::move(write));
             }
@@ -267,6 +271,11 @@ void download::configure(const settings& s)
     discardtext_ = s.discard_text_content;
 }
 
+void download::set_batch_size(std::size_t num_commands)
+{
+    batch_size_ = std::max<std::size_t>(num_commands, 1);
+}
+
 bool download::has_commands() const
 {
     return !articles_.empty(); 
@@ -278,7 +287,7 @@ std::size_t download::max_num_actions() const
     return articles_.size() * 2;
 }
 
-std::shared_ptr<datafile> download::create_file(const std::string& name, std::size_t assumed_size)
+std::shared_ptr<datafile> download::create_file(const std::string& name, std::size_t assumed_size, bool verify)
 {
     if (name.empty())
         throw std::runtime_error("binary has no name");
@@ -293,6 +302,14 @@ std::shared_ptr<datafile> download::create_file(const std::string& name, std::si
     {
         file = std::make_shared<datafile>(path_, name, assumed_size, true, overwrite_);
         files_.push_back(file);
+
+        // only yEnc content carries the offsets needed for the verification.
+        const auto* desc = (verify && par2_) ? par2_->find_file(name) : nullptr;
+        if (desc)
+        {
+            std::unique_ptr<par2_verifier> verifier(new par2_verifier(par2_->slice_size, *desc));
+            file->set_verifier(std::move(verifier));
+        }
     } 
     else 
     {
@@ -24,12 +24,14 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include "buffer.h"
 #include "task.h"
 
 namespace newsflash
 {
     class datafile;
     class decode;
+    struct par2_set;
 
     // extract encoded content from the buffers
     class download : public task
@@ -48,6 +50,7 @@ namespace newsflash
         virtual void complete(cmdlist& cmd,
             std::vector<std::unique_ptr<action>>& next) override;
         virtual void configure(const settings& s) override;
+        virtual void set_batch_size(std::size_t num_commands) override;
         virtual bool has_commands() const override;
         //virtual bool is_ready() const override;
         virtual std::size_t max_num_actions() const override;
@@ -72,20 +75,27 @@ namespace newsflash
         const std::string& path() const 
         { return path_; }
 
+        // set the par2 set to verify the binaries against. only the files
+        // created after this are verified since the earlier content is gone.
+        void set_par2(std::shared_ptr<const par2_set> set)
+        { par2_ = set; }
+
     private:
-        std::shared_ptr<datafile> create_file(const std::string& name, std::size_t assumed_size);
+        std::shared_ptr<datafile> create_file(const std::string& name, std::size_t assumed_size, bool verify);
 
     private:
-        using stash = std::vector<char>;
+        using stash = buffer;
 
         std::vector<std::string> groups_;
         std::vector<std::string> articles_;
         std::vector<std::shared_ptr<datafile>> files_;
         std::vector<std::unique_ptr<stash>> stash_;
+        std::shared_ptr<const par2_set> par2_;
         std::string path_;
         std::string name_;
         std::string stash_name_;
         std::size_t decode_jobs_;
+        std::size_t batch_size_;
     private:
         bool overwrite_;
         bool discardtext_;
@@ -26,6 +26,8 @@
 #include <mutex>
 #include <fstream>
 #include <list>
+#include <set>
+#include <unordered_map>
 #include <cassert>
 #include <cstdlib> // for getenv
 
@@ -39,16 +41,20 @@
 #include "logging.h"
 #include "utf8.h"
 #include "threadpool.h"
+#include "reactor.h"
 #include "cmdlist.h"
 #include "settings.h"
 #include "datafile.h"
 #include "listing.h"
 #include "update.h"
 #include "throttle.h"
+#include "bufferpool.h"
+#include "completion_queue.h"
 #include "session.pb.h"
 #include "sslcontext.h"
 #include "encoding.h"
 #include "nntp.h"
+#include "par2.h"
 
 namespace newsflash
 {
@@ -112,8 +118,42 @@ struct engine::state {
     std::deque<std::unique_ptr<engine::conn>> conns;
     std::deque<std::unique_ptr<engine::batch>> batches;
 
+    // the task and connection lists are in the UI order.
+    // these index them by id for routing the completed actions.
+    std::unordered_map<std::size_t, engine::task*> task_index;
+    std::unordered_map<std::size_t, engine::conn*> conn_index;
+
+    // order tasks by their position in the task list.
+    struct task_order {
+        bool operator()(const engine::task* lhs, const engine::task* rhs) const;
+    };
+
+    // scheduling state for each account.
+    struct account_queue {
+        // the idle connections by id. the connections are checked when taken 
+        // out since a connection may have been deleted after it was queued.
+        std::deque<std::size_t> ready_conns;
+
+        // the cmdlists waiting for a connection. 
+        std::deque<std::shared_ptr<cmdlist>> pending_cmds;
+
+        // the tasks that may have commands to run. a task that is found not
+        // eligible for running is removed and queued again when it 
+        // might become eligible again.
+        std::set<engine::task*, task_order> runnable;
+
+        std::size_t num_conns = 0;
+    };
+    std::unordered_map<std::size_t, account_queue> queues;
+
+    // the task list position keys for a new task at the front/back.
+    std::int64_t front_order;
+    std::int64_t back_order;
+
     std::vector<ui::account> accounts;
-    std::list<std::shared_ptr<cmdlist>> cmds;
+
+    // the currently active cmdlists by task id.
+    std::unordered_map<std::size_t, std::list<std::shared_ptr<cmdlist>>> cmds;
     std::uint64_t bytes_downloaded;
     std::uint64_t bytes_queued;
     std::uint64_t bytes_ready;
@@ -125,9 +165,11 @@ struct engine::state {
     std::unique_ptr<class logger> logger;
     std::unique_ptr<conntest> current_connection_test;
 
-    std::mutex  mutex;
-    std::queue<std::unique_ptr<action>> actions;
+    completion_queue actions;
     std::unique_ptr<threadpool> threads;
+#if defined(LINUX_OS)
+    std::unique_ptr<class reactor> reactor;
+#endif
     std::size_t num_pending_actions;
     std::size_t num_pending_tasks;
 
@@ -203,11 +245,18 @@ struct engine::state {
             LOG_D("Action ", a->get_id(), " (", a->describe(),  ") perform by current thread.");
 
             a->perform();
-            std::lock_guard<std::mutex> lock(mutex);
-            actions.emplace(a);
-            on_notify_callback();
+            if (actions.push(a))
+                on_notify_callback();
             quit_pump_loop = true;
         }
+#if defined(LINUX_OS)
+        else if (dynamic_cast<reactor::operation*>(a))
+        {
+            LOG_D("Action ", a->get_id(), " (", a->describe(), ") submitted to the reactor.");
+
+            reactor->submit(a);
+        }
+#endif
         else
         {
             LOG_D("Action ", a->get_id(), " (", a->describe(), ") submitted to the threadpool.");
@@ -217,19 +266,19 @@ struct engine::state {
         num_pending_actions++;
     }
 
+#if defined(WINDOWS_OS)
     void submit(action* a, threadpool::worker* thread)
     {
         threads->submit(a, thread);
         num_pending_actions++;
     }
+#endif
 
     std::unique_ptr<action> get_action()
     {
-        std::lock_guard<std::mutex> lock(mutex);
-        if (actions.empty())
+        std::unique_ptr<action> act = actions.pop();
+        if (!act)
             return nullptr;
-        std::unique_ptr<action> act = std::move(actions.front());
-        actions.pop();
 
         LOG_D("Action ", act->get_id(), " (", act->describe(), ") is complete");
         LOG_D("Action ", act->get_id(), " has exception: ", act->has_exception());
@@ -237,9 +286,26 @@ struct engine::state {
     }
 
     engine::batch& find_batch(std::size_t id);
+    engine::task* find_task(std::size_t id);
+    engine::conn* find_conn(std::size_t id);
+
+    void add_task(std::unique_ptr<engine::task> t, bool front);
+    void remove_task(const engine::task& t);
+    void swap_tasks(std::size_t i, std::size_t j);
+    void reorder_tasks();
+    void schedule(engine::task& t);
+
+    void add_conn(std::unique_ptr<engine::conn> c);
+    void reindex_conns();
+    void ready(engine::conn& c);
 
     void execute();
+    void execute(std::size_t account, account_queue& queue);
     void enqueue(const task& t, std::shared_ptr<cmdlist> cmd);
+
+private:
+    engine::conn* peek_ready_conn(account_queue& queue);
+    engine::conn* take_ready_conn(account_queue& queue);
 };
 
 
@@ -269,11 +335,17 @@ private:
         ui_.account    = 0;
         ui_.down       = 0;
         ui_.bps        = 0;
+        ui_.rtt        = 0;
+        ui_.depth      = 0;
+        ui_.batch      = 0;
         ui_.logfile    = file;
         ticks_to_ping_ = 30;
         ticks_to_conn_ = 5;
+        in_ready_queue_ = false;
         logger_        = std::make_shared<filelogger>(file, true);
+    #if defined(WINDOWS_OS)
         thread_        = state.threads->allocate();
+    #endif
         LOG_D("Connection ", ui_.id, " log file: ", file);
     }
 
@@ -395,7 +467,9 @@ public:
             do_action(state, conn_.disconnect());
         }
 
+    #if defined(WINDOWS_OS)
         state.threads->detach(thread_);
+    #endif
     }
 
     void execute(engine::state& state, std::shared_ptr<cmdlist> cmds, std::size_t tid, std::string desc)
@@ -425,8 +499,14 @@ public:
                 ui_.down = ui.down = bytes_current;
             }
         }
+        ui_.rtt   = ui.rtt   = conn_.current_rtt_ms();
+        ui_.depth = ui.depth = conn_.current_pipeline_depth();
+        ui_.batch = ui.batch = conn_.current_batch_size();
     }
 
+    std::size_t batch_size() const
+    { return conn_.current_batch_size(); }
+
     void on_action(engine::state& state, std::unique_ptr<action> act)
     {
         LOG_D("Connection ", ui_.id, " action ", act->get_id(), "(", act->describe(), ") complete");
@@ -520,6 +600,13 @@ public:
         return ui_.state == states::connected;
     }
 
+    // whether the connection is queued in the account's ready queue.
+    bool in_ready_queue() const
+    { return in_ready_queue_; }
+
+    void set_in_ready_queue(bool on_off)
+    { in_ready_queue_ = on_off; }
+
     double bps() const
     {
         if (ui_.state == states::active)
@@ -571,16 +658,24 @@ private:
 
         a->set_owner(ui_.id);
         a->set_log(logger_);
+    #if defined(LINUX_OS)
+        // the socket I/O is multiplexed on the reactor.
+        state.submit(a.release());
+    #else
         state.submit(a.release(), thread_);
+    #endif
     }
 
 private:
     ui::connection ui_;
     connection conn_;
     std::shared_ptr<logger> logger_;
+#if defined(WINDOWS_OS)
     threadpool::worker* thread_;
+#endif
     unsigned ticks_to_ping_;
     unsigned ticks_to_conn_;
+    bool in_ready_queue_;
 };
 
 
@@ -685,11 +780,13 @@ private:
 
 class engine::task
 {
-    task(std::size_t id) : num_active_cmdlists_(0), num_active_actions_(0), num_actions_ready_(0), num_actions_total_(0)
+    task(std::size_t id) : num_active_cmdlists_(0), num_active_actions_(0), num_actions_ready_(0), num_actions_total_(0), order_(0)
     {
         ui_.task_id  = id;
         ui_.size     = 0;
         is_fillable_ = false;
+        is_held_     = false;
+        is_parked_   = false;
         num_bytes_queued_ = 0;
     }
 
@@ -848,18 +945,12 @@ public:
 
         if (ui_.state != states::complete)
         {
-            for (auto i=std::begin(state.cmds); i != std::end(state.cmds);)
+            auto it = state.cmds.find(ui_.task_id);
+            if (it != std::end(state.cmds))
             {
-                auto cmd = *i;
-                if (cmd->task() == ui_.task_id)
-                {
+                for (auto& cmd : it->second)
                     cmd->cancel();
-                    i = state.cmds.erase(i);
-                }
-                else
-                {
-                    ++i;
-                }
+                state.cmds.erase(it);
             }
 
             assert(task_);
@@ -867,7 +958,7 @@ public:
 
             state.bytes_queued -= ui_.size;
         }
-        if (!(ui_.state == states::complete || ui_.state == states::error))
+        if (!(ui_.state == states::complete || ui_.state == states::error) && !is_parked_)
         {
             state.num_pending_tasks--;
             if (state.num_pending_tasks == 0)
@@ -879,6 +970,34 @@ public:
         }
     }
 
+    // hold the task paused until the batch decides whether it's needed.
+    transition hold(engine::state& state)
+    {
+        LOG_D("Task ", ui_.task_id, " hold");
+
+        is_held_ = true;
+        return pause(state);
+    }
+
+    // the held task turned out not to be needed. it stays paused
+    // but no longer counts as pending work unless it's resumed.
+    void park(engine::state& state)
+    {
+        LOG_D("Task ", ui_.task_id, " park");
+
+        assert(is_held_);
+        is_held_   = false;
+        is_parked_ = true;
+
+        state.num_pending_tasks--;
+        if (state.num_pending_tasks == 0)
+        {
+            LOG_D("All tasks are complete");
+            if (state.on_finish_callback)
+                state.on_finish_callback();
+        }
+    }
+
     void configure(const settings& s)
     {
         if (task_)
@@ -903,13 +1022,15 @@ public:
         return false;
     }
 
-    transition run(engine::state& state)
+    transition run(engine::state& state, std::size_t batch_size)
     {
         if (ui_.state == states::complete ||
             ui_.state == states::error ||
             ui_.state == states::paused)
             return no_transition;
 
+        task_->set_batch_size(batch_size);
+
         auto cmds = task_->create_commands();
 
         LOG_I("Task ", ui_.task_id, " new cmdlist ", cmds->id());
@@ -1040,21 +1161,7 @@ public:
             ui_.state == states::complete)
             return no_transition;
 
-        for (auto it = std::begin(state.cmds); it != std::end(state.cmds); )
-        {
-            auto cmd = *it;
-            if (cmd->task() == ui_.task_id)
-            {
-                cmd->cancel();
-                it = state.cmds.erase(it);
-                assert(num_active_cmdlists_ > 0);
-                --num_active_cmdlists_;
-            }
-            else
-            {
-                ++it;
-            }
-        }
+        cancel_cmdlists(state);
 
         return goto_state(state, states::paused);
     }
@@ -1066,6 +1173,12 @@ public:
         if (ui_.state != states::paused)
             return no_transition;
 
+        if (is_parked_)
+            state.num_pending_tasks++;
+
+        is_held_   = false;
+        is_parked_ = false;
+
         // it's possible that user paused the task but all
         // command were already processed by the background
         // threads but are queued waiting for state transition.
@@ -1175,6 +1288,13 @@ public:
     void set_batch(std::size_t batch)
     { ui_.batch_id = batch; }
 
+    // set the key for the task's position in the task list.
+    void set_order(std::int64_t order)
+    { order_ = order; }
+
+    std::int64_t order() const
+    { return order_; }
+
     std::size_t account() const
     { return ui_.account; }
 
@@ -1206,6 +1326,45 @@ public:
                (ui_.batch_id != 0);
     }
 
+    // get the path to the main .par2 file produced by this task if any.
+    std::string par2_file() const
+    {
+        if (auto* ptr = dynamic_cast<const class download*>(task_.get()))
+        {
+            const auto& files = ptr->files();
+            for (const auto& file : files)
+            {
+                if (file->is_binary() && is_main_par2(file->filename()))
+                    return fs::joinpath(file->filepath(), file->filename());
+            }
+        }
+        return "";
+    }
+
+    // collect the files produced by this task.
+    void list_files(std::vector<const datafile*>& files) const
+    {
+        if (auto* ptr = dynamic_cast<const class download*>(task_.get()))
+        {
+            for (const auto& file : ptr->files())
+                files.push_back(file.get());
+        }
+    }
+
+    bool is_held() const
+    { return is_held_; }
+
+    bool is_parked() const
+    { return is_parked_; }
+
+    void set_par2(std::shared_ptr<const par2_set> set)
+    {
+        if (ui_.state == states::complete || ui_.state == states::error)
+            return;
+        if (auto* ptr = dynamic_cast<class download*>(task_.get()))
+            ptr->set_par2(set);
+    }
+
 
 
 private:
@@ -1261,6 +1420,21 @@ private:
         return no_transition;
     }
 
+    void cancel_cmdlists(engine::state& state)
+    {
+        auto it = state.cmds.find(ui_.task_id);
+        if (it == std::end(state.cmds))
+            return;
+
+        for (auto& cmd : it->second)
+        {
+            cmd->cancel();
+            assert(num_active_cmdlists_ > 0);
+            --num_active_cmdlists_;
+        }
+        state.cmds.erase(it);
+    }
+
     void do_action(engine::state& state, std::unique_ptr<action> a)
     {
         if (!a) return;
@@ -1303,22 +1477,7 @@ private:
 
             case states::crunching:
                 ui_.state   = new_state;
-                for (auto it = std::begin(state.cmds); it != std::end(state.cmds);)
-                {
-                    auto cmd = *it;
-                    if (cmd->task() == ui_.task_id)
-                    {
-                        cmd->cancel();
-                        it = state.cmds.erase(it);
-                        assert(num_active_cmdlists_ > 0);
-                        --num_active_cmdlists_;
-                    }
-                    else
-                    {
-                        ++it;
-                    }
-
-                }
+                cancel_cmdlists(state);
                 break;
 
             case states::complete:
@@ -1329,6 +1488,22 @@ private:
 
                 task_->commit();
 
+                // the crc of a multipart binary can only be checked
+                // once all the parts have been downloaded.
+                if (auto* ptr = dynamic_cast<class download*>(task_.get()))
+                {
+                    const auto& files = ptr->files();
+                    for (const auto& file : files)
+                    {
+                        if (file->has_crc_mismatch())
+                            ui_.error.set(ui::task::errors::damaged);
+
+                        const auto* verifier = file->verifier();
+                        if (verifier && !verifier->is_verified())
+                            ui_.error.set(ui::task::errors::damaged);
+                    }
+                }
+
                 ui_.state   = new_state;
                 ui_.etatime = 0;
                 if (state.on_task_callback)
@@ -1346,6 +1521,15 @@ private:
                         ui.path    = file->filepath();
                         ui.size    = file->size();
                         ui.damaged = ui_.error.any_bit();
+                        ui.verified = false;
+                        if (const auto* verifier = file->verifier())
+                        {
+                            ui.verified = verifier->is_verified();
+                            ui.damaged_slices = verifier->damaged_slices();
+                            // the par2 verdict is about this very file and 
+                            // overrides any errors elsewhere in the task.
+                            ui.damaged = !ui.verified;
+                        }
                         state.on_file_callback(ui);
                     }
                 }
@@ -1385,12 +1569,13 @@ private:
                 if (state.on_task_callback)
                     state.on_task_callback(ui_);
 
-                for (auto i=std::begin(state.cmds); i != std::end(state.cmds); ++i)
                 {
-                    auto cmd = *i;
-                    if (cmd->task() != ui_.task_id)
-                        continue;
-                    cmd->cancel();
+                    auto it = state.cmds.find(ui_.task_id);
+                    if (it != std::end(state.cmds))
+                    {
+                        for (auto& cmd : it->second)
+                            cmd->cancel();
+                    }
                 }
                 break;
         }
@@ -1423,8 +1608,11 @@ private:
     std::size_t num_actions_ready_;
     std::size_t num_actions_total_;
     std::size_t num_bytes_queued_;
+    std::int64_t order_;
 private:
     bool is_fillable_;
+    bool is_held_;
+    bool is_parked_;
 };
 
 // for msvc...
@@ -1438,8 +1626,10 @@ class engine::batch
         ui_.task_id  = id;
         std::fill(std::begin(statesets_), std::end(statesets_), 0);
         filebatch_  = false;
+        released_   = false;
         num_slices_ = 0;
         num_tasks_  = 0;
+        num_held_   = 0;
     }
 
 public:
@@ -1554,12 +1744,17 @@ public:
             if (task->bid() != ui_.batch_id)
                 continue;
 
+            // the held back recovery volumes are resumed one by one.
+            if (task->is_held() || task->is_parked())
+                continue;
+
             const auto transition = task->resume(state);
             if (transition)
             {
                 leave_state(*task, transition.previous);
                 enter_state(*task, transition.current);
             }
+            state.schedule(*task);
         }
         update(state);
     }
@@ -1594,7 +1789,10 @@ public:
             });
 
         for (auto i=it; i != std::end(state.tasks); ++i)
+        {
             (*i)->kill(state);
+            state.remove_task(**i);
+        }
 
         state.tasks.erase(it, std::end(state.tasks));
     }
@@ -1603,7 +1801,16 @@ public:
     {
         leave_state(t, t.state());
         num_tasks_--;
-        update(state);
+
+        // killing the last file that isn't held leaves only the
+        // recovery volumes which then need to be released.
+        if (filebatch_ && num_tasks_)
+        {
+            count_held(state, &t);
+            if (!released_ && is_full_set(states::complete, states::error))
+                release_volumes(state, &t);
+        }
+        update(state, &t);
 
         return num_tasks_ == 0;
     }
@@ -1614,6 +1821,18 @@ public:
 
         leave_state(t, s.previous);
         enter_state(t, s.current);
+
+        // the recovery volumes must be released before the batch
+        // state is updated, otherwise the batch would be complete.
+        if (filebatch_ && (s.current == states::complete || s.current == states::error))
+        {
+            if (s.current == states::complete && !par2_)
+                load_par2(state, t);
+
+            count_held(state);
+            if (!released_ && is_full_set(states::complete, states::error))
+                release_volumes(state);
+        }
         update(state);
 
         if (!filebatch_)
@@ -1638,12 +1857,17 @@ public:
 
         double total = 0.0;
 
-        const double slice = 1.0 / (double)num_slices_;
+        // the parked recovery volumes aren't going to be downloaded.
+        count_held(state);
+
+        const double slice = 1.0 / (double)(num_slices_ - num_held_);
         for (auto it = std::begin(state.tasks); it != std::end(state.tasks); ++it)
         {
             const auto& task = *it;
             if (task->bid() != ui_.batch_id)
                 continue;
+            if (task->is_held() || task->is_parked())
+                continue;
             double done = task->done() / 100.0;
             total += done * slice;
         }
@@ -1655,6 +1879,39 @@ public:
     { return ui_.batch_id; }
 
 private:
+    // once the main .par2 file of the batch is downloaded its slice
+    // checksums are used to verify the rest of the files while they're
+    // being downloaded.
+    void load_par2(engine::state& state, const task& t)
+    {
+        const auto file = t.par2_file();
+        if (file.empty())
+            return;
+
+        auto set = std::make_shared<par2_set>();
+        try
+        {
+            if (!newsflash::load_par2(file, *set))
+            {
+                LOG_W("Batch ", ui_.batch_id, " par2 file ", file, " has no recovery set");
+                return;
+            }
+        }
+        catch (const std::exception& e)
+        {
+            LOG_E("Batch ", ui_.batch_id, " failed to read par2 file ", file, " ", e.what());
+            return;
+        }
+        LOG_I("Batch ", ui_.batch_id, " verifying ", set->files.size(), " files with ", file);
+
+        par2_ = set;
+        for (auto& task : state.tasks)
+        {
+            if (task->bid() == ui_.batch_id)
+                task->set_par2(par2_);
+        }
+    }
+
     void enter_state(const task& t, states s)
     {
         statesets_[(int)s]++;
@@ -1671,19 +1928,126 @@ private:
         return statesets_[(int)s] == 0;
     }
 
+    // the held and parked tasks are paused but they don't keep
+    // the rest of the batch from being in the given state(s).
     bool is_full_set(states s)
     {
-        return statesets_[(int)s] == num_tasks_;
+        return statesets_[(int)s] + num_held_ == num_tasks_;
     }
     bool is_full_set(states a, states b)
     {
         const auto num_a = statesets_[(int)a];
         const auto num_b = statesets_[(int)b];
-        return num_a + num_b == num_tasks_;
+        return num_a + num_b + num_held_ == num_tasks_;
+    }
+
+    void count_held(engine::state& state, const task* killed = nullptr)
+    {
+        num_held_ = std::count_if(std::begin(state.tasks), std::end(state.tasks),
+            [&](const std::unique_ptr<task>& t) {
+                return t->bid() == ui_.batch_id && t.get() != killed &&
+                    (t->is_held() || t->is_parked());
+            });
+    }
+
+    // once every other file of the batch is done the held recovery volumes
+    // are released. if every file was verified against the par2 set then 
+    // the number of damaged and missing slices is known and only enough 
+    // volumes to cover them are released, the rest are parked.
+    void release_volumes(engine::state& state, const task* killed = nullptr)
+    {
+        released_ = true;
+
+        std::vector<task*> volumes;
+        std::vector<const datafile*> files;
+        for (auto& t : state.tasks)
+        {
+            if (t->bid() != ui_.batch_id || t.get() == killed)
+                continue;
+            if (t->is_held())
+                volumes.push_back(t.get());
+            else t->list_files(files);
+        }
+        if (volumes.empty())
+            return;
+
+        bool known = par2_ != nullptr;
+        std::uint64_t needed = 0;
+        if (known)
+        {
+            for (const auto& desc : par2_->files)
+            {
+                auto it = std::find_if(std::begin(files), std::end(files),
+                    [&](const datafile* f) {
+                        return f->is_binary() && par2_->find_file(f->binary_name()) == &desc;
+                    });
+                if (it == std::end(files))
+                    needed += desc.crcs.size();
+                else if (const auto* verifier = (*it)->verifier())
+                    needed += verifier->damaged_slices().size();
+                else known = false;
+            }
+        }
+
+        const auto blocks = [](const task* t) {
+            std::uint32_t num_blocks = 0;
+            is_par2_volume(t->desc(), num_blocks);
+            return (std::uint64_t)num_blocks;
+        };
+
+        std::vector<task*> release;
+        if (!known)
+        {
+            LOG_I("Batch ", ui_.batch_id, " has unverified files, releasing all recovery volumes");
+            release = std::move(volumes);
+        }
+        else
+        {
+            LOG_I("Batch ", ui_.batch_id, " needs ", needed, " recovery blocks");
+
+            // take the smallest volume that covers the rest of the blocks
+            // or if there's no such volume then the largest one and repeat.
+            std::sort(std::begin(volumes), std::end(volumes), 
+                [&](const task* a, const task* b) {
+                    return blocks(a) < blocks(b);
+                });
+            while (needed && !volumes.empty())
+            {
+                auto it = std::find_if(std::begin(volumes), std::end(volumes),
+                    [&](const task* t) {
+                        return blocks(t) >= needed;
+                    });
+                if (it == std::end(volumes))
+                    it = std::prev(std::end(volumes));
+
+                needed -= std::min(needed, blocks(*it));
+                release.push_back(*it);
+                volumes.erase(it);
+            }
+        }
+
+        for (auto* t : release)
+        {
+            LOG_I("Batch ", ui_.batch_id, " releasing ", t->desc());
+            const auto transition = t->resume(state);
+            if (transition)
+            {
+                leave_state(*t, transition.previous);
+                enter_state(*t, transition.current);
+            }
+            state.schedule(*t);
+        }
+        for (auto* t : volumes)
+        {
+            LOG_I("Batch ", ui_.batch_id, " parking ", t->desc());
+            t->park(state);
+        }
     }
 
-    void update(engine::state& state)
+    void update(engine::state& state, const task* killed = nullptr)
     {
+        count_held(state, killed);
+
         const std::size_t num_states = std::accumulate(std::begin(statesets_),
             std::end(statesets_), 0);
         assert(num_states == num_tasks_);
@@ -1696,7 +2060,7 @@ private:
         else if (is_full_set(states::crunching))
             goto_state(state, states::crunching);
 
-        if (!is_empty_set(states::paused))
+        if (statesets_[(int)states::paused] > num_held_)
             goto_state(state, states::paused);
         else if (is_full_set(states::complete, states::error))
         {
@@ -1741,7 +2105,10 @@ private:
     std::size_t num_slices_;
     std::size_t num_tasks_;
     std::size_t statesets_[7];
+    std::size_t num_held_;
+    std::shared_ptr<const par2_set> par2_;
     bool filebatch_;
+    bool released_;
 };
 
 engine::batch& engine::state::find_batch(std::size_t id)
@@ -1754,73 +2121,239 @@ engine::batch& engine::state::find_batch(std::size_t id)
     return *(*it);
 }
 
-void engine::state::execute()
+bool engine::state::task_order::operator()(const engine::task* lhs, const engine::task* rhs) const
 {
-    if (!started)
+    return lhs->order() < rhs->order();
+}
+
+engine::task* engine::state::find_task(std::size_t id)
+{
+    auto it = task_index.find(id);
+    if (it == std::end(task_index))
+        return nullptr;
+    return it->second;
+}
+
+engine::conn* engine::state::find_conn(std::size_t id)
+{
+    auto it = conn_index.find(id);
+    if (it == std::end(conn_index))
+        return nullptr;
+    return it->second;
+}
+
+void engine::state::add_task(std::unique_ptr<engine::task> t, bool front)
+{
+    auto* ptr = t.get();
+    task_index[ptr->tid()] = ptr;
+
+    if (front)
+    {
+        ptr->set_order(front_order--);
+        tasks.push_front(std::move(t));
+    }
+    else
+    {
+        ptr->set_order(++back_order);
+        tasks.push_back(std::move(t));
+    }
+    schedule(*ptr);
+}
+
+void engine::state::remove_task(const engine::task& t)
+{
+    task_index.erase(t.tid());
+    cmds.erase(t.tid());
+
+    auto it = queues.find(t.account());
+    if (it != std::end(queues))
+        it->second.runnable.erase(const_cast<engine::task*>(&t));
+}
+
+void engine::state::swap_tasks(std::size_t i, std::size_t j)
+{
+    auto* a = tasks[i].get();
+    auto* b = tasks[j].get();
+
+    // the keys can't change while the tasks are in the runnable sets.
+    auto& runnable_a = queues[a->account()].runnable;
+    auto& runnable_b = queues[b->account()].runnable;
+    const auto has_a = runnable_a.erase(a);
+    const auto has_b = runnable_b.erase(b);
+
+    const auto order = a->order();
+    a->set_order(b->order());
+    b->set_order(order);
+    std::swap(tasks[i], tasks[j]);
+
+    if (has_a)
+        runnable_a.insert(a);
+    if (has_b)
+        runnable_b.insert(b);
+}
+
+void engine::state::reorder_tasks()
+{
+    for (auto& q : queues)
+        q.second.runnable.clear();
+
+    front_order = 0;
+    back_order  = 0;
+    for (auto& t : tasks)
+    {
+        t->set_order(++back_order);
+        schedule(*t);
+    }
+}
+
+void engine::state::schedule(engine::task& t)
+{
+    if (!t.eligible_for_run())
         return;
 
-    for (auto it = std::begin(tasks); it != std::end(tasks); ++it)
+    queues[t.account()].runnable.insert(&t);
+}
+
+void engine::state::add_conn(std::unique_ptr<engine::conn> c)
+{
+    conn_index[c->id()] = c.get();
+    queues[c->account()].num_conns++;
+    conns.push_back(std::move(c));
+}
+
+void engine::state::reindex_conns()
+{
+    conn_index.clear();
+    for (auto& q : queues)
+        q.second.num_conns = 0;
+
+    for (auto& c : conns)
     {
-        auto& task  = *it;
-        if (!task->eligible_for_run())
+        conn_index[c->id()] = c.get();
+        queues[c->account()].num_conns++;
+    }
+}
+
+void engine::state::ready(engine::conn& c)
+{
+    auto& queue = queues[c.account()];
+
+    // the cmdlists that are already waiting go first.
+    while (!queue.pending_cmds.empty())
+    {
+        auto cmd = queue.pending_cmds.front();
+        queue.pending_cmds.pop_front();
+        if (cmd->conn() || cmd->is_canceled() || cmd->account() != c.account())
             continue;
 
-        std::size_t num_conns = std::count_if(std::begin(conns), std::end(conns),
-            [&](const std::unique_ptr<engine::conn>& c) {
-                return c->account() == task->account();
-            });
+        auto* task = find_task(cmd->task());
+        ASSERT(task);
 
-        const auto& acc = find_account(task->account());
-        for (auto i=num_conns; i<acc.connections; ++i)
-            conns.emplace_back(new engine::conn(acc.id, oid++, *this));
+        c.execute(*this, cmd, task->tid(), task->desc());
+        cmd->set_conn(c.id());
+        return;
+    }
 
-        while (task->eligible_for_run())
-        {
-            auto it = std::find_if(std::begin(conns), std::end(conns),
-                [&](const std::unique_ptr<engine::conn>& c) {
-                    return c->is_ready() && (c->account() == task->account());
-                });
-            if (it == std::end(conns))
-                break;
+    if (!c.in_ready_queue())
+    {
+        c.set_in_ready_queue(true);
+        queue.ready_conns.push_back(c.id());
+    }
+    execute(c.account(), queue);
+}
 
-            const auto transition = task->run(*this);
-            if (transition)
-            {
-                auto& batch = find_batch(task->bid());
-                batch.update(*this, *task, transition);
-            }
-        }
+engine::conn* engine::state::peek_ready_conn(account_queue& queue)
+{
+    while (!queue.ready_conns.empty())
+    {
+        auto* conn = find_conn(queue.ready_conns.front());
+        if (conn && conn->is_ready())
+            return conn;
+
+        if (conn)
+            conn->set_in_ready_queue(false);
+        queue.ready_conns.pop_front();
     }
+    return nullptr;
 }
 
-void engine::state::enqueue(const task& t, std::shared_ptr<cmdlist> cmd)
+engine::conn* engine::state::take_ready_conn(account_queue& queue)
 {
-    cmd->set_conn(0);
-    cmds.push_back(cmd);
+    auto* conn = peek_ready_conn(queue);
+    if (conn)
+    {
+        conn->set_in_ready_queue(false);
+        queue.ready_conns.pop_front();
+    }
+    return conn;
+}
 
+void engine::state::execute()
+{
     if (!started)
         return;
 
-    std::size_t num_conns = 0;
+    for (auto& q : queues)
+        execute(q.first, q.second);
+}
 
-    for (auto& conn : conns)
+void engine::state::execute(std::size_t account, account_queue& queue)
+{
+    if (!started)
+        return;
+
+    while (!queue.runnable.empty())
     {
-        if (conn->account() != cmd->account())
+        auto* task = *queue.runnable.begin();
+        if (!task->eligible_for_run())
+        {
+            queue.runnable.erase(queue.runnable.begin());
             continue;
+        }
 
-        ++num_conns;
+        const auto& acc = find_account(account);
+        for (auto i=queue.num_conns; i<acc.connections; ++i)
+            add_conn(std::unique_ptr<engine::conn>(new engine::conn(acc.id, oid++, *this)));
 
-        if (!conn->is_ready())
-            continue;
+        // the cmdlist goes to the connection at the front of the ready queue
+        // so it's sized for that connection.
+        const auto* conn = peek_ready_conn(queue);
+        if (!conn)
+            break;
 
-        cmd->set_conn(conn->id());
-        conn->execute(*this, cmd, t.tid(), t.desc());
-        return;
+        const auto transition = task->run(*this, conn->batch_size());
+        if (transition)
+        {
+            auto& batch = find_batch(task->bid());
+            batch.update(*this, *task, transition);
+        }
+    }
+}
+
+void engine::state::enqueue(const task& t, std::shared_ptr<cmdlist> cmd)
+{
+    cmd->set_conn(0);
+    cmds[t.tid()].push_back(cmd);
+
+    auto& queue = queues[cmd->account()];
+
+    if (started)
+    {
+        if (auto* conn = take_ready_conn(queue))
+        {
+            cmd->set_conn(conn->id());
+            conn->execute(*this, cmd, t.tid(), t.desc());
+            return;
+        }
     }
 
+    queue.pending_cmds.push_back(cmd);
+
+    if (!started)
+        return;
 
     const auto& acc = find_account(cmd->account());
-    if (num_conns < acc.connections)
+    if (queue.num_conns < acc.connections)
     {
         // const auto num_acc   = cmd->account();
         // const auto num_tasks = std::count_if(std::begin(tasks), std::end(tasks),
@@ -1831,24 +2364,36 @@ void engine::state::enqueue(const task& t, std::shared_ptr<cmdlist> cmd)
         //     return;
 
         const auto id = oid++;
-        conns.emplace_back(new engine::conn(acc.id, id, *this));
+        add_conn(std::unique_ptr<engine::conn>(new engine::conn(acc.id, id, *this)));
     }
-
 }
 
 
-engine::engine() : state_(new state)
+engine::engine() : engine(threadpool::default_num_threads())
+{}
+
+engine::engine(std::size_t num_threads) : state_(new state)
 {
-    state_->threads.reset(new threadpool(4));
+    state_->threads.reset(new threadpool(num_threads));
 
+    // the notification only tells the pump to run, it takes all the
+    // actions completed by then so one pending notification is enough.
     state_->threads->on_complete = [&](action* a)
     {
-        std::lock_guard<std::mutex> lock(state_->mutex);
-        state_->actions.emplace(a);
-        state_->on_notify_callback();
+        if (state_->actions.push(a))
+            state_->on_notify_callback();
     };
 
+#if defined(LINUX_OS)
+    // a couple of event loops is plenty for all the connections
+    // since they're mostly waiting for the network.
+    state_->reactor.reset(new reactor(2));
+    state_->reactor->on_complete = state_->threads->on_complete;
+#endif
+
     state_->oid                   = 1;
+    state_->front_order           = 0;
+    state_->back_order            = 0;
     state_->fill_account          = 0;
     state_->bytes_downloaded      = 0;
     state_->bytes_queued          = 0;
@@ -1872,6 +2417,10 @@ engine::~engine()
 
     state_->threads->shutdown();
     state_->threads.reset();
+#if defined(LINUX_OS)
+    state_->reactor->shutdown();
+    state_->reactor.reset();
+#endif
 }
 
 void engine::test_account(const ui::account& acc)
@@ -1936,6 +2485,7 @@ void engine::set_account(const ui::account& acc)
         });
 
     state_->conns.erase(end, std::end(state_->conns));
+    state_->reindex_conns();
 
     //const auto have_tasks = std::find_if(std::begin(state_->tasks), std::end(state_->tasks),
     //    [&](const std::unique_ptr<task>& t) {
@@ -1948,10 +2498,7 @@ void engine::set_account(const ui::account& acc)
     // if there are less than the minimum number of allowed, we spawn
     // new connections, otherwise the shrink the connection list down
     // to the max allowed.
-    const auto num_conns = std::count_if(std::begin(state_->conns), std::end(state_->conns),
-        [&](const std::unique_ptr<conn>& c) {
-            return c->account() == acc.id;
-        });
+    const auto num_conns = state_->queues[acc.id].num_conns;
 
     if (num_conns < acc.connections)
     {
@@ -1961,12 +2508,13 @@ void engine::set_account(const ui::account& acc)
         for (auto i = num_conns; i<acc.connections; ++i)
         {
             const auto cid = state_->oid++;
-            state_->conns.emplace_back(new engine::conn(acc.id, cid, *state_));
+            state_->add_conn(std::unique_ptr<conn>(new engine::conn(acc.id, cid, *state_)));
         }
     }
     else if (num_conns > acc.connections)
     {
         state_->conns.resize(acc.connections);
+        state_->reindex_conns();
     }
 }
 
@@ -1978,6 +2526,7 @@ void engine::del_account(std::size_t id)
         });
 
     state_->conns.erase(end, std::end(state_->conns));
+    state_->reindex_conns();
 
     auto it = std::find_if(std::begin(state_->accounts), std::end(state_->accounts),
         [&](const ui::account& a) {
@@ -2002,10 +2551,27 @@ engine::action_id_t engine::download_files(ui::batch batch, bool priority)
     s.discard_text_content = state_->discard_text;
     s.overwrite_existing_files = state_->overwrite_existing;
 
+    // download the main .par2 file first so that the other files can be
+    // verified against it while they're downloaded. the tasks added to
+    // the front end up in reverse order.
+    const auto is_main = [](const ui::download& d) {
+        return is_main_par2(d.name);
+    };
+    const auto has_par2 = std::any_of(std::begin(batch.files), std::end(batch.files), is_main);
+    if (priority)
+        std::stable_partition(std::begin(batch.files), std::end(batch.files), 
+            [&](const ui::download& d) { return !is_main(d); });
+    else std::stable_partition(std::begin(batch.files), std::end(batch.files), is_main);
+
     for (auto& file : batch.files)
     {
         const auto taskid = state_->oid++;
 
+        // the recovery volumes are held back until it's known how many
+        // recovery blocks are needed, which needs the main .par2 file.
+        std::uint32_t num_blocks = 0;
+        const auto hold = has_par2 && is_par2_volume(file.name, num_blocks);
+
         file.path = batch.path;
         std::unique_ptr<engine::task> job(new class engine::task(taskid, std::move(file)));
         job->configure(s);
@@ -2014,9 +2580,14 @@ engine::action_id_t engine::download_files(ui::batch batch, bool priority)
 
         assert(job->is_valid());
 
-        if (priority)
-            state_->tasks.push_front(std::move(job));
-        else state_->tasks.push_back(std::move(job));
+        auto* ptr = job.get();
+        engine::task::transition transition = engine::task::no_transition;
+        if (hold)
+            transition = job->hold(*state_);
+
+        state_->add_task(std::move(job), priority);
+        if (transition)
+            b->update(*state_, *ptr, transition);
 
         state_->bytes_queued += file.size;
         state_->num_pending_tasks++;
@@ -2040,7 +2611,7 @@ engine::action_id_t engine::download_listing(ui::listing list)
 
     assert(job->is_valid());
 
-    state_->tasks.push_back(std::move(job));
+    state_->add_task(std::move(job), false);
     state_->batches.push_back(std::move(batch));
     state_->num_pending_tasks++;
     state_->execute();
@@ -2059,7 +2630,7 @@ engine::action_id_t engine::download_headers(ui::update update)
 
     assert(task->is_valid());
 
-    state_->tasks.push_back(std::move(task));
+    state_->add_task(std::move(task), false);
     state_->batches.push_back(std::move(batch));
     state_->num_pending_tasks++;
     state_->execute();
@@ -2144,14 +2715,8 @@ bool engine::pump()
             }
             #endif
 
-            auto tit  = std::find_if(std::begin(state_->tasks), std::end(state_->tasks),
-                [&](const std::unique_ptr<engine::task>& t) {
-                    return t->tid() == tid;
-                });
-            if (tit != std::end(state_->tasks))
+            if (auto* task = state_->find_task(tid))
             {
-                auto& task = *tit;
-
                 if (e->has_exception())
                 {
                     LOG_E("Action ", e->get_id(), " (", e->describe(), " ) has an exception. Cmdlist ", cmds->id(), " not ready.");
@@ -2159,9 +2724,10 @@ bool engine::pump()
                 }
                 else
                 {
-                    auto it = std::find(std::begin(state_->cmds), std::end(state_->cmds), cmds);
-                    if (it != std::end(state_->cmds))
-                        state_->cmds.erase(it);
+                    auto& active = state_->cmds[tid];
+                    auto it = std::find(std::begin(active), std::end(active), cmds);
+                    if (it != std::end(active))
+                        active.erase(it);
 
                     const auto transition = task->complete(*state_, cmds);
                     if (transition)
@@ -2169,6 +2735,7 @@ bool engine::pump()
                         auto& batch = state_->find_batch(task->bid());
                         batch.update(*state_, *task, transition);
                     }
+                    state_->schedule(*task);
                 }
             }
             state_->bytes_downloaded += bytes;
@@ -2181,54 +2748,13 @@ bool engine::pump()
         }
 
         const auto id = action->get_owner();
-        auto it = std::find_if(std::begin(state_->conns), std::end(state_->conns),
-            [&](const std::unique_ptr<engine::conn>& c) {
-                return c->id() == id;
-            });
-        if (it != std::end(state_->conns))
+        if (auto* conn = state_->find_conn(id))
         {
-            auto& conn = *it;
+            // give the connection the next pending cmdlist or 
+            // run the next task on the account.
             conn->on_action(*state_, std::move(action));
             if (conn->is_ready())
-            {
-                auto it = std::find_if(std::begin(state_->cmds), std::end(state_->cmds),
-                    [&](const std::shared_ptr<cmdlist>& c) {
-                        return c->conn() == 0 &&
-                               c->account() == conn->account() &&
-                               c->is_canceled() == false;
-                           });
-                if (it != std::end(state_->cmds))
-                {
-                    auto cmd = *it;
-                    auto tit = std::find_if(std::begin(state_->tasks), std::end(state_->tasks),
-                        [&](const std::unique_ptr<task>& t) {
-                            return t->tid() == cmd->task();
-                        });
-                    ASSERT(tit != std::end(state_->tasks));
-                    auto& task = *tit;
-
-                    conn->execute(*state_, cmd, task->tid(), task->desc());
-                    cmd->set_conn(conn->id());
-                }
-                else
-                {
-                    auto it = std::find_if(std::begin(state_->tasks), std::end(state_->tasks),
-                        [&](const std::unique_ptr<engine::task>& t) {
-                            return t->account() == conn->account() &&
-                                   t->eligible_for_run();
-                               });
-                    if (it != std::end(state_->tasks))
-                    {
-                        auto& task = *it;
-                        const auto transition = task->run(*state_);
-                        if (transition)
-                        {
-                            auto& batch = state_->find_batch(task->bid());
-                            batch.update(*state_, *task, transition);
-                        }
-                    }
-                }
-            }
+                state_->ready(*conn);
         }
         else if (state_->current_connection_test &&
             state_->current_connection_test->id() == id)
@@ -2239,33 +2765,26 @@ bool engine::pump()
         }
         else
         {
-            for (auto& task : state_->tasks)
+            if (auto* task = state_->find_task(id))
             {
-                if (task->tid() != id)
-                    continue;
-
                 const auto transition = task->on_action(*state_, std::move(action));
                 if (transition)
                 {
                     auto& batch = state_->find_batch(task->bid());
                     batch.update(*state_, *task, transition);
                 }
-                // if (task->eligible_for_run())
-                // {
-                //     const auto transition = task->run(*state_);
-                //     if (transition)
-                //     {
-                //         auto& batch = state_->find_batch(task->bid());
-                //         batch.update(*state_, *task, transition);
-                //     }
-                // }
-                break;
+                state_->schedule(*task);
             }
             state_->execute();
         }
         state_->num_pending_actions--;
     }
 
+    // if we quit with some actions still in the batch nobody's going
+    // to notify about them, so we need to come back for them.
+    if (state_->actions.suspend())
+        state_->on_notify_callback();
+
     LOG_FLUSH();
 
     return state_->num_pending_actions != 0;
@@ -2284,7 +2803,7 @@ void engine::tick()
                     return t->bid() == batch->id();
                 });
         }
-
+        state_->reorder_tasks();
         state_->repartition_task_list = false;
     }
 
@@ -2330,11 +2849,21 @@ void engine::stop()
 
     LOG_I("Engine stopping");
 
+    const auto pool = bufferpool::get_stats();
+    LOG_I("Buffer pool hits ", pool.hits, " misses ", pool.misses,
+        " peak resident ", size{pool.peak_resident_bytes});
+
+    const auto completions = state_->actions.get_stats();
+    LOG_I("Completed actions ", completions.num_actions, " notifications ", completions.num_notifications,
+        " latency avg ", completions.num_actions ? completions.total_latency_us / completions.num_actions : 0,
+        " us max ", completions.max_latency_us, " us");
+
     for (auto& conn : state_->conns)
     {
         conn->stop(*state_);
     }
     state_->conns.clear();
+    state_->reindex_conns();
     state_->started = false;
     state_->logger->flush();
 }
@@ -2446,7 +2975,7 @@ void engine::load_session(const std::string& file)
 
         assert(task->is_valid());
 
-        state_->tasks.push_back(std::move(task));
+        state_->add_task(std::move(task), false);
     }
 
     state_->oid = list.current_id();
@@ -2608,6 +3137,39 @@ std::uint64_t engine::get_bytes_downloaded() const
     return state_->bytes_downloaded;
 }
 
+std::uint64_t engine::get_buffer_pool_hits() const
+{
+    return bufferpool::get_stats().hits;
+}
+
+std::uint64_t engine::get_buffer_pool_misses() const
+{
+    return bufferpool::get_stats().misses;
+}
+
+std::uint64_t engine::get_buffer_pool_peak_bytes() const
+{
+    return bufferpool::get_stats().peak_resident_bytes;
+}
+
+std::uint64_t engine::get_completion_latency_avg() const
+{
+    const auto stats = state_->actions.get_stats();
+    if (stats.num_actions == 0)
+        return 0;
+    return stats.total_latency_us / stats.num_actions;
+}
+
+std::uint64_t engine::get_completion_latency_max() const
+{
+    return state_->actions.get_stats().max_latency_us;
+}
+
+std::uint64_t engine::get_completion_notifications() const
+{
+    return state_->actions.get_stats().num_notifications;
+}
+
 std::string engine::get_logfile() const
 {
     return fs::joinpath(state_->logpath, "engine.log");
@@ -2628,7 +3190,7 @@ void engine::set_group_items(bool on_off)
                     return t->bid() == batch->id();
                 });
         }
-
+        state_->reorder_tasks();
         state_->repartition_task_list = false;
     }
 }
@@ -2687,6 +3249,7 @@ void engine::kill_connection(std::size_t i)
     it += i;
     (*it)->stop(*state_);
     state_->conns.erase(it);
+    state_->reindex_conns();
 }
 
 void engine::clone_connection(std::size_t i)
@@ -2699,7 +3262,7 @@ void engine::clone_connection(std::size_t i)
 
     auto& dna  = state_->conns[i];
     auto dolly = std::unique_ptr<conn>(new conn(cid, *state_, *dna));
-    state_->conns.push_back(std::move(dolly));
+    state_->add_conn(std::move(dolly));
 }
 
 void engine::kill_task(std::size_t i)
@@ -2734,6 +3297,7 @@ void engine::kill_task(std::size_t i)
         }
 
         task->kill(*state_);
+        state_->remove_task(*task);
         state_->tasks.erase(tit);
     }
 
@@ -2788,6 +3352,7 @@ void engine::resume_task(std::size_t index)
             auto& batch = state_->find_batch(task->bid());
             batch.update(*state_, *task, transition);
         }
+        state_->schedule(*task);
 
     }
     state_->execute();
@@ -2809,7 +3374,7 @@ void engine::move_task_up(std::size_t index)
         assert(state_->tasks.size() > 1);
         assert(index < state_->tasks.size());
         assert(index > 0);
-        std::swap(state_->tasks[index], state_->tasks[index - 1]);
+        state_->swap_tasks(index, index - 1);
     }
 }
 
@@ -2827,7 +3392,7 @@ void engine::move_task_down(std::size_t index)
     {
         assert(state_->tasks.size() > 1);
         assert(index < state_->tasks.size()-1);
-        std::swap(state_->tasks[index], state_->tasks[index + 1]);
+        state_->swap_tasks(index, index + 1);
     }
 }
 
@@ -88,7 +88,13 @@ namespace newsflash
 
         using action_id_t = std::size_t;
 
+        // create the engine with a worker thread for each hardware thread.
         engine();
+
+        // create the engine with num_threads worker threads for
+        // decoding, writing and other data processing.
+        // precondition: num_threads > 0
+        engine(std::size_t num_threads);
        ~engine();
 
         void test_account(const ui::account& acc);
@@ -213,6 +219,28 @@ namespace newsflash
         // and includes a few bytes of protocol data per transaction.
         std::uint64_t get_bytes_downloaded() const;
 
+        // get the number of article buffer allocations served from the buffer pool.
+        std::uint64_t get_buffer_pool_hits() const;
+
+        // get the number of article buffer allocations that had to allocate new memory.
+        std::uint64_t get_buffer_pool_misses() const;
+
+        // get the highest number of bytes held by the buffer pool so far,
+        // both the buffers in use and the ones cached for reuse.
+        std::uint64_t get_buffer_pool_peak_bytes() const;
+
+        // get the average time in microseconds from an action being completed
+        // to the action being handled in pump.
+        std::uint64_t get_completion_latency_avg() const;
+
+        // get the maximum time in microseconds from an action being completed
+        // to the action being handled in pump.
+        std::uint64_t get_completion_latency_max() const;
+
+        // get the number of async notifications requested for completed actions.
+        // the notifications are coalesced so this is less than the number of actions.
+        std::uint64_t get_completion_notifications() const;
+
         std::string get_logfile() const;
 
         // get whether engine is started or not.
@@ -91,6 +91,22 @@ public:
             throw std::runtime_error("file write failed");        
     }
 
+    void sync()
+    {
+        if (FlushFileBuffers(file_) == 0)
+            throw std::runtime_error("file sync failed");
+    }
+
+    void resize(std::uint64_t size)
+    {
+        LARGE_INTEGER pos;
+        pos.QuadPart = size;
+        if (SetFilePointerEx(file_, pos, NULL, FILE_BEGIN) == 0)
+            throw std::runtime_error("file seek failed");
+        if (SetEndOfFile(file_) == 0)
+            throw std::runtime_error("file resize failed");
+    }
+
     std::size_t size() const 
     {
         LARGE_INTEGER size;
@@ -126,21 +142,27 @@ public:
     }
     void read(void* buff, std::size_t bytes, std::size_t offset)
     {
-        if (::lseek64(file_, offset, SEEK_SET) == off64_t(-1))
-            throw std::runtime_error("file seek failed");
-        if (::read(file_, buff, bytes) == -1)
+        if (::pread64(file_, buff, bytes, offset) == -1)
             throw std::runtime_error("file read failed");
     }
 
     void write(const void* buff, std::size_t bytes, std::size_t offset)
     {
-        // lseek allows the seek to be set beyond the existing end of file.
-        if (::lseek64(file_, offset, SEEK_SET) == off64_t(-1))
-            throw std::runtime_error("file seek failed");
-        if (::write(file_, buff, bytes) == -1)
+        // the offset can be beyond the existing end of file.
+        if (::pwrite64(file_, buff, bytes, offset) == -1)
             throw std::runtime_error("file write failed");
+    }
 
-        //::fdatasync(file_); // todo: ??
+    void sync()
+    {
+        if (::fdatasync(file_) == -1)
+            throw std::runtime_error("file sync failed");
+    }
+
+    void resize(std::size_t size)
+    {
+        if (::ftruncate64(file_, size) == -1)
+            throw std::runtime_error("file resize failed");
     }
 
     std::size_t size() const
@@ -184,6 +206,16 @@ filebuf::buffer filebuf::load(std::size_t offset, std::size_t size, unsigned fla
     return {fileio_, std::move(vec), offset, write_data};
 }
 
+void filebuf::sync()
+{
+    fileio_->sync();
+}
+
+void filebuf::resize(std::size_t size)
+{
+    fileio_->resize(size);
+}
+
 std::size_t filebuf::size() const 
 {
     return fileio_->size();
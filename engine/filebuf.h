@@ -99,6 +99,12 @@ namespace newsflash
 
         buffer load(std::size_t offset, std::size_t size, unsigned flags);
 
+        // flush the written data to the disk.
+        void sync();
+
+        // truncate or extend the file to the given size.
+        void resize(std::size_t size);
+
         std::size_t size() const;
 
         std::string filename() const;
@@ -19,79 +19,119 @@
 // THE SOFTWARE.
 
 #include <newsflash/config.h>
-#include <newsflash/warnpush.h>
-#  include <boost/regex.hpp>
-#include <newsflash/warnpop.h>
-#include <sstream>
-#include <vector>
 #include <cctype>
 #include "filetype.h"
 
 namespace newsflash
 {
 
-std::vector<std::string> split(const std::string& input)
+namespace {
+
+// the known file extensions. the extension of the filename is matched
+// against these in order and the first one that is a prefix of the
+// extension decides the type. # is any digit.
+const struct known_extension {
+    const char* str;
+    filetype type;
+} extensions[] = {
+    {".mp3",  filetype::audio},
+    {".mp2",  filetype::audio},
+    {".wav",  filetype::audio},
+    {".xm",   filetype::audio},
+    {".flac", filetype::audio},
+    {".m3u",  filetype::audio},
+    {".pls",  filetype::audio},
+    {".mpa",  filetype::audio},
+    {".ogg",  filetype::audio},
+
+    {".avi",  filetype::video},
+    {".mkv",  filetype::video},
+    {".ogm",  filetype::video},
+    {".wmv",  filetype::video},
+    {".wma",  filetype::video},
+    {".mpeg", filetype::video},
+    {".mpg",  filetype::video},
+    {".rm",   filetype::video},
+    {".mov",  filetype::video},
+    {".flv",  filetype::video},
+    {".asf",  filetype::video},
+    {".mp4",  filetype::video},
+    {".3gp",  filetype::video},
+    {".3g2",  filetype::video},
+    {".m4v",  filetype::video},
+
+    {".jpeg", filetype::image},
+    {".jpg",  filetype::image},
+    {".bmp",  filetype::image},
+    {".png",  filetype::image},
+    {".gif",  filetype::image},
+
+    {".txt",  filetype::text},
+    {".nfo",  filetype::text},
+    {".sfv",  filetype::text},
+    {".log",  filetype::text},
+    {".nzb",  filetype::text},
+    {".rtf",  filetype::text},
+    {".cue",  filetype::text},
+
+    // .part001.rar is covered by the .rar since only the
+    // last extension is looked at.
+    {".zip",  filetype::archive},
+    {".rar",  filetype::archive},
+    {".7z",   filetype::archive},
+    {".r#",   filetype::archive},
+    {".##",   filetype::archive},
+
+    {".par",  filetype::parity},
+    {".par2", filetype::parity},
+
+    {".doc",  filetype::document},
+    {".chm",  filetype::document},
+    {".pdf",  filetype::document}
+};
+
+bool is_prefix(const char* pattern, const char* str, const char* end)
 {
-    std::stringstream ss(input);
-    std::string s;
-    std::vector<std::string> ret;
-    while (std::getline(ss, s, '|'))
+    for (; *pattern; ++pattern, ++str)
     {
-        if (s[0] == ' ')
-            s.erase(s.begin());
-        if (s.back() == ' ')
-            s.pop_back();
-        ret.push_back(s);
+        if (str == end)
+            return false;
+
+        const auto c = std::tolower((unsigned char)*str);
+        if (*pattern == '#')
+        {
+            if (!std::isdigit(c))
+                return false;
+        }
+        else if (*pattern != c)
+            return false;
     }
-    return ret;
+    return true;
 }
 
-std::string tolower(const std::string& s)
-{
-    std::string ret;
-    for (const auto& c : s)
-        ret.push_back(std::tolower(c));
+} // namespace
 
-    return ret;
-}
-
-filetype find_filetype(const std::string& filename)
+filetype find_filetype(const char* filename, std::size_t len)
 {
-    struct pattern {
-        filetype type;        
-        const char* str;
-    } patterns[] = {
-        { filetype::audio, ".mp3 | .mp2 | .wav | .xm | .flac | .m3u | .pls | .mpa | .ogg" },
-        { filetype::video, ".avi | .mkv | .ogm | .wmv | .wma | .mpe?g | .rm | .mov | .flv | .asf | .mp4 | .3gp | .3g2 | .m4v" },
-        { filetype::image, ".jpe?g | .bmp | .png | .gif" },
-        { filetype::text,  ".txt | .nfo | .sfv | .log | .nzb | .rtf | .cue"},
-        { filetype::archive, ".zip | .rar | .7z | .r\\d{1,3} | .\\d{2} | .part\\d{1,3}\\.rar" },
-        { filetype::parity, ".par | .par2" },
-        { filetype::document, ".doc | .chm | .pdf" }
-    };
-
-    const auto pos = filename.find_last_of(".");
-    if (pos == std::string::npos)
+    const char* end = filename + len;
+    const char* dot = end;
+    while (dot != filename && dot[-1] != '.')
+        --dot;
+    if (dot == filename)
         return filetype::other;
+    --dot;
 
-    const auto xtension = tolower(filename.substr(pos));
-
-    // note that the regular expressions above should be of the form \\.mp3 
-    // i.e. we need to escape the . 
-
-    for (auto it = std::begin(patterns); it != std::end(patterns); ++it)
+    for (const auto& ext : extensions)
     {
-        const auto pat  = split((*it).str);
-        const auto type = (*it).type;
-        for (auto it = std::begin(pat); it != std::end(pat); ++it)
-        {
-            // escape the . and interpret it as a char
-            boost::regex r("\\" + *it, boost::regbase::icase /* | boost::regbase::perl */);
-            if (boost::regex_search(xtension.begin(), xtension.end(), r))
-                return type;
-        }
+        if (is_prefix(ext.str, dot, end))
+            return ext.type;
     }
     return filetype::other;
 }
 
+filetype find_filetype(const std::string& filename)
+{
+    return find_filetype(filename.c_str(), filename.size());
+}
+
 } // newsflash
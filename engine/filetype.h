@@ -22,6 +22,7 @@
 
 #include <newsflash/config.h>
 #include <string>
+#include <cstddef>
 #include <cstdint>
 
 namespace newsflash
@@ -56,6 +57,8 @@ namespace newsflash
         other
     };
 
+    // find the type of the file based on the filename extension.
+    filetype find_filetype(const char* filename, std::size_t len);
     filetype find_filetype(const std::string& filename);
 
     enum class fileflag : std::uint8_t {
@@ -21,52 +21,29 @@
 #pragma once
 
 #include <newsflash/config.h>
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <string>
+#include <vector>
+#include <map>
 #include "assert.h"
 
 namespace newsflash
 {
-    // an array message ids 
+    // an array message ids. the file layout is a header (the number of
+    // items) followed by the 16 bit message number deltas.
+    // the idlist is read only and is meant to be used with a mapped 
+    // storage (filemap). the idlist_writer writes the file.
     template<typename Storage>
     class idlist : public Storage
     {
     public:
-        class proxy 
-        {
-        public:
-            operator std::int16_t()
-            {
-                return *(std::int16_t*)buff_.address();
-            }
-            proxy& operator=(std::int16_t value)
-            {
-                std::memcpy(buff_.address(), &value, sizeof(value));
-                buff_.flush();
-                return *this;
-            }
-        private:
-            friend class idlist;
-            proxy(typename Storage::buffer b) : buff_(std::move(b))
-            {}
-        private:
-            typename Storage::buffer buff_;
-        };
-
         idlist()
         {
             header_.size = 0;
         }
 
-        void resize(std::size_t s)
-        {
-            header_.size = s;
-            auto buff = Storage::load(0, sizeof(header_), Storage::buf_write);
-            std::memcpy(buff.address(), &header_, sizeof(header_));
-            buff.flush();
-        }
-
         void open(std::string file)
         {
             Storage::open(file);
@@ -77,12 +54,14 @@ namespace newsflash
                 return;                
             }
         }
-        proxy operator[](std::size_t i)
+        std::int16_t operator[](std::size_t i)
         {
             ASSERT(i < header_.size);
             const auto offset = sizeof(header_) + i * sizeof(std::int16_t);
-            auto buff = Storage::load(offset, sizeof(std::int16_t), Storage::buf_read | Storage::buf_write);
-            return {std::move(buff)};
+            const auto buff = Storage::load(offset, sizeof(std::int16_t), Storage::buf_read);
+            std::int16_t value;
+            std::memcpy(&value, buff.address(), sizeof(value));
+            return value;
         }
 
         std::size_t size() const 
@@ -95,4 +74,191 @@ namespace newsflash
         };
         header header_;
     };
-} // newsflash
\ No newline at end of file
+
+    // write the idlist file. the values are collected in memory in pages
+    // and written out when flushed so that writing a batch of articles results
+    // in a few large writes instead of a write for each article part.
+    // the idlist mostly grows at the end, new pages are created without reading
+    // the file and the pages that were recently written are kept around since
+    // the parts of a file are usually close to each other in the article numbers.
+    template<typename Storage>
+    class idlist_writer : public Storage
+    {
+    public:
+        // number of values per page.
+        enum { PageSize = 2048 };
+
+        // number of clean pages to keep in memory after flush.
+        enum { MaxCachedPages = 64 };
+
+        idlist_writer() : size_(0), size_on_disk_(0), dirty_size_(false), clock_(0)
+        {}
+
+        void open(std::string file)
+        {
+            Storage::open(file);
+            pages_.clear();
+            size_ = 0;
+            if (Storage::size())
+            {
+                const auto buff = Storage::load(0, sizeof(size_), Storage::buf_read);
+                std::memcpy(&size_, buff.address(), sizeof(size_));
+            }
+            size_on_disk_ = size_;
+            dirty_size_   = false;
+        }
+
+        // grow the idlist to the new size. the new values are 0.
+        void resize(std::size_t size)
+        {
+            ASSERT(size >= size_);
+            if (size == size_)
+                return;
+
+            // touch all the new pages so that the whole range is written
+            // even if some of the values are never set.
+            const auto first = size_ / PageSize;
+            const auto last  = (size - 1) / PageSize;
+            for (auto i=first; i<=last; ++i)
+                get_page(i).dirty = true;
+
+            size_ = size;
+            dirty_size_ = true;
+        }
+
+        void set(std::size_t i, std::int16_t value)
+        {
+            ASSERT(i < size_);
+            auto& p = get_page(i / PageSize);
+            p.values[i % PageSize] = value;
+            p.dirty = true;
+        }
+
+        std::size_t size() const 
+        {
+            return size_;
+        }
+
+        // write out the pending changes. the values are written before the size 
+        // in the header and both are synced to the disk before returning. this way
+        // the header never covers values that are not on the disk and anything 
+        // written after the flush (such as the catalog that refers to the values)
+        // will not land on the disk before the idlist does.
+        void flush()
+        {
+            bool written = false;
+
+            auto it = pages_.begin();
+            while (it != pages_.end())
+            {
+                if (!it->second.dirty)
+                {
+                    ++it;
+                    continue;
+                }
+                // coalesce the consecutive dirty pages into a single write.
+                auto end = it;
+                std::size_t num_pages = 0;
+                while (end != pages_.end() && end->second.dirty && end->first == it->first + num_pages)
+                {
+                    ++end;
+                    ++num_pages;
+                }
+
+                const auto first = it->first * PageSize;
+                const auto count = std::min<std::size_t>(num_pages * PageSize, size_ - first);
+                const auto bytes = count * sizeof(std::int16_t);
+                const auto offset = sizeof(size_) + first * sizeof(std::int16_t);
+
+                auto buff = Storage::load(offset, bytes, Storage::buf_write);
+                auto* ptr = static_cast<std::uint8_t*>(buff.address());
+                for (; it != end; ++it)
+                {
+                    const auto len = std::min<std::size_t>(PageSize, size_ - it->first * PageSize);
+                    std::memcpy(ptr, &it->second.values[0], len * sizeof(std::int16_t));
+                    ptr += len * sizeof(std::int16_t);
+                    it->second.dirty = false;
+                }
+                buff.flush();
+                written = true;
+            }
+
+            if (written && dirty_size_)
+                Storage::sync();
+
+            if (dirty_size_)
+            {
+                auto buff = Storage::load(0, sizeof(size_), Storage::buf_write);
+                std::memcpy(buff.address(), &size_, sizeof(size_));
+                buff.flush();
+                dirty_size_ = false;
+                written = true;
+            }
+            if (written)
+                Storage::sync();
+
+            size_on_disk_ = size_;
+
+            evict();
+        }
+
+    private:
+        struct page {
+            std::vector<std::int16_t> values;
+            std::uint64_t used = 0;
+            bool dirty = false;
+        };
+
+        page& get_page(std::size_t index)
+        {
+            auto it = pages_.find(index);
+            if (it == pages_.end())
+            {
+                page p;
+                p.values.resize(PageSize);
+
+                // read the part of the page that is already on the disk.
+                const auto first = index * PageSize;
+                if (first < size_on_disk_)
+                {
+                    const auto count  = std::min<std::size_t>(PageSize, size_on_disk_ - first);
+                    const auto offset = sizeof(size_) + first * sizeof(std::int16_t);
+                    const auto buff = Storage::load(offset, count * sizeof(std::int16_t), Storage::buf_read);
+                    std::memcpy(&p.values[0], buff.address(), count * sizeof(std::int16_t));
+                }
+                it = pages_.insert(std::make_pair(index, std::move(p))).first;
+            }
+            it->second.used = ++clock_;
+            return it->second;
+        }
+
+        // drop the least recently used pages.
+        void evict()
+        {
+            if (pages_.size() <= MaxCachedPages)
+                return;
+
+            std::vector<std::uint64_t> used;
+            for (const auto& p : pages_)
+                used.push_back(p.second.used);
+
+            const auto nth = used.end() - MaxCachedPages;
+            std::nth_element(used.begin(), nth, used.end());
+            const auto limit = *nth;
+
+            for (auto it = pages_.begin(); it != pages_.end(); )
+            {
+                if (it->second.used < limit)
+                    it = pages_.erase(it);
+                else ++it;
+            }
+        }
+
+    private:
+        std::map<std::size_t, page> pages_;
+        std::size_t size_;
+        std::size_t size_on_disk_;
+        bool dirty_size_;
+        std::uint64_t clock_;
+    };
+} // newsflash
@@ -24,13 +24,21 @@
 #include <functional>
 #include <algorithm>
 #include <deque>
+#include <vector>
 #include <limits>
+#include <utility>
+#include <type_traits>
+#include <iterator>
 #include <thread>
 #include <future>
+#include <atomic>
+#include <exception>
 #include <cstdint>
 #include <cstring>
 #include <cassert>
+#include <ctime>
 #include "article.h"
+#include "columns.h"
 #include "assert.h"
 #include "bitflag.h"
 
@@ -58,25 +66,88 @@ namespace newsflash
         };
 
         enum class flags {
-            selected
+            selected,
+            // set on the items that matched the filter when it was last evaluated.
+            matched
         };
 
         using article_t = typename newsflash::article<Storage>;
+        using string_t  = typename std::decay<decltype(std::declval<article_t>().subject())>::type;
 
-        index() : size_(0), sorting_(sorting::sort_by_date), sortdir_(sortdir::ascending)
+        index() : size_(0), filter_threads_(1), filter_pos_(0), filtering_(false), unsorted_(false), sorting_(sorting::sort_by_date), sortdir_(sortdir::ascending)
         {}
 
         // loading callback
         using loader = std::function<article_t (std::size_t key, std::size_t index)>;
         // filtering callback (predicate)
         using predicate = std::function<bool (const article_t& a)>;
+        // filtering callback on the columns. the key is the key 
+        // the columns were set with.
+        using column_predicate = std::function<bool (std::size_t key, const column_view& c, std::size_t row)>;
 
         loader on_load; // callback to load an article object
         predicate on_filter; // callback to filter an article object
+        column_predicate on_filter_columns; // callback to filter a row in the columns
+
+        // set the number of threads to evaluate the filter with. when more
+        // than 1 thread is used the filtering callbacks (and on_load when
+        // filtering on the articles) need to be safe to call concurrently.
+        void set_filter_threads(std::size_t threads)
+        {
+            filter_threads_ = std::max<std::size_t>(threads, 1);
+        }
+
+        // set the columns for the articles with the given key. once the
+        // columns are set the items are inserted with insert(key, row) and
+        // the index sorts and filters on the columns without loading the 
+        // articles. the index given to on_load is then the row.
+        void set_columns(std::size_t key, const column_view& view)
+        {
+            if (columns_.size() <= key)
+                columns_.resize(key + 1);
+            columns_[key] = view;
+        }
+
+        // get the columns for the item at the given index.
+        column_view& columns(std::size_t index)
+        {
+            assert(index < size_);
+            return columns_[items_[index].key];
+        }
+
+        // get the row of the item at the given index in its columns.
+        std::size_t row(std::size_t index) const
+        {
+            assert(index < size_);
+            return items_[index].index;
+        }
+
+        // get the key of the columns of the item at the given index.
+        std::size_t key(std::size_t index) const
+        {
+            assert(index < size_);
+            return items_[index].key;
+        }
+
+        // set the flag of the item at the given index in its columns. 
+        // when sorting on the flag the sort key of the item is updated
+        // and the next sort sorts the items again instead of reversing.
+        void set_bits(std::size_t index, fileflag flag, bool on_off)
+        {
+            assert(index < size_);
+            auto& item = items_[index];
+            columns_[item.key].set_bits(item.index, flag, on_off);
+
+            const auto key = make_key(item);
+            if (key == item.sortkey)
+                return;
+            item.sortkey = key;
+            unsorted_ = true;
+        }
 
         void sort(sorting column, sortdir up_down)
         {
-            if (column == sorting_)
+            if (column == sorting_ && !unsorted_)
             {
                 auto beg = std::begin(items_);
                 auto mid = std::begin(items_) + size_;
@@ -85,44 +156,29 @@ namespace newsflash
                 std::reverse(mid, end);
                 sorting_ = column;
                 sortdir_ = up_down;
+                filter_pos_ = 0;
                 return;
             }
             sorting_ = column;
             sortdir_ = up_down;
             resort();
         }
+
+        // sort the items on the current sorting. the sort key of every
+        // item is extracted once (which is the only time the article 
+        // needs to be loaded) and the items are then radix sorted on the keys.
         void resort()
         {
-            switch (sorting_)
-            {
-                case sorting::sort_by_broken:
-                    sort(sortdir_, fileflag::broken);
-                    break;
-                case sorting::sort_by_binary:
-                    sort(sortdir_, fileflag::binary);
-                    break;
-                case sorting::sort_by_downloaded:
-                    sort(sortdir_, fileflag::downloaded);
-                    break;
-                case sorting::sort_by_bookmarked:
-                    sort(sortdir_, fileflag::bookmarked);
-                    break;
-                case sorting::sort_by_date:
-                    sort(sortdir_, &article_t::pubdate);
-                    break;
-                case sorting::sort_by_type:
-                    sort(sortdir_, &article_t::type);
-                    break;
-                case sorting::sort_by_size:
-                    sort(sortdir_, &article_t::bytes);
-                    break;
-                case sorting::sort_by_author:
-                    sort(sortdir_, &article_t::author);
-                    break;
-                case sorting::sort_by_subject:
-                    sort(sortdir_, &article_t::subject);
-                    break;
-            }
+            auto beg = std::begin(items_);
+            auto mid = std::begin(items_) + size_;
+            auto end = std::end(items_);
+            sort(beg, mid);
+            sort(mid, end);
+            unsorted_ = false;
+
+            // the items have moved around so any filtering in 
+            // progress needs to start over.
+            filter_pos_ = 0;
         }
 
         // insert the new item into the index in the right position.
@@ -130,10 +186,10 @@ namespace newsflash
         // this will maintain current sorting.
         void insert(const article_t& a, std::size_t key, std::size_t index)
         {
+            const bool match = is_match(a);
             iterator beg;
             iterator end;
-            iterator pos;
-            if (!is_match(a))
+            if (!match)
             {
                 beg = std::begin(items_) + size_;
                 end = std::end(items_);
@@ -144,38 +200,39 @@ namespace newsflash
                 end = std::begin(items_) + size_;
                 ++size_;
             }
-            switch (sorting_)
-            {
-                case sorting::sort_by_broken:
-                    pos = lower_bound(beg, end, a, fileflag::broken);
-                    break;
-                case sorting::sort_by_binary:
-                    pos = lower_bound(beg, end, a, fileflag::binary);
-                    break;
-                case sorting::sort_by_downloaded:
-                    pos = lower_bound(beg, end, a, fileflag::downloaded);
-                    break;
-                case sorting::sort_by_bookmarked:
-                    pos = lower_bound(beg, end, a, fileflag::bookmarked);
-                    break;
+            item i {key, index, {}, make_key(a)};
+            i.bits.set(flags::matched, match);
+
+            auto pos = std::lower_bound(beg, end, i, [&](const item& lhs, const item& rhs) {
+                const auto ret = compare(lhs, rhs, a);
+                return sortdir_ == sortdir::ascending ? ret < 0 : ret > 0;
+            });
+            insert(pos, i);
+        }
 
-                case sorting::sort_by_date:
-                    pos = lower_bound(beg, end, a, &article_t::pubdate);
-                    break;
-                case sorting::sort_by_type:
-                    pos = lower_bound(beg, end, a, &article_t::type);
-                    break;
-                case sorting::sort_by_size:
-                    pos = lower_bound(beg, end, a, &article_t::bytes);
-                    break;
-                case sorting::sort_by_author:
-                    pos = lower_bound(beg, end, a, &article_t::author);
-                    break;
-                case sorting::sort_by_subject:
-                    pos = lower_bound(beg, end, a, &article_t::subject);
-                    break;
+        // insert the item on the row in the columns with the given key
+        // into the index in the right position. 
+        void insert(std::size_t key, std::size_t row)
+        {
+            ASSERT(key < columns_.size());
+
+            const bool match = on_filter_columns(key, columns_[key], row);
+            item i {key, row, {}, make_key(columns_[key], row)};
+            i.bits.set(flags::matched, match);
+            iterator beg;
+            iterator end;
+            if (!match)
+            {
+                beg = std::begin(items_) + size_;
+                end = std::end(items_);
             }
-            items_.insert(pos, {key, index});
+            else
+            {
+                beg = std::begin(items_);
+                end = std::begin(items_) + size_;
+                ++size_;
+            }
+            insert(std::upper_bound(beg, end, i, item_order(this)), i);
         }
 
         std::size_t size() const
@@ -215,16 +272,49 @@ namespace newsflash
             return item.bits.test(flags::selected);
         }
 
-        void filter()
+        // start filtering the items with the current filter callbacks. 
+        // the filter is evaluated in batches with filter_next and once
+        // every item has been evaluated the result is applied with 
+        // filter_apply. starting again cancels the filtering in progress
+        // and evaluates all the items again.
+        void filter_begin()
         {
+            filtering_  = true;
+            filter_pos_ = 0;
+        }
+
+        // evaluate the filter on the next batch of at most max_items items.
+        // returns true when all the items have been evaluated.
+        bool filter_next(std::size_t max_items)
+        {
+            assert(filtering_);
+            const auto beg = filter_pos_;
+            const auto end = std::min(items_.size(), beg + max_items);
+            evaluate_filter(beg, end);
+            filter_pos_ = end;
+            return filter_pos_ == items_.size();
+        }
+
+        bool is_filtering() const
+        { return filtering_; }
+
+        // the number of items evaluated by the filtering in progress.
+        std::size_t filter_progress() const
+        { return filter_pos_; }
+
+        void filter_apply()
+        {
+            assert(filtering_);
+            assert(filter_pos_ == items_.size());
+            filtering_ = false;
+
             // we might have items from previous filter that are currently
             // not being displayed. since the filter might become
             // more "relaxed" and those items might match we need to put them
             // back into the "visible" range. also note that we must maintain
             // the correct sorting
-            auto pred = [this](const item& i) {
-                const auto& a = on_load(i.key, i.index);
-                return is_match(a);
+            auto pred = [](const item& i) {
+                return i.bits.test(flags::matched);
             };
 
             if (size_ == items_.size())
@@ -267,220 +357,345 @@ namespace newsflash
             auto b = std::stable_partition(mid, end, pred);
 
             auto out = std::back_inserter(tmp);
+            std::merge(beg, a, mid, b, out, item_order(this));
+            std::merge(a, mid, b, end, out, item_order(this));
+            size_  = (a - beg) + (b - mid);
+            items_ = std::move(tmp);
+            deselect_non_visible();
+        }
+
+        void filter()
+        {
+            filter_begin();
+            filter_next(items_.size());
+            filter_apply();
+        }
+
+    private:
+        using iterator = typename std::deque<item>::iterator;
+
+        // order the items on the current sorting and direction.
+        struct item_order {
+            item_order(const index* i) : index_(i)
+            {}
+
+            bool operator()(const item& lhs, const item& rhs) const
+            {
+                const auto ret = index_->compare(lhs, rhs);
+                if (index_->sortdir_ == sortdir::ascending)
+                    return ret < 0;
+                return ret > 0;
+            }
+        private:
+            const index* index_;
+        };
+
+        bool is_string_sort() const
+        {
+            return sorting_ == sorting::sort_by_author ||
+                   sorting_ == sorting::sort_by_subject;
+        }
+
+        // the sort keys map the sorted value into an unsigned integer
+        // with the same ordering. for the strings the key is the prefix 
+        // of the string and only the items with the same prefix need to
+        // look at the whole string.
+        std::uint64_t make_key(const article_t& a) const
+        {
             switch (sorting_)
             {
                 case sorting::sort_by_broken:
-                    merge(beg, a, mid, b, out, fileflag::broken);
-                    merge(a, mid, b, end, out, fileflag::broken);
-                    break;
-
+                    return a.test(fileflag::broken);
                 case sorting::sort_by_binary:
-                    merge(beg, a, mid, b, out, fileflag::binary);
-                    merge(a, mid, b, end, out, fileflag::binary);
-                    break;
-
+                    return a.test(fileflag::binary);
                 case sorting::sort_by_downloaded:
-                    merge(beg, a, mid, b, out, fileflag::downloaded);
-                    merge(a, mid, b, end, out, fileflag::downloaded);
-                    break;
-
+                    return a.test(fileflag::downloaded);
                 case sorting::sort_by_bookmarked:
-                    merge(beg, a, mid, b, out, fileflag::bookmarked);
-                    merge(a, mid, b, end, out, fileflag::bookmarked);
-                    break;
-
+                    return a.test(fileflag::bookmarked);
                 case sorting::sort_by_date:
-                    merge(beg, a, mid, b, out, &article_t::pubdate);
-                    merge(a, mid, b, end, out, &article_t::pubdate);
-                    break;
-
+                    return date_key(a.pubdate());
                 case sorting::sort_by_type:
-                    merge(beg, a, mid, b, out, &article_t::type);
-                    merge(a, mid, b, end, out, &article_t::type);
-                    break;
-
+                    return (std::uint64_t)a.type();
                 case sorting::sort_by_size:
-                    merge(beg, a, mid, b, out, &article_t::bytes);
-                    merge(a, mid, b, end, out, &article_t::bytes);
-                    break;
-
+                    return a.bytes();
                 case sorting::sort_by_author:
-                    merge(beg, a, mid, b, out, &article_t::author);
-                    merge(a, mid, b, end, out, &article_t::author);
-                    break;
-
+                    return prefix_key(a.author());
                 case sorting::sort_by_subject:
-                    merge(beg, a, mid, b, out, &article_t::subject);
-                    merge(a, mid, b, end, out, &article_t::subject);
-                    break;
+                    return prefix_key(a.subject());
             }
-            size_  = (a - beg) + (b - mid);
-            items_ = std::move(tmp);
-            deselect_non_visible();
+            return 0;
         }
 
-    private:
-        template<typename Class, typename Member>
-        struct bigger_t {
-            typedef Member (Class::*MemPtr)(void) const;
-
-            bigger_t(MemPtr p, loader func) : ptr_(p), load_(func)
-            {}
-
-            bool operator()(const item& lhs, const item& rhs) const
-            {
-                const auto& a = load_(lhs.key, lhs.index);
-                const auto& b = load_(rhs.key, rhs.index);
-                return (a.*ptr_)() > (b.*ptr_)();
-            }
-            bool operator()(const item& lhs, const article_t& rhs) const
+        std::uint64_t make_key(const column_view& c, std::size_t row) const
+        {
+            switch (sorting_)
             {
-                const auto& a = load_(lhs.key, lhs.index);
-                const auto& b = rhs;
-                return (a.*ptr_)() > (b.*ptr_)();
+                case sorting::sort_by_broken:
+                    return c.test(row, fileflag::broken);
+                case sorting::sort_by_binary:
+                    return c.test(row, fileflag::binary);
+                case sorting::sort_by_downloaded:
+                    return c.test(row, fileflag::downloaded);
+                case sorting::sort_by_bookmarked:
+                    return c.test(row, fileflag::bookmarked);
+                case sorting::sort_by_date:
+                    return date_key(c.pubdate(row));
+                case sorting::sort_by_type:
+                    return (std::uint64_t)c.type(row);
+                case sorting::sort_by_size:
+                    return c.bytes(row);
+                case sorting::sort_by_author:
+                    return prefix_key(c.author(row));
+                case sorting::sort_by_subject:
+                    return prefix_key(c.subject(row));
             }
-        private:
-            MemPtr ptr_;
-            loader load_;
-        };
-        template<typename Class, typename Member>
-        struct smaller_t {
-            typedef Member (Class::*MemPtr)(void) const;
+            return 0;
+        }
 
-            smaller_t(MemPtr p, loader func) : ptr_(p), load_(func)
-            {}
+        std::uint64_t make_key(const item& i) const
+        {
+            if (!columns_.empty())
+                return make_key(columns_[i.key], i.index);
 
-            bool operator()(const item& lhs, const item& rhs) const
+            return make_key(on_load(i.key, i.index));
+        }
+
+        // flip the sign bit so that the negative dates come first.
+        static std::uint64_t date_key(std::time_t t)
+        {
+            return (std::uint64_t)(std::int64_t)t ^ (std::uint64_t(1) << 63);
+        }
+
+        // pack 8 bytes of the string starting at the offset into a big 
+        // endian integer. shorter strings are padded with zeros so that 
+        // a string sorts before any longer string it is a prefix of.
+        template<typename String>
+        static std::uint64_t prefix_key(const String& str, std::size_t offset = 0)
+        {
+            std::uint64_t key = 0;
+            for (std::size_t i=offset; i<offset + 8; ++i)
             {
-                const auto& a = load_(lhs.key, lhs.index);
-                const auto& b = load_(rhs.key, rhs.index);
-                return (a.*ptr_)() < (b.*ptr_)();
+                key <<= 8;
+                if (i < str.size())
+                    key |= (std::uint8_t)str.begin()[i];
             }
-            bool operator()(const item& lhs, const article_t& rhs) const
+            return key;
+        }
+
+        template<typename Lhs, typename Rhs>
+        static int string_compare(const Lhs& lhs, const Rhs& rhs)
+        {
+            const auto len = std::min<std::size_t>(lhs.size(), rhs.size());
+            if (len)
             {
-                const auto& a = load_(lhs.key, lhs.index);
-                const auto& b = rhs;
-                return (a.*ptr_)() < (b.*ptr_)();
+                const auto ret = std::memcmp(&*lhs.begin(), &*rhs.begin(), len);
+                if (ret)
+                    return ret;
             }
-        private:
-            MemPtr ptr_;
-            loader load_;
-        };
+            if (lhs.size() < rhs.size())
+                return -1;
+            return lhs.size() > rhs.size();
+        }
 
-        template<typename Class, typename Member>
-        smaller_t<Class, Member> less(Member (Class::*p)(void) const)
+        auto article_string(const article_t& a) const -> decltype(a.subject())
         {
-            return smaller_t<Class, Member>(p, on_load);
+            if (sorting_ == sorting::sort_by_subject)
+                return a.subject();
+            return a.author();
         }
-        template<typename Class, typename Member>
-        bigger_t<Class, Member> greater(Member (Class::*p)(void) const)
+
+        str::string_view column_string(const item& i) const
         {
-            return bigger_t<Class, Member>(p, on_load);
+            const auto& c = columns_[i.key];
+            if (sorting_ == sorting::sort_by_subject)
+                return c.subject(i.index);
+            return c.author(i.index);
         }
 
-        using iterator = typename std::deque<item>::iterator;
+        // compare the items in ascending order. 
+        int compare(const item& lhs, const item& rhs) const
+        {
+            if (lhs.sortkey != rhs.sortkey)
+                return lhs.sortkey < rhs.sortkey ? -1 : 1;
+            if (!is_string_sort())
+                return 0;
+            if (!columns_.empty())
+                return string_compare(column_string(lhs), column_string(rhs));
+
+            return string_compare(article_string(on_load(lhs.key, lhs.index)),
+                article_string(on_load(rhs.key, rhs.index)));
+        }
 
-        template<typename OutputIt, typename MemPtr>
-        void merge(iterator first1, iterator last1,
-            iterator first2, iterator last2, OutputIt out, MemPtr p)
+        // compare the items in ascending order when the rhs item
+        // is not in the index yet and its article is given.
+        int compare(const item& lhs, const item& rhs, const article_t& b) const
         {
-            if (sortdir_ == sortdir::ascending)
-                std::merge(first1, last1, first2, last2, out, less(p));
-            else std::merge(first1, last1, first2, last2, out, greater(p));
+            if (lhs.sortkey != rhs.sortkey)
+                return lhs.sortkey < rhs.sortkey ? -1 : 1;
+            if (!is_string_sort())
+                return 0;
+
+            return string_compare(article_string(on_load(lhs.key, lhs.index)),
+                article_string(b));
         }
 
-        template<typename OutputIt>
-        void merge(iterator first1, iterator last1,
-            iterator first2, iterator last2, OutputIt out, fileflag mask)
+        void sort(iterator beg, iterator end)
         {
-            if (sortdir_ == sortdir::ascending)
+            if (!is_string_sort())
             {
-                std::merge(first1, last1, first2, last2, out, [=](const item& lhs, const item& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = on_load(rhs.key, rhs.index);
-                    return (a.bits() & mask).value()  < (b.bits() & mask).value();
+                for (auto it = beg; it != end; ++it)
+                    it->sortkey = make_key(*it);
+
+                radix_sort(beg, end, [](const item& i) {
+                    return i.sortkey;
+                });
+            }
+            else if (!columns_.empty())
+            {
+                sort_by_string<str::string_view>(beg, end, [this](const item& i) {
+                    return column_string(i);
                 });
             }
             else
             {
-                std::merge(first1, last1, first2, last2, out, [=](const item& lhs, const item& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = on_load(rhs.key, rhs.index);
-                    return (a.bits() & mask).value() > (b.bits() & mask).value();
+                sort_by_string<string_t>(beg, end, [this](const item& i) {
+                    return string_t(article_string(on_load(i.key, i.index)));
                 });
             }
+            if (sortdir_ == sortdir::descending)
+                std::reverse(beg, end);
         }
 
-        template<typename MemPtr>
-        void sort(sortdir up_down, MemPtr p)
+        template<typename String>
+        struct run_item {
+            std::uint64_t key;
+            String str;
+            item i;
+        };
+
+        // sort the items on their strings. every string is fetched only 
+        // once and the prefix of the string is kept as the sort key.
+        template<typename String, typename Getter>
+        static void sort_by_string(iterator beg, iterator end, Getter get)
         {
-            auto beg = std::begin(items_);
-            auto mid = std::begin(items_) + size_;
-            auto end = std::end(items_);
-            if (up_down == sortdir::ascending)
+            std::vector<run_item<String>> run;
+            run.reserve(std::distance(beg, end));
+            for (auto it = beg; it != end; ++it)
             {
-                std::sort(beg, mid, less(p));
-                std::sort(mid, end, less(p));
-            }
-            else
-            {
-                std::sort(beg, mid, greater(p));
-                std::sort(mid, end, greater(p));
+                run.push_back(run_item<String>{0, get(*it), *it});
+                run.back().i.sortkey = prefix_key(run.back().str);
             }
+
+            sort_strings(std::begin(run), std::end(run), 0);
+
+            for (const auto& r : run)
+                *beg++ = r.i;
         }
 
-        void sort(sortdir up_down, fileflag mask)
+        // msd radix sort on the strings that have the same first offset
+        // bytes. the next 8 bytes are the key for the next round so that 
+        // the subjects that share a long prefix (which is typical when
+        // the posts are made with the same tool) don't all end up being
+        // compared as whole strings.
+        template<typename Iterator>
+        static void sort_strings(Iterator beg, Iterator end, std::size_t offset)
         {
-            auto beg = std::begin(items_);
-            auto mid = std::begin(items_) + size_;
-            auto end = std::end(items_);
-            if (up_down == sortdir::ascending)
+            using value = typename std::iterator_traits<Iterator>::value_type;
+
+            auto less = [](const value& lhs, const value& rhs) {
+                return string_compare(lhs.str, rhs.str) < 0;
+            };
+            if (std::distance(beg, end) < 64)
             {
-                auto pred = [=](const item& lhs, const item& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = on_load(rhs.key, rhs.index);
-                    return (a.bits() & mask).value()  < (b.bits() & mask).value();
-                };
-                std::sort(beg, mid, pred);
-                std::sort(mid, end, pred);
+                std::sort(beg, end, less);
+                return;
             }
-            else
+
+            bool more = false;
+            for (auto it = beg; it != end; ++it)
             {
-                auto pred = [=](const item& lhs, const item& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = on_load(rhs.key, rhs.index);
-                    return (a.bits() & mask).value() > (b.bits() & mask).value();
-                };
-                std::sort(beg, mid, pred);
-                std::sort(mid, end, pred);
+                it->key = prefix_key(it->str, offset);
+                more = more || it->str.size() > offset;
+            }
+            if (!more)
+            {
+                std::sort(beg, end, less);
+                return;
             }
-        }
 
-        template<typename MemPtr>
-        iterator lower_bound(iterator beg, iterator end, const article_t& a, MemPtr p)
-        {
-            if (sortdir_ == sortdir::ascending)
-                return std::lower_bound(beg, end, a, less(p));
-            else return std::lower_bound(beg, end, a, greater(p));
+            radix_sort(beg, end, [](const value& v) {
+                return v.key;
+            });
+
+            auto it = beg;
+            while (it != end)
+            {
+                const auto key = it->key;
+                auto next = std::find_if(it, end, [=](const value& v) {
+                    return v.key != key;
+                });
+                if (std::distance(it, next) > 1)
+                    sort_strings(it, next, offset + 8);
+                it = next;
+            }
         }
 
-        iterator lower_bound(iterator beg, iterator end, const article_t& a, fileflag mask)
+        // lsd radix sort on the keys one byte at a time. the passes
+        // over a byte that has the same value in every key are skipped,
+        // so for example sorting on a flag takes a single pass.
+        template<typename Iterator, typename Key>
+        static void radix_sort(Iterator beg, Iterator end, Key key)
         {
-            if (sortdir_ == sortdir::ascending) {
-                return std::lower_bound(beg, end, a, [=](const item& lhs, const article_t& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = rhs;
-                    return (a.bits() & mask).value() < (b.bits() & mask).value();
+            using value = typename std::iterator_traits<Iterator>::value_type;
+
+            const std::size_t count = std::distance(beg, end);
+            if (count < 64)
+            {
+                std::sort(beg, end, [&](const value& lhs, const value& rhs) {
+                    return key(lhs) < key(rhs);
                 });
+                return;
             }
-            else
+
+            std::vector<value> src(std::make_move_iterator(beg), std::make_move_iterator(end));
+            std::vector<value> dst(count);
+            std::vector<std::size_t> histogram(8 * 256);
+            for (const auto& v : src)
             {
-                return std::lower_bound(beg, end, a, [=](const item& lhs, const article_t& rhs) {
-                    const auto& a = on_load(lhs.key, lhs.index);
-                    const auto& b = rhs;
-                    return (a.bits() & mask).value() > (b.bits() & mask).value();
-                });
+                const std::uint64_t k = key(v);
+                for (unsigned b=0; b<8; ++b)
+                    ++histogram[b * 256 + ((k >> (b * 8)) & 0xff)];
+            }
+
+            for (unsigned b=0; b<8; ++b)
+            {
+                auto* offsets = &histogram[b * 256];
+                const auto first = (key(src[0]) >> (b * 8)) & 0xff;
+                if (offsets[first] == count)
+                    continue;
+
+                std::size_t offset = 0;
+                for (unsigned i=0; i<256; ++i)
+                {
+                    const auto n = offsets[i];
+                    offsets[i] = offset;
+                    offset += n;
+                }
+                for (auto& v : src)
+                    dst[offsets[(key(v) >> (b * 8)) & 0xff]++] = std::move(v);
+
+                src.swap(dst);
             }
+            std::move(std::begin(src), std::end(src), beg);
+        }
+
+        void insert(iterator pos, const item& i)
+        {
+            // the new item is evaluated with the current filter already
+            // so the filtering in progress can skip it.
+            if (filtering_ && (std::size_t)std::distance(std::begin(items_), pos) < filter_pos_)
+                ++filter_pos_;
+            items_.insert(pos, i);
         }
 
         bool is_match(const article_t& a) const
@@ -488,6 +703,81 @@ namespace newsflash
             return on_filter(a);
         }
 
+        bool is_match(const item& i) const
+        {
+            if (!columns_.empty())
+                return on_filter_columns(i.key, columns_[i.key], i.index);
+
+            return is_match(on_load(i.key, i.index));
+        }
+
+        // evaluate the filter on the items in [first, last) and mark the
+        // matching items. the range is split into chunks that the filter
+        // threads (including this thread) take in turns.
+        void evaluate_filter(std::size_t first, std::size_t last)
+        {
+            const std::size_t chunk_size = 1 << 14;
+            const std::size_t chunks = (last - first + chunk_size - 1) / chunk_size;
+
+            std::atomic<std::size_t> next(0);
+            std::atomic<bool> cancel(false);
+
+            auto work = [&]() {
+                const std::size_t chunk = next++;
+                if (chunk >= chunks || cancel)
+                    return false;
+
+                const auto beg = first + chunk * chunk_size;
+                const auto end = std::min(beg + chunk_size, last);
+                for (auto i=beg; i<end; ++i)
+                {
+                    auto& item = items_[i];
+                    item.bits.set(flags::matched, is_match(item));
+                }
+                return true;
+            };
+
+            // an exception from any of the threads stops the others 
+            // and is rethrown here once all the threads are done.
+            const auto num_threads = std::min(filter_threads_, std::max<std::size_t>(chunks, 1));
+            std::vector<std::exception_ptr> errors(num_threads);
+            std::vector<std::thread> threads;
+            for (std::size_t i=1; i<num_threads; ++i)
+            {
+                threads.emplace_back([&, i]() {
+                    try
+                    {
+                        while (work())
+                            ;
+                    }
+                    catch (...)
+                    {
+                        errors[i] = std::current_exception();
+                        cancel = true;
+                    }
+                });
+            }
+
+            try
+            {
+                while (work())
+                    ;
+            }
+            catch (...)
+            {
+                errors[0] = std::current_exception();
+                cancel = true;
+            }
+            for (auto& t : threads)
+                t.join();
+
+            for (const auto& e : errors)
+            {
+                if (e)
+                    std::rethrow_exception(e);
+            }
+        }
+
         void deselect_non_visible()
         {
             auto beg = std::begin(items_) + size_;
@@ -504,9 +794,16 @@ namespace newsflash
             std::size_t key;
             std::size_t index;
             bitflag<flags> bits;
+            std::uint64_t sortkey;
         };
         std::deque<item> items_;
         std::size_t size_;
+        std::vector<column_view> columns_;
+        std::size_t filter_threads_;
+        std::size_t filter_pos_;
+        bool filtering_;
+        // set when a sort key has changed after the items were sorted.
+        bool unsorted_;
     private:
         sorting sorting_;
         sortdir sortdir_;
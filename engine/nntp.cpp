@@ -23,11 +23,9 @@
 #include <newsflash/warnpush.h>
 #  include <boost/spirit/include/classic.hpp>
 #  include <boost/functional/hash.hpp>
-#  include <boost/regex.hpp>
 #include <newsflash/warnpop.h>
 #include <sstream>
 #include <algorithm>
-#include <stack>
 #include <cctype>
 
 #ifndef BOOST_HAS_THREADS
@@ -38,6 +36,7 @@
 #  include <strings.h> // for strcasecmp
 #endif
 #include "nntp.h"
+#include "subject.h"
 
 namespace {
     bool strip_leading_space(const char*& str, size_t& len)
@@ -101,65 +100,6 @@ namespace {
         // return true;
     }
 
-    // http://www.fileinfo.com/common.php
-
-    // construct an ugly reg exp and try to see if the subject line matches.
-    // try to keep the most common stuff at the front.
-    // note that the regular expression is in *reverse* because it's matched in reverse
-
-    // 001, 002, 003... files are HJSplit files
-    // Container formats: AVI, WMV, MP4, OGG, OMG, MKV, MKA
-    // Compression formats: RAR, ZIP, GZ, 7z
-    // Image formats: BMP, GIF, JPG, JPEG, PNG
-    // Audio formats: MP3, MP2, WAV
-    // DNS: Nintendo DS
-    // SFW: flash
-    const char* REVERSE_FILE_EXTENSION_REGEX = 
-        R"(rar\.|2rap\.|rap\.|ge?pj\.|iva\.|[234]pm\.|ge?pm\.|gnp\.|)" \
-        R"(fig\.|fdp\.|ggo\.|vmw\.|vom\.|osi\.|nib\.|piz\.|vaw\.|amw\.|)" \
-        R"(pmb\.|vfs\.|[0-9][0-9]r\.|ofn\.|euc\.|u3m\.|alf\.|bzn\.|mgo\.|)" \
-        R"([0-9]{3}\.|xvid\.|exe\.|mr\.|a4m\.|bov\.|vkm\.|akm\.|eca\.|mar\.|calf\.|)" \
-        R"([0-9]{1,3}z\.|fdm\.|tad\.|z7\.|caa\.|grn\.|cpm\.|fit\.)"\
-        R"([0-9]{1,3}s\.|ffai\.|fws\.|sdn\.|st\.|3ca\.|rrs\.)" \
-        R"(v4m\.|vlf\.|mhc\.)";
-
-// part count notation indicates the segment of the file when the file is split
-// to multiple NNTP posts. Usual notation is (xx/yy) but sometimes [xx/yy] is used
-// also note that sometimes subject lines contain both. In this case the [xx/yy] is considered
-// to indicate the file number in the batch of files. 
-// so [xx/yy] is not considered as part count unless (xx/yy) is not found.
-const char* find_part_count(const char* subjectline, std::size_t len, std::size_t& i)
-{
-    // NOTE: the regex is in reverse because the search is from the tail
-    // this matches "metallica - enter sandman.mp3 (01/50)"
-     const static boost::regex ex("(\\]|\\))[0-9]*/[0-9]*(\\(|\\[)");
-    
-     nntp::reverse_c_str_iterator itbeg(subjectline + len - 1);
-     nntp::reverse_c_str_iterator itend(subjectline - 1);
-
-     boost::match_results<nntp::reverse_c_str_iterator> res;
-
-     if (!regex_search(itbeg, itend, res, ex))
-         return NULL;
-    
-     if (res[0].second == itend)
-         return NULL;
-
-     const char* end   = res[0].first.as_ptr();  // at the last matched character
-     const char* start = res[0].second.as_ptr(); // at one before the start of the match
-     
-     ++start;
-     ++end;
-     // some people use this gay notation of prefixing their stuff with (xx/yy) notation
-     // to indicate all the articles of their posting "batch". This has nothing to do with 
-     // with the yEnc part count hack. So if the search returned a match at the beginning, ignore this.
-     if (start == subjectline)
-         return NULL;
-
-     i = end - start;
-     return start;
-}
-
 std::string make_string(const nntp::overview::field& f)
 {
     if (!f.start) return "";
@@ -191,89 +131,10 @@ bool is_binary_post(const char* str, size_t len)
     // TODO: consider separating this functionality into two functions.
     // 1 to find whether a post is should be collapsed, i.e. is multipart post
     // 2 to find whether the post is a binary post
-    // http://www.boost.org/libs/regex/doc/syntax_perl.html      
-    const static boost::regex filename(REVERSE_FILE_EXTENSION_REGEX, boost::regbase::icase | boost::regbase::perl);
-    const static boost::regex yenc("yEnc *\\([0-9]*/[0-9]*\\)");
-    const static boost::regex part("\\([0-9]*/[0-9]*\\)|yEnc");
-
-    const char* start = str + len - 1;
-    const char* end   = nullptr;
-    while (true)
-    {
-        reverse_c_str_iterator itbeg(start);
-        reverse_c_str_iterator itend(str - 1);
-        
-        boost::match_results<reverse_c_str_iterator> res;
+    detail::extension ext;
+    const bool found = len && detail::find_extension(str, str + len - 1, ext);
 
-        if (!regex_search(itbeg, itend, res, filename))
-        {
-            // a desperate attempt....
-            // if there's 'yEnc (xx/yy)' we just assume its a yEnc binary
-            if (regex_search(str, str+len, yenc))
-                return true;
-            return false;
-        }
-
-        // first returns an iterator pointing to the
-        // start of the sequence, which in this case is the end of
-        // the filename extension
-        end = res[0].first.as_ptr();
-        // second returns an iterator pointing one past the end of the sequence,
-        // which in this case is one before the start of the sequence
-        start = res[0].second.as_ptr();
-
-        // move start to the first character (.)
-        ++start;
-        // move end one past the last character in the extension
-        ++end;
-
-        // if the subject line starts with the filename extension
-        // we assume this post in question is not a binary post
-        // but something like ".pdf viewer for linux?"
-        if (start == str)
-            return false;
-        
-        // if filename is matched at the end of the subjectline
-        // this is ok
-        if (end == str + len)
-            return true;
-
-        --start;
-
-        assert(end < str + len);        
-        assert(start >= str);
-        
-        // if the filename ends with a space (very common), 
-        // or with a double quote this is ok and the extension does not
-        // have a space right before it then it is ok
-        
-        // if the filename ends with a quote this is ok.
-        // (yEnc encoded posts should have a subject line like '"fooobar.mp3 (1/10)" yEnc'
-        // another used notation is '(fooobar.jpeg')
-        if (*end == '"' || *end == ')')
-            return true;
-        
-        if (*start != ' ')
-        {
-            // a space after a filename this is swell. Probably some non-yEnc encoded
-            // binary. For example 'anna-kournikova.JPEG - sweet ass
-            if (*end == ' ')
-                return true;
-
-            // finally there's a case that falls through everything else.
-            // Ie. we have a match like 'metallica - enter sandman.mp3Posted by keke'
-            // see if the rest of the string contains either 'yEnc' or '(xx/yy)'. if it does then this is ok, otherwise fail.
-            if (regex_search(start, str+len, part))
-                return true;
-        }
-        else
-        {
-            if (regex_search(start, str+len, part))
-                return true;
-        }
-    }
-
-    return false;    
+    return detail::is_binary_post(str, len, ext, found);
 }
 
 bool strcmp(const char* first,  std::size_t firstLen, const char* second, std::size_t secondLen)
@@ -281,7 +142,7 @@ bool strcmp(const char* first,  std::size_t firstLen, const char* second, std::s
     std::size_t skip_first  = 0;
     std::size_t skip_second = 0;
 
-    const auto* p1 = find_part_count(first, firstLen, skip_first);
+    const auto* p1 = detail::find_part_count(first, firstLen, skip_first);
     if (!p1)
     {
         if (firstLen != secondLen)
@@ -292,7 +153,7 @@ bool strcmp(const char* first,  std::size_t firstLen, const char* second, std::s
     }
     else
     {
-        const auto* p2 = find_part_count(second, secondLen, skip_second);
+        const auto* p2 = detail::find_part_count(second, secondLen, skip_second);
         if (!p2) 
             return false;
 
@@ -518,39 +379,25 @@ std::pair<bool, part> parse_part(const char* str, size_t len)
 {
     nntp::part part {0};
 
-    str = find_part_count(str, len, len);
+    str = detail::find_part_count(str, len, len);
     if (!str) 
         return {false, part};
 
-    using namespace boost::spirit::classic;
-
-    // first notation (xx/yy)
-    {
-        const auto& ret = parse(str, str+len,
-            (                                   
-               ch_p('(') >> uint_p[assign(part.numerator)] >> 
-                   ch_p('/') >> uint_p[assign(part.denominator)] >>
-                   ch_p(')')
-                   ));
-        if (ret.full)
-            return {ret.full, part};
-    }
+    std::size_t numerator   = 0;
+    std::size_t denominator = 0;
+    if (!detail::parse_part_count(str, len, numerator, denominator))
+        return {false, part};
 
-    // second notation  [xx/yy]
-    const auto& ret = parse(str, str+len,
-        (                                   
-         ch_p('[') >> uint_p[assign(part.numerator)] >> 
-             ch_p('/') >> uint_p[assign(part.denominator)] >>
-             ch_p(']')
-             ));
-    return {ret.full, part};
+    part.numerator   = numerator;
+    part.denominator = denominator;
+    return {true, part};
 }
 
 std::uint32_t hashvalue(const char* subjectline, size_t len)
 {
     std::size_t seed = 0;
     std::size_t skip = 0;
-    const auto* p = find_part_count(subjectline, len, skip);
+    const auto* p = detail::find_part_count(subjectline, len, skip);
     if (!p)
     {
         for (std::size_t i=0; i<len; ++i)
@@ -571,232 +418,43 @@ std::uint32_t hashvalue(const char* subjectline, size_t len)
     return std::uint32_t(seed);
 }
 
-
-std::string find_filename(const char* str, size_t len, bool include_extension)
+std::uint64_t fingerprint(const char* subjectline, size_t len)
 {
-    using namespace boost::spirit::classic;
-
-    const static boost::regex regex(REVERSE_FILE_EXTENSION_REGEX, boost::regbase::icase | boost::regbase::perl);
-    const static boost::regex mk1("File [0-9]* of [0-9]*");
-    const static boost::regex mk2("(\\(|\\[)[0-9]*/[0-9]*(\\)|\\])");
-
-    // see if it's an yEnc subjectline match.
-    {
-        std::string yenc_name;
-        const auto ret = parse(str, str + len,
-            (*(anychar_p - '"') >> str_p("\"") >> (*(anychar_p - '"'))[assign(yenc_name)] >> str_p("\" yEnc")));
-        if (ret.hit)
-        {
-            if (include_extension)
-                return yenc_name;
-
-        }
-        using iterator = std::string::reverse_iterator;
-
-        boost::match_results<iterator> res;
-        if (regex_search(yenc_name.rbegin(), yenc_name.rend(), res, regex))
-        {
-            auto start = res[0].second;
-            yenc_name.erase(start.base());
-        }
-    }
-
-    reverse_c_str_iterator itbeg(str + len - 1);
-    reverse_c_str_iterator itend(str - 1);
-
-    boost::match_results<reverse_c_str_iterator> res;
-    
-    if (!regex_search(itbeg, itend, res, regex))
-        return "";
-
-    // first returns an iterator pointing to the 
-    // start of the sequence, which in this case is the end of the filename
-    // extension.
-    const char* ext = res[0].first.as_ptr(); 
-    // second returns an iterator pointing one past the end of the sequence
-    // which in this case is one before the the start of the filename extension
-    const char* start = res[0].second.as_ptr();
-
-    if (start < str)
-        ++start;
-
-    // seek the dot, its part of the regex so it must be found before start of str    
-    const char* dot = ext;
-    while (*dot != '.')
-    {
-        if (--dot < start)
-            return "";
-    }
-
-    if (dot == start)
-        return "";
-
-    if (dot[-1] == ' ')
-        return "";
-
-    const auto ext_len = ext - dot;
-
-    char start_marker = 0;
-    // look at the first character after the filename extension and see if it's a special
-    // character such as ", ], )
-    if (++ext < str + len)
-    {
-        if (*ext == '"')
-            start_marker = '"';
-        else if (*ext == ')')
-            start_marker = '(';
-        else if (*ext == ']')
-            start_marker = '[';
-        //else if (*ext == '#')
-        //    start_marker = '#';
-    }
-
-    if (start_marker)
-    {
-        while (*start != start_marker && start > str)
-            --start;
+    // FNV-1a over the subject line without the part count. the position
+    // of the part count is marked with a byte that doesn't appear in text 
+    // so that the prefix and the suffix don't run into each other.
+    std::uint64_t hash = 14695981039346656037ull;
+    const auto mix = [&](unsigned char c) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    };
 
-        // if we hit the marker exclude it from the name
-        if (*start == start_marker)
-            ++start;
+    std::size_t skip = 0;
+    const auto* p = detail::find_part_count(subjectline, len, skip);
+    const auto num = p ? std::size_t(p - subjectline) : len;
 
-        // trim whitespace
-        while (std::isspace((unsigned char)*start) && start < dot)
-            ++start;
-    }
-    else
+    for (std::size_t i=0; i<num; ++i)
+        mix(subjectline[i]);
+    if (p)
     {
-        // see if we can find some sort of upper limit how far to seek
-        // forwards from the file extension
-        // if the subject line contains something like
-        // Foobar bla blah - File 07 of 10 - foobar.mp3" we use the "File xx of yy" as a marker
-        {
-            boost::match_results<const char*> res;
-            if (regex_search(str, dot, res, mk1) ||
-                regex_search(str, dot, res, mk2))
-            {
-                const auto e = res[0].second;
-                const auto m = e - str;
-                str  = e;
-                len -= m;
-            }
-        }
-
-        struct name_pred {
-
-            name_pred(bool parity) : prev_(0), dash_(false), good_(true), parity_(parity)
-            {}
-
-            bool is_allowed(int c)
-            {
-                const auto ret = test(c);
-                prev_ = c;
-                return ret;
-            }
-            bool is_good()
-            {
-                return good_;
-            }
-            bool test(int c)
-            {
-                if (std::isalnum(c))
-                {
-                    if (prev_ == '-')
-                        good_ = true;
-                    return true;
-                }
-
-                if (c == '_' || c == '.' || c == ' ')
-                {
-                    return true;
-                }
-                else if (c == '-')
-                {
-                    if (prev_ == ' ' || prev_ == '-')                    
-                    {
-                        if (dash_ == true)
-                            return false;
-                            
-                        good_ = false;
-                        dash_ = true;
-                    }
-                    return true;
-                }
-                else if (c == '+')
-                {
-                    if (parity_ && std::isdigit(prev_))
-                        return true;
-                }
-                else if (c == ']' || c == ')' || c == '"')
-                {
-                    good_ = false;
-                    enclosure_.push(c);
-                    return true;
-                }
-                else if (c == '[')
-                {
-                    return test_top(']');
-                }
-                else if (c == '(')
-                {
-                    return test_top(')');
-                }
-                else if (c == '"')
-                {
-                    return test_top('"');
-                }
-
-                return false;
-            }
-        private:
-            bool test_top(int expected)
-            {
-                if (enclosure_.empty())
-                    return false;
-                auto top = enclosure_.top();
-                enclosure_.pop();
-                good_ = top == expected;
-                return good_;
-            }
-
-        private:
-            int prev_;
-            bool dash_;
-            bool good_;
-            bool parity_;
-            std::stack<int> enclosure_;
-
-        };
-        bool is_parity = !strncmp(dot, ".PAR2", ext_len) || !strncmp(dot, ".par2", ext_len);
-
-        name_pred pred(is_parity);
-
-        const char* good = start;
-
-        while (pred.is_allowed((unsigned char)*start) && start >= str)
-        {
-            if (pred.is_good())
-                good = start;
-            --start;
-        }
-
-        assert(good <= dot);
-
-        while ((*good == ' ' || *good == '-') && (good < dot))
-            ++good;
-
-        start = good;
+        mix(0xff);
+        for (std::size_t i=num + skip; i<len; ++i)
+            mix(subjectline[i]);
     }
+    return hash ? hash : 1;
+}
 
-    assert(start <= dot && dot < ext);
+std::string find_filename(const char* str, size_t len, bool include_extension)
+{
+    detail::extension ext;
+    const bool found = len && detail::find_extension(str, str + len - 1, ext);
 
-    if (start - dot == 0)
+    std::size_t name_len = 0;
+    const char* name = detail::find_filename(str, len, include_extension, ext, found, name_len);
+    if (!name)
         return "";
 
-    if (include_extension)
-        return std::string(start, ext - start);
-
-    return std::string(start, dot - start);
+    return std::string(name, name_len);
 }
 
 std::size_t find_response(const void* buff, std::size_t size)
@@ -866,7 +524,7 @@ void thread_safe_initialize()
     // https://msdn.microsoft.com/en-us/library/hh567368.aspx
 
     std::size_t i;
-    find_part_count("", 0, i);
+    detail::find_part_count("", 0, i);
     is_binary_post("", 0);
     find_filename("", 0, false);
 }
@@ -189,6 +189,15 @@ namespace nntp
     std::uint32_t hashvalue(const std::string& s)
     { return hashvalue(s.c_str(), s.size()); }
 
+    // return a 64bit fingerprint of the subject line. the fingerprints of two
+    // subject lines are equal when they compare equal with nntp::strcmp, i.e.
+    // the part count is ignored. never returns 0.
+    std::uint64_t fingerprint(const char* subjectline, size_t len);
+
+    inline
+    std::uint64_t fingerprint(const std::string& s)
+    { return fingerprint(s.c_str(), s.size()); }
+
     // find a filename in the given subjectline. if no filename was found
     // then returns (nullptr, 0), otherwise a pointer to the start of the filename
     // and the length of the name. 
@@ -0,0 +1,377 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <algorithm>
+#include <iterator>
+#include <cstring>
+#include <cctype>
+#include "par2.h"
+#include "crc32.h"
+#include "bigfile.h"
+#include "filesys.h"
+
+namespace {
+
+const std::size_t HEADER_SIZE = 64;
+const char MAGIC[8]       = {'P', 'A', 'R', '2', '\0', 'P', 'K', 'T'};
+const char TYPE_MAIN[16]  = {'P', 'A', 'R', ' ', '2', '.', '0', '\0', 'M', 'a', 'i', 'n', '\0', '\0', '\0', '\0'};
+const char TYPE_DESC[16]  = {'P', 'A', 'R', ' ', '2', '.', '0', '\0', 'F', 'i', 'l', 'e', 'D', 'e', 's', 'c'};
+const char TYPE_IFSC[16]  = {'P', 'A', 'R', ' ', '2', '.', '0', '\0', 'I', 'F', 'S', 'C', '\0', '\0', '\0', '\0'};
+
+// the integers in par2 packets are little endian
+std::uint64_t read_u64(const std::uint8_t* p)
+{
+    std::uint64_t ret = 0;
+    for (int i=7; i>=0; --i)
+        ret = (ret << 8) | p[i];
+    return ret;
+}
+
+std::uint32_t read_u32(const std::uint8_t* p)
+{
+    return (std::uint32_t)p[0] | (std::uint32_t)p[1] << 8 |
+           (std::uint32_t)p[2] << 16 | (std::uint32_t)p[3] << 24;
+}
+
+struct packet {
+    const std::uint8_t* setid;
+    const std::uint8_t* type;
+    const std::uint8_t* body;
+    std::size_t size;
+};
+
+// visit each well formed packet. the packets are 4 byte aligned so
+// after a damaged packet the scanning continues at the next 4 bytes.
+template<typename Visitor>
+void for_each_packet(const std::uint8_t* data, std::size_t len, Visitor visit)
+{
+    std::size_t pos = 0;
+    while (len - pos >= HEADER_SIZE)
+    {
+        const auto* p = data + pos;
+        if (std::memcmp(p, MAGIC, sizeof(MAGIC)))
+        {
+            pos += 4;
+            continue;
+        }
+        const auto size = read_u64(p + 8);
+        if (size < HEADER_SIZE || size % 4 || size > len - pos)
+        {
+            pos += 4;
+            continue;
+        }
+        packet pkt;
+        pkt.setid = p + 32;
+        pkt.type  = p + 48;
+        pkt.body  = p + HEADER_SIZE;
+        pkt.size  = size - HEADER_SIZE;
+        visit(pkt);
+        pos += size;
+    }
+}
+
+bool is_type(const packet& pkt, const char* type)
+{
+    return !std::memcmp(pkt.type, type, 16);
+}
+
+std::string file_id(const std::uint8_t* p)
+{
+    return std::string((const char*)p, 16);
+}
+
+std::uint32_t crc32_zeros(std::uint32_t crc, std::uint64_t len)
+{
+    static const char zeros[4096] = {0};
+    while (len)
+    {
+        const auto bytes = std::min<std::uint64_t>(len, sizeof(zeros));
+        crc  = newsflash::crc32(crc, zeros, bytes);
+        len -= bytes;
+    }
+    return crc;
+}
+
+} // namespace
+
+namespace newsflash
+{
+
+const par2_file* par2_set::find_file(const std::string& name) const
+{
+    const auto legal = fs::remove_illegal_filename_chars(name);
+    for (const auto& file : files)
+    {
+        if (fs::remove_illegal_filename_chars(file.name) == legal)
+            return &file;
+    }
+    return nullptr;
+}
+
+bool parse_par2(const void* data, std::size_t len, par2_set& set)
+{
+    const auto* ptr = static_cast<const std::uint8_t*>(data);
+
+    // the main packet identifies the recovery set and the slice size.
+    std::string setid;
+    std::uint64_t slice_size = 0;
+    for_each_packet(ptr, len, [&](const packet& pkt) {
+        if (!setid.empty() || !is_type(pkt, TYPE_MAIN) || pkt.size < 12)
+            return;
+        slice_size = read_u64(pkt.body);
+        if (slice_size == 0 || slice_size % 4)
+            return;
+        setid.assign((const char*)pkt.setid, 16);
+    });
+    if (setid.empty())
+        return false;
+
+    struct desc {
+        std::string name;
+        std::uint64_t size;
+    };
+    std::map<std::string, desc> descs;
+    std::map<std::string, std::vector<std::uint32_t>> crcs;
+
+    for_each_packet(ptr, len, [&](const packet& pkt) {
+        if (std::memcmp(pkt.setid, setid.data(), 16))
+            return;
+
+        if (is_type(pkt, TYPE_DESC) && pkt.size > 56)
+        {
+            const auto* name = (const char*)pkt.body + 56;
+            const auto* end  = (const char*)pkt.body + pkt.size;
+            desc d;
+            d.size = read_u64(pkt.body + 48);
+            d.name.assign(name, std::find(name, end, '\0'));
+            descs.insert(std::make_pair(file_id(pkt.body), std::move(d)));
+        }
+        else if (is_type(pkt, TYPE_IFSC) && pkt.size >= 16 && (pkt.size - 16) % 20 == 0)
+        {
+            const auto id = file_id(pkt.body);
+            if (crcs.find(id) != std::end(crcs))
+                return;
+
+            std::vector<std::uint32_t> values;
+            for (std::size_t i=16; i<pkt.size; i+=20)
+                values.push_back(read_u32(pkt.body + i + 16));
+            crcs.insert(std::make_pair(id, std::move(values)));
+        }
+    });
+
+    set.slice_size = slice_size;
+    set.files.clear();
+    for (auto& pair : descs)
+    {
+        auto it = crcs.find(pair.first);
+        if (it == std::end(crcs))
+            continue;
+
+        const auto& d = pair.second;
+        const auto num_slices = (d.size + slice_size - 1) / slice_size;
+        if (it->second.size() != num_slices)
+            continue;
+
+        par2_file file;
+        file.name = d.name;
+        file.size = d.size;
+        file.crcs = std::move(it->second);
+        set.files.push_back(std::move(file));
+    }
+    return true;
+}
+
+bool load_par2(const std::string& file, par2_set& set)
+{
+    bigfile big;
+    big.open(file);
+
+    const auto size = big.size();
+    std::vector<char> data((std::size_t)size);
+    if (size)
+    {
+        if (big.read(&data[0], data.size()) != data.size())
+            return false;
+    }
+    return parse_par2(data.data(), data.size(), set);
+}
+
+bool is_main_par2(const std::string& name)
+{
+    std::string lower;
+    std::transform(std::begin(name), std::end(name), std::back_inserter(lower), 
+        [](char c) { return std::tolower((unsigned char)c); });
+
+    if (lower.size() < 5 || lower.compare(lower.size() - 5, 5, ".par2"))
+        return false;
+
+    // only the .volNN+MM.par2 suffix makes a recovery volume, 
+    // a release name such as "Kill.Bill.Vol.1" doesn't.
+    std::uint32_t num_blocks = 0;
+    return !is_par2_volume(name, num_blocks);
+}
+
+bool is_par2_volume(const std::string& name, std::uint32_t& num_blocks)
+{
+    std::string lower;
+    std::transform(std::begin(name), std::end(name), std::back_inserter(lower), 
+        [](char c) { return std::tolower((unsigned char)c); });
+
+    if (lower.size() < 5 || lower.compare(lower.size() - 5, 5, ".par2"))
+        return false;
+
+    // .volNN+MM.par2 where NN is the first block and MM the number of blocks.
+    const auto pos = lower.rfind(".vol");
+    if (pos == std::string::npos)
+        return false;
+
+    std::size_t i = pos + 4;
+    const auto end = lower.size() - 5;
+    const auto first = i;
+    while (i < end && std::isdigit((unsigned char)lower[i]))
+        ++i;
+    if (i == first || i == end || (lower[i] != '+' && lower[i] != '-'))
+        return false;
+
+    std::uint32_t count = 0;
+    const auto digits = ++i;
+    for (; i < end; ++i)
+    {
+        if (!std::isdigit((unsigned char)lower[i]))
+            return false;
+        count = count * 10 + (lower[i] - '0');
+    }
+    if (i == digits)
+        return false;
+
+    num_blocks = count;
+    return true;
+}
+
+par2_verifier::par2_verifier(std::uint64_t slice_size, const par2_file& file)
+    : slice_size_(slice_size), file_size_(file.size)
+{
+    slices_.resize(file.crcs.size());
+    for (std::size_t i=0; i<slices_.size(); ++i)
+    {
+        slices_[i].bytes    = 0;
+        slices_[i].expected = file.crcs[i];
+        slices_[i].state    = result::pending;
+    }
+}
+
+void par2_verifier::write(std::uint64_t offset, const void* data, std::size_t len)
+{
+    const auto* ptr = static_cast<const char*>(data);
+    const auto end  = offset + len;
+
+    // anything past the end of the file means the content doesn't
+    // match what the par2 set describes.
+    if (end > file_size_)
+    {
+        if (!slices_.empty())
+            slices_.back().state = result::bad;
+        if (offset >= file_size_)
+            return;
+        len = (std::size_t)(file_size_ - offset);
+    }
+
+    while (len)
+    {
+        const auto index = (std::size_t)(offset / slice_size_);
+        const auto start = offset % slice_size_;
+        const auto bytes = (std::size_t)std::min<std::uint64_t>(len, slice_size_ - start);
+        add_chunk(index, start, bytes, crc32(0, ptr, bytes));
+        offset += bytes;
+        ptr    += bytes;
+        len    -= bytes;
+    }
+}
+
+bool par2_verifier::is_verified() const
+{
+    return std::all_of(std::begin(slices_), std::end(slices_),
+        [](const slice& s) {
+            return s.state == result::good;
+        });
+}
+
+std::vector<std::uint32_t> par2_verifier::damaged_slices() const
+{
+    std::vector<std::uint32_t> ret;
+    for (std::size_t i=0; i<slices_.size(); ++i)
+    {
+        if (slices_[i].state != result::good)
+            ret.push_back((std::uint32_t)i);
+    }
+    return ret;
+}
+
+void par2_verifier::add_chunk(std::size_t index, std::uint64_t offset, std::uint64_t size, std::uint32_t crc)
+{
+    auto& s = slices_[index];
+    if (s.state != result::pending)
+        return;
+
+    // the same data can be written again for example when an
+    // article is retried, the latter write replaces the former.
+    auto it = s.chunks.find(offset);
+    if (it != std::end(s.chunks))
+    {
+        s.bytes -= it->second.size;
+        s.chunks.erase(it);
+    }
+    s.chunks.insert(std::make_pair(offset, chunk{size, crc}));
+    s.bytes += size;
+
+    const auto begin  = (std::uint64_t)index * slice_size_;
+    const auto length = std::min(slice_size_, file_size_ - begin);
+    if (s.bytes < length)
+        return;
+
+    std::uint64_t pos = 0;
+    std::uint32_t value = 0;
+    for (const auto& c : s.chunks)
+    {
+        // overlapping chunks
+        if (c.first != pos)
+        {
+            s.state = result::bad;
+            break;
+        }
+        value = crc32_combine(value, c.second.crc, c.second.size);
+        pos  += c.second.size;
+    }
+    if (s.state == result::pending)
+    {
+        if (pos != length)
+            s.state = result::bad;
+        else
+        {
+            value = crc32_zeros(value, slice_size_ - length);
+            s.state = value == s.expected ? result::good : result::bad;
+        }
+    }
+    s.chunks.clear();
+}
+
+} // newsflash
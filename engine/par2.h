@@ -0,0 +1,122 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include <cstddef>
+
+namespace newsflash
+{
+    // the verification data of a single file in a par2 recovery set.
+    struct par2_file {
+        // the name of the file as recorded in the par2 set.
+        std::string name;
+
+        // the size of the file in bytes.
+        std::uint64_t size;
+
+        // the crc32 of each slice (block) of the file in file order.
+        // the last slice is padded with zeros to the full slice size.
+        std::vector<std::uint32_t> crcs;
+    };
+
+    // the slice checksums of a par2 recovery set as read from the
+    // critical packets (main, file description and input file slice 
+    // checksum) of a .par2 file. The slice md5s are not kept since 
+    // verifying them needs the slices in order, the crcs are enough 
+    // for verifying the data as it's being downloaded in pieces.
+    struct par2_set {
+        std::uint64_t slice_size;
+
+        // the files that have both a description and checksum packet.
+        std::vector<par2_file> files;
+
+        // find a file by its name. the name is compared after removing
+        // the characters that aren't legal in file names, in the same way
+        // the downloaded file names are. returns nullptr if not found.
+        const par2_file* find_file(const std::string& name) const;
+    };
+
+    // parse the packets in the .par2 file content. only the packets that
+    // belong to the same recovery set as the first main packet are used and
+    // damaged packets are skipped. returns false if no main packet was found.
+    bool parse_par2(const void* data, std::size_t len, par2_set& set);
+
+    // read and parse the given .par2 file. 
+    bool load_par2(const std::string& file, par2_set& set);
+
+    // returns true if the name is a main .par2 file i.e. not a recovery volume.
+    bool is_main_par2(const std::string& name);
+
+    // returns true if the name is a par2 recovery volume such as
+    // foo.vol07+08.par2 and stores the number of recovery blocks in it.
+    bool is_par2_volume(const std::string& name, std::uint32_t& num_blocks);
+
+    // par2_verifier checks the slices of a file against the crcs
+    // of a par2 set while the contents are written. The content can be
+    // written in chunks in any order, each slice is checked once all of
+    // its bytes have been seen.
+    class par2_verifier
+    {
+    public:
+        par2_verifier(std::uint64_t slice_size, const par2_file& file);
+
+        // verify a chunk of the file content at the given offset.
+        void write(std::uint64_t offset, const void* data, std::size_t len);
+
+        // returns true once every slice has been written and matched its crc.
+        bool is_verified() const;
+
+        // get the indices of the slices that either didn't match their crc
+        // or haven't been completely written.
+        std::vector<std::uint32_t> damaged_slices() const;
+
+        std::size_t num_slices() const 
+        { return slices_.size(); }
+
+    private:
+        enum class result : std::uint8_t {
+            pending, good, bad
+        };
+        struct chunk {
+            std::uint64_t size;
+            std::uint32_t crc;
+        };
+        struct slice {
+            // chunks by their offset within the slice.
+            std::map<std::uint64_t, chunk> chunks;
+            std::uint64_t bytes;
+            std::uint32_t expected;
+            result state;
+        };
+        void add_chunk(std::size_t index, std::uint64_t offset, std::uint64_t size, std::uint32_t crc);
+
+    private:
+        std::vector<slice> slices_;
+        std::uint64_t slice_size_;
+        std::uint64_t file_size_;
+    };
+
+} // newsflash
@@ -0,0 +1,96 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+#include <algorithm>
+#include <cmath>
+#include "pipeline_controller.h"
+
+namespace {
+    // smoothing factors for the moving averages, the rtt as in tcp (rfc 6298).
+    const double RttGain  = 1.0 / 8.0;
+    const double RateGain = 1.0 / 4.0;
+    const double SizeGain = 1.0 / 4.0;
+
+    // how much more than the bandwidth-delay product to keep in the pipeline.
+    const double DepthGain = 2.0;
+
+    double average(double avg, double sample, double gain)
+    {
+        if (avg == 0.0)
+            return sample;
+        return avg + gain * (sample - avg);
+    }
+} // namespace
+
+namespace newsflash
+{
+
+const std::size_t pipeline_controller::min_depth;
+const std::size_t pipeline_controller::max_depth;
+const std::size_t pipeline_controller::min_batch;
+const std::size_t pipeline_controller::max_batch;
+const std::size_t pipeline_controller::initial_depth;
+const std::size_t pipeline_controller::initial_batch;
+const std::size_t pipeline_controller::target_batch_ms;
+
+pipeline_controller::pipeline_controller() : rtt_(0), rate_(0), size_(0), 
+    depth_(initial_depth), batch_(initial_batch)
+{}
+
+void pipeline_controller::sample_rtt(duration rtt)
+{
+    // clamp to 1us so that a zero sample isn't taken as "no value"
+    const auto us = std::max<duration::rep>(rtt.count(), 1);
+    rtt_ = average(rtt_, us, RttGain);
+    update();
+}
+
+void pipeline_controller::sample_response(std::size_t bytes, duration interval)
+{
+    if (bytes == 0)
+        return;
+
+    const auto us = std::max<duration::rep>(interval.count(), 1);
+    size_ = average(size_, bytes, SizeGain);
+    rate_ = average(rate_, bytes * 1000000.0 / us, RateGain);
+    update();
+}
+
+void pipeline_controller::update()
+{
+    if (rtt_ == 0.0 || rate_ == 0.0 || size_ == 0.0)
+        return;
+
+    // bandwidth-delay product expressed in responses. one more is needed
+    // so that the next command is already there when a response completes.
+    const auto bdp   = rate_ * (rtt_ / 1000000.0) / size_;
+    const auto depth = std::ceil(DepthGain * bdp) + 1.0;
+    depth_ = static_cast<std::size_t>(std::min<double>(depth, max_depth));
+    depth_ = std::max(depth_, min_depth);
+
+    // every cmdlist begins with an empty pipeline so it should be 
+    // a few times deeper than the pipeline to amortize that.
+    const auto batch = std::floor(rate_ * (target_batch_ms / 1000.0) / size_);
+    batch_ = static_cast<std::size_t>(std::min<double>(batch, max_batch));
+    batch_ = std::max(batch_, 2 * depth_);
+    batch_ = std::min(std::max(batch_, min_batch), max_batch);
+}
+
+} // newsflash
@@ -0,0 +1,104 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#pragma once
+
+#include <newsflash/config.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace newsflash
+{
+    // pick the command pipelining depth and the cmdlist batch size
+    // for a connection based on its measured performance.
+    //
+    // the pipeline needs to hold enough commands to cover the bandwidth-delay 
+    // product of the link, otherwise the connection idles for a round trip 
+    // in between the responses. on a high latency link that's most of the time.
+    // on the other hand anything that is pipelined has to be thrown away 
+    // (with a socket reset) when the cmdlist is canceled, and big cmdlists 
+    // keep the connection from other tasks for longer, so we don't want 
+    // to go any deeper than is needed.
+    //
+    // the depth is computed with a gain of 2 so that when the pipeline 
+    // is too shallow (latency bound) the measured throughput is low but the depth
+    // still grows until the link bandwidth becomes the limiting factor.
+    class pipeline_controller
+    {
+    public:
+        using duration = std::chrono::microseconds;
+
+        pipeline_controller();
+
+        // record a round trip time sample, i.e. the time from sending
+        // a command on an idle pipeline to receiving the first response bytes.
+        void sample_rtt(duration rtt);
+
+        // record a completed response of the given size in bytes that
+        // took the given time since the previous response was completed.
+        void sample_response(std::size_t bytes, duration interval);
+
+        // the number of commands to keep in the pipeline.
+        std::size_t depth() const
+        { return depth_; }
+
+        // the number of data commands to put into a cmdlist.
+        std::size_t batch_size() const
+        { return batch_; }
+
+        // smoothed round trip time.
+        duration rtt() const
+        { return duration(static_cast<duration::rep>(rtt_)); }
+
+        // smoothed throughput in bytes per second.
+        double throughput() const
+        { return rate_; }
+
+        // smoothed response size in bytes.
+        double response_size() const
+        { return size_; }
+
+        // the limits for the decisions. 
+        static const std::size_t min_depth = 1;
+        static const std::size_t max_depth = 64;
+        static const std::size_t min_batch = 2;
+        static const std::size_t max_batch = 100;
+
+        // the initial values when nothing has been measured yet.
+        // these are what was used before the controller.
+        static const std::size_t initial_depth = 10;
+        static const std::size_t initial_batch = 10;
+
+        // the batch is sized to keep a cmdlist in the transfer 
+        // for about this long.
+        static const std::size_t target_batch_ms = 2000;
+
+    private:
+        void update();
+
+    private:
+        double rtt_;
+        double rate_;
+        double size_;
+        std::size_t depth_;
+        std::size_t batch_;
+    };
+
+} // newsflash
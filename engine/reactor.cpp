@@ -0,0 +1,360 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#if defined(LINUX_OS)
+#  include <sys/epoll.h>
+#  include <sys/eventfd.h>
+#  include <unistd.h>
+#  include <cerrno>
+#endif
+#include <functional>
+#include <stdexcept>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <unordered_set>
+#include <unordered_map>
+#include <deque>
+#include <cstdint>
+#include <cassert>
+#include "reactor.h"
+#include "action.h"
+#include "minidump.h"
+#include "assert.h"
+
+namespace newsflash
+{
+
+// todo: the windows implementation would go on top of IOCP. until then
+// the engine keeps running the connections on private threads on windows.
+
+#if defined(LINUX_OS)
+
+using clock = std::chrono::steady_clock;
+
+struct reactor::entry {
+    action* act;
+    reactor::operation* op;
+
+    // currently registered socket and event descriptors
+    // and their epoll interest set. -1 when not registered.
+    int socket;
+    int event;
+    std::uint32_t socket_events;
+    std::uint32_t event_events;
+
+    // queued for running in the current loop iteration.
+    bool ready;
+
+    bool has_timer;
+    std::multimap<clock::time_point, entry*>::iterator timer;
+};
+
+struct reactor::loop {
+    std::mutex mutex;
+    std::vector<action*> queue;
+    std::unique_ptr<std::thread> thread;
+    bool run_loop;
+
+    // the following are only accessed by the loop thread itself.
+    int epoll;
+    int wakeup;
+    std::multimap<clock::time_point, entry*> timers;
+    std::unordered_set<entry*> entries;
+    std::vector<entry*> ready;
+
+    // actions waiting for the previous action
+    // of the same owner to complete.
+    std::unordered_map<std::size_t, std::deque<action*>> owners;
+};
+
+namespace {
+
+// change the epoll registration of a descriptor to match the wanted
+// descriptor and interest set.
+void watch(int epoll, int& fd, std::uint32_t& current, int wanted_fd, std::uint32_t wanted, void* ptr)
+{
+    if (fd != -1 && (fd != wanted_fd || !wanted))
+    {
+        // the descriptor may have been closed already in which
+        // case the kernel has already removed it from the set.
+        epoll_ctl(epoll, EPOLL_CTL_DEL, fd, nullptr);
+        fd = -1;
+        current = 0;
+    }
+    if (wanted_fd == -1 || !wanted || (fd == wanted_fd && current == wanted))
+        return;
+
+    struct epoll_event ev {0};
+    ev.events   = wanted;
+    ev.data.ptr = ptr;
+
+    int op = fd == -1 ? EPOLL_CTL_ADD : EPOLL_CTL_MOD;
+    if (epoll_ctl(epoll, op, wanted_fd, &ev) && errno == EEXIST)
+    {
+        op = EPOLL_CTL_MOD;
+        epoll_ctl(epoll, op, wanted_fd, &ev);
+    }
+    // if the registration failed the operation will still
+    // be run once its timeout expires.
+    fd = wanted_fd;
+    current = wanted;
+}
+
+} // namespace
+
+reactor::reactor(std::size_t num_loops) : queue_size_(0)
+{
+    assert(num_loops);
+
+    for (std::size_t i=0; i<num_loops; ++i)
+    {
+        std::unique_ptr<loop> l(new loop);
+        l->run_loop = true;
+        l->epoll    = epoll_create1(EPOLL_CLOEXEC);
+        if (l->epoll == -1)
+            throw std::runtime_error("epoll_create failed");
+
+        l->wakeup = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (l->wakeup == -1)
+        {
+            ::close(l->epoll);
+            throw std::runtime_error("eventfd failed");
+        }
+
+        // the wakeup descriptor is identified by a null pointer.
+        struct epoll_event ev {0};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = nullptr;
+        CHECK(epoll_ctl(l->epoll, EPOLL_CTL_ADD, l->wakeup, &ev), 0);
+
+        l->thread.reset(new std::thread(std::bind(&reactor::loop_seh, this, l.get())));
+        loops_.push_back(std::move(l));
+    }
+}
+
+reactor::~reactor()
+{
+    shutdown();
+}
+
+void reactor::submit(action* act)
+{
+    assert(dynamic_cast<operation*>(act));
+
+    auto& l = loops_[act->get_owner() % loops_.size()];
+
+    queue_size_++;
+
+    std::lock_guard<std::mutex> lock(l->mutex);
+    l->queue.push_back(act);
+
+    const std::uint64_t one = 1;
+    CHECK(::write(l->wakeup, &one, sizeof(one)), sizeof(one));
+}
+
+void reactor::shutdown()
+{
+    for (auto& l : loops_)
+    {
+        {
+            std::lock_guard<std::mutex> lock(l->mutex);
+            l->run_loop = false;
+
+            const std::uint64_t one = 1;
+            CHECK(::write(l->wakeup, &one, sizeof(one)), sizeof(one));
+        }
+        l->thread->join();
+
+        for (auto* e : l->entries)
+            delete e;
+        for (auto& owner : l->owners)
+        {
+            for (auto* a : owner.second)
+                delete a;
+        }
+        for (auto* a : l->queue)
+            delete a;
+
+        ::close(l->wakeup);
+        ::close(l->epoll);
+    }
+    loops_.clear();
+}
+
+void reactor::loop_main(loop* self)
+{
+    std::vector<struct epoll_event> events(64);
+    auto& ready = self->ready;
+
+    for (;;)
+    {
+        int timeout = -1;
+        if (!self->timers.empty())
+        {
+            const auto now  = clock::now();
+            const auto next = self->timers.begin()->first;
+            timeout = 0;
+            if (next > now)
+            {
+                // round up so that we don't wake up before the deadline
+                const auto us = std::chrono::duration_cast<std::chrono::microseconds>(next - now);
+                timeout = (us.count() + 999) / 1000;
+            }
+        }
+
+        const int num = epoll_wait(self->epoll, &events[0], events.size(), timeout);
+        if (num == -1 && errno != EINTR)
+            throw std::runtime_error("epoll_wait failed");
+
+        for (int i=0; i<num; ++i)
+        {
+            auto* e = static_cast<entry*>(events[i].data.ptr);
+            if (e == nullptr)
+            {
+                std::uint64_t value;
+                ::read(self->wakeup, &value, sizeof(value));
+
+                std::vector<action*> submitted;
+                {
+                    std::lock_guard<std::mutex> lock(self->mutex);
+                    if (!self->run_loop)
+                        return;
+                    submitted.swap(self->queue);
+                }
+                for (auto* act : submitted)
+                {
+                    auto& pending = self->owners[act->get_owner()];
+                    pending.push_back(act);
+                    if (pending.size() == 1)
+                        start(self, act);
+                }
+            }
+            else if (!e->ready)
+            {
+                e->ready = true;
+                ready.push_back(e);
+            }
+        }
+
+        const auto now = clock::now();
+        while (!self->timers.empty() && self->timers.begin()->first <= now)
+        {
+            auto* e = self->timers.begin()->second;
+            self->timers.erase(self->timers.begin());
+            e->has_timer = false;
+            if (!e->ready)
+            {
+                e->ready = true;
+                ready.push_back(e);
+            }
+        }
+
+        // completing an action can start the next one which
+        // is then appended here, so no iterators.
+        for (std::size_t i=0; i<ready.size(); ++i)
+        {
+            auto* e = ready[i];
+            e->ready = false;
+            run(self, e);
+        }
+        ready.clear();
+    }
+}
+
+void reactor::loop_seh(loop* self)
+{
+    SEH_BLOCK(loop_main(self);)
+}
+
+void reactor::start(loop* self, action* act)
+{
+    auto* op = dynamic_cast<operation*>(act);
+    op->set_nonblocking(true);
+
+    auto* e = new entry;
+    e->act    = act;
+    e->op     = op;
+    e->socket = -1;
+    e->event  = -1;
+    e->socket_events = 0;
+    e->event_events  = 0;
+    e->ready     = true;
+    e->has_timer = false;
+    self->entries.insert(e);
+    self->ready.push_back(e);
+}
+
+void reactor::run(loop* self, entry* e)
+{
+    e->act->perform();
+
+    if (e->has_timer)
+    {
+        self->timers.erase(e->timer);
+        e->has_timer = false;
+    }
+
+    if (e->act->has_exception() || e->op->is_complete())
+    {
+        watch(self->epoll, e->socket, e->socket_events, -1, 0, e);
+        watch(self->epoll, e->event, e->event_events, -1, 0, e);
+        self->entries.erase(e);
+
+        auto* act = e->act;
+        delete e;
+
+        auto it = self->owners.find(act->get_owner());
+        it->second.pop_front();
+        if (it->second.empty())
+            self->owners.erase(it);
+        else start(self, it->second.front());
+
+        on_complete(act);
+
+        queue_size_--;
+        return;
+    }
+
+    const auto& wait = e->op->get_wait();
+
+    std::uint32_t socket_events = 0;
+    if (wait.socket && wait.read)
+        socket_events |= EPOLLIN;
+    if (wait.socket && wait.write)
+        socket_events |= EPOLLOUT;
+
+    watch(self->epoll, e->socket, e->socket_events, 
+        wait.socket ? wait.socket_handle : -1, socket_events, e);
+    watch(self->epoll, e->event, e->event_events, 
+        wait.event ? wait.event_handle : -1, wait.event ? EPOLLIN : 0, e);
+
+    if (wait.timeout.count())
+    {
+        e->timer = self->timers.insert(std::make_pair(clock::now() + wait.timeout, e));
+        e->has_timer = true;
+    }
+}
+
+#endif // LINUX_OS
+
+} // newsflash
@@ -0,0 +1,117 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include "native_types.h"
+
+namespace newsflash
+{
+    class action;
+
+    // reactor multiplexes non-blocking socket operations over a small number
+    // of event loop threads instead of dedicating a blocked thread to each
+    // connection. an operation is performed in steps, each step does as much
+    // work as possible without blocking and then tells the reactor what it is
+    // waiting for next.
+    class reactor
+    {
+    public:
+        // what the operation needs to happen before it can make progress.
+        struct wait {
+            // wait on the socket handle for readability/writability.
+            bool socket;
+            bool read;
+            bool write;
+            native_handle_t socket_handle;
+
+            // wait on an event handle (such as a cancellation event).
+            bool event;
+            native_handle_t event_handle;
+
+            // the operation is performed again after the timeout
+            // if nothing else happened. 0 for no timeout, but then
+            // the operation must be waiting for a handle.
+            std::chrono::milliseconds timeout;
+        };
+
+        // interface for actions that can be performed on the reactor.
+        class operation
+        {
+        public:
+            virtual ~operation() = default;
+
+            // when non-blocking the action performs a single step and
+            // then returns without waiting. otherwise the action waits
+            // for its handles itself and runs until completion.
+            virtual void set_nonblocking(bool on_off) = 0;
+
+            // returns true once the operation has completed.
+            virtual bool is_complete() const = 0;
+
+            // get what the operation is waiting for after a step.
+            virtual wait get_wait() const = 0;
+        protected:
+        private:
+        };
+
+        // callback to be invoked when an action has been completed
+        std::function<void (action*)> on_complete;
+
+        // initialize the reactor with num_loops event loop threads.
+        // precondition: num_loops > 0
+        reactor(std::size_t num_loops);
+       ~reactor();
+
+        // submit an action for execution. the action must implement
+        // the operation interface. actions with the same owner id are 
+        // performed one at a time in the order they were submitted.
+        // (just like with a private thread)
+        void submit(action* act);
+
+        // shutdown the reactor. will block and join all the threads. 
+        // operations that are still pending are discarded.
+        void shutdown();
+
+        std::size_t num_pending_actions() const 
+        { return queue_size_; }
+
+    private:
+        struct loop;
+        struct entry;
+        void loop_main(loop* self);
+        void loop_seh(loop* self);
+        void start(loop* self, action* act);
+        void run(loop* self, entry* e);
+
+    private:
+        std::vector<std::unique_ptr<loop>> loops_;
+        std::atomic<std::size_t> queue_size_;
+    };
+
+} // newsflash
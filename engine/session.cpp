@@ -19,6 +19,10 @@
 // THE SOFTWARE.
 
 #include <newsflash/config.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+#include <cstring>
 #include <zlib/zlib.h>
 #include "session.h"
 #include "buffer.h"
@@ -27,6 +31,7 @@
 #include "format.h"
 #include "types.h"
 #include "utility.h"
+#include "yenc.h"
 
 namespace newsflash
 {
@@ -38,7 +43,9 @@ struct session::impl {
     bool auth_required;
     bool enable_pipelining;
     bool enable_compression;
+    bool compress_gzip;
     bool have_caps;
+    std::size_t pipeline_depth;
     std::string user;
     std::string pass;
     std::string group;
@@ -433,111 +440,311 @@ private:
     std::string range_;
 };
 
-class session::xovergzip : public session::command
+namespace {
+
+// inflate zlib compressed data incrementally as it arrives.
+// both the zlib wrapped and the raw deflate format are accepted
+// since the servers don't seem to agree on which one to use.
+class inflater
 {
 public:
-    xovergzip(std::string range) : range_(std::move(range)), obytes_(0), ibytes_(0)
+    inflater() : init_(false), done_(false)
     {
         std::memset(&z_, 0, sizeof(z_));
-        inflateInit(&z_);
-        inflate_done_ = false;
     }
-   ~xovergzip()
+   ~inflater()
     {
-        inflateEnd(&z_);
+        if (init_)
+            inflateEnd(&z_);
     }
 
-    virtual bool parse(buffer& buff, buffer& out, impl& st) override
+    // inflate the data into the output buffer. the output buffer grows
+    // as needed. consumed is the number of input bytes used.
+    // returns Z_OK when more data is needed, Z_STREAM_END when the 
+    // end of the stream was found or a zlib error code.
+    int inflate(const char* data, std::size_t len, buffer& out, std::size_t& consumed)
     {
-        if (inflate_done_)
+        consumed = 0;
+        if (!init_)
+        {
+            // need the 2 byte zlib header to tell the formats apart.
+            if (len < 2)
+                return Z_OK;
+            const auto cmf = (unsigned char)data[0];
+            const auto flg = (unsigned char)data[1];
+            const bool zlib = (cmf & 0x0f) == Z_DEFLATED && ((cmf << 8) | flg) % 31 == 0;
+            const auto err  = inflateInit2(&z_, zlib ? MAX_WBITS : -MAX_WBITS);
+            if (err != Z_OK)
+                return err;
+            init_ = true;
+        }
+
+        z_.next_in  = (Bytef*)data;
+        z_.avail_in = uInt(len);
+
+        int err = Z_OK;
+        while (z_.avail_in)
         {
-            LOG_D("Rescanning....");
-            if (buff.size() >= 3)
+            if (out.full())
+                out.allocate(std::max<std::size_t>(out.size() * 2, MB(1)));
+
+            const auto avail = out.available();
+            z_.next_out  = (Bytef*)out.back();
+            z_.avail_out = uInt(avail);
+            err = ::inflate(&z_, Z_NO_FLUSH);
+            out.append(avail - z_.avail_out);
+
+            if (err == Z_STREAM_END)
             {
-                if (!std::strncmp(buff.head(), ".\r\n", 3))
-                {
-                    LOG_D("Found end of body marker!");
-                    buff.pop(3);
-                    return true;
-                }
+                done_ = true;
+                break;
             }
+            // no progress possible is not an error here, we just
+            // need more input (or more room which we add above).
+            if (err == Z_BUF_ERROR)
+                err = Z_OK;
+            else if (err != Z_OK)
+                break;
         }
+        consumed = len - z_.avail_in;
+        return err;
+    }
 
+    bool done() const
+    { return done_; }
 
-        const auto len = nntp::find_response(buff.head(), buff.size());
-        if (len == 0)
-            return false;
+    std::size_t total_in() const
+    { return z_.total_in; }
 
-        // 412 no news group selected
-        // 420 no article(s) selected
-        // 502 no permssion 
-        nntp::scan_response({224}, buff.head(), len);        
+    std::size_t total_out() const
+    { return z_.total_out; }
 
-        if (out.size() == 0)
-            out.allocate(MB(1));
+private:
+    z_stream z_;
+    bool init_;
+    bool done_;
+};
 
-        // astraweb supposedly uses a scheme where the zlib deflate'd data is yenc encoded.
-        // http://helpdesk.astraweb.com/index.php?_m=news&_a=viewnews&newsid=9
-        // but this information is just junk. the data that comes is junk too.
-        // the correct way is to call XFEATURE COMPRESS GZIP
-        // and then the XOVER data that follows is zlib deflated.
+} // namespace
 
-        int err = Z_OK;
-        for (;;)
+// XOVER after XFEATURE COMPRESS GZIP. the overview data that follows the
+// response line is deflated and terminated with .\r\n as usual.
+class session::xovergzip : public session::command
+{
+public:
+    xovergzip(std::string range) : range_(std::move(range)), len_(0), ibytes_(0), scanned_(0), failed_(false)
+    {}
+
+    virtual bool parse(buffer& buff, buffer& out, impl& st) override
+    {
+        // the response line is only scanned once, the data 
+        // that follows it takes many calls to come in.
+        if (len_ == 0)
         {
-            const auto head = buff.head() + len + ibytes_;
-            const auto size = buff.size() - len - ibytes_;
-            if (size == 0)
+            len_ = nntp::find_response(buff.head(), buff.size());
+            if (len_ == 0)
                 return false;
 
-            z_.next_in   = (Bytef*)head;
-            z_.avail_in  = size;
-            z_.next_out  = (Bytef*)out.back();
-            z_.avail_out = out.available();
-            err = inflate(&z_, Z_NO_FLUSH);
-
-            out.append(z_.total_out - obytes_);
-            obytes_ = z_.total_out;
-            ibytes_ = z_.total_in;
+            // 412 no news group selected
+            // 420 no article(s) selected
+            // 502 no permssion 
+            nntp::scan_response({224}, buff.head(), len_);
+        }
+        const auto len = len_;
 
-            if (err < 0)
-                break;
-            else if (err == Z_BUF_ERROR)
-                out.allocate(out.size() * 2);
-            else if (err == Z_STREAM_END)
-                break;
+        // the compressed data stays in the input buffer after the response
+        // line until the whole response has been read but each byte
+        // is inflated only once as it comes in.
+        if (!inflater_.done() && !failed_)
+        {
+            const auto head = buff.head() + len + ibytes_;
+            const auto size = buff.size() - len - ibytes_;
+            std::size_t consumed = 0;
+            const auto err = inflater_.inflate(head, size, out, consumed);
+            ibytes_ += consumed;
+            if (err != Z_OK && err != Z_STREAM_END)
+            {
+                LOG_E("Inflate failed zlib error: ", err);
+                failed_  = true;
+                scanned_ = ibytes_;
+            }
+            else if (!inflater_.done())
+                return false;
         }
-        inflate_done_ = true;
 
-        if (err != Z_STREAM_END)
+        const auto head = buff.head() + len + ibytes_;
+        const auto size = buff.size() - len - ibytes_;
+        if (failed_)
         {
-            LOG_E("Inflate failed zlib error: ", err);        
-            out.set_status(buffer::status::error);       
+            // skip the rest of the response. the data that has been 
+            // searched already is not searched again except for the 
+            // last bytes that can be the start of the end of body.
+            const char eob[] = "\r\n.\r\n";
+            const auto data = buff.head() + len;
+            const auto end  = buff.head() + buff.size();
+            const auto beg  = scanned_ >= 4 ? data + scanned_ - 4 : data - 2;
+            const auto pos  = std::search(beg, end, eob, eob + 5);
+            scanned_ = end - data;
+            if (pos == end)
+                return false;
+            buff.pop(len + (pos - data) + 5);
+            out.clear();
+            out.set_content_type(buffer::type::overview);
+            out.set_status(buffer::status::error);
             return true;
         }
-        LOG_I("Inflated header data from ", kb(ibytes_), " to ", kb(obytes_));
+
+        // the deflated data is followed by the end of body marker.
+        std::size_t marker = 0;
+        if (size >= 2 && head[0] == '\r' && head[1] == '\n')
+            marker = 2;
+        if (size < marker + 3)
+            return false;
+        if (std::strncmp(head + marker, ".\r\n", 3))
+            throw nntp::exception("no end of body after compressed data", 0);
+
+        LOG_I("Inflated header data from ", kb(inflater_.total_in()), " to ", kb(inflater_.total_out()));
+
+        buff.pop(len + ibytes_ + marker + 3);
 
         out.set_content_start(0);
+        out.set_content_length(out.size());
         out.set_content_type(buffer::type::overview);
         out.set_status(buffer::status::success);
-        out.set_content_length(obytes_);
+        return true;
+    }
+
+    virtual bool can_pipeline() const override
+    { return true; }
 
-        const auto head = buff.head() + ibytes_ + len;
-        const auto size = buff.size() - ibytes_ - len;
-        if (size >= 3) 
+    virtual session::state state() const override
+    { return session::state::transfer; }
+
+    virtual std::string str() const override
+    { return "XOVER " + range_; }
+
+private:
+    std::string range_;
+    std::size_t len_;
+    std::size_t ibytes_;
+    std::size_t scanned_;
+    bool failed_;
+    inflater inflater_;
+};
+
+// XZVER is XOVER where the response data is deflated and then
+// yEnc encoded into =ybegin ... =yend lines.
+class session::xzver : public session::command
+{
+public:
+    xzver(std::string range) : range_(std::move(range)), len_(0), ibytes_(0), phase_(phase::header), failed_(false)
+    {}
+
+    virtual bool parse(buffer& buff, buffer& out, impl& st) override
+    {
+        if (len_ == 0)
+        {
+            len_ = nntp::find_response(buff.head(), buff.size());
+            if (len_ == 0)
+                return false;
+
+            nntp::scan_response({224}, buff.head(), len_);
+        }
+        const auto len = len_;
+
+        // like with the xovergzip the encoded data stays in the input 
+        // buffer but the complete lines are decoded and inflated as they come in.
+        for (;;)
         {
-            if (!std::strncmp(head, ".\r\n", 3))
+            const auto head = buff.head() + len + ibytes_;
+            const auto size = buff.size() - len - ibytes_;
+
+            if (phase_ == phase::data)
+            {
+                std::size_t lines = size;
+                while (lines >= 2 && !(head[lines-2] == '\r' && head[lines-1] == '\n'))
+                    --lines;
+                if (lines < 2)
+                    return false;
+
+                // if the =yend line is missing the data ends at the end 
+                // of body line. the dots in the data are doubled so a 
+                // line with a single dot can't be data.
+                const auto end = find_end_of_body(head, lines);
+
+                yenc::decode_result ret {0, 0};
+                if (end)
+                {
+                    decoded_.resize(end);
+                    ret = yenc::decode_buffer(head, end, &decoded_[0]);
+                }
+                ibytes_ += ret.consumed;
+                if (!failed_ && ret.written)
+                {
+                    std::size_t consumed = 0;
+                    const auto err = inflater_.inflate(&decoded_[0], ret.written, out, consumed);
+                    if (err != Z_OK && err != Z_STREAM_END)
+                    {
+                        LOG_E("Inflate failed zlib error: ", err);
+                        failed_ = true;
+                    }
+                }
+                // the decoder stops at the =yend line.
+                if (ret.consumed < end)
+                    phase_ = phase::trailer;
+                else if (end < lines)
+                {
+                    LOG_E("Compressed header data has no =yend line.");
+                    failed_ = true;
+                    phase_  = phase::end;
+                }
+                else return false;
+                continue;
+            }
+
+            const auto line = nntp::find_response(head, size);
+            if (line == 0)
+                return false;
+            ibytes_ += line;
+
+            if (line == 3 && head[0] == '.')
+                break;
+            if (phase_ == phase::trailer)
+            {
+                if (std::strncmp(head, "=yend", 5))
+                {
+                    LOG_E("Compressed header data has a malformed trailer.");
+                    failed_ = true;
+                }
+                phase_ = phase::end;
+            }
+            if (phase_ == phase::header && std::strncmp(head, "=ybegin", 7) && std::strncmp(head, "=ypart", 6))
             {
-                LOG_D("Found end of body marker!");
-                buff.pop(ibytes_ + len + 3);
-                return true;
+                // first line of data, decode it with the rest.
+                ibytes_ -= line;
+                phase_ = phase::data;
             }
         }
 
-        buff.pop(ibytes_ + len);
-        // we're still missing the .\r\n that supposedly comes at the end of
-        // deflated data. therefore we return false.
-        return false;
+        buff.pop(len + ibytes_);
+
+        if (failed_ || !inflater_.done())
+        {
+            if (!failed_)
+                LOG_E("Compressed header data is incomplete.");
+            out.clear();
+            out.set_content_type(buffer::type::overview);
+            out.set_status(buffer::status::error);
+            return true;
+        }
+
+        LOG_I("Inflated header data from ", kb(inflater_.total_in()), " to ", kb(inflater_.total_out()));
+
+        out.set_content_start(0);
+        out.set_content_length(out.size());
+        out.set_content_type(buffer::type::overview);
+        out.set_status(buffer::status::success);
+        return true;
     }
 
     virtual bool can_pipeline() const override
@@ -547,16 +754,44 @@ public:
     { return session::state::transfer; }
 
     virtual std::string str() const override
-    { return "XOVER " + range_; }
+    { return "XZVER " + range_; }
 
 private:
-    std::string range_;
-private:
-    z_stream z_;
-    uLong obytes_;
-    uLong ibytes_;
+    // find the start of the end of body line in the data 
+    // that begins at the start of a line. 
+    static std::size_t find_end_of_body(const char* data, std::size_t len)
+    {
+        std::size_t pos = 0;
+        while (len - pos >= 3)
+        {
+            if (data[pos] == '.' && data[pos+1] == '\r' && data[pos+2] == '\n')
+                return pos;
+            const auto* next = (const char*)std::memchr(data + pos, '\n', len - pos);
+            if (next == nullptr)
+                break;
+            pos = next - data + 1;
+        }
+        return len;
+    }
+
 private:
-    bool inflate_done_;
+    enum class phase {
+        // =ybegin and =ypart lines
+        header, 
+        // the yEnc encoded data
+        data, 
+        // the =yend line
+        trailer, 
+        // anything up to the end of body
+        end
+    };
+    std::string range_;
+    std::size_t len_;
+    std::size_t ibytes_;
+    phase phase_;
+    bool failed_;
+    std::vector<char> decoded_;
+    inflater inflater_;
 };
 
 
@@ -637,12 +872,15 @@ public:
             return true;
         }
 
+        // after a succesful XFEATURE COMPRESS GZIP all the XOVER data
+        // is compressed. otherwise we can still try XZVER if the server has it.
         const auto beg = buff.head();
         if (beg[0] != '2') 
         {
             LOG_W("Compression not supported.");
-            st.enable_compression = false;
+            st.compress_gzip = false;
         }
+        else st.compress_gzip = true;
         buff.clear();
         return true;
     }
@@ -681,6 +919,8 @@ void session::reset()
     state_->group          = "";
     state_->enable_pipelining = false;
     state_->enable_compression = false;
+    state_->compress_gzip  = false;
+    state_->pipeline_depth = std::numeric_limits<std::size_t>::max();
 }
 
 void session::start()
@@ -716,10 +956,14 @@ void session::retrieve_article(std::string messageid)
 
 void session::retrieve_headers(std::string range)
 {
-    if (state_->enable_compression)
+    if (state_->enable_compression && state_->compress_gzip)
     {
         send_.emplace_back(new xovergzip(std::move(range)));
     }
+    else if (state_->enable_compression && state_->has_xzver)
+    {
+        send_.emplace_back(new xzver(std::move(range)));
+    }
     else
     {
         send_.emplace_back(new xover(std::move(range)));
@@ -766,6 +1010,9 @@ bool session::send_next()
 
         if (!state_->enable_pipelining)
             return false;
+
+        if (recv_.size() >= state_->pipeline_depth)
+            return false;
     }
 
     for (;;)
@@ -798,6 +1045,10 @@ bool session::send_next()
         // first non-pipelineable command will stall the sending queue
         if (!send_.front()->can_pipeline())
             break;
+
+        // the rest is sent as the responses come in.
+        if (recv_.size() >= state_->pipeline_depth)
+            break;
     }
     return true;
 }
@@ -870,6 +1121,9 @@ bool session::pending() const
 void session::enable_pipelining(bool on_off)
 { state_->enable_pipelining = on_off; }
 
+void session::set_pipeline_depth(std::size_t depth)
+{ state_->pipeline_depth = std::max<std::size_t>(depth, 1); }
+
 void session::enable_compression(bool on_off)
 { state_->enable_compression = on_off; }
 
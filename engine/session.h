@@ -141,7 +141,13 @@ namespace newsflash
         // turn on/off command pipelining where applicable.
         void enable_pipelining(bool on_off);
 
-        // turn on/off header compression.
+        // limit the number of pipelined commands waiting for a response.
+        // the remaining commands are sent as the responses are received.
+        void set_pipeline_depth(std::size_t depth);
+
+        // turn on/off header compression. the headers are retrieved
+        // compressed with XFEATURE COMPRESS GZIP if the server accepts it
+        // or with XZVER if the server lists it in its capabilities.
         void enable_compression(bool on_off);
 
         // get current error
@@ -169,6 +175,7 @@ namespace newsflash
         class quit;
         class xover;
         class xovergzip;
+        class xzver;
         class list;
         class xfeature_compress_gzip;
 
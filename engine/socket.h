@@ -44,6 +44,12 @@ namespace newsflash
         // the connection is ready to be used for sending and receiving data.
         // on error an exception is thrown.
         virtual void complete_connect() = 0;
+
+        // Try to complete the connection attempt without blocking.
+        // Returns true when the connection is ready to be used, false if
+        // the caller needs to wait on the socket (see wants_write) and try again.
+        // on error an exception is thrown.
+        virtual bool try_complete_connect() = 0;
         
         // Write all of the input data to the socket.
         // On error an exception is thrown.
@@ -59,6 +65,16 @@ namespace newsflash
         // on error an exception is thrown.
         virtual int recvsome(void* buff, int capacity) = 0;
 
+        // Receive some data into the buffer without blocking.
+        // Returns the number of bytes received, 0 if no data is available
+        // at the moment or -1 if the connection was closed by the peer.
+        // on error an exception is thrown.
+        virtual int try_recv(void* buff, int capacity) = 0;
+
+        // returns true if the last try_ operation needs the socket to become
+        // writable before it can make progress, otherwise readable.
+        virtual bool wants_write() const = 0;
+
         // Close the socket.
         virtual void close() = 0;
 
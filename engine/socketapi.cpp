@@ -97,6 +97,26 @@ std::pair<native_socket_t, native_handle_t> begin_socket_connect(ipv4addr_t host
     return {s, h};
 }
 
+bool poll_socket_connect(native_socket_t sock)
+{
+    // use select instead of the socket event object so that a
+    // pending FD_CONNECT signal is not consumed here.
+    // a failed connection attempt is reported in the except set.
+    fd_set write;
+    fd_set except;
+    FD_ZERO(&write);
+    FD_ZERO(&except);
+    FD_SET(sock, &write);
+    FD_SET(sock, &except);
+
+    struct timeval tv {0};
+    const int ret = select(0, nullptr, &write, &except, &tv);
+    if (ret == SOCKET_ERROR)
+        throw std::runtime_error("select failed");
+
+    return ret > 0;
+}
+
 void complete_socket_connect(native_handle_t handle, native_socket_t sock)
 {
     int len = sizeof(len);
@@ -204,6 +224,20 @@ std::pair<native_socket_t, native_handle_t> begin_socket_connect(ipv4addr_t host
     return {fd, fd};
 }
 
+bool poll_socket_connect(native_socket_t sock)
+{
+    struct pollfd fd {0};
+    fd.fd     = sock;
+    fd.events = POLLOUT;
+
+    const int ret = poll(&fd, 1, 0);
+    if (ret == -1)
+        throw std::runtime_error("poll failed");
+
+    // a failed attempt is signaled with POLLERR/POLLHUP
+    return ret > 0;
+}
+
 void complete_socket_connect(native_handle_t handle, native_socket_t sock)
 {
     assert(handle == sock);
@@ -44,8 +44,13 @@ namespace newsflash
     // initially non-blocking. Check the wait handle for completion of the connection attempt.
     std::pair<native_socket_t, native_handle_t> begin_socket_connect(ipv4addr_t host, ipv4port_t port);
 
+    // check without blocking whether the previously started connection
+    // attempt has finished (either succesfully or not). the result
+    // still needs to be checked with complete_socket_connect.
+    bool poll_socket_connect(native_socket_t sock);
+
     // complete the previously started connection attempt. 
-    // if connection was succesful this also makes the socket blocking again.
+    // the socket stays non-blocking.
     // on error an exception is thrown.
     void complete_socket_connect(native_handle_t handle, native_socket_t sock);
 
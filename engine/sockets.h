@@ -30,6 +30,7 @@
 #  include <sys/types.h>
 #  include <sys/socket.h>
 #  include <sys/select.h>
+#  include <poll.h>
 #  include <arpa/inet.h>
 #  include <netinet/in.h>
 #  include <fcntl.h>
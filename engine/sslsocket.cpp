@@ -82,22 +82,22 @@ std::string get_ssl_error(unsigned long code)
 namespace newsflash
 {
 
-sslsocket::sslsocket() : socket_(0), handle_(0), ssl_(nullptr), bio_(nullptr)
+sslsocket::sslsocket() : socket_(0), handle_(0), ssl_(nullptr), bio_(nullptr), want_write_(false)
 {}
 
 
 sslsocket::sslsocket(native_socket_t sock, native_handle_t handle) : 
-    socket_(sock), handle_(handle), ssl_(nullptr), bio_(nullptr)
+    socket_(sock), handle_(handle), ssl_(nullptr), bio_(nullptr), want_write_(false)
 {
     complete_secure_connect();
 }
 
 sslsocket::sslsocket(native_socket_t sock, native_handle_t handle, SSL* ssl, BIO* bio) : 
-    socket_(sock), handle_(handle), ssl_(ssl), bio_(bio)
+    socket_(sock), handle_(handle), ssl_(ssl), bio_(bio), want_write_(false)
 {}
 
 sslsocket::sslsocket(sslsocket&& other) : 
-    socket_(other.socket_), handle_(other.handle_), ssl_(other.ssl_), bio_(other.bio_)
+    socket_(other.socket_), handle_(other.handle_), ssl_(other.ssl_), bio_(other.bio_), want_write_(other.want_write_)
 {
     other.socket_ = 0;
     other.handle_ = 0;
@@ -121,6 +121,7 @@ void sslsocket::begin_connect(ipv4addr_t host, ipv4port_t port)
 
     socket_ = ret.first;
     handle_ = ret.second;
+    want_write_ = true;
 }
 
 void sslsocket::complete_connect()
@@ -132,6 +133,25 @@ void sslsocket::complete_connect()
     complete_secure_connect();
 }
 
+bool sslsocket::try_complete_connect()
+{
+    assert(socket_);
+    assert(handle_);
+
+    // first the TCP connection, then the SSL handshake.
+    if (!ssl_)
+    {
+        if (!poll_socket_connect(socket_))
+        {
+            want_write_ = true;
+            return false;
+        }
+        complete_socket_connect(handle_, socket_);
+        begin_secure_connect();
+    }
+    return try_secure_connect();
+}
+
 
 void sslsocket::sendall(const void* buff, int len) 
 {
@@ -221,69 +241,73 @@ int sslsocket::sendsome(const void* buff, int len)
 
 int sslsocket::recvsome(void* buff, int capacity)
 {
-    ERR_clear_error();
     // the SSL_read operation may fail because SSL handshake
     // is being done transparently and that requires IO on the socket
-    // which cannot be completed at the time. This is indicated by 
-    // SSL_ERROR_WANT_READ, SSL_ERROR_WANT_WRITE. When this happens
+    // which cannot be completed at the time. When this happens
     // we need to wait utill the condition can be satisfied on the
     // underlying socket object (can read/write) and then restart
     // the SSL operation with the *same* parameters.        
-
-    int recv = 0;
-    do 
+    for (;;)
     {
-        const int ret = SSL_read(ssl_, buff, capacity);
-        switch (SSL_get_error(ssl_, ret))
-        {
-            case SSL_ERROR_NONE:
-                recv += ret;
-                break;
-
-            case SSL_ERROR_WANT_WRITE:
-                ssl_wait_write();
-                break;
-
-            case SSL_ERROR_WANT_READ:
-                ssl_wait_read();
-                break;
-
-            // some I/O error occurred. The OpenSSL error queue may contain
-            // more information. If the error queue is empty (i.e. ERR_get_error returns 0)
-            // ret can be used to find more about the error. if ret == 0 an EOF was observed
-            // that violates the protocol. if err == -1 the underlying BIO reported an I/O
-            // error.
-            case SSL_ERROR_SYSCALL:
-                {
-                    const auto ssl_err = ERR_get_error();
-                    if (ssl_err == 0)
-                    {
-                        if (ret == 0)
-                            throw std::runtime_error("socket was closed unexpectedly");
-
-                        const auto sock_err = get_last_socket_error();
-                        if (sock_err != std::errc::operation_would_block)
-                            throw std::system_error(sock_err, "socket send");
-                    }
-                    else
-                    {
-                        throw std::runtime_error(get_ssl_error(ssl_err));
-                    }
-                }
-                break;
-
+        const int ret = try_recv(buff, capacity);
+        if (ret > 0)
+            return ret;
+        else if (ret < 0)
+            return 0;
+
+        if (want_write_)
+            ssl_wait_write();
+        else ssl_wait_read();
+    }
+}
 
-            // socket was closed.
-            case SSL_ERROR_ZERO_RETURN:
-                return 0;                
+int sslsocket::try_recv(void* buff, int capacity)
+{
+    ERR_clear_error();
 
-            default:
-                throw std::runtime_error("SSL_read");
-        }
+    const int ret = SSL_read(ssl_, buff, capacity);
+    switch (SSL_get_error(ssl_, ret))
+    {
+        case SSL_ERROR_NONE:
+            return ret;
+
+        case SSL_ERROR_WANT_WRITE:
+            want_write_ = true;
+            return 0;
+
+        case SSL_ERROR_WANT_READ:
+            want_write_ = false;
+            return 0;
+
+        // some I/O error occurred. The OpenSSL error queue may contain
+        // more information. If the error queue is empty (i.e. ERR_get_error returns 0)
+        // ret can be used to find more about the error. if ret == 0 an EOF was observed
+        // that violates the protocol. if err == -1 the underlying BIO reported an I/O
+        // error.
+        case SSL_ERROR_SYSCALL:
+            {
+                const auto ssl_err = ERR_get_error();
+                if (ssl_err != 0)
+                    throw std::runtime_error(get_ssl_error(ssl_err));
+                if (ret == 0)
+                    throw std::runtime_error("socket was closed unexpectedly");
+
+                const auto sock_err = get_last_socket_error();
+                if (sock_err != std::errc::operation_would_block)
+                    throw std::system_error(sock_err, "socket recv");
+
+                want_write_ = false;
+            }
+            return 0;
+
+        // socket was closed.
+        case SSL_ERROR_ZERO_RETURN:
+            return -1;
+
+        default:
+            throw std::runtime_error("SSL_read");
     }
-    while (!recv);
-
-    return recv;
+    return 0;
 }
 
 
@@ -342,6 +366,7 @@ sslsocket& sslsocket::operator=(sslsocket&& other)
     std::swap(handle_, other.handle_);
     std::swap(ssl_, other.ssl_);
     std::swap(bio_, other.bio_);
+    std::swap(want_write_, other.want_write_);
     return *this;
 }
 
@@ -358,6 +383,18 @@ void sslsocket::ssl_wait_read()
 }
 
 void sslsocket::complete_secure_connect()
+{
+    begin_secure_connect();
+
+    while (!try_secure_connect())
+    {
+        if (want_write_)
+            ssl_wait_write();
+        else ssl_wait_read();
+    }
+}
+
+void sslsocket::begin_secure_connect()
 {
     // create SSL and BIO objects and then initialize ssl client mode.
     // setup SSL session now that we have TCP connection.
@@ -375,37 +412,46 @@ void sslsocket::complete_secure_connect()
     // connect the IO object with SSL, this takes the ownership
     // of the BIO object.
     SSL_set_bio(ssl_, bio_, bio_);
+}
 
+bool sslsocket::try_secure_connect()
+{
     ERR_clear_error();
 
     // go into client mode.
-    while (true)
+    const int ret = SSL_connect(ssl_);
+    if (ret == 1)
     {
-        const int ret = SSL_connect(ssl_);
-        if (ret == 1)
-            break;
-
-        const int err = SSL_get_error(ssl_, ret);
-        switch (err)
-        {
-            case SSL_ERROR_WANT_READ:
-                ssl_wait_read();
-                break;
-
-            case SSL_ERROR_WANT_WRITE:
-                ssl_wait_write();
-                break;
-
-            case SSL_ERROR_SYSCALL:
-                if (ret == -1)
-                    throw std::system_error(get_last_socket_error(), 
-                        "SSL socket I/O error");
-                // fallthrough intended
+        want_write_ = false;
+        return true;
+    }
 
-            default:
-                throw std::runtime_error("SSL_connect failed");
-        }
+    const int err = SSL_get_error(ssl_, ret);
+    switch (err)
+    {
+        case SSL_ERROR_WANT_READ:
+            want_write_ = false;
+            return false;
+
+        case SSL_ERROR_WANT_WRITE:
+            want_write_ = true;
+            return false;
+
+        case SSL_ERROR_SYSCALL:
+            if (ret == -1)
+                throw std::system_error(get_last_socket_error(), 
+                    "SSL socket I/O error");
+            // fallthrough intended
+
+        default:
+            throw std::runtime_error("SSL_connect failed");
     }
+    return false;
+}
+
+bool sslsocket::wants_write() const
+{
+    return want_write_;
 }
 
 
@@ -49,9 +49,12 @@ namespace newsflash
 
         virtual void begin_connect(ipv4addr_t host, ipv4port_t port) override;
         virtual void complete_connect() override;
+        virtual bool try_complete_connect() override;
         virtual void sendall(const void* buff, int len) override;
         virtual int sendsome(const void* buff, int len) override;
         virtual int recvsome(void* buff, int capacity) override;
+        virtual int try_recv(void* buff, int capacity) override;
+        virtual bool wants_write() const override;
         virtual void close() override;
         virtual waithandle wait() const override;
         virtual waithandle wait(bool waitread, bool waitwrite) const override;
@@ -62,6 +65,8 @@ namespace newsflash
         void ssl_wait_write();
         void ssl_wait_read();
         void complete_secure_connect();
+        void begin_secure_connect();
+        bool try_secure_connect();
 
     private:
         // actual socket handle
@@ -77,6 +82,9 @@ namespace newsflash
         BIO* bio_;
 
         sslcontext context_;
+
+        // the SSL state machine needs to write before it can continue.
+        bool want_write_;
     }; 
 } // newsflash
 
@@ -0,0 +1,684 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/functional/hash.hpp>
+#include <newsflash/warnpop.h>
+#include <algorithm>
+#include <cstring>
+#include <cctype>
+#include <climits>
+#include <string>
+#include <vector>
+#include <cassert>
+#include "subject.h"
+
+namespace {
+
+// character classes for the subject line scanning.
+enum : std::uint8_t {
+    DIGIT  = 0x1,
+    OPEN   = 0x2, // ( or [
+    CLOSE  = 0x4, // ) or ]
+};
+
+// one step in a pattern, a set of characters that is matched from min to max times.
+struct step {
+    std::uint64_t bits[4];
+    unsigned min;
+    unsigned max;
+
+    bool test(unsigned char c) const
+    { return (bits[c >> 6] >> (c & 63)) & 1; }
+
+    void set(unsigned char c)
+    { bits[c >> 6] |= std::uint64_t(1) << (c & 63); }
+};
+
+// a pattern compiled from a simple notation. letters match in either
+// case, # is a digit, [abc] is a set and ? and {n,m} repeat the previous.
+struct pattern {
+    step steps[12];
+    unsigned count;
+};
+
+pattern compile(const char* str)
+{
+    pattern p;
+    std::memset(&p, 0, sizeof(p));
+    for (; *str; ++str)
+    {
+        if (*str == '?')
+        {
+            p.steps[p.count-1].min = 0;
+            continue;
+        }
+        else if (*str == '{')
+        {
+            auto& prev = p.steps[p.count-1];
+            prev.min = str[1] - '0';
+            prev.max = str[3] - '0';
+            str += 4;
+            continue;
+        }
+        assert(p.count < sizeof(p.steps) / sizeof(p.steps[0]));
+
+        auto& s = p.steps[p.count++];
+        s.min = 1;
+        s.max = 1;
+        if (*str == '#')
+        {
+            for (char c='0'; c<='9'; ++c)
+                s.set(c);
+        }
+        else if (*str == '[')
+        {
+            while (*++str != ']')
+                s.set(*str);
+        }
+        else
+        {
+            s.set(std::tolower(*str));
+            s.set(std::toupper(*str));
+        }
+    }
+    return p;
+}
+
+// the file extensions that make the subject line look like a binary post.
+// the subject line is searched from the end and the first extension (in this
+// order) that ends at the position is the match. 
+// note that ".s#{1,3}.tif" and ".m4v.srr" are really what the extension
+// list used to say, it was missing a couple of | characters.
+const char* EXTENSIONS[] = {
+    ".rar", ".par2", ".par", ".jpe?g", ".avi", ".mp[234]", ".mpe?g", ".png",
+    ".gif", ".pdf", ".ogg", ".wmv", ".mov", ".iso", ".bin", ".zip", ".wav", ".wma",
+    ".bmp", ".sfv", ".r##", ".nfo", ".cue", ".m3u", ".fla", ".nzb", ".ogm",
+    ".###", ".divx", ".exe", ".rm", ".m4a", ".vob", ".mkv", ".mka", ".ace", ".ram", ".flac",
+    ".z#{1,3}", ".mdf", ".dat", ".7z", ".aac", ".nrg", ".mpc", ".s#{1,3}.tif", 
+    ".iaff", ".swf", ".nds", ".ts", ".ac3", ".m4v.srr",
+    ".flv", ".chm"
+};
+
+const std::size_t NUM_EXTENSIONS = sizeof(EXTENSIONS) / sizeof(EXTENSIONS[0]);
+
+struct tables {
+    std::uint8_t classes[256];
+
+    pattern extensions[NUM_EXTENSIONS];
+
+    // the extensions that can end with the character. the bits are
+    // in the same order as the extensions.
+    std::uint64_t ends_with[256];
+
+    tables()
+    {
+        static_assert(NUM_EXTENSIONS <= 64, "too many extensions for the mask");
+
+        std::memset(classes, 0, sizeof(classes));
+        for (char c='0'; c<='9'; ++c)
+            classes[(unsigned char)c] |= DIGIT;
+        classes['('] |= OPEN;
+        classes['['] |= OPEN;
+        classes[')'] |= CLOSE;
+        classes[']'] |= CLOSE;
+
+        std::memset(ends_with, 0, sizeof(ends_with));
+        for (std::size_t i=0; i<NUM_EXTENSIONS; ++i)
+        {
+            extensions[i] = compile(EXTENSIONS[i]);
+            const auto& last = extensions[i].steps[extensions[i].count-1];
+            for (unsigned c=0; c<256; ++c)
+            {
+                if (last.test(c))
+                    ends_with[c] |= std::uint64_t(1) << i;
+            }
+        }
+    }
+};
+
+const tables& get_tables()
+{
+    static const tables t;
+    return t;
+}
+
+bool is_digit(unsigned char c)
+{ return get_tables().classes[c] & DIGIT; }
+
+#if defined(__MSVC__)
+inline unsigned count_trailing_zeros(std::uint64_t value)
+{
+    unsigned long index = 0;
+    _BitScanForward64(&index, value);
+    return index;
+}
+#else
+inline unsigned count_trailing_zeros(std::uint64_t value)
+{
+    return __builtin_ctzll(value);
+}
+#endif
+
+// match the first count steps of the pattern so that the last step ends at pos.
+// the steps are matched greedily and backtracked like a regular expression
+// would. returns the position of the first character of the match or -1.
+std::ptrdiff_t match_backward(const step* steps, unsigned count, const char* str, std::ptrdiff_t pos)
+{
+    if (count == 0)
+        return pos + 1;
+
+    const auto& s = steps[count-1];
+    unsigned n = 0;
+    while (n < s.max && pos - std::ptrdiff_t(n) >= 0 && s.test(str[pos - n]))
+        ++n;
+
+    for (; n + 1 > s.min; --n)
+    {
+        const auto ret = match_backward(steps, count - 1, str, pos - n);
+        if (ret != -1)
+            return ret;
+        if (n == 0)
+            break;
+    }
+    return -1;
+}
+
+// skip the digits starting at str[i] going backwards.
+std::ptrdiff_t skip_digits_backward(const std::uint8_t* classes, const char* str, std::ptrdiff_t i)
+{
+    while (i >= 0 && (classes[(unsigned char)str[i]] & DIGIT))
+        --i;
+    return i;
+}
+
+// skip the digits starting at str going forward.
+const char* skip_digits(const std::uint8_t* classes, const char* str, const char* end)
+{
+    while (str != end && (classes[(unsigned char)*str] & DIGIT))
+        ++str;
+    return str;
+}
+
+// match "d*/d*" followed by the closing character at str. returns 
+// the end of the match or nullptr.
+const char* match_slash_digits(const std::uint8_t* classes, const char* str, const char* end, std::uint8_t close_class, char close)
+{
+    str = skip_digits(classes, str, end);
+    if (str == end || *str != '/')
+        return nullptr;
+    str = skip_digits(classes, str + 1, end);
+    if (str == end)
+        return nullptr;
+    if (close_class ? !(classes[(unsigned char)*str] & close_class) : *str != close)
+        return nullptr;
+    return str + 1;
+}
+
+// search for (d*/d*) or yEnc in the range.
+bool find_part_or_yenc(const char* str, const char* end)
+{
+    const auto* classes = get_tables().classes;
+    for (; str != end; ++str)
+    {
+        if (*str == '(')
+        {
+            if (match_slash_digits(classes, str + 1, end, 0, ')'))
+                return true;
+        }
+        else if (*str == 'y')
+        {
+            if (end - str >= 4 && !std::memcmp(str, "yEnc", 4))
+                return true;
+        }
+    }
+    return false;
+}
+
+// search for yEnc followed by (d*/d*), for example 'yEnc (01/10)'
+bool find_yenc_part(const char* str, const char* end)
+{
+    const auto* classes = get_tables().classes;
+    for (; end - str >= 4; ++str)
+    {
+        if (*str != 'y' || std::memcmp(str, "yEnc", 4))
+            continue;
+        const char* p = str + 4;
+        while (p != end && *p == ' ')
+            ++p;
+        if (p != end && *p == '(' && match_slash_digits(classes, p + 1, end, 0, ')'))
+            return true;
+    }
+    return false;
+}
+
+// search for 'File xx of yy' and return the end of the first match or nullptr.
+const char* find_file_marker(const char* str, const char* end)
+{
+    const auto* classes = get_tables().classes;
+    for (; end - str >= 5; ++str)
+    {
+        if (*str != 'F' || std::memcmp(str, "File ", 5))
+            continue;
+        const char* p = skip_digits(classes, str + 5, end);
+        if (end - p < 4 || std::memcmp(p, " of ", 4))
+            continue;
+        return skip_digits(classes, p + 4, end);
+    }
+    return nullptr;
+}
+
+// search for (xx/yy) or [xx/yy] and return the end of the first match or nullptr.
+const char* find_part_marker(const char* str, const char* end)
+{
+    const auto* classes = get_tables().classes;
+    for (; str != end; ++str)
+    {
+        if (!(classes[(unsigned char)*str] & OPEN))
+            continue;
+        if (const char* p = match_slash_digits(classes, str + 1, end, CLOSE, 0))
+            return p;
+    }
+    return nullptr;
+}
+
+// the characters that are allowed in a filename when the name is
+// looked for backwards from the file extension.
+class name_pred
+{
+public:
+    name_pred(bool parity) : prev_(0), dash_(false), good_(true), parity_(parity)
+    {}
+
+    bool is_allowed(int c)
+    {
+        const auto ret = test(c);
+        prev_ = c;
+        return ret;
+    }
+    bool is_good() const
+    {
+        return good_;
+    }
+private:
+    bool test(int c)
+    {
+        if (std::isalnum(c))
+        {
+            if (prev_ == '-')
+                good_ = true;
+            return true;
+        }
+
+        if (c == '_' || c == '.' || c == ' ')
+        {
+            return true;
+        }
+        else if (c == '-')
+        {
+            if (prev_ == ' ' || prev_ == '-')
+            {
+                if (dash_ == true)
+                    return false;
+
+                good_ = false;
+                dash_ = true;
+            }
+            return true;
+        }
+        else if (c == '+')
+        {
+            if (parity_ && std::isdigit(prev_))
+                return true;
+        }
+        else if (c == ']' || c == ')' || c == '"')
+        {
+            good_ = false;
+            enclosure_.push_back(char(c));
+            return true;
+        }
+        else if (c == '[')
+        {
+            return test_top(']');
+        }
+        else if (c == '(')
+        {
+            return test_top(')');
+        }
+        return false;
+    }
+    bool test_top(int expected)
+    {
+        if (enclosure_.empty())
+            return false;
+        const auto top = enclosure_.back();
+        enclosure_.pop_back();
+        good_ = top == expected;
+        return good_;
+    }
+private:
+    int prev_;
+    bool dash_;
+    bool good_;
+    bool parity_;
+    // the short strings don't allocate.
+    std::string enclosure_;
+};
+
+} // namespace
+
+namespace nntp
+{
+namespace detail
+{
+
+const char* find_part_count(const char* str, std::size_t size, std::size_t& len)
+{
+    const auto* classes = get_tables().classes;
+
+    // look for the closing ) or ] closest to the end that completes a 
+    // part count notation. the opening and closing characters don't
+    // need to be of the same kind here.
+    for (auto i = std::ptrdiff_t(size) - 1; i >= 0; --i)
+    {
+        if (!(classes[(unsigned char)str[i]] & CLOSE))
+            continue;
+
+        auto j = skip_digits_backward(classes, str, i - 1);
+        if (j < 0 || str[j] != '/')
+            continue;
+        j = skip_digits_backward(classes, str, j - 1);
+        if (j < 0 || !(classes[(unsigned char)str[j]] & OPEN))
+            continue;
+
+        // some people use this gay notation of prefixing their stuff with (xx/yy) notation
+        // to indicate all the articles of their posting "batch". This has nothing to do with 
+        // with the yEnc part count hack. So if the match is at the beginning, ignore this.
+        if (j == 0)
+            return nullptr;
+
+        len = i + 1 - j;
+        return str + j;
+    }
+    return nullptr;
+}
+
+bool parse_part_count(const char* str, std::size_t len, std::size_t& numerator, std::size_t& denominator)
+{
+    const char* end = str + len;
+    const char open = *str++;
+    const char close = end[-1];
+    if (!((open == '(' && close == ')') || (open == '[' && close == ']')))
+        return false;
+
+    // the numbers are parsed into unsigned ints, too big values are no good.
+    std::uint64_t values[2] = {0, 0};
+    for (int i=0; i<2; ++i)
+    {
+        const char* beg = str;
+        for (; is_digit(*str); ++str)
+        {
+            values[i] = values[i] * 10 + (*str - '0');
+            if (values[i] > UINT_MAX)
+                return false;
+        }
+        if (str == beg)
+            return false;
+        ++str; // '/' or the closing character
+    }
+    numerator   = std::size_t(values[0]);
+    denominator = std::size_t(values[1]);
+    return true;
+}
+
+bool find_extension(const char* str, const char* last, extension& ext)
+{
+    const auto& t = get_tables();
+
+    for (auto i = last - str; i >= 0; --i)
+    {
+        auto mask = t.ends_with[(unsigned char)str[i]];
+        while (mask)
+        {
+            const auto index = count_trailing_zeros(mask);
+            mask &= mask - 1;
+
+            const auto& p = t.extensions[index];
+            const auto first = match_backward(p.steps, p.count, str, i);
+            if (first != -1)
+            {
+                ext.first = str + first;
+                ext.last  = str + i;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool is_binary_post(const char* str, std::size_t len, extension ext, bool found)
+{
+    while (true)
+    {
+        if (!found)
+        {
+            // a desperate attempt....
+            // if there's 'yEnc (xx/yy)' we just assume its a yEnc binary
+            return find_yenc_part(str, str + len);
+        }
+
+        const char* start = ext.first;
+        const char* end   = ext.last + 1;
+
+        // if the subject line starts with the filename extension
+        // we assume this post in question is not a binary post
+        // but something like ".pdf viewer for linux?"
+        if (start == str)
+            return false;
+
+        // if filename is matched at the end of the subjectline
+        // this is ok
+        if (end == str + len)
+            return true;
+
+        --start;
+
+        // if the filename ends with a quote this is ok.
+        // (yEnc encoded posts should have a subject line like '"fooobar.mp3 (1/10)" yEnc'
+        // another used notation is '(fooobar.jpeg')
+        if (*end == '"' || *end == ')')
+            return true;
+
+        // a space after a filename this is swell. Probably some non-yEnc encoded
+        // binary. For example 'anna-kournikova.JPEG - sweet ass
+        if (*start != ' ' && *end == ' ')
+            return true;
+
+        // finally there's a case that falls through everything else.
+        // Ie. we have a match like 'metallica - enter sandman.mp3Posted by keke'
+        // see if the rest of the string contains either 'yEnc' or '(xx/yy)'. 
+        if (find_part_or_yenc(start, str + len))
+            return true;
+
+        found = find_extension(str, start, ext);
+    }
+    return false;
+}
+
+const char* find_filename(const char* str, std::size_t len, bool include_extension,
+    extension match, bool found, std::size_t& name_len)
+{
+    // see if it's an yEnc subjectline match, i.e. the first quoted
+    // string is followed by yEnc.
+    if (include_extension)
+    {
+        const char* end   = str + len;
+        const char* open  = std::find(str, end, '"');
+        const char* close = open == end ? end : std::find(open + 1, end, '"');
+        if (end - close >= 6 && !std::memcmp(close, "\" yEnc", 6))
+        {
+            name_len = close - open - 1;
+            return open + 1;
+        }
+    }
+
+    if (!found)
+        return nullptr;
+
+    const char* ext   = match.last;
+    const char* start = match.first - 1;
+    if (start < str)
+        ++start;
+
+    // seek the dot, there's at least the one that starts the extension.
+    const char* dot = ext;
+    while (*dot != '.')
+    {
+        if (--dot < start)
+            return nullptr;
+    }
+
+    if (dot == start)
+        return nullptr;
+
+    if (dot[-1] == ' ')
+        return nullptr;
+
+    const auto ext_len = ext - dot;
+
+    char start_marker = 0;
+    // look at the first character after the filename extension and see if it's a special
+    // character such as ", ], )
+    if (++ext < str + len)
+    {
+        if (*ext == '"')
+            start_marker = '"';
+        else if (*ext == ')')
+            start_marker = '(';
+        else if (*ext == ']')
+            start_marker = '[';
+    }
+
+    if (start_marker)
+    {
+        while (*start != start_marker && start > str)
+            --start;
+
+        // if we hit the marker exclude it from the name
+        if (*start == start_marker)
+            ++start;
+
+        // trim whitespace
+        while (std::isspace((unsigned char)*start) && start < dot)
+            ++start;
+    }
+    else
+    {
+        // see if we can find some sort of upper limit how far to seek
+        // forwards from the file extension
+        // if the subject line contains something like
+        // Foobar bla blah - File 07 of 10 - foobar.mp3" we use the "File xx of yy" as a marker
+        const char* marker = find_file_marker(str, dot);
+        if (!marker)
+            marker = find_part_marker(str, dot);
+        if (marker)
+            str = marker;
+
+        const bool is_parity = !std::strncmp(dot, ".PAR2", ext_len) || !std::strncmp(dot, ".par2", ext_len);
+
+        name_pred pred(is_parity);
+
+        const char* good = start;
+
+        while (start >= str && pred.is_allowed((unsigned char)*start))
+        {
+            if (pred.is_good())
+                good = start;
+            --start;
+        }
+
+        assert(good <= dot);
+
+        while ((*good == ' ' || *good == '-') && (good < dot))
+            ++good;
+
+        start = good;
+    }
+
+    assert(start <= dot && dot < ext);
+
+    if (start == dot)
+        return nullptr;
+
+    name_len = include_extension ? ext - start : dot - start;
+    return start;
+}
+
+} // detail
+
+subject analyse_subject(const char* str, std::size_t len)
+{
+    subject ret;
+    ret.has_part     = false;
+    ret.numerator    = 0;
+    ret.denominator  = 0;
+    ret.filename     = nullptr;
+    ret.filename_len = 0;
+
+    std::size_t skip = 0;
+    const char* part = detail::find_part_count(str, len, skip);
+    if (part)
+        ret.has_part = detail::parse_part_count(part, skip, ret.numerator, ret.denominator);
+
+    // the hash and the fingerprint skip the part count so that all
+    // the parts of a file have the same values. 
+    const auto num = part ? std::size_t(part - str) : len;
+    std::size_t seed = 0;
+    std::uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i=0; i<num; ++i)
+    {
+        boost::hash_combine(seed, str[i]);
+        hash = (hash ^ (unsigned char)str[i]) * 1099511628211ull;
+    }
+    if (part)
+    {
+        hash = (hash ^ 0xff) * 1099511628211ull;
+        for (std::size_t i=num + skip; i<len; ++i)
+        {
+            boost::hash_combine(seed, str[i]);
+            hash = (hash ^ (unsigned char)str[i]) * 1099511628211ull;
+        }
+    }
+    ret.hash        = std::uint32_t(seed);
+    ret.fingerprint = hash ? hash : 1;
+
+    // the filename and the binary post detection start from 
+    // the same extension closest to the end.
+    detail::extension ext;
+    const bool found = len && detail::find_extension(str, str + len - 1, ext);
+
+    ret.binary   = detail::is_binary_post(str, len, ext, found);
+    ret.filename = detail::find_filename(str, len, true, ext, found, ret.filename_len);
+    return ret;
+}
+
+} // nntp
@@ -0,0 +1,83 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace nntp
+{
+    // everything that the header import needs to know about a subject 
+    // line. the fields are the same as what the individual functions in 
+    // nntp.h return for the subject line.
+    struct subject {
+        // the part count, see parse_part
+        bool has_part;
+        std::size_t numerator;
+        std::size_t denominator;
+
+        // see is_binary_post
+        bool binary;
+
+        // the filename with the extension, see find_filename. 
+        // points into the subject line, nullptr if no name was found.
+        const char* filename;
+        std::size_t filename_len;
+
+        // see hashvalue and fingerprint.
+        std::uint32_t hash;
+        std::uint64_t fingerprint;
+    };
+
+    // analyse the subject line. this finds the part count and the file
+    // extension once and then uses them for the rest of the information
+    // which is a lot cheaper than calling the functions one by one.
+    subject analyse_subject(const char* str, std::size_t len);
+
+    namespace detail {
+        // find the (xx/yy) or [xx/yy] part count notation that is closest to the 
+        // end of the subject line. returns nullptr if not found, otherwise the 
+        // start of the notation and its length in len.
+        const char* find_part_count(const char* str, std::size_t size, std::size_t& len);
+
+        // parse the numbers in the part count notation found by find_part_count.
+        bool parse_part_count(const char* str, std::size_t len, std::size_t& numerator, std::size_t& denominator);
+
+        // the file extension that was found in the subject line. first is 
+        // the first character of the extension (the dot) and last is the last 
+        // character of the extension. 
+        struct extension {
+            const char* first;
+            const char* last;
+        };
+
+        // find the file extension that ends closest to the position last.
+        // returns false if there's no extension in [str, last].
+        bool find_extension(const char* str, const char* last, extension& ext);
+
+        bool is_binary_post(const char* str, std::size_t len, extension ext, bool found);
+
+        const char* find_filename(const char* str, std::size_t len, bool include_extension,
+            extension ext, bool found, std::size_t& name_len);
+    } // detail
+
+} // nntp
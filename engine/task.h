@@ -64,6 +64,11 @@ namespace newsflash
         // update task settings
         virtual void configure(const settings& s) {}
 
+        // set the number of data commands to put in the next cmdlist.
+        // the engine sets this from the performance of the connection
+        // that is going to execute the cmdlist.
+        virtual void set_batch_size(std::size_t num_commands) {}
+
         virtual bool has_commands() const = 0;
 
         virtual std::size_t max_num_actions() const = 0;
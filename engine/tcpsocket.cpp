@@ -31,17 +31,18 @@
 namespace newsflash
 {
 
-tcpsocket::tcpsocket() : socket_(0), handle_(0)
+tcpsocket::tcpsocket() : socket_(0), handle_(0), connecting_(false)
 {}
 
 tcpsocket::tcpsocket(native_socket_t sock, native_handle_t handle) : 
-    socket_(sock), handle_(handle)
+    socket_(sock), handle_(handle), connecting_(false)
 {}
 
-tcpsocket::tcpsocket(tcpsocket&& other) : socket_(other.socket_), handle_(other.handle_)
+tcpsocket::tcpsocket(tcpsocket&& other) : socket_(other.socket_), handle_(other.handle_), connecting_(other.connecting_)
 {
     other.socket_ = 0;
     other.handle_ = 0;
+    other.connecting_ = false;
 }
 
 tcpsocket::~tcpsocket()
@@ -58,11 +59,24 @@ void tcpsocket::begin_connect(ipv4addr_t host, ipv4port_t port)
 
     socket_ = ret.first;
     handle_ = ret.second;    
+    connecting_ = true;
 }
 
 void tcpsocket::complete_connect()
 {
     complete_socket_connect(handle_, socket_);
+    connecting_ = false;
+}
+
+bool tcpsocket::try_complete_connect()
+{
+    assert(socket_);
+
+    if (!poll_socket_connect(socket_))
+        return false;
+
+    complete_connect();
+    return true;
 }
 
 void tcpsocket::sendall(const void* buff, int len)
@@ -161,6 +175,32 @@ int tcpsocket::recvsome(void* buff, int capacity)
     return ret;
 }
 
+int tcpsocket::try_recv(void* buff, int capacity)
+{
+    assert(socket_);
+
+    char* ptr = static_cast<char*>(buff);
+
+    const int ret = ::recv(socket_, ptr, capacity, 0);
+    if (ret == OS_SOCKET_ERROR)
+    {
+        const auto err = get_last_socket_error();
+        if (err != std::errc::operation_would_block)
+            throw std::system_error(err, "socket recv");
+
+        return 0;
+    }
+    else if (ret == 0)
+        return -1;
+
+    return ret;
+}
+
+bool tcpsocket::wants_write() const 
+{
+    return connecting_;
+}
+
 void tcpsocket::close()
 {
     if (!socket_)
@@ -169,6 +209,7 @@ void tcpsocket::close()
     closesocket(handle_, socket_);
     socket_ = 0;
     handle_ = 0;
+    connecting_ = false;
 }
 
 waithandle tcpsocket::wait() const
@@ -199,6 +240,7 @@ tcpsocket& tcpsocket::operator=(tcpsocket&& other)
 
     std::swap(socket_, other.socket_);
     std::swap(handle_, other.handle_);
+    std::swap(connecting_, other.connecting_);
     return *this;
 }
 
@@ -41,9 +41,12 @@ namespace newsflash
 
         virtual void begin_connect(ipv4addr_t host, ipv4port_t port) override;
         virtual void complete_connect() override;
+        virtual bool try_complete_connect() override;
         virtual void sendall(const void* buff, int len) override;
         virtual int sendsome(const void* buff, int len) override;
         virtual int recvsome(void* buff, int capacity) override;
+        virtual int try_recv(void* buff, int capacity) override;
+        virtual bool wants_write() const override;
         virtual void close() override;
         virtual waithandle wait() const override;
         virtual waithandle wait(bool waitread, bool waitwrite) const override;
@@ -56,6 +59,9 @@ namespace newsflash
 
         // event handle associated with the socket
         native_handle_t handle_;
+
+        // connection attempt is still in progress
+        bool connecting_;
     };
 
 } // newsflash
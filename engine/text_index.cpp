@@ -0,0 +1,665 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#if defined(WINDOWS_OS)
+#  include <windows.h>
+#endif
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include "text_index.h"
+#include "bigfile.h"
+#include "assert.h"
+#include "utf8.h"
+
+namespace {
+    const std::uint32_t MAGIC   = 0x7e87f1de;
+    const std::uint32_t VERSION = 1;
+
+    // the words are cut at this length. the rest of the word
+    // is not searchable with the word queries.
+    const std::size_t MAX_WORD = 64;
+
+    // the most rare trigrams used to narrow down a substring.
+    const std::size_t MAX_TRIGRAMS = 6;
+
+    // the trigram terms have a prefix that can't be in a word
+    // so they sort before the words.
+    const char TRIGRAM = '\x01';
+
+    struct text_header {
+        std::uint32_t cookie;
+        std::uint32_t version;
+        // the number of rows in the index.
+        std::uint32_t rows;
+        // the number of terms in the term table.
+        std::uint32_t terms;
+        // the offset of the term strings.
+        std::uint32_t keys;
+        // the offset of the posting lists.
+        std::uint32_t postings;
+        // the size of the whole index.
+        std::uint32_t size;
+        std::uint32_t reserved;
+    };
+
+    bool is_word(unsigned char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80;
+    }
+
+    char to_lower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+    }
+
+    bool is_ascii(const char* p, std::size_t len)
+    {
+        for (std::size_t i=0; i<len; ++i)
+        {
+            if ((unsigned char)p[i] >= 0x80)
+                return false;
+        }
+        return true;
+    }
+
+    // call the function for each word in normalized text.
+    template<typename Function>
+    void for_each_word(const std::string& text, Function func)
+    {
+        std::size_t i = 0;
+        while (i < text.size())
+        {
+            if (!is_word(text[i]))
+            {
+                ++i;
+                continue;
+            }
+            const auto beg = i;
+            while (i < text.size() && is_word(text[i]))
+                ++i;
+            func(beg, std::min(i - beg, MAX_WORD));
+        }
+    }
+
+    // compare the same way as std::string does so that the terms
+    // saved in the std::string order can be searched.
+    int compare(const unsigned char* key, std::size_t len, const std::string& str)
+    {
+        const auto ret = std::memcmp(key, str.data(), std::min(len, str.size()));
+        if (ret)
+            return ret;
+        if (len < str.size())
+            return -1;
+        return len > str.size() ? 1 : 0;
+    }
+
+    std::uint32_t pack_trigram(const char* p)
+    {
+        return std::uint32_t((unsigned char)p[0]) << 16 | 
+               std::uint32_t((unsigned char)p[1]) << 8 | 
+               std::uint32_t((unsigned char)p[2]);
+    }
+
+    std::string unpack_trigram(std::uint32_t trigram)
+    {
+        std::string ret(4, TRIGRAM);
+        ret[1] = char(trigram >> 16);
+        ret[2] = char(trigram >> 8);
+        ret[3] = char(trigram);
+        return ret;
+    }
+
+    void put_varint(std::string& out, std::uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            out.push_back(char(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(char(value));
+    }
+
+    // merge a list of sorted row sets.
+    std::vector<std::uint32_t> merge(std::vector<std::vector<std::uint32_t>>& sets)
+    {
+        std::vector<std::uint32_t> ret;
+        for (auto& s : sets)
+        {
+            std::vector<std::uint32_t> tmp;
+            tmp.reserve(ret.size() + s.size());
+            std::set_union(ret.begin(), ret.end(), s.begin(), s.end(), std::back_inserter(tmp));
+            ret.swap(tmp);
+        }
+        return ret;
+    }
+
+    void intersect(std::vector<std::uint32_t>& rows, const std::vector<std::uint32_t>& other)
+    {
+        auto end = std::set_intersection(rows.begin(), rows.end(), other.begin(), other.end(), rows.begin());
+        rows.erase(end, rows.end());
+    }
+
+    void subtract(std::vector<std::uint32_t>& rows, const std::vector<std::uint32_t>& other)
+    {
+        auto end = std::set_difference(rows.begin(), rows.end(), other.begin(), other.end(), rows.begin());
+        rows.erase(end, rows.end());
+    }
+
+    bool replace_file(const std::string& from, const std::string& to)
+    {
+    #if defined(LINUX_OS)
+        return std::rename(from.c_str(), to.c_str()) == 0;
+    #elif defined(WINDOWS_OS)
+        return MoveFileExW(utf8::decode(from).c_str(), utf8::decode(to).c_str(), MOVEFILE_REPLACE_EXISTING) == TRUE;
+    #endif
+    }
+
+} // namespace
+
+namespace newsflash
+{
+
+struct text_view::term {
+    std::uint32_t key;
+    std::uint32_t key_len;
+    std::uint32_t data;
+    std::uint32_t bytes;
+    std::uint32_t count;
+    std::uint32_t last;
+};
+
+std::string text_normalize(const char* str, std::size_t len)
+{
+    std::string ret(str, len);
+    for (auto& c : ret)
+        c = to_lower(c);
+    return ret;
+}
+
+text_index::text_index() : rows_(0)
+{}
+
+void text_index::add(std::uint32_t row, const std::string& subject)
+{
+    ASSERT(row >= rows_);
+
+    const auto& text = text_normalize(subject.c_str(), subject.size());
+
+    std::string word;
+    for_each_word(text, [&](std::size_t pos, std::size_t len) {
+        word.assign(text, pos, len);
+        add_row(words_[word], row);
+    });
+
+    for (std::size_t i=0; i+3<=text.size(); ++i)
+        add_row(trigrams_[pack_trigram(&text[i])], row);
+
+    rows_ = row + 1;
+}
+
+bool text_index::load(const std::string& file, std::uint32_t volume_rows)
+{
+    clear();
+
+#if defined(LINUX_OS)
+    std::ifstream in(file, std::ios::in | std::ios::binary);
+#elif defined(WINDOWS_OS)
+    std::ifstream in(utf8::decode(file), std::ios::in | std::ios::binary);
+#endif
+    if (!in.is_open())
+        return false;
+
+    in.seekg(0, std::ios::end);
+    const auto size = (std::size_t)in.tellg();
+    in.seekg(0, std::ios::beg);
+
+    std::vector<char> buff(size);
+    if (size)
+        in.read(&buff[0], size);
+    if (!in.good())
+        return false;
+
+    const text_view view(buff.data(), buff.size());
+    if (view.rows() == 0 || view.rows() > volume_rows)
+        return false;
+
+    for (std::uint32_t i=0; i<view.num_terms_; ++i)
+    {
+        const auto& t = view.terms_[i];
+        const auto* key = (const char*)view.base_ + t.key;
+        auto& p = (t.key_len == 4 && key[0] == TRIGRAM)
+            ? trigrams_[pack_trigram(key + 1)]
+            : words_[std::string(key, t.key_len)];
+        p.data.assign((const char*)view.base_ + t.data, t.bytes);
+        p.count = t.count;
+        p.last  = t.last;
+    }
+    rows_ = view.rows();
+    return true;
+}
+
+void text_index::save(const std::string& file) const
+{
+    using value_type = std::pair<std::string, const postings*>;
+
+    std::vector<value_type> terms;
+    terms.reserve(trigrams_.size() + words_.size());
+    for (const auto& t : trigrams_)
+        terms.push_back(std::make_pair(unpack_trigram(t.first), &t.second));
+    for (const auto& t : words_)
+        terms.push_back(std::make_pair(t.first, &t.second));
+    std::sort(terms.begin(), terms.end(), [](const value_type& lhs, const value_type& rhs) {
+        return lhs.first < rhs.first;
+    });
+
+    std::uint64_t key_bytes  = 0;
+    std::uint64_t data_bytes = 0;
+    for (const auto& t : terms)
+    {
+        key_bytes  += t.first.size();
+        data_bytes += t.second->data.size();
+    }
+
+    text_header header;
+    header.cookie   = MAGIC;
+    header.version  = VERSION;
+    header.rows     = rows_;
+    header.terms    = std::uint32_t(terms.size());
+    header.keys     = std::uint32_t(sizeof(header) + terms.size() * sizeof(text_view::term));
+    header.postings = std::uint32_t(header.keys + key_bytes);
+    header.size     = std::uint32_t(header.postings + data_bytes);
+    header.reserved = 0;
+    if (header.postings + data_bytes > std::numeric_limits<std::uint32_t>::max())
+        throw std::runtime_error("text index is too large: " + file);
+
+    // the new index is written to a temporary file first and then moved 
+    // over the old one so that the readers never see a partial file.
+    const auto temp = file + ".tmp";
+
+#if defined(LINUX_OS)
+    std::ofstream out(temp, std::ios::out | std::ios::binary | std::ios::trunc);
+#elif defined(WINDOWS_OS)
+    std::ofstream out(utf8::decode(temp), std::ios::out | std::ios::binary | std::ios::trunc);
+#endif
+    if (!out.is_open())
+        throw std::runtime_error("unable to open: " + temp);
+
+    out.write((const char*)&header, sizeof(header));
+
+    std::uint32_t key  = header.keys;
+    std::uint32_t data = header.postings;
+    for (const auto& t : terms)
+    {
+        text_view::term entry;
+        entry.key     = key;
+        entry.key_len = std::uint32_t(t.first.size());
+        entry.data    = data;
+        entry.bytes   = std::uint32_t(t.second->data.size());
+        entry.count   = t.second->count;
+        entry.last    = t.second->last;
+        out.write((const char*)&entry, sizeof(entry));
+        key  += entry.key_len;
+        data += entry.bytes;
+    }
+    for (const auto& t : terms)
+        out.write(t.first.data(), t.first.size());
+    for (const auto& t : terms)
+        out.write(t.second->data.data(), t.second->data.size());
+
+    out.close();
+    if (out.fail())
+    {
+        bigfile::erase(temp);
+        throw std::runtime_error("failed to write: " + temp);
+    }
+
+    // on windows the file can't be replaced while someone has it mapped.
+    // the index on the disk then just has less rows and the rest
+    // are added again when the volume is opened the next time.
+    if (!replace_file(temp, file))
+        bigfile::erase(temp);
+}
+
+void text_index::clear()
+{
+    words_.clear();
+    trigrams_.clear();
+    rows_ = 0;
+}
+
+void text_index::add_row(postings& p, std::uint32_t row)
+{
+    if (p.count && p.last == row)
+        return;
+
+    // the first row is stored as is and the rest as deltas to the previous row.
+    put_varint(p.data, p.count ? row - p.last : row);
+    p.last = row;
+    p.count++;
+}
+
+text_view::text_view() : base_(nullptr), terms_(nullptr), num_terms_(0), rows_(0)
+{}
+
+text_view::text_view(const void* base, std::size_t size) : base_((const unsigned char*)base), terms_(nullptr), num_terms_(0), rows_(0)
+{
+    if (size < sizeof(text_header))
+        return;
+
+    text_header header;
+    std::memcpy(&header, base_, sizeof(header));
+    if (header.cookie != MAGIC || header.version != VERSION)
+        return;
+    if (header.size > size || header.postings > header.size || header.keys > header.postings)
+        return;
+    if (header.keys - sizeof(header) != std::uint64_t(header.terms) * sizeof(term))
+        return;
+
+    const auto* terms = (const term*)(base_ + sizeof(header));
+    for (std::uint32_t i=0; i<header.terms; ++i)
+    {
+        const auto& t = terms[i];
+        if (t.key < header.keys || std::uint64_t(t.key) + t.key_len > header.postings)
+            return;
+        if (t.data < header.postings || std::uint64_t(t.data) + t.bytes > header.size)
+            return;
+    }
+    terms_     = terms;
+    num_terms_ = header.terms;
+    rows_      = header.rows;
+}
+
+text_view::rowset text_view::find_word(const std::string& word) const
+{
+    auto key = text_normalize(word.c_str(), std::min(word.size(), MAX_WORD));
+    if (const auto* t = find(key))
+        return decode(*t);
+    return rowset();
+}
+
+text_view::rowset text_view::find_prefix(const std::string& prefix) const
+{
+    const auto& key = text_normalize(prefix.c_str(), std::min(prefix.size(), MAX_WORD));
+    if (key.empty())
+        return all_rows();
+
+    const auto* end = terms_ + num_terms_;
+    const auto* it  = std::lower_bound(terms_, end, key, [&](const term& t, const std::string& key) {
+        return compare(base_ + t.key, t.key_len, key) < 0;
+    });
+
+    std::vector<rowset> sets;
+    for (; it != end; ++it)
+    {
+        if (it->key_len < key.size() || std::memcmp(base_ + it->key, key.data(), key.size()))
+            break;
+        sets.push_back(decode(*it));
+    }
+    return merge(sets);
+}
+
+bool text_view::find_substring(const std::string& str, rowset& rows) const
+{
+    const auto& text = text_normalize(str.c_str(), str.size());
+
+    std::vector<const term*> terms;
+    std::string key(4, TRIGRAM);
+    for (std::size_t i=0; i+3<=text.size(); ++i)
+    {
+        if (!is_ascii(&text[i], 3))
+            continue;
+        key[1] = text[i+0];
+        key[2] = text[i+1];
+        key[3] = text[i+2];
+        const auto* t = find(key);
+        if (t == nullptr)
+        {
+            rows.clear();
+            return true;
+        }
+        terms.push_back(t);
+    }
+    if (terms.empty())
+        return false;
+
+    // the rarest trigrams narrow down the rows the most and
+    // the rest wouldn't change the result much.
+    std::sort(terms.begin(), terms.end(), [](const term* lhs, const term* rhs) {
+        return lhs->count < rhs->count;
+    });
+    terms.erase(std::unique(terms.begin(), terms.end()), terms.end());
+    if (terms.size() > MAX_TRIGRAMS)
+        terms.resize(MAX_TRIGRAMS);
+
+    rows = decode(*terms[0]);
+    for (std::size_t i=1; i<terms.size() && !rows.empty(); ++i)
+        intersect(rows, decode(*terms[i]));
+    return true;
+}
+
+text_view::rowset text_view::query(const std::string& query, const subject_callback& subject) const
+{
+    struct term {
+        std::string text;
+        bool phrase;
+        bool prefix;
+    };
+    struct clause {
+        std::vector<term> terms;
+        bool negate;
+    };
+    std::vector<clause> clauses;
+
+    // split the query into terms. the OR between two terms 
+    // puts the terms into the same clause.
+    bool disjunct = false;
+    std::size_t i = 0;
+    while (i < query.size())
+    {
+        if (std::isspace((unsigned char)query[i]))
+        {
+            ++i;
+            continue;
+        }
+        bool negate = false;
+        if (query[i] == '-')
+        {
+            negate = true;
+            ++i;
+        }
+        term t;
+        t.phrase = false;
+        t.prefix = false;
+        if (i < query.size() && query[i] == '"')
+        {
+            const auto end = query.find('"', i + 1);
+            t.text   = query.substr(i + 1, end == std::string::npos ? end : end - i - 1);
+            t.phrase = true;
+            i = end == std::string::npos ? query.size() : end + 1;
+        }
+        else
+        {
+            const auto beg = i;
+            while (i < query.size() && !std::isspace((unsigned char)query[i]))
+                ++i;
+            t.text = query.substr(beg, i - beg);
+            if (!negate && t.text == "OR")
+            {
+                disjunct = !clauses.empty() && !clauses.back().negate;
+                continue;
+            }
+            if (!t.text.empty() && t.text.back() == '*')
+            {
+                t.text.pop_back();
+                t.prefix = true;
+            }
+            if (t.text.empty())
+                continue;
+            // something like "foo.bar" is more than one word
+            // and it's looked up as a phrase.
+            const auto& text = text_normalize(t.text.c_str(), t.text.size());
+            std::size_t words = 0;
+            for_each_word(text, [&](std::size_t pos, std::size_t len) {
+                ++words;
+            });
+            if (words != 1 || !is_word(text[0]) || !is_word(text.back()))
+            {
+                t.phrase = true;
+                t.prefix = false;
+            }
+        }
+        if (t.text.empty())
+            continue;
+
+        if (disjunct && !negate)
+            clauses.back().terms.push_back(std::move(t));
+        else
+        {
+            clause c;
+            c.negate = negate;
+            c.terms.push_back(std::move(t));
+            clauses.push_back(std::move(c));
+        }
+        disjunct = false;
+    }
+
+    // the phrases are checked last so that only the rows
+    // matching the rest of the query need to be checked.
+    std::stable_partition(clauses.begin(), clauses.end(), [](const clause& c) {
+        return std::none_of(c.terms.begin(), c.terms.end(), [](const term& t) {
+            return t.phrase;
+        });
+    });
+
+    const auto evaluate = [&](const term& t, const rowset* within) -> rowset {
+        if (t.phrase)
+            return find_phrase(t.text, subject, within);
+        if (t.prefix)
+            return find_prefix(t.text);
+        return find_word(t.text);
+    };
+
+    rowset rows;
+    bool first = true;
+    for (const auto& c : clauses)
+    {
+        if (c.negate)
+            continue;
+        std::vector<rowset> sets;
+        for (const auto& t : c.terms)
+            sets.push_back(evaluate(t, first ? nullptr : &rows));
+        auto set = merge(sets);
+        if (first)
+            rows.swap(set);
+        else intersect(rows, set);
+        first = false;
+    }
+    if (first)
+        rows = all_rows();
+
+    for (const auto& c : clauses)
+    {
+        if (!c.negate || rows.empty())
+            continue;
+        // the phrase rows are only the candidates unless
+        // they're checked and can't be taken out.
+        const auto& t = c.terms[0];
+        if (t.phrase && !subject)
+            continue;
+        subtract(rows, evaluate(t, &rows));
+    }
+    return rows;
+}
+
+const text_view::term* text_view::find(const std::string& key) const
+{
+    const auto* end = terms_ + num_terms_;
+    const auto* it  = std::lower_bound(terms_, end, key, [&](const term& t, const std::string& key) {
+        return compare(base_ + t.key, t.key_len, key) < 0;
+    });
+    if (it == end || it->key_len != key.size())
+        return nullptr;
+    if (std::memcmp(base_ + it->key, key.data(), key.size()))
+        return nullptr;
+    return it;
+}
+
+text_view::rowset text_view::decode(const term& t) const
+{
+    rowset rows;
+    rows.reserve(t.count);
+
+    const auto* p   = base_ + t.data;
+    const auto* end = p + t.bytes;
+    std::uint32_t row = 0;
+    while (p < end)
+    {
+        std::uint32_t value = 0;
+        unsigned shift = 0;
+        while (p < end && (*p & 0x80) && shift < 28)
+        {
+            value |= std::uint32_t(*p++ & 0x7f) << shift;
+            shift += 7;
+        }
+        if (p == end)
+            break;
+        value |= std::uint32_t(*p++) << shift;
+        row = rows.empty() ? value : row + value;
+        rows.push_back(row);
+    }
+    return rows;
+}
+
+text_view::rowset text_view::find_phrase(const std::string& phrase, const subject_callback& subject, const rowset* within) const
+{
+    rowset rows;
+    if (!find_substring(phrase, rows))
+        rows = within ? *within : all_rows();
+    else if (within)
+        intersect(rows, *within);
+    if (!subject)
+        return rows;
+
+    const auto& needle = text_normalize(phrase.c_str(), phrase.size());
+    auto end = std::remove_if(rows.begin(), rows.end(), [&](std::uint32_t row) {
+        const auto& s = subject(row);
+        return std::search(s.begin(), s.end(), needle.begin(), needle.end(), [](char lhs, char rhs) {
+            return to_lower(lhs) == rhs;
+        }) == s.end();
+    });
+    rows.erase(end, rows.end());
+    return rows;
+}
+
+text_view::rowset text_view::all_rows() const
+{
+    rowset rows(rows_);
+    for (std::uint32_t i=0; i<rows_; ++i)
+        rows[i] = i;
+    return rows;
+}
+
+} // newsflash
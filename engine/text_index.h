@@ -0,0 +1,156 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <functional>
+#include <unordered_map>
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+#include "stringlib/string_view.h"
+
+namespace newsflash
+{
+    // the subject lines are indexed in utf-8 with the ascii letters in 
+    // lower case. the words are the runs of ascii letters and digits and 
+    // non-ascii characters, the trigrams are all the 3 byte sequences.
+    // the words answer the word and prefix queries and the trigrams
+    // narrow down the rows that can have a substring.
+
+    // the inverted index of the subject lines in a volume. maps the words 
+    // and the trigrams in the subject lines to the rows of the articles
+    // in the volume columns. the rows are kept in posting lists of delta
+    // coded varints, so a list is mostly 1 byte per row.
+    //
+    // the index is saved next to the volume. the rows in a volume are 
+    // only appended so an index that was saved earlier is still valid
+    // for the rows it has and only the new rows need to be added.
+    class text_index
+    {
+    public:
+        text_index();
+
+        // add the subject line (in utf-8) of the article on the row.
+        // the rows must be added in increasing order.
+        void add(std::uint32_t row, const std::string& subject);
+
+        // load the index from the file. returns false if the file doesn't 
+        // exist or isn't valid for a volume with the given number of rows.
+        // otherwise the index has the first rows() rows of the volume.
+        bool load(const std::string& file, std::uint32_t volume_rows);
+
+        // save the index to the file. the new file replaces the old
+        // one so that a reader that has the old file mapped keeps
+        // seeing the old index.
+        void save(const std::string& file) const;
+
+        void clear();
+
+        // the number of rows in the index.
+        std::uint32_t rows() const
+        { return rows_; }
+
+    private:
+        struct postings {
+            std::string data;
+            std::uint32_t count;
+            std::uint32_t last;
+        };
+        static void add_row(postings& p, std::uint32_t row);
+
+    private:
+        std::unordered_map<std::string, postings> words_;
+        // the trigrams are keyed by the 3 bytes packed in an integer
+        // since there's so many more of them than words.
+        std::unordered_map<std::uint32_t, postings> trigrams_;
+        std::uint32_t rows_;
+    };
+
+    // read access to the index saved by text_index when the file
+    // is mapped into memory. 
+    class text_view
+    {
+    public:
+        // sorted rows.
+        using rowset = std::vector<std::uint32_t>;
+
+        // callback to get the subject line on the row for checking
+        // the phrase queries.
+        using subject_callback = std::function<str::string_view (std::uint32_t row)>;
+
+        text_view();
+
+        // create a view to the index data at base. if the data
+        // is not valid the view has no rows.
+        text_view(const void* base, std::size_t size);
+
+        // the number of rows in the index.
+        std::uint32_t rows() const
+        { return rows_; }
+
+        // find the rows that have the word.
+        rowset find_word(const std::string& word) const;
+
+        // find the rows that have a word that starts with the prefix.
+        rowset find_prefix(const std::string& prefix) const;
+
+        // find the rows that can have the string as a substring. the 
+        // rows need to be checked against the subject lines. returns 
+        // false if the index can't narrow down the rows, for example 
+        // when the string is shorter than 3 bytes.
+        // the trigrams with non-ascii characters are not used so the
+        // rows are good for a case insensitive match as well.
+        bool find_substring(const std::string& str, rowset& rows) const;
+
+        // evaluate the query and return the matching rows.
+        // the query is a list of terms that must all match. 
+        //   word      the subject has the word
+        //   word*     the subject has a word that starts with word
+        //   "a b"     the subject has the phrase as a substring 
+        //   -term     the subject doesn't match the term
+        //   a OR b    either term matches
+        // the phrases are only checked when the subject callback
+        // is given, otherwise the rows are the candidate rows.
+        // an empty query matches all the rows.
+        rowset query(const std::string& query, const subject_callback& subject = subject_callback()) const;
+
+    private:
+        friend class text_index;
+        struct term;
+        const term* find(const std::string& key) const;
+        rowset decode(const term& t) const;
+        rowset find_phrase(const std::string& phrase, const subject_callback& subject, const rowset* within) const;
+        rowset all_rows() const;
+
+    private:
+        const unsigned char* base_;
+        const term* terms_;
+        std::uint32_t num_terms_;
+        std::uint32_t rows_;
+    };
+
+    // normalize the text for the index. the ascii letters
+    // are converted to lower case.
+    std::string text_normalize(const char* str, std::size_t len);
+
+} // newsflash
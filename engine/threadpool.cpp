@@ -22,35 +22,145 @@
 #include <functional>
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
 #include <thread>
 #include "threadpool.h"
 #include "action.h"
 #include "minidump.h"
 
+namespace {
+
+using newsflash::action;
+
+// work stealing deque (Chase-Lev). the actions are pushed to the bottom
+// end by the submitting thread and taken from the top end by both the 
+// owning worker and the thieves, which keeps the actions in the
+// submission order. the push side is serialized with a mutex since there
+// can be more than one submitting thread, taking actions is lock free.
+class work_queue
+{
+public:
+    work_queue() : top_(0), bottom_(0)
+    {
+        std::unique_ptr<array> arr(new array(64));
+        array_ = arr.get();
+        arrays_.push_back(std::move(arr));
+    }
+
+    void push(action* a)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        const auto b = bottom_.load(std::memory_order_relaxed);
+        const auto t = top_.load(std::memory_order_acquire);
+        auto* arr = array_.load(std::memory_order_relaxed);
+        if (b - t >= static_cast<std::int64_t>(arr->size))
+            arr = grow(arr, t, b);
+
+        arr->put(b, a);
+        bottom_.store(b + 1, std::memory_order_release);
+    }
+
+    action* steal()
+    {
+        for (;;)
+        {
+            auto t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto b = bottom_.load(std::memory_order_acquire);
+            if (t >= b)
+                return nullptr;
+
+            auto* arr = array_.load(std::memory_order_acquire);
+            auto* a = arr->get(t);
+            if (top_.compare_exchange_strong(t, t + 1, 
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+                return a;
+
+            // somebody else took it, try the next one.
+        }
+    }
+
+    bool empty() const
+    {
+        const auto t = top_.load(std::memory_order_acquire);
+        const auto b = bottom_.load(std::memory_order_acquire);
+        return t >= b;
+    }
+
+private:
+    struct array {
+        std::size_t size;
+        std::unique_ptr<std::atomic<action*>[]> slots;
+
+        array(std::size_t s) : size(s), slots(new std::atomic<action*>[s])
+        {}
+
+        action* get(std::int64_t i) const
+        { return slots[i & (size - 1)].load(std::memory_order_acquire); }
+
+        void put(std::int64_t i, action* a)
+        { slots[i & (size - 1)].store(a, std::memory_order_release); }
+    };
+
+    array* grow(array* old, std::int64_t top, std::int64_t bottom)
+    {
+        // a thief might still be reading the old array so it's kept
+        // around until the queue is destroyed.
+        std::unique_ptr<array> arr(new array(old->size * 2));
+        for (auto i=top; i<bottom; ++i)
+            arr->put(i, old->get(i));
+
+        array_.store(arr.get(), std::memory_order_release);
+        arrays_.push_back(std::move(arr));
+        return array_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<std::int64_t> top_;
+    std::atomic<std::int64_t> bottom_;
+    std::atomic<array*> array_;
+    std::vector<std::unique_ptr<array>> arrays_;
+    std::mutex mutex_;
+};
+
+} // namespace
+
 namespace newsflash
 {
 struct threadpool::worker {
-    std::mutex mutex;
-    std::condition_variable cond;
     std::unique_ptr<std::thread> thread;
-    std::queue<action*> queue;
-    bool run_loop;
-    bool in_use;
+
+    // actions that any worker can perform.
+    work_queue queue;
+
+    // actions that only this worker can perform.
+    std::mutex mutex;
+    std::queue<action*> pinned;
+    std::atomic<std::size_t> num_pinned;
+
+    std::size_t index;
+    bool is_private;
+    std::atomic<bool> in_use;
 };
 
-threadpool::threadpool(std::size_t num_threads) : round_robin_(0), pool_size_(num_threads), queue_size_(0)
+threadpool::threadpool(std::size_t num_threads) : run_loop_(true), round_robin_(0), pool_size_(num_threads), queue_size_(0), sleepers_(0)
 {
     assert(num_threads);
 
     for (std::size_t i=0; i<num_threads; ++i)
     {
         std::unique_ptr<threadpool::worker> thread(new threadpool::worker);
-        std::lock_guard<std::mutex> lock(thread->mutex);
-
-        thread->run_loop = true;
-        thread->thread.reset(new std::thread(std::bind(&threadpool::thread_seh, this, thread.get())));
+        thread->num_pinned = 0;
+        thread->index      = i;
+        thread->is_private = false;
+        thread->in_use     = true;
         threads_.push_back(std::move(thread));
     }
+    // all the workers need to be in place before any of 
+    // them starts looking for work to steal.
+    for (auto& thread : threads_)
+        start(thread.get());
 }
 
 threadpool::~threadpool()
@@ -62,79 +172,81 @@ void threadpool::submit(action* act)
 {
     const auto num_threads  = pool_size_;
     const auto affinity = act->get_affinity();
-    worker* thread = nullptr;
 
     if (affinity == action::affinity::any_thread)
     {
-        thread = threads_[round_robin_ % num_threads].get();
-        round_robin_++;
+        queue_size_++;
+
+        auto& thread = threads_[round_robin_++ % num_threads];
+        thread->queue.push(act);
+        wakeup(nullptr);
     }
     else
     {
-        const auto act_id = act->get_owner();        
-        thread = threads_[act_id % num_threads].get();
+        const auto act_id = act->get_owner() + act->get_shard();
+        submit(act, threads_[act_id % num_threads].get());
     }
-
-    std::lock_guard<std::mutex> lock(thread->mutex);
-    thread->queue.push(act);
-    thread->cond.notify_one();    
-
-    queue_size_++;    
 }
 
 void threadpool::submit(action* act, threadpool::worker* t)
 {
-    std::lock_guard<std::mutex> lock(t->mutex);
-    t->queue.push(act);
-    t->cond.notify_one();
-
     queue_size_++;
+
+    {
+        std::lock_guard<std::mutex> lock(t->mutex);
+        t->pinned.push(act);
+        t->num_pinned++;
+    }
+    wakeup(t);
 }
 
 void threadpool::wait_all_actions()
 {
-    // this is quick and dirty waiting
+    std::unique_lock<std::mutex> lock(mutex_);
     while (queue_size_ > 0)
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        idle_cond_.wait(lock);
 }
 
 void threadpool::shutdown()
 {
-    for (auto& thread : threads_)
     {
-        {
-            std::lock_guard<std::mutex> lock(thread->mutex);
-            thread->run_loop = false;
-            thread->cond.notify_one();
-        }
-        thread->thread->join();
+        std::lock_guard<std::mutex> lock(mutex_);
+        run_loop_ = false;
+        pool_cond_.notify_all();
+        private_cond_.notify_all();
     }
+    for (auto& thread : threads_)
+        thread->thread->join();
+
+    std::lock_guard<std::mutex> lock(private_mutex_);
+    for (auto& thread : private_)
+        thread->thread->join();
+
     threads_.clear();
+    private_.clear();
 }
 
 threadpool::worker* threadpool::allocate()
 {
-    for (std::size_t i=pool_size_; i<threads_.size(); ++i)
+    std::lock_guard<std::mutex> lock(private_mutex_);
+
+    for (auto& thread : private_)
     {
-        auto& thread = threads_[i];
-        if (!thread->in_use)
-        {
-            thread->in_use = true;
+        bool in_use = false;
+        if (thread->in_use.compare_exchange_strong(in_use, true))
             return thread.get();
-        }
     }
 
     std::unique_ptr<threadpool::worker> thread(new threadpool::worker);
-    std::lock_guard<std::mutex> lock(thread->mutex);
+    thread->num_pinned = 0;
+    thread->index      = private_.size();
+    thread->is_private = true;
+    thread->in_use     = true;
 
     auto* handle = thread.get();
+    start(handle);
 
-    thread->run_loop = true;
-    thread->in_use = true;
-    thread->thread.reset(new std::thread(std::bind(&threadpool::thread_seh, this, 
-        handle)));
-
-    threads_.push_back(std::move(thread));
+    private_.push_back(std::move(thread));
     return handle;
 }
 
@@ -143,30 +255,49 @@ void threadpool::detach(threadpool::worker* thread)
     thread->in_use = false;
 }
 
+std::size_t threadpool::default_num_threads()
+{
+    const auto num_threads = std::thread::hardware_concurrency();
+    if (num_threads == 0)
+        return 4;
+    return num_threads;
+}
+
 void threadpool::thread_main(threadpool::worker* self)
 {
     while (true)
     {
-        std::unique_lock<std::mutex> lock(self->mutex);
-        if (!self->run_loop)
-            return;
-        else if (self->queue.empty())
+        action* next = find_work(self);
+        if (next)
         {
-            self->cond.wait(lock);
-            continue;
-        }
-
-        assert(!self->queue.empty());
+            next->perform();
 
-        action* next = self->queue.front();
-        self->queue.pop();
-        lock.unlock();
+            on_complete(next);
 
-        next->perform();
+            if (--queue_size_ == 0)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                idle_cond_.notify_all();
+            }
+            continue;
+        }
 
-        on_complete(next);
+        // out of work. the sleeper count is raised before checking for work
+        // so that a submitter either sees us sleeping and wakes us up or we
+        // see the submitted work here.
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!run_loop_)
+            return;
 
-        queue_size_--;
+        sleepers_++;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!has_work(self))
+        {
+            if (self->is_private)
+                private_cond_.wait(lock);
+            else pool_cond_.wait(lock);
+        }
+        sleepers_--;
     }
 }
 
@@ -175,5 +306,72 @@ void threadpool::thread_seh(threadpool::worker* self)
     SEH_BLOCK(thread_main(self);)
 }
 
+void threadpool::start(threadpool::worker* w)
+{
+    w->thread.reset(new std::thread(std::bind(&threadpool::thread_seh, this, w)));
+}
+
+void threadpool::wakeup(threadpool::worker* w)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!sleepers_)
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    // work that can be stolen can be done by any pool worker.
+    // pinned work must wake up the specific worker which can't
+    // be chosen with the condition variable so all are woken.
+    if (w == nullptr)
+        pool_cond_.notify_one();
+    else if (w->is_private)
+        private_cond_.notify_all();
+    else pool_cond_.notify_all();
+}
+
+action* threadpool::find_work(threadpool::worker* self)
+{
+    // pinned work first since nobody else can do it.
+    if (self->num_pinned)
+    {
+        std::lock_guard<std::mutex> lock(self->mutex);
+        action* next = self->pinned.front();
+        self->pinned.pop();
+        self->num_pinned--;
+        return next;
+    }
+
+    if (self->is_private)
+        return nullptr;
+
+    if (auto* next = self->queue.steal())
+        return next;
+
+    // try to steal from the other workers.
+    const auto num_threads = threads_.size();
+    for (std::size_t i=1; i<num_threads; ++i)
+    {
+        auto& victim = threads_[(self->index + i) % num_threads];
+        if (auto* next = victim->queue.steal())
+            return next;
+    }
+    return nullptr;
+}
+
+bool threadpool::has_work(threadpool::worker* self) const
+{
+    if (self->num_pinned)
+        return true;
+
+    if (self->is_private)
+        return false;
+
+    for (const auto& thread : threads_)
+    {
+        if (!thread->queue.empty())
+            return true;
+    }
+    return false;
+}
 
 } // newsflash
@@ -27,6 +27,7 @@
 #include <memory>
 #include <mutex>
 #include <queue>
+#include <vector>
 #include <atomic>
 #include <cstddef>
 
@@ -34,6 +35,12 @@ namespace newsflash
 {
     class action;
 
+    // threadpool with work stealing. the any_thread actions are distributed
+    // to the workers round robin but an idle worker will steal queued
+    // actions from the other workers so that a long running action doesn't
+    // hold up the actions queued after it.
+    // actions with single_thread affinity are pinned to a worker by the
+    // owner id and the shard and are never stolen, so they're performed in order.
     class threadpool
     {
 
@@ -73,17 +80,40 @@ namespace newsflash
         std::size_t num_pending_actions() const
         { return queue_size_; }
 
+        std::size_t num_threads() const 
+        { return pool_size_; }
+
+        // get the default number of threads for a pool. 
+        // this is the number of hardware threads.
+        static std::size_t default_num_threads();
+
    private:
         void thread_main(threadpool::worker* self);
         void thread_seh(threadpool::worker* self);
+        void start(threadpool::worker* w);
+        void wakeup(threadpool::worker* w);
+        action* find_work(threadpool::worker* self);
+        bool has_work(threadpool::worker* self) const;
 
     private:
-        std::condition_variable cond_;
+        // workers wait here when out of work.
         std::mutex mutex_;
+        std::condition_variable pool_cond_;
+        std::condition_variable private_cond_;
+        std::condition_variable idle_cond_;
+        bool run_loop_;
+
+        // the pool workers are fixed after construction so that
+        // they can be looked into for stealing without locking.
         std::vector<std::unique_ptr<worker>> threads_;
-        std::size_t round_robin_;
+
+        std::mutex private_mutex_;
+        std::vector<std::unique_ptr<worker>> private_;
+
+        std::atomic<std::size_t> round_robin_;
         std::size_t pool_size_;
         std::atomic<std::size_t> queue_size_;
+        std::atomic<std::size_t> sleepers_;
     };
 
 } // newsflash
@@ -118,6 +118,15 @@ namespace newsflash
 
         // current speed in bytes per second.
         std::uint32_t bps;
+
+        // measured round trip time to the server in milliseconds.
+        std::uint32_t rtt;
+
+        // the number of commands kept in the pipeline. 
+        std::size_t depth;
+
+        // the number of articles (or header ranges) per cmdlist.
+        std::size_t batch;
     };
 
 } // ui
@@ -23,6 +23,7 @@
 #include <newsflash/config.h>
 
 #include <string>
+#include <vector>
 #include <cstddef>
 
 namespace newsflash
@@ -46,6 +47,14 @@ namespace newsflash
 
         // this is set to true if the file is binary data
         bool binary;
+
+        // this is set to true if every slice of the file matched the
+        // checksums of the par2 set downloaded in the same batch.
+        bool verified;
+
+        // the indices of the par2 slices that didn't match. only valid
+        // if the file was checked against a par2 set at all.
+        std::vector<std::uint32_t> damaged_slices;
     };
 
 } // ui
@@ -0,0 +1,236 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <cstdlib>
+#include "../engine.h"
+#include "../sockets.h"
+#include "../socketapi.h"
+
+// benchmark for the engine scheduling overhead with a large number of
+// queued tasks. every file in the batch is a task of its own with a
+// single article and a local stand-in server replies to every article
+// request immediately that the article is not available. so the time spent
+// is mostly the engine completing a cmdlist and scheduling the next one.
+//
+// usage: perf_engine [tasks] [connections]
+
+#if defined(LINUX_OS)
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+
+class server
+{
+public:
+    server() : port_(0)
+    {
+        listen_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr {0};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = 0;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        BOOST_REQUIRE(::bind(listen_, static_cast<sockaddr*>((void*)&addr), sizeof(addr)) == 0);
+        BOOST_REQUIRE(::listen(listen_, 1024) == 0);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_, static_cast<sockaddr*>((void*)&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        std::thread(std::bind(&server::accept_clients, this)).detach();
+    }
+    std::uint16_t port() const 
+    { return port_; }
+
+private:
+    void accept_clients()
+    {
+        for (;;)
+        {
+            const auto client = ::accept(listen_, nullptr, nullptr);
+            if (client == -1)
+                return;
+            std::thread(std::bind(&server::service_client, this, client)).detach();
+        }
+    }
+
+    void send(int sock, const std::string& data)
+    {
+        std::size_t sent = 0;
+        while (sent != data.size())
+        {
+            const auto ret = ::send(sock, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (ret <= 0)
+                return;
+            sent += ret;
+        }
+    }
+
+    void service_client(int sock)
+    {
+        send(sock, "200 welcome\r\n");
+
+        std::string input;
+        char buff[1024];
+        for (;;)
+        {
+            const auto pos = input.find("\r\n");
+            if (pos == std::string::npos)
+            {
+                const auto ret = ::recv(sock, buff, sizeof(buff), 0);
+                if (ret <= 0)
+                    break;
+                input.append(buff, ret);
+                continue;
+            }
+            const auto cmd = input.substr(0, pos);
+            input.erase(0, pos + 2);
+
+            if (cmd == "QUIT")
+            {
+                send(sock, "205 bye\r\n");
+                break;
+            }
+            else if (cmd == "MODE READER")
+                send(sock, "200 posting allowed\r\n");
+            else if (cmd.find("GROUP ") == 0)
+                send(sock, "211 1000 1 1000 " + cmd.substr(6) + "\r\n");
+            else if (cmd.find("BODY ") == 0)
+                send(sock, "430 no such article\r\n");
+            else send(sock, "500 what?\r\n");
+        }
+        ::close(sock);
+    }
+
+private:
+    int listen_;
+    std::uint16_t port_;
+};
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t num_tasks   = argc > 1 ? std::atoi(argv[1]) : 50000;
+    const std::size_t connections = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    server s;
+
+    nf::initialize();
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool notify = false;
+    bool finished = false;
+
+    nf::engine engine(2);
+    engine.set_error_callback([](const nf::ui::error&) {});
+    engine.set_file_callback([](const nf::ui::file&) {});
+    engine.set_task_callback([](const nf::ui::task&) {});
+    engine.set_batch_callback([](const nf::ui::batch&) {});
+    engine.set_finish_callback([&]() {
+        finished = true;
+    });
+    engine.set_notify_callback([&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        notify = true;
+        cond.notify_one();
+    });
+
+    nf::ui::account account;
+    account.id                    = 1;
+    account.name                  = "perf";
+    account.general_host          = "127.0.0.1";
+    account.general_port          = s.port();
+    account.secure_port           = 0;
+    account.connections           = connections;
+    account.enable_general_server = true;
+    account.enable_secure_server  = false;
+    account.enable_compression    = false;
+    account.enable_pipelining     = false;
+    engine.set_account(account);
+    engine.set_prefer_secure(false);
+
+    nf::ui::batch batch;
+    batch.account = 1;
+    batch.path    = ".";
+    batch.desc    = "perf";
+    for (std::size_t i=0; i<num_tasks; ++i)
+    {
+        nf::ui::download file;
+        file.groups.push_back("alt.binaries.foo");
+        file.articles.push_back(std::to_string(i + 1));
+        file.size = 0;
+        file.path = ".";
+        file.name = "file" + std::to_string(i) + ".bin";
+        batch.files.push_back(std::move(file));
+    }
+
+    std::cout << num_tasks << " tasks, " << connections << " connections" << std::endl;
+
+    const auto start = clock_type::now();
+
+    engine.download_files(std::move(batch));
+    engine.start(".");
+
+    auto wait_and_pump = [&]() {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!notify)
+                cond.wait(lock);
+            notify = false;
+        }
+        return engine.pump();
+    };
+
+    while (!finished)
+        wait_and_pump();
+
+    const auto time = clock_type::now() - start;
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+    std::cout << std::fixed << std::setprecision(3) << secs << " s "
+              << std::setprecision(1) << num_tasks / secs << " tasks/s" << std::endl;
+
+    engine.stop();
+    while (wait_and_pump())
+        ;
+
+    return 0;
+}
+
+#else
+
+int test_main(int, char*[])
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,180 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include <thread>
+#include <algorithm>
+#include "../catalog.h"
+#include "../columns.h"
+#include "../filemap.h"
+#include "../index.h"
+#include "unit_test_common.h"
+
+// benchmark for sorting and filtering the articles in the index
+// either by loading the articles from the catalogs or on the volume
+// columns. uses the volumes written by perf_update, so run that first
+// with the same number of articles.
+//
+// usage: perf_index [articles]
+
+namespace nf = newsflash;
+
+using clock_type    = std::chrono::steady_clock;
+using catalog       = nf::catalog<nf::filemap>;
+using article       = nf::article<nf::filemap>;
+using article_index = nf::index<nf::filemap>;
+
+template<typename Func>
+void measure(const char* what, Func func)
+{
+    const auto start = clock_type::now();
+    func();
+    const auto end = clock_type::now();
+    const auto ms  = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    std::cout << "   " << std::setw(16) << std::left << what << ms << " ms" << std::endl;
+}
+
+void run(article_index& idx, const char* how)
+{
+    std::cout << how << std::endl;
+    measure("sort by date", [&]() {
+        idx.sort(article_index::sorting::sort_by_date, article_index::sortdir::ascending);
+    });
+    measure("sort by size", [&]() {
+        idx.sort(article_index::sorting::sort_by_size, article_index::sortdir::ascending);
+    });
+    measure("sort by subject", [&]() {
+        idx.sort(article_index::sorting::sort_by_subject, article_index::sortdir::ascending);
+    });
+    measure("filter", [&]() {
+        idx.filter();
+    });
+    // the gui filters in batches from the event loop so the 
+    // longest batch is how long the gui is blocked at a time.
+    clock_type::duration longest(0);
+    measure("filter batches", [&]() {
+        idx.filter_begin();
+        for (;;)
+        {
+            const auto start = clock_type::now();
+            const auto done  = idx.filter_next(250000);
+            longest = std::max(longest, clock_type::now() - start);
+            if (done)
+                break;
+        }
+        idx.filter_apply();
+    });
+    std::cout << "   longest batch   " 
+              << std::chrono::duration_cast<std::chrono::milliseconds>(longest).count() << " ms" << std::endl;
+    std::cout << "   " << idx.size() << " / " << idx.real_size() << " shown" << std::endl;
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t articles = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const std::string group = "alt.binaries.perf";
+
+    std::deque<catalog> catalogs;
+    std::deque<nf::filemap> files;
+    std::deque<nf::column_view> views;
+    for (std::size_t i=0; i<=articles / nf::CATALOG_SIZE; ++i)
+    {
+        std::stringstream ss;
+        ss << group << "/vol" << std::setfill('0') << std::setw(15) << i;
+        if (!file_exists((ss.str() + ".dat").c_str()))
+            continue;
+
+        catalogs.emplace_back();
+        catalogs.back().open(ss.str() + ".dat");
+        files.emplace_back();
+        files.back().open(ss.str() + ".col");
+        views.emplace_back(files.back().map_ptr(0, files.back().size()), files.back().size());
+        BOOST_REQUIRE(views.back().rows() >= catalogs.back().size());
+    }
+
+    // the filter looks at the same data as the gui filter does and then 
+    // keeps every other article so that the items need to be moved around.
+    bool filter = false;
+
+    {
+        article_index idx;
+        idx.on_load = [&](std::size_t key, std::size_t i) {
+            return catalogs[key].load(catalog::index_t{i});
+        };
+        idx.on_filter = [&](const article& a) {
+            if (!filter)
+                return true;
+            if (a.test(nf::fileflag::deleted) || a.pubdate() == 0 || a.bytes() == 0)
+                return false;
+            return a.index() % 2 == 0;
+        };
+        filter = false;
+        measure("load articles", [&]() {
+            for (std::size_t key=0; key<catalogs.size(); ++key)
+            {
+                auto& db = catalogs[key];
+                for (auto it = db.begin(); it != db.end(); ++it)
+                    idx.insert(*it, key, it->index());
+            }
+        });
+        filter = true;
+        run(idx, "articles");
+    }
+
+    {
+        article_index idx;
+        idx.on_load = [&](std::size_t key, std::size_t row) {
+            return catalogs[key].load(catalog::index_t{views[key].slot(row)});
+        };
+        idx.on_filter_columns = [&](std::size_t, const nf::column_view& c, std::size_t row) {
+            if (!filter)
+                return true;
+            if (c.test(row, nf::fileflag::deleted) || c.pubdate(row) == 0 || c.bytes(row) == 0)
+                return false;
+            return c.slot(row) % 2 == 0;
+        };
+        for (std::size_t key=0; key<views.size(); ++key)
+            idx.set_columns(key, views[key]);
+        idx.set_filter_threads(std::thread::hardware_concurrency());
+
+        filter = false;
+        measure("load columns", [&]() {
+            for (std::size_t key=0; key<catalogs.size(); ++key)
+            {
+                for (std::size_t row=0; row<catalogs[key].size(); ++row)
+                    idx.insert(key, row);
+            }
+        });
+        filter = true;
+        run(idx, "columns");
+    }
+    return 0;
+}
@@ -0,0 +1,301 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <cstdlib>
+#include "../connection.h"
+#include "../cmdlist.h"
+#include "../throttle.h"
+#include "../action.h"
+#include "../sockets.h"
+#include "../socketapi.h"
+
+// benchmark for the command pipelining depth and cmdlist size.
+// a local stand-in server serves articles of fixed size and delays
+// every response by the given latency counting from when the command
+// was received, i.e. the latency is like on a long network path and the 
+// pipelined commands are delayed concurrently. optionally the server
+// limits the bandwidth per connection.
+//
+// usage: perf_pipeline [latency ms] [KB/s per connection, 0 for no limit] [articles] [article KB]
+
+#if defined(LINUX_OS)
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+
+class server
+{
+public:
+    server(std::size_t article_size, std::chrono::milliseconds latency, std::size_t rate) 
+        : latency_(latency), rate_(rate), port_(0)
+    {
+        // article body, lines of 128 bytes.
+        std::string line(126, 'x');
+        line.append("\r\n");
+        while (body_.size() < article_size)
+            body_.append(line);
+        body_.append(".\r\n");
+
+        listen_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr {0};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = 0;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        BOOST_REQUIRE(::bind(listen_, static_cast<sockaddr*>((void*)&addr), sizeof(addr)) == 0);
+        BOOST_REQUIRE(::listen(listen_, 1024) == 0);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_, static_cast<sockaddr*>((void*)&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        std::thread(std::bind(&server::accept_clients, this)).detach();
+    }
+    std::uint16_t port() const 
+    { return port_; }
+
+private:
+    struct client {
+        std::mutex mutex;
+        std::condition_variable cond;
+        std::deque<std::pair<clock_type::time_point, std::string>> responses;
+        bool quit;
+    };
+
+    void accept_clients()
+    {
+        for (;;)
+        {
+            const auto sock = ::accept(listen_, nullptr, nullptr);
+            if (sock == -1)
+                return;
+            auto c = std::make_shared<client>();
+            c->quit = false;
+            std::thread(std::bind(&server::read_commands, this, sock, c)).detach();
+            std::thread(std::bind(&server::send_responses, this, sock, c)).detach();
+        }
+    }
+
+    void send(int sock, const std::string& data)
+    {
+        // pace the data in small chunks when there's a bandwidth limit.
+        const std::size_t chunk = rate_ ? std::max<std::size_t>(rate_ / 100, 1024) : data.size();
+        const auto start = clock_type::now();
+
+        std::size_t sent = 0;
+        while (sent != data.size())
+        {
+            const auto len = std::min(chunk, data.size() - sent);
+            const auto ret = ::send(sock, data.data() + sent, len, MSG_NOSIGNAL);
+            if (ret <= 0)
+                return;
+            sent += ret;
+            if (rate_)
+            {
+                const auto due = start + std::chrono::microseconds(sent * 1000000 / rate_);
+                std::this_thread::sleep_until(due);
+            }
+        }
+    }
+
+    void respond(client& c, std::string response, bool delay)
+    {
+        const auto due = clock_type::now() + (delay ? latency_ : std::chrono::milliseconds(0));
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.responses.push_back(std::make_pair(due, std::move(response)));
+        c.cond.notify_one();
+    }
+
+    void send_responses(int sock, std::shared_ptr<client> c)
+    {
+        for (;;)
+        {
+            std::unique_lock<std::mutex> lock(c->mutex);
+            while (c->responses.empty() && !c->quit)
+                c->cond.wait(lock);
+            if (c->responses.empty())
+                break;
+
+            auto next = std::move(c->responses.front());
+            c->responses.pop_front();
+            lock.unlock();
+
+            std::this_thread::sleep_until(next.first);
+            send(sock, next.second);
+        }
+        ::close(sock);
+    }
+
+    void read_commands(int sock, std::shared_ptr<client> c)
+    {
+        // the connection setup is not delayed so that only
+        // the data transfer is measured.
+        respond(*c, "200 welcome\r\n", false);
+
+        std::string input;
+        char buff[1024];
+        for (;;)
+        {
+            const auto pos = input.find("\r\n");
+            if (pos == std::string::npos)
+            {
+                const auto ret = ::recv(sock, buff, sizeof(buff), 0);
+                if (ret <= 0)
+                    break;
+                input.append(buff, ret);
+                continue;
+            }
+            const auto cmd = input.substr(0, pos);
+            input.erase(0, pos + 2);
+
+            if (cmd == "QUIT")
+            {
+                respond(*c, "205 bye\r\n", false);
+                break;
+            }
+            else if (cmd == "MODE READER")
+                respond(*c, "200 posting allowed\r\n", false);
+            else if (cmd.find("GROUP ") == 0)
+                respond(*c, "211 1000 1 1000 " + cmd.substr(6) + "\r\n", true);
+            else if (cmd.find("BODY ") == 0)
+                respond(*c, "222 body follows\r\n" + body_, true);
+            else respond(*c, "500 what?\r\n", false);
+        }
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->quit = true;
+        c->cond.notify_one();
+    }
+
+private:
+    std::string body_;
+    std::chrono::milliseconds latency_;
+    std::size_t rate_;
+    int listen_;
+    std::uint16_t port_;
+};
+
+std::shared_ptr<nf::cmdlist> make_cmdlist(std::size_t first, std::size_t articles)
+{
+    nf::cmdlist::messages m;
+    m.groups.push_back("alt.binaries.foo");
+    for (std::size_t i=0; i<articles; ++i)
+        m.numbers.push_back(std::to_string(first + i));
+    return std::make_shared<nf::cmdlist>(std::move(m));
+}
+
+// download the articles over a single connection. if batch is 0 
+// the cmdlists are sized as the connection suggests.
+void benchmark(const char* name, std::uint16_t port, std::size_t articles, bool pipelining, std::size_t batch)
+{
+    nf::throttle throttle;
+    nf::connection conn;
+    nf::connection::spec spec;
+    spec.hostname = "localhost";
+    spec.hostport = port;
+    spec.use_ssl  = false;
+    spec.enable_pipelining  = pipelining;
+    spec.enable_compression = false;
+    spec.pthrottle = &throttle;
+
+    auto act = conn.connect(spec);
+    while (act)
+    {
+        act->perform();
+        BOOST_REQUIRE(!act->has_exception());
+        act = conn.complete(std::move(act));
+    }
+
+    const auto start = clock_type::now();
+
+    std::size_t bytes = 0;
+    std::size_t done  = 0;
+    std::size_t lists = 0;
+    while (done < articles)
+    {
+        const auto size = std::min(batch ? batch : conn.current_batch_size(), articles - done);
+        auto cmds = make_cmdlist(done + 1, size);
+        act = conn.execute(cmds, 0);
+        act->perform();
+        BOOST_REQUIRE(!act->has_exception());
+        bytes += static_cast<class nf::connection::execute*>(act.get())->get_bytes_transferred();
+        done  += size;
+        lists++;
+    }
+
+    const auto time = clock_type::now() - start;
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+
+    std::cout << std::setw(10) << name << " "
+              << std::fixed << std::setprecision(3) << secs << " s "
+              << std::setprecision(1) << std::setw(7) << bytes / secs / (1024.0 * 1024.0) << " MB/s "
+              << std::setprecision(3) << secs / lists << " s/cmdlist "
+              << "rtt " << conn.current_rtt_ms() << " ms "
+              << "depth " << conn.current_pipeline_depth() << " "
+              << "batch " << conn.current_batch_size() << std::endl;
+
+    act = conn.disconnect();
+    act->perform();
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t latency    = argc > 1 ? std::atoi(argv[1]) : 100;
+    const std::size_t rate_kb    = argc > 2 ? std::atoi(argv[2]) : 0;
+    const std::size_t articles   = argc > 3 ? std::atoi(argv[3]) : 200;
+    const std::size_t article_kb = argc > 4 ? std::atoi(argv[4]) : 384;
+
+    server s(article_kb * 1024, std::chrono::milliseconds(latency), rate_kb * 1024);
+
+    std::cout << articles << " articles of " << article_kb << " KB, "
+              << latency << " ms latency, ";
+    if (rate_kb)
+        std::cout << rate_kb << " KB/s per connection" << std::endl;
+    else std::cout << "no bandwidth limit" << std::endl;
+
+    benchmark("serial", s.port(), articles, false, 10);
+    benchmark("batch 10", s.port(), articles, true, 10);
+    benchmark("adaptive", s.port(), articles, true, 0);
+    return 0;
+}
+
+#else
+
+int test_main(int, char*[])
+{
+    return 0;
+}
+
+#endif
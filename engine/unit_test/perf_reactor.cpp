@@ -0,0 +1,329 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <condition_variable>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdlib>
+#include "../connection.h"
+#include "../reactor.h"
+#include "../cmdlist.h"
+#include "../throttle.h"
+#include "../action.h"
+#include "../sockets.h"
+#include "../socketapi.h"
+
+// benchmark for running NNTP connections on the reactor compared to
+// running each connection on a private blocking thread.
+// a local stand-in server serves articles of fixed size. the server
+// uses a thread per client, only the client side is measured.
+//
+// usage: perf_reactor [connections] [articles per connection] [article KB]
+
+// the reactor is only implemented for linux.
+#if defined(LINUX_OS)
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+
+class server
+{
+public:
+    server(std::size_t article_size) : port_(0)
+    {
+        // article body, lines of 128 bytes.
+        std::string line(126, 'x');
+        line.append("\r\n");
+        while (body_.size() < article_size)
+            body_.append(line);
+        body_.append(".\r\n");
+
+        listen_ = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        struct sockaddr_in addr {0};
+        addr.sin_family      = AF_INET;
+        addr.sin_port        = 0;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        BOOST_REQUIRE(::bind(listen_, static_cast<sockaddr*>((void*)&addr), sizeof(addr)) == 0);
+        BOOST_REQUIRE(::listen(listen_, 1024) == 0);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(listen_, static_cast<sockaddr*>((void*)&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        std::thread(std::bind(&server::accept_clients, this)).detach();
+    }
+    std::uint16_t port() const 
+    { return port_; }
+
+private:
+    void accept_clients()
+    {
+        for (;;)
+        {
+            const auto client = ::accept(listen_, nullptr, nullptr);
+            if (client == -1)
+                return;
+            std::thread(std::bind(&server::service_client, this, client)).detach();
+        }
+    }
+
+    void send(int sock, const std::string& data)
+    {
+        std::size_t sent = 0;
+        while (sent != data.size())
+        {
+            const auto ret = ::send(sock, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (ret <= 0)
+                return;
+            sent += ret;
+        }
+    }
+
+    void service_client(int sock)
+    {
+        send(sock, "200 welcome\r\n");
+
+        std::string input;
+        char buff[1024];
+        for (;;)
+        {
+            const auto pos = input.find("\r\n");
+            if (pos == std::string::npos)
+            {
+                const auto ret = ::recv(sock, buff, sizeof(buff), 0);
+                if (ret <= 0)
+                    break;
+                input.append(buff, ret);
+                continue;
+            }
+            const auto cmd = input.substr(0, pos);
+            input.erase(0, pos + 2);
+
+            if (cmd == "QUIT")
+            {
+                send(sock, "205 bye\r\n");
+                break;
+            }
+            else if (cmd == "MODE READER")
+                send(sock, "200 posting allowed\r\n");
+            else if (cmd.find("GROUP ") == 0)
+                send(sock, "211 1000 1 1000 " + cmd.substr(6) + "\r\n");
+            else if (cmd.find("BODY ") == 0)
+                send(sock, "222 body follows\r\n" + body_);
+            else send(sock, "500 what?\r\n");
+        }
+        ::close(sock);
+    }
+
+private:
+    std::string body_;
+    int listen_;
+    std::uint16_t port_;
+};
+
+struct client {
+    nf::connection conn;
+    nf::connection::spec spec;
+    std::shared_ptr<nf::cmdlist> cmds;
+    std::size_t bytes;
+};
+
+std::shared_ptr<nf::cmdlist> make_cmdlist(std::size_t articles)
+{
+    nf::cmdlist::messages m;
+    m.groups.push_back("alt.binaries.foo");
+    for (std::size_t i=0; i<articles; ++i)
+        m.numbers.push_back(std::to_string(i + 1));
+    return std::make_shared<nf::cmdlist>(std::move(m));
+}
+
+void report(const char* name, std::size_t threads, std::size_t bytes, clock_type::duration time)
+{
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+    std::cout << std::setw(10) << name << " "
+              << std::setw(4) << threads << " threads "
+              << std::fixed << std::setprecision(3) << secs << " s "
+              << std::setprecision(1) << bytes / secs / (1024.0 * 1024.0) << " MB/s" << std::endl;
+}
+
+std::vector<std::unique_ptr<client>> make_clients(std::size_t count, std::uint16_t port, nf::throttle& throttle)
+{
+    std::vector<std::unique_ptr<client>> clients;
+    for (std::size_t i=0; i<count; ++i)
+    {
+        std::unique_ptr<client> c(new client);
+        c->spec.hostname = "localhost";
+        c->spec.hostport = port;
+        c->spec.use_ssl  = false;
+        c->spec.enable_pipelining  = true;
+        c->spec.enable_compression = false;
+        c->spec.pthrottle = &throttle;
+        c->bytes = 0;
+        clients.push_back(std::move(c));
+    }
+    return clients;
+}
+
+// connect, initialize, execute and disconnect each connection on its own thread.
+void benchmark_threads(std::uint16_t port, std::size_t connections, std::size_t articles)
+{
+    nf::throttle throttle;
+    auto clients = make_clients(connections, port, throttle);
+
+    const auto start = clock_type::now();
+
+    std::vector<std::thread> threads;
+    for (auto& c : clients)
+    {
+        threads.emplace_back([&]() {
+            auto act = c->conn.connect(c->spec);
+            while (act)
+            {
+                act->perform();
+                BOOST_REQUIRE(!act->has_exception());
+                act = c->conn.complete(std::move(act));
+            }
+            c->cmds = make_cmdlist(articles);
+            act = c->conn.execute(c->cmds, 0);
+            act->perform();
+            BOOST_REQUIRE(!act->has_exception());
+            c->bytes = static_cast<class nf::connection::execute*>(act.get())->get_bytes_transferred();
+            act = c->conn.disconnect();
+            act->perform();
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+
+    std::size_t bytes = 0;
+    for (auto& c : clients)
+        bytes += c->bytes;
+
+    report("threads", connections, bytes, clock_type::now() - start);
+}
+
+// run all the connections on the reactor.
+void benchmark_reactor(std::uint16_t port, std::size_t connections, std::size_t articles, std::size_t loops)
+{
+    nf::throttle throttle;
+    auto clients = make_clients(connections, port, throttle);
+
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::size_t done = 0;
+
+    nf::reactor reactor(loops);
+    reactor.on_complete = [&](nf::action* a) {
+        std::unique_ptr<nf::action> act(a);
+        BOOST_REQUIRE(!act->has_exception());
+
+        const auto owner = act->get_owner();
+        auto& c = clients[owner];
+        std::unique_ptr<nf::action> next;
+        if (dynamic_cast<class nf::connection::initialize*>(a))
+        {
+            c->cmds = make_cmdlist(articles);
+            next = c->conn.execute(c->cmds, 0);
+        }
+        else if (auto* e = dynamic_cast<class nf::connection::execute*>(a))
+        {
+            c->bytes = e->get_bytes_transferred();
+            next = c->conn.disconnect();
+        }
+        else if (dynamic_cast<class nf::connection::disconnect*>(a))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (++done == clients.size())
+                cond.notify_one();
+            return;
+        }
+        else next = c->conn.complete(std::move(act));
+
+        next->set_owner(owner);
+        reactor.submit(next.release());
+    };
+
+    const auto start = clock_type::now();
+
+    // name resolution is blocking, so it's not done on the reactor.
+    for (std::size_t i=0; i<clients.size(); ++i)
+    {
+        auto act = clients[i]->conn.connect(clients[i]->spec);
+        act->perform();
+        BOOST_REQUIRE(!act->has_exception());
+        act = clients[i]->conn.complete(std::move(act));
+        act->set_owner(i);
+        reactor.submit(act.release());
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (done != clients.size())
+            cond.wait(lock);
+    }
+
+    std::size_t bytes = 0;
+    for (auto& c : clients)
+        bytes += c->bytes;
+
+    report("reactor", loops, bytes, clock_type::now() - start);
+
+    reactor.shutdown();
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t connections = argc > 1 ? std::atoi(argv[1]) : 100;
+    const std::size_t articles    = argc > 2 ? std::atoi(argv[2]) : 20;
+    const std::size_t article_kb  = argc > 3 ? std::atoi(argv[3]) : 384;
+
+    server s(article_kb * 1024);
+
+    std::cout << connections << " connections, " << articles 
+              << " articles of " << article_kb << " KB each" << std::endl;
+
+    benchmark_threads(s.port(), connections, articles);
+    benchmark_reactor(s.port(), connections, articles, 1);
+    benchmark_reactor(s.port(), connections, articles, 2);
+    return 0;
+}
+
+#else
+
+int test_main(int, char*[])
+{
+    return 0;
+}
+
+#endif
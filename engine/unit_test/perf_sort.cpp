@@ -0,0 +1,196 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include "../article.h"
+#include "../catalog.h"
+#include "../columns.h"
+#include "../filebuf.h"
+#include "../filemap.h"
+#include "../index.h"
+#include "unit_test_common.h"
+
+// benchmark for sorting the index on every sorting column with a
+// synthetic set of articles. the articles are kept in memory and 
+// loaded by copying (like the articles from a catalog<filebuf>) 
+// and the same articles are written into volume columns which
+// are then sorted on as well.
+//
+// usage: perf_sort [articles]
+
+namespace nf = newsflash;
+
+using clock_type    = std::chrono::steady_clock;
+using article       = nf::article<nf::filebuf>;
+using article_index = nf::index<nf::filebuf>;
+
+struct column {
+    const char* name;
+    article_index::sorting sorting;
+};
+
+const column columns[] = {
+    {"broken",     article_index::sorting::sort_by_broken},
+    {"binary",     article_index::sorting::sort_by_binary},
+    {"downloaded", article_index::sorting::sort_by_downloaded},
+    {"bookmarked", article_index::sorting::sort_by_bookmarked},
+    {"type",       article_index::sorting::sort_by_type},
+    {"size",       article_index::sorting::sort_by_size},
+    {"author",     article_index::sorting::sort_by_author},
+    {"subject",    article_index::sorting::sort_by_subject},
+    {"date",       article_index::sorting::sort_by_date}
+};
+
+// parse an article with the given subject so that it gets 
+// the file type and the flags like a real header would.
+article make_template(const std::string& subject)
+{
+    std::stringstream ss;
+    ss << "1\t" << subject << "\tposter@example.com\t"
+       << "Tue, 13 May 2014 00:00:00\t<1@example.com>\t\t500000\t3900\t";
+    const auto& str = ss.str();
+
+    article a;
+    BOOST_REQUIRE(a.parse(str.c_str(), str.size()));
+    return a;
+}
+
+std::vector<article> make_articles(std::size_t count)
+{
+    const char* extensions[] = {
+        ".rar", ".r01", ".par2", ".nfo", ".mp3", ".mkv", ".jpg", ".pdf"
+    };
+    std::vector<article> templates;
+    for (const auto* ext : extensions)
+        templates.push_back(make_template(std::string("post - \"file") + ext + "\" yEnc (1/10)"));
+
+    // the subjects share a long common prefix like they do in the 
+    // groups where the posts are made by the same tool.
+    std::vector<article> articles;
+    articles.reserve(count);
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto hash = (i * 2654435761u) % 4294967291u;
+        const auto post = hash % (count / 20 + 1);
+
+        std::stringstream subject;
+        subject << "[#a.b.teevee@efnet] - [FULL] - [" << post << "] - "
+                << "\"Show.Name.S" << post % 30 << ".E" << post % 24 << ".720p.part" 
+                << i % 50 << extensions[i % 8] << "\" yEnc (" << (i % 10) + 1 << "/10)";
+        std::stringstream author;
+        author << "poster" << hash % 1000 << "@example.com";
+
+        article a = templates[i % 8];
+        a.set_subject(subject.str().c_str());
+        a.set_author(author.str().c_str());
+        a.set_bytes(hash % 50000000);
+        a.set_pubdate(1400000000 + i / 4);
+        a.set_index(i % nf::CATALOG_SIZE);
+        a.set_bits(nf::fileflag::broken, hash % 7 == 0);
+        a.set_bits(nf::fileflag::downloaded, hash % 11 == 0);
+        a.set_bits(nf::fileflag::bookmarked, hash % 13 == 0);
+        articles.push_back(a);
+    }
+    return articles;
+}
+
+void run(article_index& idx, const char* how)
+{
+    std::cout << how << std::endl;
+    for (const auto& col : columns)
+    {
+        const auto start = clock_type::now();
+        idx.sort(col.sorting, article_index::sortdir::ascending);
+        const auto end = clock_type::now();
+        const auto ms  = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        std::cout << "   sort by " << std::setw(12) << std::left << col.name << ms << " ms" << std::endl;
+    }
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t count = argc > 1 ? std::atoi(argv[1]) : 5000000;
+    const std::size_t volumes = (count + nf::CATALOG_SIZE - 1) / nf::CATALOG_SIZE;
+
+    std::cout << count << " articles" << std::endl;
+
+    const auto articles = make_articles(count);
+    {
+        article_index idx;
+        idx.on_load = [&](std::size_t key, std::size_t i) {
+            return articles[key * nf::CATALOG_SIZE + i];
+        };
+        idx.on_filter = [](const article&) {
+            return true;
+        };
+        for (std::size_t i=0; i<count; ++i)
+            idx.insert(articles[i], i / nf::CATALOG_SIZE, i % nf::CATALOG_SIZE);
+
+        run(idx, "articles");
+    }
+
+    std::deque<nf::filemap> files;
+    {
+        article_index idx;
+        idx.on_filter_columns = [](std::size_t, const nf::column_view&, std::size_t) {
+            return true;
+        };
+        for (std::size_t key=0; key<volumes; ++key)
+        {
+            std::stringstream ss;
+            ss << "perf_sort" << key << ".col";
+            delete_file(ss.str().c_str());
+            {
+                nf::columns<nf::filebuf> writer;
+                writer.open(ss.str());
+                for (std::size_t i=key * nf::CATALOG_SIZE; i<std::min(count, (key + 1) * nf::CATALOG_SIZE); ++i)
+                    writer.append(articles[i]);
+                writer.flush();
+            }
+            files.emplace_back();
+            files.back().open(ss.str());
+            idx.set_columns(key, nf::column_view(files.back().map_ptr(0, files.back().size()), files.back().size()));
+        }
+        for (std::size_t i=0; i<count; ++i)
+            idx.insert(i / nf::CATALOG_SIZE, i % nf::CATALOG_SIZE);
+
+        run(idx, "columns");
+    }
+
+    for (std::size_t key=0; key<volumes; ++key)
+    {
+        std::stringstream ss;
+        ss << "perf_sort" << key << ".col";
+        delete_file(ss.str().c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+#include <deque>
+#include <string>
+#include <cstdlib>
+#include "../catalog.h"
+#include "../filemap.h"
+#include "../text_index.h"
+#include "unit_test_common.h"
+
+// benchmark for the subject text index. the index is built for 
+// a synthetic set of subject lines, one index per volume, and then
+// the queries are run over all the volumes and compared to scanning
+// the subject lines.
+//
+// usage: perf_text [articles]
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+
+std::string make_subject(std::size_t i, std::size_t count)
+{
+    const char* extensions[] = {
+        ".rar", ".r01", ".par2", ".nfo", ".mp3", ".mkv", ".jpg", ".pdf"
+    };
+    const char* names[] = {
+        "Show.Name", "Other.Show", "Some.Movie", "Documentary", "Concert.Live", "News"
+    };
+    const auto hash = (i * 2654435761u) % 4294967291u;
+    const auto post = hash % (count / 20 + 1);
+
+    std::stringstream ss;
+    ss << "[#a.b.teevee@efnet] - [FULL] - [" << post << "] - "
+       << "\"" << names[post / 7 % 6] << ".S" << post % 30 << ".E" << post % 24 
+       << (post % 5 ? ".720p" : ".1080p") << ".part" << i % 50 << extensions[i % 8] 
+       << "\" yEnc (" << (i % 10) + 1 << "/10)";
+    return ss.str();
+}
+
+std::int64_t ms_since(clock_type::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(clock_type::now() - start).count();
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t count = argc > 1 ? std::atoi(argv[1]) : 2000000;
+    const std::size_t volumes = (count + nf::CATALOG_SIZE - 1) / nf::CATALOG_SIZE;
+
+    std::cout << count << " articles" << std::endl;
+
+    std::vector<std::string> subjects;
+    subjects.reserve(count);
+    for (std::size_t i=0; i<count; ++i)
+        subjects.push_back(make_subject(i, count));
+
+    std::uint64_t bytes = 0;
+    {
+        const auto start = clock_type::now();
+        for (std::size_t key=0; key<volumes; ++key)
+        {
+            std::stringstream ss;
+            ss << "perf_text" << key << ".fts";
+
+            nf::text_index idx;
+            const auto first = key * nf::CATALOG_SIZE;
+            for (std::size_t i=first; i<std::min(count, first + nf::CATALOG_SIZE); ++i)
+                idx.add(std::uint32_t(i - first), subjects[i]);
+            idx.save(ss.str());
+        }
+        std::cout << "build " << ms_since(start) << " ms" << std::endl;
+    }
+
+    std::deque<nf::filemap> files;
+    std::vector<nf::text_view> views;
+    for (std::size_t key=0; key<volumes; ++key)
+    {
+        std::stringstream ss;
+        ss << "perf_text" << key << ".fts";
+        files.emplace_back();
+        files.back().open(ss.str());
+        views.emplace_back(files.back().map_ptr(0, files.back().size()), files.back().size());
+        bytes += files.back().size();
+    }
+    std::cout << "index " << bytes / (1024 * 1024) << " MB" << std::endl;
+
+    const char* queries[] = {
+        "documentary",
+        "concert*",
+        "some movie 1080p",
+        "news OR concert s7",
+        "show -other 720p",
+        "\"S11.E5.720p.part1.\"",
+        "\"movie.s2\" mkv"
+    };
+    for (const auto* query : queries)
+    {
+        const auto start = clock_type::now();
+        std::size_t matches = 0;
+        for (std::size_t key=0; key<volumes; ++key)
+        {
+            const auto first = key * nf::CATALOG_SIZE;
+            const auto& rows = views[key].query(query, [&](std::uint32_t row) {
+                const auto& s = subjects[first + row];
+                return str::string_view(s.c_str(), s.size());
+            });
+            matches += rows.size();
+        }
+        std::cout << "   " << std::setw(28) << std::left << query << std::setw(8) 
+                  << matches << ms_since(start) << " ms" << std::endl;
+    }
+
+    // the same phrase by scanning all the subject lines.
+    {
+        const auto start = clock_type::now();
+        const auto& needle = nf::text_normalize("s11.e5.720p.part1.", 18);
+        std::size_t matches = 0;
+        for (const auto& s : subjects)
+        {
+            if (nf::text_normalize(s.c_str(), s.size()).find(needle) != std::string::npos)
+                ++matches;
+        }
+        std::cout << "   " << std::setw(28) << std::left << "scan" << std::setw(8) 
+                  << matches << ms_since(start) << " ms" << std::endl;
+    }
+
+    files.clear();
+    for (std::size_t key=0; key<volumes; ++key)
+    {
+        std::stringstream ss;
+        ss << "perf_text" << key << ".fts";
+        delete_file(ss.str().c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,234 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cstring>
+#include "../threadpool.h"
+#include "../action.h"
+#include "../yenc.h"
+#include "unit_test_common.h"
+
+// throughput benchmark for the threadpool with a mixed workload that
+// resembles a download. decode actions of varying article sizes produce
+// write actions that are pinned to a thread per file and must be performed
+// in order. the work stealing pool is compared against the pool
+// with the decode actions pinned round robin to the workers, which is how
+// the actions were distributed before there was any stealing.
+
+using clock_type = std::chrono::steady_clock;
+
+namespace nf = newsflash;
+
+const std::size_t num_files    = 8;
+const std::size_t num_articles = 400;
+
+struct article {
+    std::vector<char> encoded;
+    std::size_t size;
+};
+
+struct file {
+    std::size_t next_part;
+    std::size_t bytes;
+    std::size_t errors;
+};
+
+class decode_action : public nf::action
+{
+public:
+    decode_action(const article& a, std::size_t file, std::size_t part) : article_(a), file_(file), part_(part)
+    {}
+
+    virtual void xperform() override
+    {
+        binary_.resize(article_.size);
+        const auto ret = yenc::decode_buffer(&article_.encoded[0], article_.encoded.size(), &binary_[0]);
+        binary_.resize(ret.written);
+    }
+
+    std::vector<char>& binary()
+    { return binary_; }
+
+    std::size_t file_index() const
+    { return file_; }
+
+    std::size_t part() const
+    { return part_; }
+
+private:
+    const article& article_;
+    const std::size_t file_;
+    const std::size_t part_;
+    std::vector<char> binary_;
+};
+
+class write_action : public nf::action
+{
+public:
+    write_action(file& f, std::size_t part, std::vector<char> data) : file_(f), part_(part), data_(std::move(data))
+    {}
+
+    virtual void xperform() override
+    {
+        // the writes to a file must happen in the decoding order.
+        if (file_.next_part != part_)
+            file_.errors++;
+        file_.next_part = part_ + 1;
+        file_.bytes += data_.size();
+    }
+
+private:
+    file& file_;
+    const std::size_t part_;
+    const std::vector<char> data_;
+};
+
+void benchmark(const char* name, std::size_t num_threads, bool stealing, const std::vector<article>& articles)
+{
+    std::vector<file> files(num_files);
+    for (auto& f : files)
+    {
+        f.next_part = 0;
+        f.bytes     = 0;
+        f.errors    = 0;
+    }
+
+    nf::threadpool threads(num_threads);
+
+    // the decode actions are completed in any order but the writes
+    // are submitted in the order of the parts, like the engine does
+    // when the decoding is done on a single thread.
+    std::mutex mutex;
+    std::vector<std::vector<std::unique_ptr<decode_action>>> decoded(num_files);
+    std::vector<std::size_t> next_write(num_files);
+
+    threads.on_complete = [&](nf::action* a) {
+        auto* dec = dynamic_cast<decode_action*>(a);
+        if (dec == nullptr)
+        {
+            delete a;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+
+        const auto index = dec->file_index();
+        auto& parts = decoded[index];
+        if (parts.size() <= dec->part())
+            parts.resize(dec->part() + 1);
+        parts[dec->part()].reset(dec);
+
+        auto& next = next_write[index];
+        while (next < parts.size() && parts[next])
+        {
+            auto* write = new write_action(files[index], next, std::move(parts[next]->binary()));
+            write->set_affinity(nf::action::affinity::single_thread);
+            write->set_owner(index);
+            parts[next].reset();
+            threads.submit(write);
+            ++next;
+        }
+    };
+
+    std::size_t bytes = 0;
+
+    const auto start = clock_type::now();
+    for (std::size_t i=0; i<articles.size(); ++i)
+    {
+        const auto file = i % num_files;
+        const auto part = i / num_files;
+
+        auto* dec = new decode_action(articles[i], file, part);
+        if (stealing)
+        {
+            dec->set_affinity(nf::action::affinity::any_thread);
+        }
+        else
+        {
+            dec->set_affinity(nf::action::affinity::single_thread);
+            dec->set_owner(i);
+        }
+        threads.submit(dec);
+        bytes += articles[i].size;
+    }
+    threads.wait_all_actions();
+
+    const auto time = clock_type::now() - start;
+    threads.shutdown();
+
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+    const auto mbs  = bytes / secs / (1024.0 * 1024.0);
+    std::cout << std::setw(10) << name << " "
+              << std::setw(2) << num_threads << " threads "
+              << std::fixed << std::setprecision(3) << secs << " s "
+              << std::setprecision(1) << mbs << " MB/s" << std::endl;
+
+    std::size_t written = 0;
+    for (const auto& f : files)
+    {
+        BOOST_REQUIRE(f.errors == 0);
+        written += f.bytes;
+    }
+    BOOST_REQUIRE(written == bytes);
+}
+
+int test_main(int, char*[])
+{
+    // mostly regular article sizes with the odd small and huge one
+    // so that the cost of the actions varies a lot.
+    const std::size_t sizes[] = {
+        16 * 1024, 128 * 1024, 768 * 1024, 768 * 1024,
+        768 * 1024, 128 * 1024, 4 * 1024 * 1024, 768 * 1024
+    };
+
+    std::vector<article> articles;
+    for (std::size_t i=0; i<num_articles; ++i)
+    {
+        const auto size = sizes[(i * 7 + i / 3) % 8];
+        const auto binary = generate_buffer(size);
+
+        article a;
+        a.size = size;
+        yenc::encode(binary.begin(), binary.end(), std::back_inserter(a.encoded), 128, true);
+        articles.push_back(std::move(a));
+    }
+
+    const auto num_threads = nf::threadpool::default_num_threads();
+
+    std::cout << articles.size() << " articles in " << num_files << " files" << std::endl;
+
+    // warm up the allocator so that the first run isn't penalized.
+    benchmark("warmup", num_threads, true, articles);
+
+    for (int i=0; i<2; ++i)
+    {
+        benchmark("pinned", num_threads, false, articles);
+        benchmark("stealing", num_threads, true, articles);
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <mutex>
+#include "../update.h"
+#include "../cmdlist.h"
+#include "../buffer.h"
+#include "../action.h"
+#include "../filesys.h"
+#include "../catalog.h"
+#include "../threadpool.h"
+#include "unit_test_common.h"
+
+// benchmark for the header update (parse + store) on a synthetic XOVER
+// stream of multipart posts. the posts are interleaved so that the parts
+// of a post are some distance apart like they are in a real group.
+// reports the time and the number of read and write system calls
+// (from /proc/self/io) spent on storing the headers.
+// the store actions are either performed in order on the main thread 
+// (like when they ran on the gui thread) or submitted to a threadpool 
+// where they run concurrently for different volumes.
+//
+// the XOVER data is generated batch by batch so that large groups
+// (for example 10 million headers) can be run without keeping it all in memory.
+//
+// usage: perf_update [articles] [parts per post] [concurrent posts] [threads]
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+
+struct io_counters {
+    std::uint64_t syscr;
+    std::uint64_t syscw;
+    std::uint64_t rchar;
+    std::uint64_t wchar;
+};
+
+io_counters read_io_counters()
+{
+    io_counters io = {0, 0, 0, 0};
+#if defined(LINUX_OS)
+    std::ifstream in("/proc/self/io");
+    std::string key;
+    std::uint64_t val;
+    while (in >> key >> val)
+    {
+        if (key == "syscr:")
+            io.syscr = val;
+        else if (key == "syscw:")
+            io.syscw = val;
+        else if (key == "rchar:")
+            io.rchar = val;
+        else if (key == "wchar:")
+            io.wchar = val;
+    }
+#endif
+    return io;
+}
+
+// generate the overview lines for articles first to last (inclusive).
+std::string make_xover(std::size_t first, std::size_t last, std::size_t parts, std::size_t posts)
+{
+    std::stringstream ss;
+    for (std::size_t num=first; num<=last; ++num)
+    {
+        // the articles go round robin to the concurrently running posts 
+        // and each post has a fixed number of parts.
+        const auto slot  = (num - 1) % posts;
+        const auto round = (num - 1) / posts;
+        const auto post  = (round / parts) * posts + slot;
+        const auto part  = round % parts + 1;
+
+        ss << num << "\t"
+           << "post " << post << " - \"file" << post << ".rar\" yEnc (" << part << "/" << parts << ")\t"
+           << "poster" << slot << "@example.com\t"
+           << "Tue, 13 May 2014 00:00:00\t"
+           << "<" << num << "@example.com>\t"
+           << "\t"
+           << 500000 << "\t"
+           << 3900 << "\t\r\n";
+    }
+    return ss.str();
+}
+
+int test_main(int argc, char* argv[])
+{
+    const std::size_t articles = argc > 1 ? std::atoi(argv[1]) : 200000;
+    const std::size_t parts    = argc > 2 ? std::atoi(argv[2]) : 50;
+    const std::size_t posts    = argc > 3 ? std::atoi(argv[3]) : 100;
+    const std::size_t threads  = argc > 4 ? std::atoi(argv[4]) : 0;
+
+    const std::string group = "alt.binaries.perf";
+    fs::createpath(group);
+    delete_file((group + "/" + group + ".nfo").c_str());
+    delete_file((group + "/" + group + ".idb").c_str());
+    for (std::size_t i=0; i<=articles / nf::CATALOG_SIZE; ++i)
+    {
+        std::stringstream ss;
+        ss << group << "/vol" << std::setfill('0') << std::setw(15) << i;
+        delete_file((ss.str() + ".dat").c_str());
+        delete_file((ss.str() + ".idx").c_str());
+        delete_file((ss.str() + ".col").c_str());
+    }
+
+    std::cout << articles << " articles, " << parts << " parts per post, " 
+              << posts << " concurrent posts, " 
+              << (threads ? std::to_string(threads) + " store threads" : "stores in order")
+              << std::endl;
+
+    std::vector<std::unique_ptr<nf::action>> actions;
+
+    nf::update u("", group);
+
+    // one range of 1000 articles per cmdlist
+    u.set_batch_size(1);
+
+    auto cmd = u.create_commands();
+    const auto info = "211 " + std::to_string(articles) + " 1 " + std::to_string(articles) + " " + group + "\r\n";
+    nf::buffer buff(info.size() + 1);
+    buff.append(info);
+    buff.set_content_length(info.size());
+    buff.set_content_start(0);
+    buff.set_content_type(nf::buffer::type::groupinfo);
+    cmd->receive_data_buffer(buff);
+    u.complete(*cmd, actions);
+
+    // the completed stores are handed back to the main thread 
+    // like the engine does.
+    std::unique_ptr<nf::threadpool> pool;
+    std::mutex mutex;
+    std::vector<nf::action*> completed;
+    if (threads)
+    {
+        pool.reset(new nf::threadpool(threads));
+        pool->on_complete = [&](nf::action* a) {
+            std::lock_guard<std::mutex> lock(mutex);
+            completed.push_back(a);
+        };
+    }
+    const auto complete_stores = [&]() {
+        std::vector<nf::action*> done;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.swap(completed);
+        }
+        for (auto* a : done)
+        {
+            std::unique_ptr<nf::action> store(a);
+            BOOST_REQUIRE(!store->has_exception());
+            std::vector<std::unique_ptr<nf::action>> next;
+            u.complete(*store, next);
+        }
+    };
+
+    clock_type::duration parse_time(0);
+    clock_type::duration total_time(0);
+
+    const auto before = read_io_counters();
+
+    // go newest first like the update does. 
+    for (std::size_t batch=(articles + 999) / 1000; batch; --batch)
+    {
+        const auto first = (batch - 1) * 1000 + 1;
+        const auto last  = std::min(first + 999, articles);
+        const auto str   = make_xover(first, last, parts, posts);
+        nf::buffer b(str.size() + 1);
+        b.append(str);
+        b.set_content_length(str.size());
+        b.set_content_start(0);
+        b.set_content_type(nf::buffer::type::overview);
+        b.set_status(nf::buffer::status::success);
+
+        const auto start = clock_type::now();
+
+        cmd = u.create_commands();
+        cmd->receive_data_buffer(std::move(b));
+
+        actions.clear();
+        u.complete(*cmd, actions);
+        BOOST_REQUIRE(actions.size() == 1);
+
+        auto parse = std::move(actions[0]);
+        const auto parse_start = clock_type::now();
+        parse->perform();
+        parse_time += clock_type::now() - parse_start;
+        BOOST_REQUIRE(!parse->has_exception());
+
+        actions.clear();
+        u.complete(*parse, actions);
+        for (auto& store : actions)
+        {
+            if (pool)
+            {
+                store->set_owner(1);
+                pool->submit(store.release());
+            }
+            else
+            {
+                store->perform();
+                std::lock_guard<std::mutex> lock(mutex);
+                completed.push_back(store.release());
+            }
+        }
+        complete_stores();
+
+        total_time += clock_type::now() - start;
+    }
+    const auto start = clock_type::now();
+    if (pool)
+        pool->wait_all_actions();
+    complete_stores();
+    total_time += clock_type::now() - start;
+
+    const auto after = read_io_counters();
+    io_counters io;
+    io.syscr = after.syscr - before.syscr;
+    io.syscw = after.syscw - before.syscw;
+    io.rchar = after.rchar - before.rchar;
+    io.wchar = after.wchar - before.wchar;
+
+    const auto commit_start = clock_type::now();
+    u.commit();
+    const auto commit_time = clock_type::now() - commit_start;
+
+    const auto ms = [](clock_type::duration d) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+    };
+    std::cout << "total " << ms(total_time) << " ms, parse " << ms(parse_time) << " ms, store " 
+              << ms(total_time - parse_time) << " ms, commit " << ms(commit_time) << " ms" << std::endl;
+    std::cout << "store syscalls: " << io.syscr << " reads, " << io.syscw << " writes, "
+              << std::fixed << std::setprecision(2) 
+              << double(io.syscr + io.syscw) / articles << " per article" << std::endl;
+    std::cout << "store bytes: " << io.rchar << " read, " << io.wchar << " written, "
+              << double(io.wchar) / articles << " written per article" << std::endl;
+    return 0;
+}
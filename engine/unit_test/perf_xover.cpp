@@ -0,0 +1,300 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <ctime>
+#include "../xover.h"
+#include "../article.h"
+#include "../filebuf.h"
+#include "../filetype.h"
+#include "../linebuffer.h"
+#include "../iso_8859_15.h"
+#include "../utf8.h"
+#include "../nntp.h"
+#include "unit_test_common.h"
+
+// benchmark for the header import. parses XOVER data with the 
+// xover_parser using each kernel supported by the CPU and compares 
+// to splitting the lines and parsing each one with the nntp functions,
+// i.e. what the update used to do for each header. 
+//
+// without a file the data is generated, the same every time.
+//
+// usage: perf_xover [xover data file]
+
+namespace nf = newsflash;
+
+using clock_type = std::chrono::steady_clock;
+using article    = nf::article<nf::filebuf>;
+
+// the number of headers in the generated data.
+const std::size_t NUM_HEADERS = 500000;
+
+// the article data the way article::parse used to build it from a line.
+struct legacy_article {
+    std::string subject;
+    std::string author;
+    std::uint64_t number;
+    std::uint64_t fingerprint;
+    std::time_t pubdate;
+    std::uint32_t bytes;
+    std::uint32_t hash;
+    std::uint16_t partno;
+    std::uint16_t parts_total;
+    nf::filetype type;
+    bool binary;
+};
+
+bool legacy_parse(const char* line, std::size_t len, legacy_article& a)
+{
+    const auto& pair = nntp::parse_overview(line, len);
+    if (!pair.first)
+        return false;
+
+    const auto& data = pair.second;
+    if (data.subject.len == 0 || data.subject.len > 512)
+        return false;
+    if (data.author.len == 0)
+        return false;
+
+    a.partno      = 0;
+    a.parts_total = 0;
+    const auto& part = nntp::parse_part(data.subject.start, data.subject.len);
+    if (part.first)
+    {
+        if (part.second.numerator > part.second.denominator)
+            return false;
+        a.partno      = part.second.numerator;
+        a.parts_total = part.second.denominator;
+    }
+
+    const auto date = nntp::parse_date(data.date.start, data.date.len);
+    if (!date.first)
+        return false;
+
+    a.pubdate = nntp::timevalue(date.second);
+    a.binary  = nntp::is_binary_post(data.subject.start, data.subject.len);
+    a.type    = nf::filetype::none;
+    if (a.binary)
+    {
+        const auto& filename = nntp::find_filename(data.subject.start, data.subject.len);
+        if (!filename.empty())
+            a.type = nf::find_filetype(filename);
+    }
+
+    if (utf8::is_well_formed(data.subject.start, data.subject.start + data.subject.len))
+        a.subject = std::string{data.subject.start, data.subject.len};
+    else a.subject = nf::ISO_8859_15_to_utf8(data.subject.start, data.subject.len);
+
+    if (utf8::is_well_formed(data.author.start, data.author.start + data.author.len))
+        a.author = std::string{data.author.start, data.author.len};
+    else a.author = nf::ISO_8859_15_to_utf8(data.author.start, data.author.len);
+
+    if (a.author.size() > 64)
+        a.author.resize(64);
+
+    a.number      = nntp::to_int<std::uint64_t>(data.number.start, data.number.len);
+    a.bytes       = nntp::to_int<std::uint32_t>(data.bytecount.start, data.bytecount.len);
+    a.hash        = nntp::hashvalue(data.subject.start, data.subject.len);
+    a.fingerprint = nntp::fingerprint(a.subject);
+    return true;
+}
+
+// generate overview lines that look like the ones in a binary group.
+// the posts are multipart rar sets and the parts of the concurrently
+// running posts are interleaved. every 50th subject is in latin-1.
+std::string make_xover(std::size_t count)
+{
+    const char* posters[] = {
+        "yenc@power-post.org (yEncBin)",
+        "Poster <poster@example.com>",
+        "anon@anon.com",
+        "\xe4\xe4li\xf6 <latin@example.com>"
+    };
+    const char* extensions[] = {
+        "rar", "par2", "vol00+01.par2", "nfo", "mkv", "jpg", "mp3"
+    };
+    const std::size_t posts = 8;
+    const std::size_t parts = 65;
+    const std::time_t start = 1400000000;
+
+    std::stringstream ss;
+    for (std::size_t i=0; i<count; ++i)
+    {
+        const auto num   = 100000000 + i;
+        const auto slot  = i % posts;
+        const auto round = i / posts;
+        const auto post  = (round / parts) * posts + slot;
+        const auto part  = round % parts + 1;
+        const auto ext   = extensions[post % (sizeof(extensions) / sizeof(extensions[0]))];
+
+        char date[64];
+        const std::time_t t = start + i * 3;
+        std::strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S +0000", std::gmtime(&t));
+
+        ss << num << "\t";
+        if (post % 50 == 0)
+            ss << "\xc4\xe4li\xf6 ";
+        ss << "[" << post % 100 << "/" << 100 << "] - Some.Release.Name." << post
+           << " - \"some.release.name." << post << ".part" << std::setw(2) << std::setfill('0') << slot + 1 
+           << "." << ext << "\" yEnc (" << part << "/" << parts << ")\t"
+           << posters[post % (sizeof(posters) / sizeof(posters[0]))] << "\t"
+           << date << "\t"
+           << "<part" << part << "of" << parts << "." << num << "@powerpost2000AA.local>\t"
+           << "\t"
+           << 390000 + (num % 1000) << "\t"
+           << 3000 << "\t"
+           << "Xref: news.example.com alt.binaries.test:" << num << "\r\n";
+    }
+    return ss.str();
+}
+
+void report(const char* name, std::size_t headers, std::size_t bytes, clock_type::duration time)
+{
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+    std::cout << std::setw(10) << name << " "
+              << std::setw(10) << std::fixed << std::setprecision(0) << headers / secs << " headers/s "
+              << std::setw(8)  << std::setprecision(1) << bytes / secs / (1024.0 * 1024.0) << " MB/s" 
+              << std::endl;
+}
+
+int test_main(int argc, char* argv[])
+{
+    std::vector<char> data;
+    if (argc > 1)
+    {
+        if (!std::ifstream(argv[1]).is_open())
+        {
+            std::cout << "no xover data in " << argv[1] << std::endl;
+            return 1;
+        }
+        data = read_file_contents(argv[1]);
+        std::cout << argv[1];
+    }
+    else
+    {
+        const auto& xover = make_xover(NUM_HEADERS);
+        data.assign(xover.begin(), xover.end());
+        std::cout << "generated";
+    }
+
+    std::size_t headers = 0;
+    {
+        nf::xover_parser parser(&data[0], data.size());
+        nf::xover_header header;
+        while (parser.next(header))
+            ++headers;
+    }
+    std::cout << " " << data.size() << " bytes " << headers << " headers" << std::endl;
+
+    const struct {
+        nf::xover_parser::kernel kernel;
+        const char* name;
+    } kernels[] = {
+        {nf::xover_parser::kernel::scalar, "scalar"},
+        {nf::xover_parser::kernel::sse2,   "sse2"},
+        {nf::xover_parser::kernel::avx2,   "avx2"}
+    };
+
+    std::vector<nf::xover_header> ret;
+    ret.reserve(headers);
+
+    for (const auto& k : kernels)
+    {
+        if (!nf::xover_parser::is_supported(k.kernel))
+            continue;
+
+        ret.clear();
+        const auto beg = clock_type::now();
+        nf::xover_parser parser(&data[0], data.size(), k.kernel);
+        nf::xover_header header;
+        while (parser.next(header))
+            ret.push_back(header);
+        report(k.name, ret.size(), data.size(), clock_type::now() - beg);
+
+        BOOST_REQUIRE(ret.size() == headers);
+    }
+
+    // the whole article for each header, i.e. what the update needs
+    // to do for the headers that are not parts of an earlier article.
+    {
+        std::size_t bytes = 0;
+        std::size_t count = 0;
+        const auto beg = clock_type::now();
+        for (const auto& header : ret)
+        {
+            article a;
+            a.parse(header);
+            bytes += a.subject().size();
+            if (++count == 100000)
+                break;
+        }
+        report("articles", count, bytes, clock_type::now() - beg);
+    }
+
+    // split the lines and parse each line with the nntp functions
+    // and compute the fingerprint like the update used to.
+    {
+        std::size_t bytes = 0;
+        std::size_t count = 0;
+        std::vector<legacy_article> articles;
+
+        const auto beg = clock_type::now();
+        nntp::linebuffer lines(&data[0], data.size());
+        for (auto it = lines.begin(); it != lines.end(); ++it)
+        {
+            bytes += it->length;
+            legacy_article a;
+            if (!legacy_parse(it->start, it->length, a))
+                continue;
+            articles.push_back(std::move(a));
+            if (++count == 100000)
+                break;
+        }
+        report("legacy", count, bytes, clock_type::now() - beg);
+
+        // both ways must come up with the same headers.
+        for (std::size_t i=0; i<articles.size(); ++i)
+        {
+            const auto& a = articles[i];
+            const auto& h = ret[i];
+            BOOST_REQUIRE(a.number == h.number);
+            BOOST_REQUIRE(a.hash == h.hash);
+            BOOST_REQUIRE(a.fingerprint == h.fingerprint);
+            BOOST_REQUIRE(a.pubdate == h.pubdate);
+            BOOST_REQUIRE(a.bytes == h.bytes);
+            BOOST_REQUIRE(a.partno == h.partno);
+            BOOST_REQUIRE(a.parts_total == h.parts_total);
+            BOOST_REQUIRE(a.type == h.type);
+        }
+    }
+    return 0;
+}
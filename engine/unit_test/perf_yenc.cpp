@@ -0,0 +1,154 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#  include <boost/crc.hpp>
+#include <newsflash/warnpop.h>
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include "../yenc.h"
+#include "../bodyiter.h"
+#include "unit_test_common.h"
+
+// micro-benchmark for the yEnc decoding. compares the iterator based
+// decoder (nntp::bodyiter + back_inserter) to the contiguous buffer
+// decoder with each kernel that is supported by the CPU.
+
+using clock_type = std::chrono::steady_clock;
+
+const int iterations = 200;
+
+void report(const char* name, std::size_t bytes, clock_type::duration time)
+{
+    const auto secs = std::chrono::duration_cast<std::chrono::microseconds>(time).count() / 1000000.0;
+    const auto gbs  = (bytes * iterations) / secs / (1024.0 * 1024.0 * 1024.0);
+    std::cout << std::setw(10) << name << " "
+              << std::fixed << std::setprecision(3) << gbs << " GB/s" << std::endl;
+}
+
+void benchmark(const char* what, const std::vector<char>& data)
+{
+    auto it = data.begin();
+    BOOST_REQUIRE(yenc::parse_header(it, data.end()).first);
+    yenc::parse_part(it, data.end());
+
+    const auto start = std::distance(data.begin(), it);
+    const auto len   = data.size() - start;
+
+    std::cout << what << " (" << len << " bytes)" << std::endl;
+
+    std::vector<char> ref;
+    {
+        const auto beg = clock_type::now();
+        for (int i=0; i<iterations; ++i)
+        {
+            nntp::bodyiter beg(&data[0], start, data.size());
+            nntp::bodyiter end(&data[0] + data.size(), 0);
+            ref.clear();
+            yenc::decode(beg, end, std::back_inserter(ref));
+        }
+        report("bodyiter", len, clock_type::now() - beg);
+    }
+
+    const struct {
+        yenc::kernel kernel;
+        const char* name;
+    } kernels[] = {
+        {yenc::kernel::scalar, "scalar"},
+        {yenc::kernel::sse2,   "sse2"},
+        {yenc::kernel::ssse3,  "ssse3"},
+        {yenc::kernel::avx2,   "avx2"}
+    };
+
+    std::vector<char> out;
+    out.resize(len);
+    for (const auto& k : kernels)
+    {
+        if (!yenc::is_supported(k.kernel))
+            continue;
+
+        yenc::decode_result ret {0, 0};
+        const auto beg = clock_type::now();
+        for (int i=0; i<iterations; ++i)
+        {
+            ret = yenc::decode_buffer(&data[start], len, &out[0], k.kernel);
+        }
+        report(k.name, len, clock_type::now() - beg);
+
+        BOOST_REQUIRE(ret.written == ref.size());
+        BOOST_REQUIRE(std::equal(ref.begin(), ref.end(), out.begin()));
+    }
+
+    // decoding followed by a separate crc pass vs. the fused decode + crc
+    {
+        std::uint32_t crc = 0;
+        const auto beg = clock_type::now();
+        for (int i=0; i<iterations; ++i)
+        {
+            const auto ret = yenc::decode_buffer(&data[start], len, &out[0]);
+            boost::crc_32_type crc32;
+            crc32.process_bytes(&out[0], ret.written);
+            crc = crc32.checksum();
+        }
+        report("+boostcrc", len, clock_type::now() - beg);
+
+        std::uint32_t fused = 0;
+        const auto now = clock_type::now();
+        for (int i=0; i<iterations; ++i)
+        {
+            fused = 0;
+            yenc::decode_buffer(&data[start], len, &out[0], fused);
+        }
+        report("fusedcrc", len, clock_type::now() - now);
+
+        BOOST_REQUIRE(crc == fused);
+    }
+}
+
+int test_main(int, char*[])
+{
+    // real article data
+    {
+        const auto data = read_file_contents("test_data/vip.part4.yenc.txt");
+        benchmark("vip.part4.yenc.txt", data);
+    }
+
+    // random binary encoded like the unit_test_yenc_decoder test data
+    {
+        const std::string header("=ybegin part=1 line=128 size=786432 name=test-data.bin\r\n"
+                                 "=ypart begin=1 end=786432\r\n");
+        const std::string footer("\r\n=yend size=786432 part=1\r\n");
+
+        const auto binary = generate_buffer(786432);
+
+        std::vector<char> data;
+        std::copy(header.begin(), header.end(), std::back_inserter(data));
+        yenc::encode(binary.begin(), binary.end(), std::back_inserter(data), 128, true);
+        std::copy(footer.begin(), footer.end(), std::back_inserter(data));
+        benchmark("random 768 KB", data);
+    }
+    return 0;
+}
@@ -44,5 +44,26 @@ int test_main(int, char*[])
     BOOST_REQUIRE(!std::memcmp(buff.head(), &str[6], buff.size()));
     BOOST_REQUIRE(!std::memcmp(other.head(), "jeesus", 6));
 
+    // split most of the data, the split buffer takes the storage
+    {
+        newsflash::buffer buff(1024);
+        std::strcpy(buff.back(), str);
+        buff.append(std::strlen(str));
+
+        auto other = buff.split(std::strlen(str) - 3);
+        BOOST_REQUIRE(other.size() == std::strlen(str) - 3);
+        BOOST_REQUIRE(!std::memcmp(other.head(), str, other.size()));
+        BOOST_REQUIRE(buff.size() == 3);
+        BOOST_REQUIRE(buff.available() == 1024 - 3);
+        BOOST_REQUIRE(!std::memcmp(buff.head(), "lla", 3));
+
+        // split everything
+        other = buff.split(3);
+        BOOST_REQUIRE(other.size() == 3);
+        BOOST_REQUIRE(!std::memcmp(other.head(), "lla", 3));
+        BOOST_REQUIRE(buff.size() == 0);
+        BOOST_REQUIRE(buff.available() == 1024);
+    }
+
     return 0;
 }
\ No newline at end of file
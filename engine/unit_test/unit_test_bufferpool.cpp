@@ -0,0 +1,149 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <boost/test/minimal.hpp>
+#include <thread>
+#include <vector>
+#include <cstring>
+#include "../bufferpool.h"
+#include "../buffer.h"
+
+namespace nf = newsflash;
+
+void test_allocate()
+{
+    // small allocations are not pooled
+    {
+        const auto stats = nf::bufferpool::get_stats();
+
+        std::size_t capacity = 0;
+        void* ptr = nf::bufferpool::allocate(1024, capacity);
+        BOOST_REQUIRE(ptr);
+        BOOST_REQUIRE(capacity == 1024);
+        nf::bufferpool::deallocate(ptr, capacity);
+
+        const auto now = nf::bufferpool::get_stats();
+        BOOST_REQUIRE(now.hits == stats.hits);
+        BOOST_REQUIRE(now.misses == stats.misses);
+    }
+
+    // rounded to size class and reused
+    {
+        const auto stats = nf::bufferpool::get_stats();
+
+        std::size_t capacity = 0;
+        void* ptr = nf::bufferpool::allocate(700 * 1024, capacity);
+        BOOST_REQUIRE(ptr);
+        BOOST_REQUIRE(capacity == 800 * 1024);
+        std::memset(ptr, 0xff, capacity);
+        nf::bufferpool::deallocate(ptr, capacity);
+
+        std::size_t capacity2 = 0;
+        void* ptr2 = nf::bufferpool::allocate(800 * 1024, capacity2);
+        BOOST_REQUIRE(ptr2 == ptr);
+        BOOST_REQUIRE(capacity2 == capacity);
+        nf::bufferpool::deallocate(ptr2, capacity2);
+
+        const auto now = nf::bufferpool::get_stats();
+        BOOST_REQUIRE(now.misses == stats.misses + 1);
+        BOOST_REQUIRE(now.hits == stats.hits + 1);
+        BOOST_REQUIRE(now.peak_resident_bytes >= capacity);
+    }
+
+    // larger than the biggest class
+    {
+        const auto stats = nf::bufferpool::get_stats();
+
+        std::size_t capacity = 0;
+        void* ptr = nf::bufferpool::allocate(5 * 1024 * 1024, capacity);
+        BOOST_REQUIRE(capacity == 5 * 1024 * 1024);
+        BOOST_REQUIRE(nf::bufferpool::get_stats().resident_bytes == stats.resident_bytes + capacity);
+        nf::bufferpool::deallocate(ptr, capacity);
+        BOOST_REQUIRE(nf::bufferpool::get_stats().resident_bytes == stats.resident_bytes);
+    }
+}
+
+void test_threads()
+{
+    // blocks freed by another thread end up in the global list
+    // once the thread cache is full and are available again.
+    std::vector<void*> blocks;
+    for (int i=0; i<10; ++i)
+    {
+        std::size_t capacity = 0;
+        blocks.push_back(nf::bufferpool::allocate(2048 * 1024, capacity));
+    }
+
+    std::thread thread([&]() {
+        for (void* ptr : blocks)
+            nf::bufferpool::deallocate(ptr, 2048 * 1024);
+    });
+    thread.join();
+
+    const auto stats = nf::bufferpool::get_stats();
+
+    for (int i=0; i<10; ++i)
+    {
+        std::size_t capacity = 0;
+        blocks[i] = nf::bufferpool::allocate(2048 * 1024, capacity);
+    }
+    const auto now = nf::bufferpool::get_stats();
+    BOOST_REQUIRE(now.hits == stats.hits + 10);
+    BOOST_REQUIRE(now.misses == stats.misses);
+
+    for (void* ptr : blocks)
+        nf::bufferpool::deallocate(ptr, 2048 * 1024);
+}
+
+void test_buffer()
+{
+    const auto stats = nf::bufferpool::get_stats();
+
+    // buffers return their storage automatically
+    for (int i=0; i<10; ++i)
+    {
+        nf::buffer buff(nf::MB(1));
+        BOOST_REQUIRE(buff.available() == nf::MB(1));
+        std::strcpy(buff.back(), "foobar");
+        buff.append(6);
+
+        buff.allocate(nf::MB(2));
+        BOOST_REQUIRE(buff.available() == nf::MB(2) - 6);
+        BOOST_REQUIRE(!std::memcmp(buff.head(), "foobar", 6));
+
+        nf::buffer copy(buff);
+        BOOST_REQUIRE(copy.size() == 6);
+        BOOST_REQUIRE(!std::memcmp(copy.head(), "foobar", 6));
+    }
+
+    const auto now = nf::bufferpool::get_stats();
+    BOOST_REQUIRE(now.hits + now.misses == stats.hits + stats.misses + 30);
+    BOOST_REQUIRE(now.misses <= stats.misses + 3);
+}
+
+int test_main(int, char*[])
+{
+    test_allocate();
+    test_threads();
+    test_buffer();
+    return 0;
+}
@@ -22,8 +22,10 @@
 
 #include <newsflash/warnpush.h>
 #  include <boost/test/minimal.hpp>
+#  include <boost/filesystem.hpp>
 #include <newsflash/warnpop.h>
 #include <chrono>
+#include <fstream>
 #include "../filemap.h"
 #include "../filebuf.h"
 #include "../catalog.h"
@@ -162,6 +164,254 @@ void unit_test_create_new()
     delete_file("file");
 }
 
+// read the version field from the catalog header
+std::uint32_t read_version(const char* file)
+{
+    std::ifstream in(file, std::ios::in | std::ios::binary);
+    std::uint32_t header[2] = {0, 0};
+    in.read((char*)header, sizeof(header));
+    return header[1];
+}
+
+void write_version(const char* file, std::uint32_t version)
+{
+    std::fstream out(file, std::ios::in | std::ios::out | std::ios::binary);
+    out.seekp(sizeof(std::uint32_t));
+    out.write((const char*)&version, sizeof(version));
+}
+
+void unit_test_log_recovery()
+{
+    using catalog  = newsflash::catalog<newsflash::filebuf>;
+    using article  = newsflash::article<newsflash::filebuf>;
+
+    delete_file("file");
+
+    // articles written after the checkpoint are in the log 
+    // and are recovered when the catalog is opened.
+    {
+        catalog db;
+        db.open("file");
+
+        article a;
+        a.set_author("John Doe");
+        a.set_subject("checkpointed");
+        a.set_number(1);
+        a.set_pubdate(1000);
+        db.append(a);
+        db.checkpoint();
+        BOOST_REQUIRE(read_version("file") == 3);
+
+        a.set_subject("logged");
+        a.set_number(2);
+        a.set_pubdate(2000);
+        db.append(a);
+
+        a.set_subject("inserted");
+        a.set_number(3);
+        a.set_pubdate(500);
+        a.set_parts(0, 10);
+        db.insert(a, catalog::index_t{50});
+
+        // update pending article in memory
+        a.set_parts(1, 10);
+        a.set_bytes(1234);
+        db.update_parts(a, catalog::index_t{50}, false);
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).num_parts_avail() == 1);
+        db.flush();
+
+        // update on the disk
+        a.set_parts(2, 10);
+        db.update_parts(a, catalog::index_t{50}, false);
+    }
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 3);
+        BOOST_REQUIRE(db.first_date() == 500);
+        BOOST_REQUIRE(db.last_date() == 2000);
+        BOOST_REQUIRE(db.load(catalog::index_t{0}).subject() == "checkpointed");
+        BOOST_REQUIRE(db.load(catalog::index_t{1}).subject() == "logged");
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).subject() == "inserted");
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).num_parts_avail() == 2);
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).bytes() == 1234);
+        BOOST_REQUIRE(db.is_empty(catalog::index_t{2}));
+
+        std::size_t count = 0;
+        for (auto it = db.begin(); it != db.end(); ++it)
+            ++count;
+        BOOST_REQUIRE(count == 3);
+    }
+
+    // the reader sees the log too
+    {
+        using catalog = newsflash::catalog<newsflash::filemap>;
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 3);
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).subject() == "inserted");
+    }
+
+    // simulate a crash in the middle of writing the last article.
+    const auto size = boost::filesystem::file_size("file");
+    boost::filesystem::resize_file("file", size - 5);
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 2);
+        BOOST_REQUIRE(db.is_empty(catalog::index_t{50}));
+        BOOST_REQUIRE(db.load(catalog::index_t{1}).subject() == "logged");
+
+        article a;
+        a.set_subject("after crash");
+        a.set_number(4);
+        db.append(a);
+        db.flush();
+    }
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 3);
+        BOOST_REQUIRE(db.load(catalog::index_t{2}).subject() == "after crash");
+
+        std::size_t count = 0;
+        for (auto it = db.begin(); it != db.end(); ++it)
+            ++count;
+        BOOST_REQUIRE(count == 3);
+    }
+
+    delete_file("file");
+}
+
+void unit_test_checkpoint_recovery()
+{
+    using catalog  = newsflash::catalog<newsflash::filebuf>;
+    using article  = newsflash::article<newsflash::filebuf>;
+
+    delete_file("file");
+
+    // the head (everything before the table) of the file.
+    char head[32];
+    static_assert(sizeof(head) == 4 * sizeof(std::uint32_t) + 2 * sizeof(std::time_t), 
+        "unexpected catalog head size");
+
+    {
+        catalog db;
+        db.open("file");
+
+        article a;
+        a.set_subject("checkpointed");
+        a.set_number(1);
+        a.set_pubdate(1000);
+        db.append(a);
+        db.checkpoint();
+
+        std::ifstream in("file", std::ios::in | std::ios::binary);
+        in.read(head, sizeof(head));
+        in.close();
+
+        a.set_subject("logged");
+        a.set_number(2);
+        a.set_pubdate(2000);
+        db.append(a);
+
+        a.set_subject("inserted");
+        a.set_number(3);
+        a.set_pubdate(500);
+        db.insert(a, catalog::index_t{50});
+        db.checkpoint();
+    }
+
+    // simulate a crash after the table was written but before the 
+    // head was, i.e. the table refers to the articles in the log.
+    {
+        std::fstream out("file", std::ios::in | std::ios::out | std::ios::binary);
+        out.write(head, sizeof(head));
+    }
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 3);
+        BOOST_REQUIRE(db.first_date() == 500);
+        BOOST_REQUIRE(db.last_date() == 2000);
+        BOOST_REQUIRE(db.load(catalog::index_t{1}).subject() == "logged");
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).subject() == "inserted");
+
+        article a;
+        a.set_subject("after crash");
+        a.set_number(4);
+        db.append(a);
+        db.flush();
+    }
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 4);
+        BOOST_REQUIRE(db.load(catalog::index_t{0}).subject() == "checkpointed");
+        BOOST_REQUIRE(db.load(catalog::index_t{1}).subject() == "logged");
+        BOOST_REQUIRE(db.load(catalog::index_t{3}).subject() == "after crash");
+        BOOST_REQUIRE(db.load(catalog::index_t{50}).subject() == "inserted");
+
+        std::size_t count = 0;
+        for (auto it = db.begin(); it != db.end(); ++it)
+            ++count;
+        BOOST_REQUIRE(count == 4);
+    }
+
+    delete_file("file");
+}
+
+void unit_test_version2()
+{
+    using catalog  = newsflash::catalog<newsflash::filebuf>;
+    using article  = newsflash::article<newsflash::filebuf>;
+
+    delete_file("file");
+
+    // version 2 has the same layout as a checkpointed version 3 
+    // file except that there's never a log after the data.
+    {
+        catalog db;
+        db.open("file");
+
+        article a;
+        a.set_subject("foobar");
+        a.set_number(1);
+        db.append(a);
+        db.checkpoint();
+    }
+    write_version("file", 2);
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 1);
+        BOOST_REQUIRE(db.load(catalog::index_t{0}).subject() == "foobar");
+
+        // the first flush upgrades the file.
+        article a;
+        a.set_subject("keke");
+        a.set_number(2);
+        db.append(a);
+        db.flush();
+        BOOST_REQUIRE(read_version("file") == 3);
+    }
+
+    {
+        catalog db;
+        db.open("file");
+        BOOST_REQUIRE(db.size() == 2);
+        BOOST_REQUIRE(db.load(catalog::index_t{1}).subject() == "keke");
+    }
+
+    delete_file("file");
+}
+
 void unit_test_performance()
 {
     // delete_file("file");
@@ -262,6 +512,9 @@ void check_file()
 int test_main(int, char*[])
 {
     unit_test_create_new();
+    unit_test_log_recovery();
+    unit_test_checkpoint_recovery();
+    unit_test_version2();
     //check_file();
 
     //unit_test_performance();
@@ -0,0 +1,133 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <fstream>
+#include "../catalog_index.h"
+#include "../bigfile.h"
+#include "unit_test_common.h"
+
+namespace nf = newsflash;
+
+void unit_test_insert_find()
+{
+    nf::catalog_index idx;
+    BOOST_REQUIRE(idx.size() == 0);
+    BOOST_REQUIRE(idx.find(1) == nullptr);
+
+    // enough to grow the table a few times. the keys are chosen 
+    // to collide in the low bits.
+    for (std::uint64_t i=1; i<=10000; ++i)
+    {
+        auto& e = idx.insert(i << 20);
+        e.slot   = std::uint32_t(i);
+        e.number = i * 10;
+    }
+    BOOST_REQUIRE(idx.size() == 10000);
+
+    for (std::uint64_t i=1; i<=10000; ++i)
+    {
+        const auto* e = idx.find(i << 20);
+        BOOST_REQUIRE(e);
+        BOOST_REQUIRE(e->fingerprint == i << 20);
+        BOOST_REQUIRE(e->slot == i);
+        BOOST_REQUIRE(e->number == i * 10);
+    }
+    BOOST_REQUIRE(idx.find(10001ull << 20) == nullptr);
+    BOOST_REQUIRE(idx.find(12345) == nullptr);
+
+    idx.find(5ull << 20)->parts_avail = 3;
+    BOOST_REQUIRE(idx.find(5ull << 20)->parts_avail == 3);
+}
+
+void unit_test_save_load()
+{
+    delete_file("vol.idx");
+
+    {
+        nf::catalog_index idx;
+        for (std::uint64_t i=1; i<=500; ++i)
+        {
+            auto& e = idx.insert(i * 7919);
+            e.slot        = std::uint32_t(i);
+            e.hash        = std::uint32_t(i * 3);
+            e.bytes       = std::uint32_t(i * 1000);
+            e.idbkey      = std::uint32_t(i * 5);
+            e.parts_avail = std::uint16_t(i % 10);
+            e.parts_total = 10;
+        }
+        idx.save("vol.idx", 500, 123456);
+    }
+
+    // the index is for a different volume
+    {
+        nf::catalog_index idx;
+        BOOST_REQUIRE(!idx.load("vol.idx", 501, 123456));
+        BOOST_REQUIRE(idx.size() == 0);
+        BOOST_REQUIRE(!nf::bigfile::exists("vol.idx"));
+    }
+
+    {
+        nf::catalog_index idx;
+        idx.insert(1);
+        idx.save("vol.idx", 500, 123456);
+        BOOST_REQUIRE(!idx.load("vol.idx", 500, 123457));
+        BOOST_REQUIRE(idx.size() == 0);
+    }
+
+    // the file is removed once it has been loaded.
+    {
+        nf::catalog_index idx;
+        for (std::uint64_t i=1; i<=500; ++i)
+            idx.insert(i * 7919).slot = std::uint32_t(i);
+        idx.save("vol.idx", 500, 123456);
+    }
+    {
+        nf::catalog_index idx;
+        BOOST_REQUIRE(idx.load("vol.idx", 500, 123456));
+        BOOST_REQUIRE(!nf::bigfile::exists("vol.idx"));
+        BOOST_REQUIRE(idx.size() == 500);
+        for (std::uint64_t i=1; i<=500; ++i)
+            BOOST_REQUIRE(idx.find(i * 7919)->slot == i);
+        BOOST_REQUIRE(!idx.load("vol.idx", 500, 123456));
+    }
+
+    // truncated file
+    {
+        nf::catalog_index idx;
+        for (std::uint64_t i=1; i<=500; ++i)
+            idx.insert(i * 7919);
+        idx.save("vol.idx", 500, 123456);
+        nf::bigfile::resize("vol.idx", 1000);
+        BOOST_REQUIRE(!idx.load("vol.idx", 500, 123456));
+        BOOST_REQUIRE(idx.size() == 0);
+    }
+
+    delete_file("vol.idx");
+}
+
+int test_main(int, char*[])
+{
+    unit_test_insert_find();
+    unit_test_save_load();
+    return 0;
+}
@@ -0,0 +1,225 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <string>
+#include "../filemap.h"
+#include "../filebuf.h"
+#include "../article.h"
+#include "../columns.h"
+#include "unit_test_common.h"
+
+using columns  = newsflash::columns<newsflash::filebuf>;
+using article  = newsflash::article<newsflash::filebuf>;
+using fileflag = newsflash::fileflag;
+
+article make_article(std::size_t i)
+{
+    article a;
+    a.set_index(i * 7);
+    a.set_subject(("subject " + std::to_string(i)).c_str());
+    a.set_author(("author " + std::to_string(i)).c_str());
+    a.set_bytes(i * 100);
+    a.set_pubdate(1000 + i);
+    a.set_parts(1, 10);
+    a.set_bits(fileflag::broken, true);
+    a.set_bits(fileflag::binary, i % 2 == 0);
+    return a;
+}
+
+void check_row(const newsflash::column_view& view, std::size_t i)
+{
+    BOOST_REQUIRE(view.slot(i) == i * 7);
+    BOOST_REQUIRE(view.subject(i) == ("subject " + std::to_string(i)).c_str());
+    BOOST_REQUIRE(view.author(i) == ("author " + std::to_string(i)).c_str());
+    BOOST_REQUIRE(view.pubdate(i) == std::time_t(1000 + i));
+    BOOST_REQUIRE(view.test(i, fileflag::binary) == (i % 2 == 0));
+}
+
+void unit_test_write_read()
+{
+    delete_file("file.col");
+
+    // enough rows to span several pages in every column.
+    {
+        columns cols;
+        cols.open("file.col");
+        BOOST_REQUIRE(cols.rows() == 0);
+
+        for (std::size_t i=0; i<3000; ++i)
+            BOOST_REQUIRE(cols.append(make_article(i)) == i);
+        cols.flush();
+    }
+
+    // update the parts in some old rows and add more rows.
+    {
+        columns cols;
+        cols.open("file.col");
+        BOOST_REQUIRE(cols.rows() == 3000);
+
+        article a;
+        a.set_bytes(12345);
+        a.set_parts(10, 10);
+        a.set_bits(fileflag::broken, false);
+        cols.update_parts(10, a, true);
+        cols.update_parts(2500, a, false);
+
+        for (std::size_t i=3000; i<5000; ++i)
+            cols.append(make_article(i));
+        cols.flush();
+    }
+
+    {
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.rows() == 5000);
+        for (std::size_t i=0; i<5000; ++i)
+            check_row(view, i);
+
+        BOOST_REQUIRE(view.bytes(10) == 12345);
+        BOOST_REQUIRE(view.num_parts_avail(10) == 10);
+        BOOST_REQUIRE(view.test(10, fileflag::broken) == false);
+        BOOST_REQUIRE(view.test(10, fileflag::binary));
+        BOOST_REQUIRE(view.bytes(2500) == 12345);
+        BOOST_REQUIRE(view.test(2500, fileflag::broken));
+        BOOST_REQUIRE(view.bytes(11) == 1100);
+        BOOST_REQUIRE(view.num_parts_avail(11) == 1);
+
+        // flags changed through the mapping stay when the parts are updated.
+        view.set_bits(20, fileflag::bookmarked, true);
+    }
+
+    {
+        columns cols;
+        cols.open("file.col");
+
+        article a;
+        a.set_parts(10, 10);
+        cols.update_parts(20, a, true);
+        cols.flush();
+
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.test(20, fileflag::bookmarked));
+        BOOST_REQUIRE(view.test(20, fileflag::broken) == false);
+    }
+
+    // flags changed through the mapping while a batch is pending
+    // are not reverted when the batch is flushed.
+    {
+        columns cols;
+        cols.open("file.col");
+
+        article a;
+        a.set_parts(10, 10);
+        a.set_bits(fileflag::broken, false);
+        cols.update_parts(30, a, true);
+        cols.update_parts(31, a, false);
+        cols.append(make_article(5000));
+
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        view.set_bits(30, fileflag::deleted, true);
+        view.set_bits(31, fileflag::bookmarked, true);
+        view.set_bits(4999, fileflag::downloaded, true);
+
+        cols.flush();
+    }
+
+    {
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.rows() == 5001);
+        check_row(view, 5000);
+        BOOST_REQUIRE(view.test(30, fileflag::deleted));
+        BOOST_REQUIRE(view.test(30, fileflag::broken) == false);
+        BOOST_REQUIRE(view.test(31, fileflag::bookmarked));
+        BOOST_REQUIRE(view.test(31, fileflag::broken));
+        BOOST_REQUIRE(view.test(4999, fileflag::downloaded));
+        BOOST_REQUIRE(view.test(5000, fileflag::broken));
+    }
+
+    // drop rows and write over them.
+    {
+        columns cols;
+        cols.open("file.col");
+        cols.truncate(100);
+        cols.append(make_article(100));
+        cols.flush();
+
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.rows() == 101);
+        check_row(view, 100);
+    }
+
+    delete_file("file.col");
+}
+
+void unit_test_invalid()
+{
+    delete_file("file.col");
+
+    // a file that isn't a column file is started from scratch.
+    {
+        newsflash::filebuf file;
+        file.open("file.col");
+        auto buff = file.load(0, newsflash::COLUMN_HEAP, newsflash::filebuf::buf_write);
+        std::fill(buff.begin(), buff.end(), 0xff);
+        buff.flush();
+    }
+    {
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.rows() == 0);
+    }
+    {
+        columns cols;
+        cols.open("file.col");
+        BOOST_REQUIRE(cols.rows() == 0);
+        cols.append(make_article(0));
+        cols.flush();
+
+        newsflash::filemap file;
+        file.open("file.col");
+        newsflash::column_view view(file.map_ptr(0, file.size()), file.size());
+        BOOST_REQUIRE(view.rows() == 1);
+        check_row(view, 0);
+    }
+
+    delete_file("file.col");
+}
+
+int test_main(int, char*[])
+{
+    unit_test_write_read();
+    unit_test_invalid();
+    return 0;
+}
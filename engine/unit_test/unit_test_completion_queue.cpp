@@ -0,0 +1,173 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <boost/test/minimal.hpp>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "../completion_queue.h"
+#include "../action.h"
+
+namespace nf = newsflash;
+
+struct test_action : public nf::action
+{
+    test_action(std::size_t producer, std::size_t seq) : producer_(producer), seq_(seq)
+    {}
+
+    virtual void xperform() override
+    {}
+
+    std::size_t producer_;
+    std::size_t seq_;
+};
+
+void unit_test_single_thread()
+{
+    nf::completion_queue queue;
+
+    BOOST_REQUIRE(!queue.pop());
+
+    // only the first push needs a notification until the consumer
+    // has taken the actions out.
+    BOOST_REQUIRE(queue.push(new test_action(0, 0)) == true);
+    BOOST_REQUIRE(queue.push(new test_action(0, 1)) == false);
+    BOOST_REQUIRE(queue.push(new test_action(0, 2)) == false);
+
+    for (std::size_t i=0; i<3; ++i)
+    {
+        auto a = queue.pop();
+        BOOST_REQUIRE(a);
+        BOOST_REQUIRE(static_cast<test_action*>(a.get())->seq_ == i);
+    }
+    BOOST_REQUIRE(!queue.pop());
+
+    BOOST_REQUIRE(queue.push(new test_action(0, 3)) == true);
+
+    // actions left in the queue are deleted with the queue.
+    queue.push(new test_action(0, 4));
+
+    const auto stats = queue.get_stats();
+    BOOST_REQUIRE(stats.num_actions == 3);
+    BOOST_REQUIRE(stats.num_notifications == 2);
+}
+
+void unit_test_suspend()
+{
+    nf::completion_queue queue;
+
+    // nothing left to come back for.
+    BOOST_REQUIRE(queue.suspend() == false);
+
+    BOOST_REQUIRE(queue.push(new test_action(0, 0)) == true);
+    BOOST_REQUIRE(queue.push(new test_action(0, 1)) == false);
+    BOOST_REQUIRE(queue.push(new test_action(0, 2)) == false);
+
+    // the consumer quits early after taking out the first action.
+    // the producers must not be the only ones to notify since the
+    // rest of the batch is stranded until the consumer comes back.
+    BOOST_REQUIRE(queue.pop());
+    BOOST_REQUIRE(queue.push(new test_action(0, 3)) == true);
+    BOOST_REQUIRE(queue.suspend() == true);
+    BOOST_REQUIRE(queue.push(new test_action(0, 4)) == false);
+
+    // and quits early again on the next notification.
+    BOOST_REQUIRE(queue.pop());
+    BOOST_REQUIRE(queue.suspend() == true);
+
+    for (std::size_t i=2; i<5; ++i)
+    {
+        auto a = queue.pop();
+        BOOST_REQUIRE(a);
+        BOOST_REQUIRE(static_cast<test_action*>(a.get())->seq_ == i);
+    }
+    BOOST_REQUIRE(!queue.pop());
+    BOOST_REQUIRE(queue.suspend() == false);
+
+    // the batch was drained so the producers notify again.
+    BOOST_REQUIRE(queue.push(new test_action(0, 5)) == true);
+
+    const auto stats = queue.get_stats();
+    BOOST_REQUIRE(stats.num_actions == 5);
+    BOOST_REQUIRE(stats.num_notifications == 5);
+}
+
+void unit_test_multiple_producers()
+{
+    const std::size_t num_producers = 4;
+    const std::size_t num_actions   = 50000;
+
+    nf::completion_queue queue;
+
+    std::atomic<std::size_t> notifications {0};
+    std::vector<std::thread> producers;
+    for (std::size_t i=0; i<num_producers; ++i)
+    {
+        producers.emplace_back([&, i]() {
+            for (std::size_t seq=0; seq<num_actions; ++seq)
+            {
+                if (queue.push(new test_action(i, seq)))
+                    notifications++;
+            }
+        });
+    }
+
+    // every action is taken out and in the order each producer pushed them.
+    std::vector<std::size_t> next(num_producers);
+    std::size_t received = 0;
+    std::size_t handled_notifications = 0;
+    while (received != num_producers * num_actions)
+    {
+        // like the engine, only pump when notified
+        if (handled_notifications == notifications)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+        handled_notifications++;
+
+        while (auto a = queue.pop())
+        {
+            auto* t = static_cast<test_action*>(a.get());
+            BOOST_REQUIRE(t->seq_ == next[t->producer_]);
+            next[t->producer_]++;
+            received++;
+        }
+    }
+
+    for (auto& t : producers)
+        t.join();
+
+    BOOST_REQUIRE(!queue.pop());
+
+    const auto stats = queue.get_stats();
+    BOOST_REQUIRE(stats.num_actions == num_producers * num_actions);
+    BOOST_REQUIRE(stats.num_notifications == notifications);
+    BOOST_REQUIRE(stats.num_notifications <= stats.num_actions);
+}
+
+int test_main(int, char*[])
+{
+    unit_test_single_thread();
+    unit_test_suspend();
+    unit_test_multiple_producers();
+    return 0;
+}
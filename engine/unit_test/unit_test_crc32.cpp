@@ -0,0 +1,119 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#  include <boost/crc.hpp>
+#include <newsflash/warnpop.h>
+#include <algorithm>
+#include <vector>
+#include <cstdlib>
+#include <ctime>
+#include "../crc32.h"
+#include "../cpu.h"
+
+namespace nf = newsflash;
+
+std::uint32_t boost_crc32(const std::vector<char>& data, std::size_t offset, std::size_t len)
+{
+    boost::crc_32_type crc;
+    crc.process_bytes(data.data() + offset, len);
+    return crc.checksum();
+}
+
+void unit_test_crc32()
+{
+    std::srand(std::time(nullptr));
+
+    const bool pclmul = nf::has_cpu_feature(nf::cpu_feature::pclmul) &&
+                        nf::has_cpu_feature(nf::cpu_feature::sse41);
+
+    BOOST_REQUIRE(nf::crc32(0, nullptr, 0) == 0);
+    BOOST_REQUIRE(nf::crc32(0, "123456789", 9) == 0xcbf43926);
+
+    for (int i=0; i<1000; ++i)
+    {
+        std::vector<char> data;
+        data.resize(std::rand() % 10000);
+        for (auto& c : data)
+            c = std::rand();
+
+        // unaligned start and end
+        const auto offset = data.empty() ? 0 : std::rand() % data.size();
+        const auto len    = data.size() - offset;
+        const auto crc    = boost_crc32(data, offset, len);
+
+        BOOST_REQUIRE(nf::crc32(0, data.data() + offset, len) == crc);
+        BOOST_REQUIRE(nf::crc32(0, data.data() + offset, len, nf::crc32_kernel::slice8) == crc);
+        if (pclmul)
+            BOOST_REQUIRE(nf::crc32(0, data.data() + offset, len, nf::crc32_kernel::pclmul) == crc);
+
+        // incremental
+        const auto split = len ? std::rand() % len : 0;
+        auto value = nf::crc32(0, data.data() + offset, split);
+        value = nf::crc32(value, data.data() + offset + split, len - split);
+        BOOST_REQUIRE(value == crc);
+    }
+}
+
+void unit_test_crc32_combine()
+{
+    std::vector<char> data;
+    data.resize(1024 * 1024);
+    for (auto& c : data)
+        c = std::rand();
+
+    const auto crc = boost_crc32(data, 0, data.size());
+
+    // combine 2 parts
+    for (int i=0; i<100; ++i)
+    {
+        const std::size_t split = std::rand() % data.size();
+        const auto crc1 = boost_crc32(data, 0, split);
+        const auto crc2 = boost_crc32(data, split, data.size() - split);
+        BOOST_REQUIRE(nf::crc32_combine(crc1, crc2, data.size() - split) == crc);
+    }
+
+    // combine several parts like a multipart yEnc binary
+    {
+        const std::size_t part = 100000;
+
+        std::uint32_t value = 0;
+        for (std::size_t offset=0; offset<data.size(); offset += part)
+        {
+            const auto len = std::min(part, data.size() - offset);
+            value = nf::crc32_combine(value, boost_crc32(data, offset, len), len);
+        }
+        BOOST_REQUIRE(value == crc);
+    }
+
+    // empty parts
+    BOOST_REQUIRE(nf::crc32_combine(crc, 0, 0) == crc);
+    BOOST_REQUIRE(nf::crc32_combine(0, crc, data.size()) == crc);
+}
+
+int test_main(int, char*[])
+{
+    unit_test_crc32();
+    unit_test_crc32_combine();
+    return 0;
+}
@@ -24,10 +24,17 @@
 #  include <boost/test/minimal.hpp>
 #include <newsflash/warnpop.h>
 #include "../decode.h"
+#include "../crc32.h"
 #include "unit_test_common.h"
 
 namespace nf = newsflash;
 
+std::vector<char> binary_data(const nf::decode& dec)
+{
+    const auto& buff = dec.get_binary_data();
+    return std::vector<char>(buff.content(), buff.content() + buff.content_length());
+}
+
 void unit_test_yenc_single()
 {
     // successful decode
@@ -43,7 +50,7 @@ void unit_test_yenc_single()
         BOOST_REQUIRE(dec.get_errors().any_bit() == false);
         BOOST_REQUIRE(dec.get_encoding() == nf::decode::encoding::yenc);
 
-        const auto& bin = dec.get_binary_data();
+        const auto bin = binary_data(dec);
         const auto& txt = dec.get_text_data();
         BOOST_REQUIRE(txt.empty() == true);
         BOOST_REQUIRE(bin.empty() == false);
@@ -79,6 +86,7 @@ void unit_test_yenc_multi()
         out.resize(jpg.size());
 
         std::size_t offset = 0;
+        std::uint32_t crc = 0;
         // first part
         {
             nf::decode dec(read_file_buffer("test_data/1489406.jpg-001.ync"));
@@ -89,9 +97,12 @@ void unit_test_yenc_multi()
             BOOST_REQUIRE(dec.get_binary_name() == "1489406.jpg");
             BOOST_REQUIRE(dec.get_errors().any_bit() == false);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::memcpy(&out[offset], bin.data(), bin.size());
             offset = bin.size();
+            crc = nf::crc32_combine(crc, dec.get_crc32(), bin.size());
+            BOOST_REQUIRE(dec.get_crc32() == 0xD7EECD14);
+            BOOST_REQUIRE(dec.get_binary_crc32() == 0);
         }
 
         // second part
@@ -104,9 +115,11 @@ void unit_test_yenc_multi()
             BOOST_REQUIRE(dec.get_binary_name() == "1489406.jpg");
             BOOST_REQUIRE(dec.get_errors().any_bit() == false);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::memcpy(&out[offset], bin.data(), bin.size());
             offset += bin.size();
+            crc = nf::crc32_combine(crc, dec.get_crc32(), bin.size());
+            BOOST_REQUIRE(dec.get_crc32() == 0xD489D14E);
         }
 
         // third part
@@ -119,9 +132,15 @@ void unit_test_yenc_multi()
             BOOST_REQUIRE(dec.get_binary_name() == "1489406.jpg");
             BOOST_REQUIRE(dec.get_errors().any_bit() == false);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::memcpy(&out[offset], bin.data(), bin.size());
             offset += bin.size();
+            crc = nf::crc32_combine(crc, dec.get_crc32(), bin.size());
+            BOOST_REQUIRE(dec.get_crc32() == 0x87129EB2);
+
+            // the whole file crc can be verified from the part crcs
+            BOOST_REQUIRE(dec.get_binary_crc32() == 0xA2E37A54);
+            BOOST_REQUIRE(crc == dec.get_binary_crc32());
         }
         BOOST_REQUIRE(offset += jpg.size());
         BOOST_REQUIRE(jpg == out);
@@ -159,7 +178,7 @@ void unit_test_uuencode_single()
         BOOST_REQUIRE(dec.is_first_part() == true);
         BOOST_REQUIRE(dec.is_last_part() == true);
 
-        const auto& bin = dec.get_binary_data();
+        const auto bin = binary_data(dec);
         BOOST_REQUIRE(bin == png);
     }
 
@@ -185,7 +204,7 @@ void unit_test_uuencode_multi()
             BOOST_REQUIRE(dec.is_first_part() == true);
             BOOST_REQUIRE(dec.is_last_part() == false);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::copy(bin.begin(), bin.end(), std::back_inserter(out));
 
         }
@@ -202,7 +221,7 @@ void unit_test_uuencode_multi()
             BOOST_REQUIRE(dec.is_first_part() == false);
             BOOST_REQUIRE(dec.is_last_part() == false);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::copy(bin.begin(), bin.end(), std::back_inserter(out));
 
         }
@@ -219,7 +238,7 @@ void unit_test_uuencode_multi()
             BOOST_REQUIRE(dec.is_first_part() == false);
             BOOST_REQUIRE(dec.is_last_part() == true);
 
-            const auto& bin = dec.get_binary_data();
+            const auto bin = binary_data(dec);
             std::copy(bin.begin(), bin.end(), std::back_inserter(out));
         }
 
@@ -30,6 +30,9 @@
 #include "../session.h"
 #include "../cmdlist.h"
 #include "../settings.h"
+#include "../datafile.h"
+#include "../par2.h"
+#include "../crc32.h"
 #include "unit_test_common.h"
 
 namespace nf = newsflash;
@@ -145,6 +148,68 @@ void unit_test_decode_yenc_bug_32()
     delete_file("02252012paul-10w(WallPaperByPaul)[1280X800].jpg");
 }
 
+// single part yEnc binaries carry no offset but need to be verified
+// against the par2 slices starting from the beginning of the file.
+void unit_test_verify_yenc_single_part()
+{
+    delete_file("test.png");
+
+    const auto& ref = read_file_contents("test_data/newsflash_2_0_0.png");
+    const std::uint64_t slice_size = 1024;
+
+    auto set = std::make_shared<nf::par2_set>();
+    set->slice_size = slice_size;
+    nf::par2_file desc;
+    desc.name = "test.png";
+    desc.size = ref.size();
+    for (std::size_t offset=0; offset<ref.size(); offset += slice_size)
+    {
+        std::vector<char> slice(slice_size);
+        const auto len = std::min<std::size_t>(slice_size, ref.size() - offset);
+        std::copy(ref.begin() + offset, ref.begin() + offset + len, slice.begin());
+        desc.crcs.push_back(nf::crc32(0, slice.data(), slice.size()));
+    }
+    set->files.push_back(desc);
+
+    nf::download download({"alt.binaries.foobar"}, {"1"}, "", "test");
+    download.set_par2(set);
+    nf::session session;
+    session.on_send = [&](const std::string&) {};
+
+    auto cmdlist = download.create_commands();
+
+    cmdlist->submit_data_commands(session);
+    cmdlist->receive_data_buffer(read_file_buffer("test_data/newsflash_2_0_0.yenc"));
+
+    std::vector<std::unique_ptr<nf::action>> actions1;
+    std::vector<std::unique_ptr<nf::action>> actions2;
+    download.complete(*cmdlist, actions1);
+
+    while (!actions1.empty())
+    {
+        for (auto& it : actions1)
+        {
+            it->perform();
+            download.complete(*it, actions2);
+        }
+        actions1 = std::move(actions2);
+        actions2 = std::vector<std::unique_ptr<nf::action>>();
+    }
+
+    download.commit();
+
+    BOOST_REQUIRE(download.files().size() == 1);
+    const auto* verifier = download.files()[0]->verifier();
+    BOOST_REQUIRE(verifier);
+    BOOST_REQUIRE(verifier->is_verified());
+    BOOST_REQUIRE(verifier->damaged_slices().empty());
+
+    const auto& png = read_file_contents("test.png");
+    BOOST_REQUIRE(png == ref);
+
+    delete_file("test.png");
+}
+
 void unit_test_decode_uuencode()
 {
     delete_file("1489406.jpg");
@@ -243,8 +308,10 @@ int test_main(int, char*[])
     unit_test_create_cmds();
     unit_test_decode_yenc();
     unit_test_decode_yenc_bug_32();
+    unit_test_verify_yenc_single_part();
     unit_test_decode_uuencode();    
     unit_test_decode_text();
     unit_test_decode_from_files();
+    delete_file("VIP140415XSKOLYO3Q.r09");
     return 0;
 }
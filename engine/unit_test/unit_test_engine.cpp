@@ -0,0 +1,115 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <boost/test/minimal.hpp>
+#include <deque>
+#include <string>
+#include "../engine.h"
+
+namespace nf = newsflash;
+
+using states = nf::ui::task::states;
+
+// the engine isn't started so the tasks stay queued
+// and the batch state follows only from the task states.
+
+nf::ui::batch make_batch()
+{
+    nf::ui::batch batch;
+    batch.account = 1;
+    batch.path    = ".";
+    batch.desc    = "foo";
+
+    const char* names[] = {
+        "foo.rar", "foo.vol00+01.par2", "foo.vol01+02.par2", "foo.par2"
+    };
+    for (const auto* name : names)
+    {
+        nf::ui::download file;
+        file.groups.push_back("alt.binaries.foo");
+        file.articles.push_back("1");
+        file.size = 0;
+        file.path = ".";
+        file.name = name;
+        batch.files.push_back(std::move(file));
+    }
+    return batch;
+}
+
+std::size_t find_task(const std::deque<nf::ui::task>& tasks, const std::string& desc)
+{
+    for (std::size_t i=0; i<tasks.size(); ++i)
+    {
+        if (tasks[i].desc == desc)
+            return i;
+    }
+    BOOST_REQUIRE(!"no such task");
+    return 0;
+}
+
+void test_kill_last_datafile()
+{
+    nf::engine engine(1);
+
+    bool batch_complete = false;
+    engine.set_batch_callback([&](const nf::ui::batch&) {
+        batch_complete = true;
+    });
+    engine.set_finish_callback([]() {});
+
+    engine.download_files(make_batch());
+
+    std::deque<nf::ui::task> tasks;
+    engine.update(tasks);
+    BOOST_REQUIRE(tasks.size() == 4);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol00+01.par2")].state == states::paused);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol01+02.par2")].state == states::paused);
+    BOOST_REQUIRE(engine.num_pending_tasks() == 4);
+
+    // the volumes stay held while there are other files.
+    engine.kill_task(find_task(tasks, "foo.par2"));
+    engine.update(tasks);
+    BOOST_REQUIRE(tasks.size() == 3);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol00+01.par2")].state == states::paused);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol01+02.par2")].state == states::paused);
+
+    // killing the last data file releases the volumes since
+    // there's no par2 set to tell how many blocks are needed.
+    engine.kill_task(find_task(tasks, "foo.rar"));
+    engine.update(tasks);
+    BOOST_REQUIRE(tasks.size() == 2);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol00+01.par2")].state == states::queued);
+    BOOST_REQUIRE(tasks[find_task(tasks, "foo.vol01+02.par2")].state == states::queued);
+    BOOST_REQUIRE(engine.num_pending_tasks() == 2);
+    BOOST_REQUIRE(!batch_complete);
+
+    engine.set_group_items(true);
+    engine.update(tasks);
+    BOOST_REQUIRE(tasks.size() == 1);
+    BOOST_REQUIRE(tasks[0].state == states::queued);
+}
+
+int test_main(int, char*[])
+{
+    test_kill_last_datafile();
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include "../idlist.h"
+#include "../filebuf.h"
+#include "../filemap.h"
+#include "unit_test_common.h"
+
+namespace nf = newsflash;
+
+using writer = nf::idlist_writer<nf::filebuf>;
+using reader = nf::idlist<nf::filemap>;
+
+void unit_test_write_read()
+{
+    delete_file("idlist");
+
+    {
+        writer w;
+        w.open("idlist");
+        BOOST_REQUIRE(w.size() == 0);
+
+        w.resize(10);
+        w.set(0, 1);
+        w.set(5, -5);
+        w.set(9, 9);
+        BOOST_REQUIRE(w.size() == 10);
+
+        // nothing is written before the flush
+        BOOST_REQUIRE(w.filebuf::size() == 0);
+
+        w.flush();
+    }
+
+    reader r;
+    r.open("idlist");
+    BOOST_REQUIRE(r.size() == 10);
+    BOOST_REQUIRE(r[0] == 1);
+    BOOST_REQUIRE(r[1] == 0);
+    BOOST_REQUIRE(r[5] == -5);
+    BOOST_REQUIRE(r[8] == 0);
+    BOOST_REQUIRE(r[9] == 9);
+
+    delete_file("idlist");
+}
+
+void unit_test_grow_and_update()
+{
+    delete_file("idlist");
+
+    const std::size_t count = writer::PageSize * (writer::MaxCachedPages + 10) + 123;
+
+    // grow the list a batch at a time and update some older values
+    // that are no longer cached.
+    {
+        writer w;
+        w.open("idlist");
+        for (std::size_t i=0; i<count; i += 1000)
+        {
+            const auto size = std::min(i + 1000, count);
+            w.resize(size);
+            for (std::size_t j=i; j<size; ++j)
+                w.set(j, std::int16_t(j % 1000));
+            w.flush();
+        }
+        w.set(1, -1);
+        w.set(writer::PageSize + 1, -2);
+        w.flush();
+    }
+
+    // reopen and continue
+    {
+        writer w;
+        w.open("idlist");
+        BOOST_REQUIRE(w.size() == count);
+        w.set(2, -3);
+        w.resize(count + 10);
+        w.set(count + 5, 42);
+        w.flush();
+    }
+
+    reader r;
+    r.open("idlist");
+    BOOST_REQUIRE(r.size() == count + 10);
+    BOOST_REQUIRE(r[0] == 0);
+    BOOST_REQUIRE(r[1] == -1);
+    BOOST_REQUIRE(r[2] == -3);
+    BOOST_REQUIRE(r[3] == 3);
+    BOOST_REQUIRE(r[writer::PageSize + 1] == -2);
+    for (std::size_t i=writer::PageSize + 2; i<count; ++i)
+        BOOST_REQUIRE(r[i] == std::int16_t(i % 1000));
+    BOOST_REQUIRE(r[count] == 0);
+    BOOST_REQUIRE(r[count + 5] == 42);
+    BOOST_REQUIRE(r[count + 9] == 0);
+
+    delete_file("idlist");
+}
+
+int test_main(int, char*[])
+{
+    unit_test_write_read();
+    unit_test_grow_and_update();
+    return 0;
+}
@@ -22,8 +22,16 @@
 #include <newsflash/warnpush.h>
 #  include <boost/test/minimal.hpp>
 #include <newsflash/warnpop.h>
+#include <functional>
+#include <vector>
+#include <string>
+#include <ctime>
 #include "../index.h"
 #include "../article.h"
+#include "../columns.h"
+#include "../filebuf.h"
+#include "../filemap.h"
+#include "unit_test_common.h"
 
 struct storage
 {
@@ -211,5 +219,272 @@ int test_main(int, char*[])
 
     }
 
+    // test sorting and filtering on the columns.
+    {
+        using index   = newsflash::index<storage>;
+        using columns = newsflash::columns<newsflash::filebuf>;
+
+        delete_file("index0.col");
+        delete_file("index1.col");
+        {
+            columns cols[2];
+            cols[0].open("index0.col");
+            cols[1].open("index1.col");
+            for (int i=0; i<3; ++i)
+                cols[0].append(catalog[0][i]);
+            for (int i=0; i<2; ++i)
+                cols[1].append(catalog[1][i]);
+            cols[0].flush();
+            cols[1].flush();
+        }
+
+        newsflash::filemap files[2];
+        files[0].open("index0.col");
+        files[1].open("index1.col");
+
+        index i;
+        i.set_columns(0, newsflash::column_view(files[0].map_ptr(0, files[0].size()), files[0].size()));
+        i.set_columns(1, newsflash::column_view(files[1].map_ptr(0, files[1].size()), files[1].size()));
+        i.on_load = [&](std::size_t key, std::size_t row) {
+            BOOST_REQUIRE(key < 2);
+            BOOST_REQUIRE(row < 3);
+            return catalog[key][row];
+        };
+        i.on_filter_columns = [](std::size_t, const newsflash::column_view& c, std::size_t row) {
+            return c.bytes(row) < 1000;
+        };
+
+        i.sort(index::sorting::sort_by_date, index::sortdir::ascending);
+        i.insert(1, 0);
+        i.insert(0, 2);
+        i.insert(0, 1);
+        i.insert(0, 0);
+        i.insert(1, 1);
+        BOOST_REQUIRE(i.size() == 4);
+        BOOST_REQUIRE(i.real_size() == 5);
+        BOOST_REQUIRE(i[0] == catalog[0][0]);
+        BOOST_REQUIRE(i[1] == catalog[0][2]);
+        BOOST_REQUIRE(i[2] == catalog[0][1]);
+        BOOST_REQUIRE(i[3] == catalog[1][0]);
+
+        i.sort(index::sorting::sort_by_size, index::sortdir::descending);
+        BOOST_REQUIRE(i[0] == catalog[0][1]);
+        BOOST_REQUIRE(i[1] == catalog[0][0]);
+        BOOST_REQUIRE(i[2] == catalog[1][0]);
+        BOOST_REQUIRE(i[3] == catalog[0][2]);
+
+        i.sort(index::sorting::sort_by_subject, index::sortdir::ascending);
+        BOOST_REQUIRE(i[0] == catalog[0][2]);
+        BOOST_REQUIRE(i.key(0) == 0 && i.row(0) == 2);
+        BOOST_REQUIRE(i[1] == catalog[1][0]);
+        BOOST_REQUIRE(i.key(1) == 1 && i.row(1) == 0);
+        BOOST_REQUIRE(i[2] == catalog[0][0]);
+        BOOST_REQUIRE(i[3] == catalog[0][1]);
+
+        i.on_filter_columns = [](std::size_t, const newsflash::column_view& c, std::size_t row) {
+            return c.bytes(row) >= 100;
+        };
+        i.filter();
+        BOOST_REQUIRE(i.size() == 3);
+        BOOST_REQUIRE(i[0] == catalog[0][0]);
+        BOOST_REQUIRE(i[1] == catalog[0][1]);
+        BOOST_REQUIRE(i[2] == catalog[1][1]);
+
+        // flags written through the columns
+        i.columns(2).set_bits(i.row(2), newsflash::fileflag::bookmarked, true);
+        i.sort(index::sorting::sort_by_bookmarked, index::sortdir::descending);
+        BOOST_REQUIRE(i[0] == catalog[1][1]);
+
+        // flags set through the index while sorting on the flag.
+        // the next sort puts the items in order of the new flags
+        // instead of reversing the previous order.
+        BOOST_REQUIRE(i[2] == catalog[0][0]);
+        i.set_bits(2, newsflash::fileflag::bookmarked, true);
+        i.set_bits(0, newsflash::fileflag::bookmarked, false);
+        BOOST_REQUIRE(i.columns(2).test(i.row(2), newsflash::fileflag::bookmarked));
+        i.sort(index::sorting::sort_by_bookmarked, index::sortdir::ascending);
+        BOOST_REQUIRE(i[2] == catalog[0][0]);
+        i.sort(index::sorting::sort_by_bookmarked, index::sortdir::descending);
+        BOOST_REQUIRE(i[0] == catalog[0][0]);
+
+        delete_file("index0.col");
+        delete_file("index1.col");
+    }
+
+
+    // test sorting on the sort keys with enough items for the radix sort 
+    // and with the subjects sharing a prefix longer than the key.
+    {
+        using index   = newsflash::index<storage>;
+        using article = newsflash::article<storage>;
+
+        std::vector<article> articles(500);
+        for (std::size_t x=0; x<articles.size(); ++x)
+        {
+            const auto n = (x * 7919) % articles.size();
+            auto& a = articles[x];
+            a.set_subject(("[#scnzb@efnet] file " + std::to_string(n % 97) + ".rar").c_str());
+            a.set_author(n % 3 ? "foo@bar.com" : "foo@bar");
+            a.set_bytes((n * 104729) % 100000);
+            a.set_pubdate((std::time_t)(n % 251) - 100);
+            a.set_bits(newsflash::fileflag::broken, n % 5 == 0);
+        }
+
+        index i;
+        i.on_load = [&](std::size_t key, std::size_t index) {
+            BOOST_REQUIRE(key == 0);
+            BOOST_REQUIRE(index < articles.size());
+            return articles[index];
+        };
+        i.on_filter = [](const article& a) {
+            return a.bytes() % 2 == 0;
+        };
+
+        for (std::size_t x=0; x<articles.size() - 50; ++x)
+            i.insert(articles[x], 0, x);
+
+        auto check = [&](std::function<bool (const article&, const article&)> less) {
+            for (std::size_t x=1; x<i.size(); ++x)
+                BOOST_REQUIRE(!less(i[x], i[x-1]));
+        };
+        auto by_date = [](const article& a, const article& b) {
+            return a.pubdate() < b.pubdate();
+        };
+        auto by_size = [](const article& a, const article& b) {
+            return a.bytes() < b.bytes();
+        };
+        auto by_subject = [](const article& a, const article& b) {
+            return a.subject() < b.subject();
+        };
+        auto by_author = [](const article& a, const article& b) {
+            return a.author() < b.author();
+        };
+        auto by_broken = [](const article& a, const article& b) {
+            return a.test(newsflash::fileflag::broken) < b.test(newsflash::fileflag::broken);
+        };
+        auto reverse = [](std::function<bool (const article&, const article&)> less) {
+            return [=](const article& a, const article& b) {
+                return less(b, a);
+            };
+        };
+        check(by_date);
+
+        i.sort(index::sorting::sort_by_size, index::sortdir::ascending);
+        check(by_size);
+        i.sort(index::sorting::sort_by_subject, index::sortdir::ascending);
+        check(by_subject);
+        i.sort(index::sorting::sort_by_author, index::sortdir::descending);
+        check(reverse(by_author));
+        i.sort(index::sorting::sort_by_broken, index::sortdir::descending);
+        check(reverse(by_broken));
+        i.sort(index::sorting::sort_by_date, index::sortdir::descending);
+        check(reverse(by_date));
+        i.sort(index::sorting::sort_by_subject, index::sortdir::descending);
+        check(reverse(by_subject));
+
+        // the keys are kept for the new items
+        for (std::size_t x=articles.size() - 50; x<articles.size(); ++x)
+            i.insert(articles[x], 0, x);
+        check(reverse(by_subject));
+        BOOST_REQUIRE(i.real_size() == articles.size());
+
+        i.on_filter = [](const article& a) {
+            return a.bytes() % 3 == 0;
+        };
+        i.filter();
+        check(reverse(by_subject));
+        i.sort(index::sorting::sort_by_size, index::sortdir::ascending);
+        check(by_size);
+    }
+
+
+    // test filtering in batches with multiple threads.
+    {
+        using index   = newsflash::index<storage>;
+        using article = newsflash::article<storage>;
+
+        std::vector<article> articles(200000);
+        for (std::size_t x=0; x<articles.size(); ++x)
+        {
+            articles[x].set_bytes((x * 7919) % articles.size());
+            articles[x].set_pubdate(x);
+        }
+
+        std::size_t modulo = 1;
+
+        auto count = [&](std::size_t num_articles) {
+            std::size_t ret = 0;
+            for (std::size_t x=0; x<num_articles; ++x)
+                ret += articles[x].bytes() % modulo == 0;
+            return ret;
+        };
+
+        index i;
+        i.on_load = [&](std::size_t key, std::size_t index) {
+            return articles[index];
+        };
+        i.on_filter = [&](const article& a) {
+            return a.bytes() % modulo == 0;
+        };
+        i.set_filter_threads(4);
+        for (std::size_t x=0; x<articles.size() - 1000; ++x)
+            i.insert(articles[x], 0, x);
+        i.sort(index::sorting::sort_by_size, index::sortdir::ascending);
+
+        modulo = 3;
+        i.filter();
+        BOOST_REQUIRE(!i.is_filtering());
+        BOOST_REQUIRE(i.size() == count(articles.size() - 1000));
+        for (std::size_t x=1; x<i.size(); ++x)
+            BOOST_REQUIRE(i[x].bytes() > i[x-1].bytes());
+
+        // start the filtering over in the middle.
+        modulo = 5;
+        i.filter_begin();
+        BOOST_REQUIRE(!i.filter_next(50000));
+        BOOST_REQUIRE(i.filter_progress() == 50000);
+        modulo = 2;
+        i.filter_begin();
+        BOOST_REQUIRE(i.filter_progress() == 0);
+        BOOST_REQUIRE(!i.filter_next(50000));
+
+        // the new items are filtered when inserted while the
+        // filtering is in progress. the items that were already in
+        // the index stay as they were until the filter is applied.
+        modulo = 3;
+        const auto shown = count(articles.size() - 1000);
+        modulo = 2;
+        const auto shown_new = count(articles.size()) - count(articles.size() - 1000);
+        for (std::size_t x=articles.size() - 1000; x<articles.size(); ++x)
+            i.insert(articles[x], 0, x);
+        BOOST_REQUIRE(i.size() == shown + shown_new);
+
+        std::size_t batches = 1;
+        while (!i.filter_next(50000))
+            ++batches;
+        BOOST_REQUIRE(batches == 3);
+        i.filter_apply();
+        BOOST_REQUIRE(!i.is_filtering());
+        BOOST_REQUIRE(i.real_size() == articles.size());
+        BOOST_REQUIRE(i.size() == articles.size() / 2);
+        for (std::size_t x=0; x<i.size(); ++x)
+            BOOST_REQUIRE(i[x].bytes() == x * 2);
+
+        // sorting while filtering starts the filtering over.
+        modulo = 5;
+        i.filter_begin();
+        i.filter_next(50000);
+        i.sort(index::sorting::sort_by_date, index::sortdir::ascending);
+        BOOST_REQUIRE(i.filter_progress() == 0);
+        while (!i.filter_next(50000))
+            ;
+        i.filter_apply();
+        BOOST_REQUIRE(i.size() == articles.size() / 5);
+        for (std::size_t x=0; x<i.size(); ++x)
+            BOOST_REQUIRE(i[x].bytes() % 5 == 0);
+        for (std::size_t x=1; x<i.size(); ++x)
+            BOOST_REQUIRE(i[x].pubdate() > i[x-1].pubdate());
+    }
+
     return 0;
 }
\ No newline at end of file
@@ -772,6 +772,17 @@ void test_hash()
     BOOST_REQUIRE(nntp::hashvalue("foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (3/10)") ==
         nntp::hashvalue("foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (10/10)"));
 
+    // the fingerprint matches when strcmp matches.
+    BOOST_REQUIRE(nntp::fingerprint("foobar") == nntp::fingerprint("foobar"));
+    BOOST_REQUIRE(nntp::fingerprint("foobar") != nntp::fingerprint("foobaz"));
+    BOOST_REQUIRE(nntp::fingerprint("foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (3/10)") ==
+        nntp::fingerprint("foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (10/10)"));
+    BOOST_REQUIRE(nntp::fingerprint("foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (3/10)") !=
+        nntp::fingerprint("foobar - [03/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (3/10)"));
+    BOOST_REQUIRE(nntp::fingerprint("heres a movie with shitty part notation foobar.avi.001 [04/50]") ==
+        nntp::fingerprint("heres a movie with shitty part notation foobar.avi.001 [10/50]"));
+    BOOST_REQUIRE(nntp::fingerprint("foo (1/2) bar") != nntp::fingerprint("foo  bar"));
+    BOOST_REQUIRE(nntp::fingerprint("foo (1/2) bar") != nntp::fingerprint("foo (1/2)bar"));
 }
 
 std::mutex mutex;
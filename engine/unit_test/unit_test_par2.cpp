@@ -0,0 +1,268 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include "../par2.h"
+#include "../crc32.h"
+
+namespace nf = newsflash;
+
+void put_u64(std::string& out, std::uint64_t value)
+{
+    for (int i=0; i<8; ++i)
+        out.push_back((char)(value >> (i * 8)));
+}
+
+void put_u32(std::string& out, std::uint32_t value)
+{
+    for (int i=0; i<4; ++i)
+        out.push_back((char)(value >> (i * 8)));
+}
+
+// build a packet with a valid header. the packet md5 is left zero
+// since it isn't checked when the slice checksums are read.
+std::string packet(const std::string& setid, const char* type, const std::string& body)
+{
+    std::string ret("PAR2\0PKT", 8);
+    put_u64(ret, 64 + body.size());
+    ret.append(16, '\0');
+    ret.append(setid);
+    ret.append(type, 16);
+    ret.append(body);
+    return ret;
+}
+
+std::string main_packet(const std::string& setid, std::uint64_t slice_size, const std::vector<std::string>& ids)
+{
+    std::string body;
+    put_u64(body, slice_size);
+    put_u32(body, ids.size());
+    for (const auto& id : ids)
+        body.append(id);
+    return packet(setid, std::string("PAR 2.0\0Main\0\0\0\0", 16).c_str(), body);
+}
+
+std::string desc_packet(const std::string& setid, const std::string& id, const std::string& name, std::uint64_t size)
+{
+    std::string body(id);
+    body.append(32, '\0'); // md5 and md5 of the first 16k
+    put_u64(body, size);
+    body.append(name);
+    while (body.size() % 4)
+        body.push_back('\0');
+    return packet(setid, "PAR 2.0\0FileDesc", body);
+}
+
+std::string ifsc_packet(const std::string& setid, const std::string& id, const std::vector<char>& data, std::uint64_t slice_size)
+{
+    std::string body(id);
+    for (std::uint64_t offset=0; offset<data.size(); offset += slice_size)
+    {
+        std::vector<char> slice(slice_size);
+        const auto len = std::min<std::uint64_t>(slice_size, data.size() - offset);
+        std::copy(data.begin() + offset, data.begin() + offset + len, slice.begin());
+        body.append(16, '\0');
+        put_u32(body, nf::crc32(0, slice.data(), slice.size()));
+    }
+    return packet(setid, std::string("PAR 2.0\0IFSC\0\0\0\0", 16).c_str(), body);
+}
+
+std::vector<char> random_data(std::size_t size)
+{
+    std::vector<char> data(size);
+    for (auto& c : data)
+        c = std::rand();
+    return data;
+}
+
+void unit_test_parse()
+{
+    const std::string setid(16, 'S');
+    const std::string other(16, 'O');
+    const std::string id1(16, '1');
+    const std::string id2(16, '2');
+    const std::string id3(16, '3');
+    const auto data1 = random_data(1000);
+    const auto data2 = random_data(256);
+
+    std::string par2;
+    par2.append("garbage!");
+    par2.append(desc_packet(setid, id1, "foo.rar", data1.size()));
+    par2.append(main_packet(setid, 256, {id1, id2, id3}));
+    par2.append(ifsc_packet(setid, id1, data1, 256));
+    par2.append(desc_packet(setid, id2, "bar.rar", data2.size()));
+    par2.append(ifsc_packet(setid, id2, data2, 256));
+    // no checksums for the 3rd file
+    par2.append(desc_packet(setid, id3, "keke.rar", 10));
+    // packet from another set
+    par2.append(ifsc_packet(other, id3, random_data(10), 256));
+    // truncated packet
+    par2.append(desc_packet(setid, id3, "foo.nfo", 10).substr(0, 70));
+
+    nf::par2_set set;
+    BOOST_REQUIRE(nf::parse_par2(par2.data(), par2.size(), set));
+    BOOST_REQUIRE(set.slice_size == 256);
+    BOOST_REQUIRE(set.files.size() == 2);
+
+    const auto* foo = set.find_file("foo.rar");
+    BOOST_REQUIRE(foo);
+    BOOST_REQUIRE(foo->size == 1000);
+    BOOST_REQUIRE(foo->crcs.size() == 4);
+    BOOST_REQUIRE(foo->crcs[0] == nf::crc32(0, data1.data(), 256));
+
+    const auto* bar = set.find_file("bar.rar");
+    BOOST_REQUIRE(bar);
+    BOOST_REQUIRE(bar->crcs.size() == 1);
+    BOOST_REQUIRE(bar->crcs[0] == nf::crc32(0, data2.data(), 256));
+
+    BOOST_REQUIRE(set.find_file("keke.rar") == nullptr);
+
+    // no main packet
+    const auto ifsc = ifsc_packet(setid, id1, data1, 256);
+    BOOST_REQUIRE(!nf::parse_par2(ifsc.data(), ifsc.size(), set));
+    BOOST_REQUIRE(!nf::parse_par2("", 0, set));
+
+    BOOST_REQUIRE(nf::is_main_par2("foo.par2"));
+    BOOST_REQUIRE(nf::is_main_par2("Foo.PAR2"));
+    BOOST_REQUIRE(!nf::is_main_par2("foo.vol00+01.par2"));
+    BOOST_REQUIRE(nf::is_main_par2("Kill.Bill.Vol.1.par2"));
+    BOOST_REQUIRE(nf::is_main_par2("Show.Vol.2.PAR2"));
+    BOOST_REQUIRE(nf::is_main_par2("Show.Volume.2.par2"));
+    BOOST_REQUIRE(!nf::is_main_par2("Kill.Bill.Vol.1.vol03+04.par2"));
+    BOOST_REQUIRE(!nf::is_main_par2("foo.rar"));
+    BOOST_REQUIRE(!nf::is_main_par2("par2"));
+
+    std::uint32_t blocks = 0;
+    BOOST_REQUIRE(nf::is_par2_volume("foo.vol07+08.par2", blocks) && blocks == 8);
+    BOOST_REQUIRE(nf::is_par2_volume("foo.bar.VOL000+128.PAR2", blocks) && blocks == 128);
+    BOOST_REQUIRE(nf::is_par2_volume("foo.vol00-01.par2", blocks) && blocks == 1);
+    BOOST_REQUIRE(!nf::is_par2_volume("foo.par2", blocks));
+    BOOST_REQUIRE(!nf::is_par2_volume("Kill.Bill.Vol.1.par2", blocks));
+    BOOST_REQUIRE(nf::is_par2_volume("Kill.Bill.Vol.1.vol03+04.par2", blocks) && blocks == 4);
+    BOOST_REQUIRE(!nf::is_par2_volume("foo.vol07+.par2", blocks));
+    BOOST_REQUIRE(!nf::is_par2_volume("foo.vol+08.par2", blocks));
+    BOOST_REQUIRE(!nf::is_par2_volume("foo.vol07+08.rar", blocks));
+}
+
+void unit_test_verify()
+{
+    const std::string setid(16, 'S');
+    const std::string id(16, 'F');
+    const std::uint64_t slice = 1024;
+
+    for (int i=0; i<100; ++i)
+    {
+        const auto data = random_data(1 + std::rand() % 10000);
+
+        std::string par2;
+        par2.append(main_packet(setid, slice, {id}));
+        par2.append(desc_packet(setid, id, "file", data.size()));
+        par2.append(ifsc_packet(setid, id, data, slice));
+
+        nf::par2_set set;
+        BOOST_REQUIRE(nf::parse_par2(par2.data(), par2.size(), set));
+        BOOST_REQUIRE(set.files.size() == 1);
+
+        // split into parts and write them in random order
+        std::vector<std::pair<std::size_t, std::size_t>> parts;
+        for (std::size_t offset=0; offset<data.size(); )
+        {
+            const auto len = std::min<std::size_t>(1 + std::rand() % 3000, data.size() - offset);
+            parts.push_back(std::make_pair(offset, len));
+            offset += len;
+        }
+        std::random_shuffle(parts.begin(), parts.end());
+
+        // intact
+        {
+            nf::par2_verifier verifier(set.slice_size, set.files[0]);
+            for (const auto& p : parts)
+            {
+                BOOST_REQUIRE(!verifier.is_verified());
+                verifier.write(p.first, &data[p.first], p.second);
+            }
+            BOOST_REQUIRE(verifier.is_verified());
+            BOOST_REQUIRE(verifier.damaged_slices().empty());
+        }
+
+        // one byte damaged
+        {
+            auto copy = data;
+            const auto pos = std::rand() % copy.size();
+            copy[pos] ^= 0x1;
+
+            nf::par2_verifier verifier(set.slice_size, set.files[0]);
+            for (const auto& p : parts)
+                verifier.write(p.first, &copy[p.first], p.second);
+
+            const auto damaged = verifier.damaged_slices();
+            BOOST_REQUIRE(!verifier.is_verified());
+            BOOST_REQUIRE(damaged.size() == 1);
+            BOOST_REQUIRE(damaged[0] == pos / slice);
+        }
+
+        // missing part
+        if (parts.size() > 1)
+        {
+            nf::par2_verifier verifier(set.slice_size, set.files[0]);
+            for (std::size_t j=1; j<parts.size(); ++j)
+                verifier.write(parts[j].first, &data[parts[j].first], parts[j].second);
+
+            const auto first = parts[0].first / slice;
+            const auto last  = (parts[0].first + parts[0].second - 1) / slice;
+            const auto damaged = verifier.damaged_slices();
+            BOOST_REQUIRE(!verifier.is_verified());
+            BOOST_REQUIRE(damaged.size() == last - first + 1);
+            BOOST_REQUIRE(damaged[0] == first);
+        }
+    }
+
+    // content past the end of the file
+    {
+        const auto data = random_data(100);
+        std::string par2;
+        par2.append(main_packet(setid, slice, {id}));
+        par2.append(desc_packet(setid, id, "file", 50));
+        par2.append(ifsc_packet(setid, id, std::vector<char>(data.begin(), data.begin() + 50), slice));
+
+        nf::par2_set set;
+        BOOST_REQUIRE(nf::parse_par2(par2.data(), par2.size(), set));
+
+        nf::par2_verifier verifier(set.slice_size, set.files[0]);
+        verifier.write(0, &data[0], data.size());
+        BOOST_REQUIRE(!verifier.is_verified());
+    }
+}
+
+int test_main(int, char*[])
+{
+    unit_test_parse();
+    unit_test_verify();
+    return 0;
+}
@@ -0,0 +1,137 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+#include <newsflash/config.h>
+
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <algorithm>
+#include <chrono>
+#include "../pipeline_controller.h"
+
+namespace nf = newsflash;
+
+using us = std::chrono::microseconds;
+
+// simulate a link with the given bandwidth (bytes per second) and 
+// round trip time (microseconds) and feed the controller with what
+// it would measure when downloading responses of the given size.
+void simulate(nf::pipeline_controller& control, double bandwidth, double rtt, double size, int cmdlists)
+{
+    for (int i=0; i<cmdlists; ++i)
+    {
+        control.sample_rtt(us((long long)rtt));
+
+        for (std::size_t j=0; j<control.batch_size(); ++j)
+        {
+            // with d commands in flight the responses come at most at the link 
+            // bandwidth and at least d responses per round trip + transfer time.
+            const double d        = control.depth();
+            const double transfer = size / bandwidth * 1000000.0;
+            const double interval = std::max(transfer, (rtt + transfer) / d);
+            control.sample_response((std::size_t)size, us((long long)interval));
+        }
+    }
+}
+
+void unit_test_initial()
+{
+    nf::pipeline_controller control;
+    BOOST_REQUIRE(control.depth() == nf::pipeline_controller::initial_depth);
+    BOOST_REQUIRE(control.batch_size() == nf::pipeline_controller::initial_batch);
+
+    // no decisions before there's both a round trip and a response.
+    control.sample_rtt(us(1000));
+    BOOST_REQUIRE(control.depth() == nf::pipeline_controller::initial_depth);
+    control.sample_response(0, us(1000));
+    BOOST_REQUIRE(control.depth() == nf::pipeline_controller::initial_depth);
+}
+
+void unit_test_high_latency()
+{
+    // 150ms, 10 MB/s and 500 KB articles. the bandwidth-delay product
+    // is 1.5 MB, i.e. 3 articles.
+    nf::pipeline_controller control;
+    simulate(control, 10 * 1024 * 1024, 150000, 500 * 1024, 20);
+
+    BOOST_REQUIRE(control.depth() >= 4);
+    BOOST_REQUIRE(control.depth() <= 10);
+    BOOST_REQUIRE(control.throughput() > 9 * 1024 * 1024);
+
+    // 2 seconds is about 40 articles
+    BOOST_REQUIRE(control.batch_size() >= 35);
+    BOOST_REQUIRE(control.batch_size() <= 45);
+}
+
+void unit_test_latency_bound_start()
+{
+    // starting from a depth that is far too shallow the depth
+    // must grow untill the link bandwidth is used.
+    nf::pipeline_controller control;
+    control.sample_rtt(us(300000));
+    control.sample_response(500 * 1024, us(300000));
+    BOOST_REQUIRE(control.depth() <= 3);
+
+    simulate(control, 20 * 1024 * 1024, 300000, 500 * 1024, 20);
+    BOOST_REQUIRE(control.depth() >= 13);
+    BOOST_REQUIRE(control.throughput() > 19 * 1024 * 1024);
+}
+
+void unit_test_low_latency()
+{
+    // local server, the pipeline doesn't need to be deep
+    // but the batch is limited for fairness.
+    nf::pipeline_controller control;
+    simulate(control, 100 * 1024 * 1024, 200, 500 * 1024, 10);
+
+    BOOST_REQUIRE(control.depth() == 2);
+    BOOST_REQUIRE(control.batch_size() == nf::pipeline_controller::max_batch);
+}
+
+void unit_test_slow_link()
+{
+    // throttled connection, a single article takes seconds. 
+    nf::pipeline_controller control;
+    simulate(control, 100 * 1024, 50000, 500 * 1024, 5);
+
+    BOOST_REQUIRE(control.depth() == 2);
+    BOOST_REQUIRE(control.batch_size() == 4);
+}
+
+void unit_test_limits()
+{
+    // huge bandwidth-delay product
+    nf::pipeline_controller control;
+    simulate(control, 1000 * 1024 * 1024, 500000, 10 * 1024, 5);
+
+    BOOST_REQUIRE(control.depth() == nf::pipeline_controller::max_depth);
+    BOOST_REQUIRE(control.batch_size() == nf::pipeline_controller::max_batch);
+}
+
+int test_main(int, char*[])
+{
+    unit_test_initial();
+    unit_test_high_latency();
+    unit_test_latency_bound_start();
+    unit_test_low_latency();
+    unit_test_slow_link();
+    unit_test_limits();
+    return 0;
+}
@@ -0,0 +1,286 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft
+//
+// http://www.ensisoft.com
+//
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <boost/test/minimal.hpp>
+#include <condition_variable>
+#include <functional>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <vector>
+#if defined(LINUX_OS)
+#  include <sys/socket.h>
+#  include <unistd.h>
+#endif
+#include "../reactor.h"
+#include "../action.h"
+#include "../event.h"
+
+// the reactor is only implemented for linux.
+#if defined(LINUX_OS)
+
+namespace nf = newsflash;
+
+// operation that is driven by a callback. the callback returns true
+// when the operation is complete and otherwise sets the wait.
+struct operation : public nf::action, public nf::reactor::operation
+{
+public:
+    std::function<bool (nf::reactor::wait&)> step;
+    int steps;
+
+    operation() : steps(0), complete_(false), nonblocking_(false)
+    {
+        wait_.socket  = false;
+        wait_.event   = false;
+        wait_.timeout = std::chrono::milliseconds(0);
+    }
+
+    virtual void set_nonblocking(bool on_off) override
+    { nonblocking_ = on_off; }
+
+    virtual bool is_complete() const override
+    { return complete_; }
+
+    virtual nf::reactor::wait get_wait() const override
+    { return wait_; }
+
+    virtual void xperform() override
+    {
+        BOOST_REQUIRE(nonblocking_);
+        ++steps;
+        complete_ = step(wait_);
+    }
+private:
+    nf::reactor::wait wait_;
+    bool complete_;
+    bool nonblocking_;
+};
+
+struct completion {
+    std::mutex mutex;
+    std::condition_variable cond;
+    std::vector<operation*> done;
+
+    void on_complete(nf::action* a)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.push_back(static_cast<operation*>(a));
+        cond.notify_one();
+    }
+
+    void wait(std::size_t count)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (done.size() != count)
+            cond.wait(lock);
+    }
+    void clear()
+    {
+        for (auto* op : done)
+            delete op;
+        done.clear();
+    }
+};
+
+void unit_test_timer()
+{
+    completion c;
+    nf::reactor r(2);
+    r.on_complete = std::bind(&completion::on_complete, &c, std::placeholders::_1);
+
+    // run few steps waiting for the timer in between
+    auto* op = new operation;
+    op->step = [=](nf::reactor::wait& w) {
+        w.socket  = false;
+        w.event   = false;
+        w.timeout = std::chrono::milliseconds(10);
+        return op->steps == 3;
+    };
+
+    const auto start = std::chrono::steady_clock::now();
+    r.submit(op);
+    c.wait(1);
+    const auto time = std::chrono::steady_clock::now() - start;
+
+    BOOST_REQUIRE(c.done[0] == op);
+    BOOST_REQUIRE(op->steps == 3);
+    BOOST_REQUIRE(time >= std::chrono::milliseconds(20));
+    c.clear();
+
+    r.shutdown();
+    BOOST_REQUIRE(r.num_pending_actions() == 0);
+}
+
+void unit_test_event()
+{
+    completion c;
+    nf::reactor r(1);
+    r.on_complete = std::bind(&completion::on_complete, &c, std::placeholders::_1);
+
+    nf::event e;
+
+    auto* op = new operation;
+    op->step = [&](nf::reactor::wait& w) {
+        if (e.is_set())
+            return true;
+        w.event   = true;
+        w.event_handle = e.wait().native_handle();
+        w.timeout = std::chrono::milliseconds(0);
+        return false;
+    };
+    r.submit(op);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    BOOST_REQUIRE(r.num_pending_actions() == 1);
+    BOOST_REQUIRE(op->steps == 1);
+
+    e.set();
+    c.wait(1);
+    BOOST_REQUIRE(op->steps == 2);
+    c.clear();
+}
+
+void unit_test_socket()
+{
+    completion c;
+    nf::reactor r(2);
+    r.on_complete = std::bind(&completion::on_complete, &c, std::placeholders::_1);
+
+    int fds[2];
+    BOOST_REQUIRE(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+
+    // read 3 bytes from the socket one at a time.
+    int bytes = 0;
+    auto* op = new operation;
+    op->step = [&](nf::reactor::wait& w) {
+        char c;
+        if (op->steps > 1)
+        {
+            BOOST_REQUIRE(::read(fds[0], &c, 1) == 1);
+            ++bytes;
+        }
+        w.socket = true;
+        w.read   = true;
+        w.write  = false;
+        w.socket_handle = fds[0];
+        w.timeout = std::chrono::milliseconds(0);
+        return bytes == 3;
+    };
+    r.submit(op);
+
+    for (int i=0; i<3; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        BOOST_REQUIRE(::write(fds[1], "x", 1) == 1);
+    }
+    c.wait(1);
+    BOOST_REQUIRE(bytes == 3);
+    BOOST_REQUIRE(op->steps == 4);
+
+    ::close(fds[0]);
+    ::close(fds[1]);
+    c.clear();
+}
+
+void unit_test_owner()
+{
+    completion c;
+    nf::reactor r(2);
+    r.on_complete = std::bind(&completion::on_complete, &c, std::placeholders::_1);
+
+    // operations with the same owner are done one after another
+    // in the submission order, others can run concurrently.
+    std::atomic<int> active[3];
+    for (auto& a : active)
+        a = 0;
+
+    for (int i=0; i<30; ++i)
+    {
+        auto* op = new operation;
+        op->set_owner(i % 3);
+        op->step = [&, op](nf::reactor::wait& w) {
+            auto& flag = active[op->get_owner()];
+            if (op->steps == 1)
+                BOOST_REQUIRE(flag++ == 0);
+            w.socket  = false;
+            w.event   = false;
+            w.timeout = std::chrono::milliseconds(1);
+            if (op->steps < 3)
+                return false;
+            flag--;
+            return true;
+        };
+        r.submit(op);
+    }
+    c.wait(30);
+
+    std::size_t order[3] = {0, 1, 2};
+    for (auto* op : c.done)
+    {
+        const auto owner = op->get_owner();
+        BOOST_REQUIRE(op->get_id() >= order[owner]);
+        order[owner] = op->get_id();
+    }
+    c.clear();
+}
+
+void unit_test_shutdown()
+{
+    completion c;
+    nf::reactor r(2);
+    r.on_complete = std::bind(&completion::on_complete, &c, std::placeholders::_1);
+
+    // pending operations are discarded.
+    nf::event e;
+    for (int i=0; i<5; ++i)
+    {
+        auto* op = new operation;
+        op->set_owner(i);
+        op->step = [&](nf::reactor::wait& w) {
+            w.event = true;
+            w.event_handle = e.wait().native_handle();
+            return false;
+        };
+        r.submit(op);
+    }
+    r.shutdown();
+    BOOST_REQUIRE(c.done.empty());
+}
+
+int test_main(int, char*[])
+{
+    unit_test_timer();
+    unit_test_event();
+    unit_test_socket();
+    unit_test_owner();
+    unit_test_shutdown();
+    return 0;
+}
+
+#else
+
+int test_main(int, char*[])
+{
+    return 0;
+}
+
+#endif
@@ -22,8 +22,12 @@
 #include <newsflash/warnpush.h>
 #  include <boost/test/minimal.hpp>
 #include <newsflash/warnpop.h>
+#include <zlib/zlib.h>
+#include <string>
+#include <iterator>
 #include "../session.h"
 #include "../buffer.h"
+#include "../yenc.h"
 
 namespace nf = newsflash;
 
@@ -343,6 +347,35 @@ void unit_test_retrieve_article()
         BOOST_REQUIRE(!session.pending());
     }
 
+    // pipelining with limited depth
+    {
+        nf::buffer incoming(1024);
+        nf::buffer content(1024);
+
+        output.clear();
+
+        session.set_pipeline_depth(2);
+        session.retrieve_article("1234");
+        session.retrieve_article("2345");
+        session.retrieve_article("3456");
+
+        BOOST_REQUIRE(session.send_next());
+        BOOST_REQUIRE(output == "BODY 1234\r\n/BODY 2345\r\n/");
+        BOOST_REQUIRE(!session.send_next());
+
+        set(incoming, "222 body follows\r\nthis is first content\r\n.\r\n");
+        BOOST_REQUIRE(session.recv_next(incoming, content));
+
+        output.clear();
+        BOOST_REQUIRE(session.send_next());
+        BOOST_REQUIRE(output == "BODY 3456\r\n/");
+
+        set(incoming, "423 no such article with that number\r\n"
+            "423 no such article with that number\r\n");
+        BOOST_REQUIRE(session.recv_next(incoming, content));
+        BOOST_REQUIRE(session.recv_next(incoming, content));
+        BOOST_REQUIRE(!session.pending());
+    }
 }
 
 void unit_test_retrieve_listing()
@@ -375,6 +408,300 @@ void unit_test_retrieve_listing()
         "alt.binaries.bar 2 1 n\r\n.\r\n"));
 }
 
+// a stand-in for a server that serves the XOVER data compressed.
+struct compressing_server {
+    std::string pending;
+
+    static std::string compress(const std::string& data, bool raw)
+    {
+        z_stream z;
+        std::memset(&z, 0, sizeof(z));
+        deflateInit2(&z, Z_BEST_COMPRESSION, Z_DEFLATED, raw ? -MAX_WBITS : MAX_WBITS, 8, Z_DEFAULT_STRATEGY);
+
+        std::string ret;
+        ret.resize(deflateBound(&z, data.size()));
+        z.next_in   = (Bytef*)data.data();
+        z.avail_in  = data.size();
+        z.next_out  = (Bytef*)&ret[0];
+        z.avail_out = ret.size();
+        deflate(&z, Z_FINISH);
+        ret.resize(z.total_out);
+        deflateEnd(&z);
+        return ret;
+    }
+
+    // XOVER response after XFEATURE COMPRESS GZIP
+    void xover_gzip(const std::string& overview)
+    {
+        pending += "224 compressed data follows\r\n";
+        pending += compress(overview, false);
+        pending += ".\r\n";
+    }
+
+    // XZVER response, yEnc encoded raw deflate data.
+    void xzver(const std::string& overview)
+    {
+        const auto& data = compress(overview, true);
+        xzver(overview, "=yend size=" + std::to_string(data.size()) + "\r\n");
+    }
+
+    // XZVER response with the given trailer after the encoded data.
+    void xzver(const std::string& overview, const std::string& trailer)
+    {
+        const auto& data = compress(overview, true);
+        pending += "224 xzver data follows\r\n";
+        pending += "=ybegin line=128 size=" + std::to_string(data.size()) + " name=xzver\r\n";
+        std::string encoded;
+        yenc::encode(data.begin(), data.end(), std::back_inserter(encoded), 128, true);
+        pending += encoded;
+        pending += "\r\n" + trailer;
+        pending += ".\r\n";
+    }
+
+    // send the next max bytes of the responses.
+    void send(nf::buffer& buff, std::size_t max)
+    {
+        const auto bytes = std::min(max, pending.size());
+        if (buff.available() < bytes)
+            buff.allocate(buff.size() + bytes);
+        std::memcpy(buff.back(), pending.data(), bytes);
+        buff.append(bytes);
+        pending.erase(0, bytes);
+    }
+};
+
+std::string make_overview(int first, int last)
+{
+    std::string ret;
+    for (int i=first; i<=last; ++i)
+    {
+        const auto num = std::to_string(i);
+        ret += num + "\tfoobar.mkv yEnc (" + num + "/1000)\tfoo@bar.com\t"
+            "Thu, 18 Jul 2013 07:30:08 +0000\t<" + num + "@news>\t\t396000\t3043\t\r\n";
+    }
+    return ret;
+}
+
+void start_compressed_session(nf::session& session, std::string& output, const char* caps, const char* xfeature)
+{
+    nf::buffer incoming(1024);
+    nf::buffer tmp(1);
+
+    session.enable_compression(true);
+    session.start();
+
+    output.clear();
+    session.send_next();
+    set(incoming, "200 welcome posting allowed\r\n");
+    session.recv_next(incoming, tmp);
+
+    output.clear();
+    session.send_next();
+    BOOST_REQUIRE(output == "CAPABILITIES\r\n");
+    set(incoming, caps);
+    session.recv_next(incoming, tmp);
+
+    output.clear();
+    session.send_next();
+    set(incoming, "200 posting allowed\r\n");
+    session.recv_next(incoming, tmp);
+
+    output.clear();
+    session.send_next();
+    BOOST_REQUIRE(output == "XFEATURE COMPRESS GZIP\r\n");
+    set(incoming, xfeature);
+    session.recv_next(incoming, tmp);
+    BOOST_REQUIRE(!session.pending());
+}
+
+void unit_test_retrieve_headers_compressed()
+{
+    // XFEATURE COMPRESS GZIP is accepted, the XOVER data is deflated.
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output = cmd;
+        };
+        start_compressed_session(session, output, "101 capabilities\r\nXZVER\r\n.\r\n", "290 feature enabled\r\n");
+
+        const auto& overview = make_overview(1, 1000);
+
+        compressing_server server;
+        server.xover_gzip(overview);
+
+        nf::buffer incoming(1024);
+        nf::buffer content;
+        session.retrieve_headers("1-1000");
+        session.send_next();
+        BOOST_REQUIRE(output == "XOVER 1-1000\r\n");
+
+        // the data comes in little by little.
+        while (!session.recv_next(incoming, content))
+            server.send(incoming, 100);
+
+        BOOST_REQUIRE(incoming.size() == 0);
+        BOOST_REQUIRE(content.content_type() == nf::buffer::type::overview);
+        BOOST_REQUIRE(content.content_status() == nf::buffer::status::success);
+        BOOST_REQUIRE(std::string(content.content(), content.content_length()) == overview);
+        BOOST_REQUIRE(!session.pending());
+    }
+
+    // XFEATURE is not supported but the server has XZVER
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output = cmd;
+        };
+        start_compressed_session(session, output, "101 capabilities\r\nXZVER\r\n.\r\n", "500 what?\r\n");
+
+        const auto& overview = make_overview(1, 1000);
+
+        compressing_server server;
+        server.xzver(overview);
+
+        nf::buffer incoming(1024);
+        nf::buffer content;
+        session.retrieve_headers("1-1000");
+        session.send_next();
+        BOOST_REQUIRE(output == "XZVER 1-1000\r\n");
+
+        while (!session.recv_next(incoming, content))
+            server.send(incoming, 77);
+
+        BOOST_REQUIRE(incoming.size() == 0);
+        BOOST_REQUIRE(content.content_status() == nf::buffer::status::success);
+        BOOST_REQUIRE(std::string(content.content(), content.content_length()) == overview);
+    }
+
+    // no compression available, plain XOVER
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output = cmd;
+        };
+        start_compressed_session(session, output, "500 what?\r\n", "500 what?\r\n");
+
+        nf::buffer incoming(1024);
+        nf::buffer content(1024);
+        session.retrieve_headers("1-1000");
+        session.send_next();
+        BOOST_REQUIRE(output == "XOVER 1-1000\r\n");
+    }
+
+    // pipelined XZVER responses arriving in one go and in pieces.
+    for (std::size_t chunk : {std::size_t(1), std::size_t(1000), std::size_t(1024 * 1024)})
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output += cmd;
+        };
+        start_compressed_session(session, output, "101 capabilities\r\nXZVER\r\n.\r\n", "500 what?\r\n");
+        output.clear();
+
+        session.enable_pipelining(true);
+        session.retrieve_headers("1-500");
+        session.retrieve_headers("501-1000");
+        session.retrieve_headers("1001-1100");
+        session.send_next();
+        BOOST_REQUIRE(output == "XZVER 1-500\r\nXZVER 501-1000\r\nXZVER 1001-1100\r\n");
+
+        compressing_server server;
+        server.xzver(make_overview(1, 500));
+        server.xzver(make_overview(501, 1000));
+        server.xzver(make_overview(1001, 1100));
+        server.pending += "423 no such article\r\n";
+
+        nf::buffer incoming(1024);
+        for (int i=0; i<3; ++i)
+        {
+            const int first[] = {1, 501, 1001};
+            const int last[]  = {500, 1000, 1100};
+            nf::buffer content;
+            while (!session.recv_next(incoming, content))
+                server.send(incoming, chunk);
+
+            BOOST_REQUIRE(content.content_status() == nf::buffer::status::success);
+            BOOST_REQUIRE(std::string(content.content(), content.content_length()) == make_overview(first[i], last[i]));
+        }
+        BOOST_REQUIRE(!session.pending());
+        server.send(incoming, 1024);
+        BOOST_REQUIRE(std::string(incoming.head(), incoming.size()) == "423 no such article\r\n");
+    }
+
+    // XZVER data without the =yend line or with a malformed trailer is an 
+    // error but the response is complete at the end of body.
+    const struct {
+        const char* trailer;
+        nf::buffer::status status;
+    } trailers[] = {
+        {"=yend size=1\r\n", nf::buffer::status::success},
+        {"", nf::buffer::status::error},
+        {"=ycrc32=12345678\r\n", nf::buffer::status::error}
+    };
+    for (const auto& t : trailers)
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output += cmd;
+        };
+        start_compressed_session(session, output, "101 capabilities\r\nXZVER\r\n.\r\n", "500 what?\r\n");
+
+        session.enable_pipelining(true);
+        session.retrieve_headers("1-500");
+        session.retrieve_headers("501-1000");
+        session.send_next();
+
+        compressing_server server;
+        server.xzver(make_overview(1, 500), t.trailer);
+        server.xzver(make_overview(501, 1000));
+
+        nf::buffer incoming(1024);
+        nf::buffer content;
+        while (!session.recv_next(incoming, content))
+            server.send(incoming, 100);
+
+        BOOST_REQUIRE(content.content_status() == t.status);
+
+        nf::buffer next;
+        while (!session.recv_next(incoming, next))
+            server.send(incoming, 100);
+        BOOST_REQUIRE(next.content_status() == nf::buffer::status::success);
+        BOOST_REQUIRE(std::string(next.content(), next.content_length()) == make_overview(501, 1000));
+        BOOST_REQUIRE(!session.pending());
+        BOOST_REQUIRE(incoming.size() == 0);
+    }
+
+    // corrupted data is an error but the session stays in sync
+    for (std::size_t chunk : {std::size_t(1), std::size_t(3), std::size_t(10)})
+    {
+        nf::session session;
+        std::string output;
+        session.on_send = [&](const std::string& cmd) {
+            output = cmd;
+        };
+        start_compressed_session(session, output, "101 capabilities\r\n.\r\n", "290 feature enabled\r\n");
+
+        compressing_server server;
+        server.pending = "224 compressed data follows\r\nthis is not deflated\r\n.\r\n423 no such article\r\n";
+
+        nf::buffer incoming(1024);
+        nf::buffer content;
+        session.retrieve_headers("1-1000");
+        session.send_next();
+        while (!session.recv_next(incoming, content))
+            server.send(incoming, chunk);
+
+        BOOST_REQUIRE(content.content_status() == nf::buffer::status::error);
+        server.send(incoming, 1024);
+        BOOST_REQUIRE(std::string(incoming.head(), incoming.size()) == "423 no such article\r\n");
+    }
+}
+
 int test_main(int, char*[])
 {
     unit_test_init_session_success();
@@ -383,5 +710,6 @@ int test_main(int, char*[])
     unit_test_change_group();
     unit_test_retrieve_article();
     unit_test_retrieve_listing();
+    unit_test_retrieve_headers_compressed();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,482 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#  include <boost/regex.hpp>
+#  include <boost/functional/hash.hpp>
+#  include <boost/spirit/include/classic.hpp>
+#include <newsflash/warnpop.h>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stack>
+#include <cstring>
+#include <cstdlib>
+#include <cctype>
+#include "../subject.h"
+#include "../nntp.h"
+#include "../filetype.h"
+
+namespace nf = newsflash;
+
+// the regular expression based implementation that the subject
+// line analysis used to have. the new implementation must produce
+// exactly the same results. 
+
+const char* REVERSE_FILE_EXTENSION_REGEX = 
+    R"(rar\.|2rap\.|rap\.|ge?pj\.|iva\.|[234]pm\.|ge?pm\.|gnp\.|)" \
+    R"(fig\.|fdp\.|ggo\.|vmw\.|vom\.|osi\.|nib\.|piz\.|vaw\.|amw\.|)" \
+    R"(pmb\.|vfs\.|[0-9][0-9]r\.|ofn\.|euc\.|u3m\.|alf\.|bzn\.|mgo\.|)" \
+    R"([0-9]{3}\.|xvid\.|exe\.|mr\.|a4m\.|bov\.|vkm\.|akm\.|eca\.|mar\.|calf\.|)" \
+    R"([0-9]{1,3}z\.|fdm\.|tad\.|z7\.|caa\.|grn\.|cpm\.|fit\.)"\
+    R"([0-9]{1,3}s\.|ffai\.|fws\.|sdn\.|st\.|3ca\.|rrs\.)" \
+    R"(v4m\.|vlf\.|mhc\.)";
+
+const char* reference_find_part_count(const char* subjectline, std::size_t len, std::size_t& i)
+{
+    const static boost::regex ex("(\\]|\\))[0-9]*/[0-9]*(\\(|\\[)");
+
+    nntp::reverse_c_str_iterator itbeg(subjectline + len - 1);
+    nntp::reverse_c_str_iterator itend(subjectline - 1);
+
+    boost::match_results<nntp::reverse_c_str_iterator> res;
+    if (!regex_search(itbeg, itend, res, ex))
+        return NULL;
+
+    if (res[0].second == itend)
+        return NULL;
+
+    const char* end   = res[0].first.as_ptr();
+    const char* start = res[0].second.as_ptr();
+    ++start;
+    ++end;
+    if (start == subjectline)
+        return NULL;
+
+    i = end - start;
+    return start;
+}
+
+std::pair<bool, nntp::part> reference_parse_part(const char* str, std::size_t len)
+{
+    nntp::part part {0};
+
+    str = reference_find_part_count(str, len, len);
+    if (!str) 
+        return {false, part};
+
+    using namespace boost::spirit::classic;
+    {
+        const auto& ret = parse(str, str+len,
+            (ch_p('(') >> uint_p[assign(part.numerator)] >> 
+             ch_p('/') >> uint_p[assign(part.denominator)] >> ch_p(')')));
+        if (ret.full)
+            return {ret.full, part};
+    }
+    const auto& ret = parse(str, str+len,
+        (ch_p('[') >> uint_p[assign(part.numerator)] >> 
+         ch_p('/') >> uint_p[assign(part.denominator)] >> ch_p(']')));
+    return {ret.full, part};
+}
+
+std::uint32_t reference_hashvalue(const char* subjectline, std::size_t len)
+{
+    std::size_t seed = 0;
+    std::size_t skip = 0;
+    const auto* p = reference_find_part_count(subjectline, len, skip);
+    const auto num = p ? std::size_t(p - subjectline) : len;
+    for (std::size_t i=0; i<num; ++i)
+        boost::hash_combine(seed, subjectline[i]);
+    if (p)
+    {
+        for (std::size_t i=num + skip; i<len; ++i)
+            boost::hash_combine(seed, subjectline[i]);
+    }
+    return std::uint32_t(seed);
+}
+
+bool reference_is_binary_post(const char* str, std::size_t len)
+{
+    const static boost::regex filename(REVERSE_FILE_EXTENSION_REGEX, boost::regbase::icase | boost::regbase::perl);
+    const static boost::regex yenc("yEnc *\\([0-9]*/[0-9]*\\)");
+    const static boost::regex part("\\([0-9]*/[0-9]*\\)|yEnc");
+
+    const char* start = str + len - 1;
+    const char* end   = nullptr;
+    while (true)
+    {
+        nntp::reverse_c_str_iterator itbeg(start);
+        nntp::reverse_c_str_iterator itend(str - 1);
+        
+        boost::match_results<nntp::reverse_c_str_iterator> res;
+        if (!regex_search(itbeg, itend, res, filename))
+            return regex_search(str, str+len, yenc);
+
+        end   = res[0].first.as_ptr();
+        start = res[0].second.as_ptr();
+        ++start;
+        ++end;
+
+        if (start == str)
+            return false;
+        if (end == str + len)
+            return true;
+
+        --start;
+        if (*end == '"' || *end == ')')
+            return true;
+        if (*start != ' ' && *end == ' ')
+            return true;
+        if (regex_search(start, str+len, part))
+            return true;
+    }
+    return false;    
+}
+
+std::string reference_find_filename(const char* str, std::size_t len, bool include_extension)
+{
+    using namespace boost::spirit::classic;
+
+    const static boost::regex regex(REVERSE_FILE_EXTENSION_REGEX, boost::regbase::icase | boost::regbase::perl);
+    const static boost::regex mk1("File [0-9]* of [0-9]*");
+    const static boost::regex mk2("(\\(|\\[)[0-9]*/[0-9]*(\\)|\\])");
+
+    {
+        std::string yenc_name;
+        const auto ret = parse(str, str + len,
+            (*(anychar_p - '"') >> str_p("\"") >> (*(anychar_p - '"'))[assign(yenc_name)] >> str_p("\" yEnc")));
+        if (ret.hit && include_extension)
+            return yenc_name;
+    }
+
+    nntp::reverse_c_str_iterator itbeg(str + len - 1);
+    nntp::reverse_c_str_iterator itend(str - 1);
+
+    boost::match_results<nntp::reverse_c_str_iterator> res;
+    if (!regex_search(itbeg, itend, res, regex))
+        return "";
+
+    const char* ext   = res[0].first.as_ptr(); 
+    const char* start = res[0].second.as_ptr();
+    if (start < str)
+        ++start;
+
+    const char* dot = ext;
+    while (*dot != '.')
+    {
+        if (--dot < start)
+            return "";
+    }
+    if (dot == start)
+        return "";
+    if (dot[-1] == ' ')
+        return "";
+
+    const auto ext_len = ext - dot;
+
+    char start_marker = 0;
+    if (++ext < str + len)
+    {
+        if (*ext == '"')
+            start_marker = '"';
+        else if (*ext == ')')
+            start_marker = '(';
+        else if (*ext == ']')
+            start_marker = '[';
+    }
+
+    if (start_marker)
+    {
+        while (*start != start_marker && start > str)
+            --start;
+        if (*start == start_marker)
+            ++start;
+        while (std::isspace((unsigned char)*start) && start < dot)
+            ++start;
+    }
+    else
+    {
+        {
+            boost::match_results<const char*> res;
+            if (regex_search(str, dot, res, mk1) ||
+                regex_search(str, dot, res, mk2))
+                str = res[0].second;
+        }
+
+        struct name_pred {
+            name_pred(bool parity) : prev_(0), dash_(false), good_(true), parity_(parity)
+            {}
+            bool is_allowed(int c)
+            {
+                const auto ret = test(c);
+                prev_ = c;
+                return ret;
+            }
+            bool test(int c)
+            {
+                if (std::isalnum(c))
+                {
+                    if (prev_ == '-')
+                        good_ = true;
+                    return true;
+                }
+                if (c == '_' || c == '.' || c == ' ')
+                    return true;
+                else if (c == '-')
+                {
+                    if (prev_ == ' ' || prev_ == '-')                    
+                    {
+                        if (dash_ == true)
+                            return false;
+                        good_ = false;
+                        dash_ = true;
+                    }
+                    return true;
+                }
+                else if (c == '+')
+                {
+                    if (parity_ && std::isdigit(prev_))
+                        return true;
+                }
+                else if (c == ']' || c == ')' || c == '"')
+                {
+                    good_ = false;
+                    enclosure_.push(c);
+                    return true;
+                }
+                else if (c == '[')
+                    return test_top(']');
+                else if (c == '(')
+                    return test_top(')');
+                return false;
+            }
+            bool test_top(int expected)
+            {
+                if (enclosure_.empty())
+                    return false;
+                auto top = enclosure_.top();
+                enclosure_.pop();
+                good_ = top == expected;
+                return good_;
+            }
+            int prev_;
+            bool dash_;
+            bool good_;
+            bool parity_;
+            std::stack<int> enclosure_;
+        };
+        const bool is_parity = !strncmp(dot, ".PAR2", ext_len) || !strncmp(dot, ".par2", ext_len);
+
+        name_pred pred(is_parity);
+
+        const char* good = start;
+        while (start >= str && pred.is_allowed((unsigned char)*start))
+        {
+            if (pred.good_)
+                good = start;
+            --start;
+        }
+        while ((*good == ' ' || *good == '-') && (good < dot))
+            ++good;
+
+        start = good;
+    }
+
+    if (start == dot)
+        return "";
+    if (include_extension)
+        return std::string(start, ext - start);
+    return std::string(start, dot - start);
+}
+
+nf::filetype reference_find_filetype(const std::string& filename)
+{
+    struct pattern {
+        nf::filetype type;        
+        std::vector<std::string> extensions;
+    } patterns[] = {
+        { nf::filetype::audio, {".mp3", ".mp2", ".wav", ".xm", ".flac", ".m3u", ".pls", ".mpa", ".ogg"} },
+        { nf::filetype::video, {".avi", ".mkv", ".ogm", ".wmv", ".wma", ".mpe?g", ".rm", ".mov", ".flv", ".asf", ".mp4", ".3gp", ".3g2", ".m4v"} },
+        { nf::filetype::image, {".jpe?g", ".bmp", ".png", ".gif"} },
+        { nf::filetype::text,  {".txt", ".nfo", ".sfv", ".log", ".nzb", ".rtf", ".cue"} },
+        { nf::filetype::archive, {".zip", ".rar", ".7z", ".r\\d{1,3}", ".\\d{2}", ".part\\d{1,3}\\.rar"} },
+        { nf::filetype::parity, {".par", ".par2"} },
+        { nf::filetype::document, {".doc", ".chm", ".pdf"} }
+    };
+
+    const auto pos = filename.find_last_of(".");
+    if (pos == std::string::npos)
+        return nf::filetype::other;
+
+    std::string xtension;
+    for (auto c : filename.substr(pos))
+        xtension.push_back(std::tolower(c));
+
+    for (const auto& pattern : patterns)
+    {
+        for (const auto& ext : pattern.extensions)
+        {
+            boost::regex r("\\" + ext, boost::regbase::icase);
+            if (boost::regex_search(xtension.begin(), xtension.end(), r))
+                return pattern.type;
+        }
+    }
+    return nf::filetype::other;
+}
+
+// compare the subject line analysis against the reference implementation.
+void verify(const std::string& str)
+{
+    const char* s = str.c_str();
+    const auto  n = str.size();
+
+    const auto& expected_part = reference_parse_part(s, n);
+    const auto& part = nntp::parse_part(s, n);
+    BOOST_REQUIRE(part.first == expected_part.first);
+    if (part.first)
+    {
+        BOOST_REQUIRE(part.second.numerator == expected_part.second.numerator);
+        BOOST_REQUIRE(part.second.denominator == expected_part.second.denominator);
+    }
+
+    const auto expected_hash    = reference_hashvalue(s, n);
+    const auto expected_binary  = reference_is_binary_post(s, n);
+    const auto expected_name    = reference_find_filename(s, n, true);
+    const auto expected_stem    = reference_find_filename(s, n, false);
+
+    if (nntp::is_binary_post(s, n) != expected_binary ||
+        nntp::find_filename(s, n, true) != expected_name ||
+        nntp::find_filename(s, n, false) != expected_stem)
+    {
+        std::cout << "Subject: " << str << std::endl;
+    }
+
+    BOOST_REQUIRE(nntp::hashvalue(s, n) == expected_hash);
+    BOOST_REQUIRE(nntp::is_binary_post(s, n) == expected_binary);
+    BOOST_REQUIRE(nntp::find_filename(s, n, true) == expected_name);
+    BOOST_REQUIRE(nntp::find_filename(s, n, false) == expected_stem);
+
+    const auto& subject = nntp::analyse_subject(s, n);
+    BOOST_REQUIRE(subject.has_part == expected_part.first);
+    if (subject.has_part)
+    {
+        BOOST_REQUIRE(subject.numerator == expected_part.second.numerator);
+        BOOST_REQUIRE(subject.denominator == expected_part.second.denominator);
+    }
+    BOOST_REQUIRE(subject.hash == expected_hash);
+    BOOST_REQUIRE(subject.fingerprint == nntp::fingerprint(s, n));
+    BOOST_REQUIRE(subject.binary == expected_binary);
+    BOOST_REQUIRE(std::string(subject.filename ? subject.filename : "", subject.filename_len) == expected_name);
+
+    BOOST_REQUIRE(nf::find_filetype(expected_name) == reference_find_filetype(expected_name));
+}
+
+const char* corpus[] = {
+    "foobar.rar",
+    "foobar.r01",
+    "foobar.mp3",
+    "terminator 2 - judgement day.001 enjoy!!",
+    "foobar.z45",
+    "\"Atlantis Rising Magazine #12.pdf\" [11/71] yEnc",
+    "\"foobar.rar [01/20] www.nzb-keke.com\"",
+    "1983 - 39 - Micael Semballo - Maniac .mp3\"The Best of Von 75er",
+    "here is metallica-enter sandman.mp3By superposter!! yEnc (1/10)",
+    "molly123123.jpg(1/1)",
+    "(paska.jpg)(1/1)",
+    "baby brown - CC Soldier .mp3 Beaz in RnB & SouL (02/30)",
+    "schalke(9/9) $ yEnc (70/120)",
+    "foobar yEnc kkeekek",
+    ".NET 2.0 WebResource",
+    "Please post DieHard.4.0:-thx",
+    "Query about GraphicsPath.Flatten() method",
+    ".doc is a microsoft format",
+    "need help with .wmv files",
+    "\"www.nzb-keke.com\"",
+    "NFO Template.txt\"Mastermix-Vol-11-To-Vol-15--www.nzb-dogz.co.uk-- (1/1)",
+    "Darkstar - Heart of Darkstar - File 07 of 10 - Darkstar_Heart of Darkness_07_The Dream (Scene 2).mp3 (01/11)",
+    "[#scnzb@efnet][529762] Automata.2014.BRrip.x264.Ac3-MiLLENiUM [1/4] - \"Automata.2014.BRrip.x264.Ac3-MiLLENiUM.mkv\" yEnc (1/1513)",
+    "Ip.Man.The.Final.Fight.2013.COMPLETE.BluRay-oOo - [1/7] - #34;Ip.Man.The.Final.Fight.2013.COMPLETE.BluRay-oOo.rar#34; yEnc (204/204)",
+    "Katatonia - Live Consternation - 04 Had to (Leave).mp3 Katatonia - Live Consternation Amsterdam [DM-320](16/19)",
+    "(Uncensored) Lovely Hina Otsuka scene 3.wmv.006 yEnc (22/30)",
+    "(Uncensored) black Gal Dance - Sakura Kiryu scene 1.wmv.vol110+110.PAR2 yEnc (01/30)",
+    "foobar (music-file.mp3) bla blah",
+    "foobar [music file.mp3] bla blah",
+    "01-Intro.mp3 (00/11) Paradise Lost yEnc",
+    "   **** 1123nmnlullj.jpg",
+    "\"(03) 03 - ALL HAIL TO THE QUEEN.mp3\" yEnc",
+    "(6/28) nGJ6001.JPG = foobar keke",
+    "\"Chaostage 1995.DAT\"",
+    "[music.mp3 (1/10)]",
+    "blah blah ----image.jpeg----",
+    "[408390]-[FULL]-[#a.b.erotica@EFNet]-[ nvg.15.04.04.corrine ]-[42/55] - \"nvg.15.04.04.corrine.r32\" yEnc (62/66)",
+    "foobar - [02/32] - \"foobar_HD_1920x1080.mp4.001\" yEnc (3/10)",
+    "heres a movie with shitty part notation foobar.avi.001 [04/50]",
+    "girls flirting with is neat   GiBBA files  Soft I Love you to BF-Vol3 (102).jpg (1/4)",
+    "foobar [1/4] \"file.mp3\" yEnc (01/10)",
+    "holiday.s01.tif (1/2)",
+    "show.m4v.srr yEnc (1/1)",
+    "huge part count (99999999999/99999999999)",
+    "mixed brackets foo.avi (1/2]",
+    "(1/2) batch at the start",
+    "",
+    "a",
+    "\"",
+    ".r"
+};
+
+void test_corpus()
+{
+    for (const auto* str : corpus)
+        verify(str);
+}
+
+// generate subject lines from the tokens that the analysis is sensitive to.
+void test_fuzz()
+{
+    const char* tokens[] = {
+        ".rar", ".RAR", ".par2", ".PAR2", ".par", ".jpg", ".jpeg", ".JPG", ".avi", ".mp3", ".mpg", ".mpeg",
+        ".r01", ".001", ".7z", ".z1", ".s12", ".tif", ".m4v", ".srr", ".ts", ".rm", ".flac", ".divx", ".vol01+02",
+        ".doc", ".txt", ".xm",
+        "(", ")", "[", "]", "\"", "/", " ", " ", " ", "-", "--", "+", "_", ".", "#", "$", "=",
+        "0", "1", "12", "123", "4294967295", "4294967296",
+        "(1/2)", "[01/10]", "(/)", "(3/", "/4)", "yEnc", "yEnc ", "\" yEnc", "File ", " of ", "File 1 of 2",
+        "foo", "Bar", "a", "x264", "\xe4", "\t"
+    };
+    const auto num_tokens = sizeof(tokens) / sizeof(tokens[0]);
+
+    std::srand(0xdeadbeef);
+    for (int i=0; i<100000; ++i)
+    {
+        std::string str;
+        const auto count = std::rand() % 12;
+        for (int j=0; j<count; ++j)
+            str += tokens[std::rand() % num_tokens];
+        verify(str);
+    }
+}
+
+int test_main(int, char*[])
+{
+    test_corpus();
+    test_fuzz();
+    return 0;
+}
@@ -0,0 +1,210 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "../text_index.h"
+#include "../filemap.h"
+#include "../bigfile.h"
+#include "unit_test_common.h"
+
+namespace nf = newsflash;
+
+using rowset = nf::text_view::rowset;
+
+// map the index file and run the test with a view to it.
+template<typename Function>
+void with_view(const char* file, Function test)
+{
+    nf::filemap map;
+    map.open(file);
+    nf::text_view view(map.map_ptr(0, map.size()), map.size());
+    test(view);
+}
+
+void unit_test_queries()
+{
+    delete_file("vol.fts");
+
+    const std::vector<std::string> subjects = {
+        "Ubuntu 14.04 LTS Desktop amd64 [01/50] - \"ubuntu-14.04-desktop-amd64.part01.rar\" yEnc (1/100)",
+        "Debian 8.0 netinst i386 - \"debian-8.0.0-i386-netinst.iso\" yEnc (1/20)",
+        "ubuntu server 14.10 i386 - \"ubuntu-14.10-server-i386.iso\" yEnc (1/30)",
+        "Fedora 21 Workstation x86_64 - \"Fedora-Live-Workstation-x86_64-21-5.iso\" yEnc (1/40)",
+        "Some Movie 2014 1080p BluRay x264-GROUP - \"some.movie.2014.1080p.nfo\" yEnc (1/1)",
+        "Some Movie 2014 720p BluRay x264-GROUP - \"some.movie.2014.720p.par2\" yEnc (1/1)",
+        "Äänikirja - \"äänikirja.mp3\" yEnc (1/10)"
+    };
+    {
+        nf::text_index idx;
+        for (std::size_t i=0; i<subjects.size(); ++i)
+            idx.add(std::uint32_t(i), subjects[i]);
+        BOOST_REQUIRE(idx.rows() == subjects.size());
+        idx.save("vol.fts");
+    }
+
+    const auto subject = [&](std::uint32_t row) {
+        return str::string_view(subjects[row].c_str(), subjects[row].size());
+    };
+
+    with_view("vol.fts", [&](const nf::text_view& view) {
+        BOOST_REQUIRE(view.rows() == subjects.size());
+
+        // words
+        BOOST_REQUIRE((view.find_word("ubuntu") == rowset{0, 2}));
+        BOOST_REQUIRE((view.find_word("UBUNTU") == rowset{0, 2}));
+        BOOST_REQUIRE((view.find_word("i386") == rowset{1, 2}));
+        BOOST_REQUIRE((view.find_word("yenc") == rowset{0, 1, 2, 3, 4, 5, 6}));
+        BOOST_REQUIRE((view.find_word("äänikirja") == rowset{6}));
+        BOOST_REQUIRE(view.find_word("ubunt").empty());
+        BOOST_REQUIRE(view.find_word("windows").empty());
+
+        // prefix
+        BOOST_REQUIRE((view.find_prefix("ubunt") == rowset{0, 2}));
+        BOOST_REQUIRE((view.find_prefix("1080") == rowset{4}));
+        BOOST_REQUIRE((view.find_prefix("f") == rowset{3}));
+        BOOST_REQUIRE(view.find_prefix("win").empty());
+
+        // substring candidates
+        rowset rows;
+        BOOST_REQUIRE(view.find_substring("BluRay x264", rows));
+        BOOST_REQUIRE((rows == rowset{4, 5}));
+        BOOST_REQUIRE(view.find_substring("netinst.iso", rows));
+        BOOST_REQUIRE((rows == rowset{1}));
+        BOOST_REQUIRE(view.find_substring("windows", rows));
+        BOOST_REQUIRE(rows.empty());
+        BOOST_REQUIRE(!view.find_substring("x2", rows));
+        BOOST_REQUIRE(!view.find_substring("ää", rows));
+
+        // queries
+        BOOST_REQUIRE((view.query("ubuntu i386") == rowset{2}));
+        BOOST_REQUIRE((view.query("ubuntu OR debian") == rowset{0, 1, 2}));
+        BOOST_REQUIRE((view.query("ubuntu OR debian i386") == rowset{1, 2}));
+        BOOST_REQUIRE((view.query("ubuntu -server") == rowset{0}));
+        BOOST_REQUIRE((view.query("-yenc").empty()));
+        BOOST_REQUIRE((view.query("-ubuntu -debian -fedora") == rowset{4, 5, 6}));
+        BOOST_REQUIRE((view.query("some movie 10*") == rowset{4}));
+        BOOST_REQUIRE((view.query("\"movie 2014\"", subject) == rowset{4, 5}));
+        BOOST_REQUIRE((view.query("\"2014 720p\"", subject) == rowset{5}));
+        BOOST_REQUIRE((view.query("\"x264 bluray\"", subject).empty()));
+        BOOST_REQUIRE((view.query("movie -\"bluray 720p\"", subject) == rowset{4, 5}));
+        BOOST_REQUIRE((view.query("movie -\"720p.par2\"", subject) == rowset{4}));
+        BOOST_REQUIRE((view.query("x264-group", subject) == rowset{4, 5}));
+        BOOST_REQUIRE((view.query("14.04", subject) == rowset{0}));
+        BOOST_REQUIRE((view.query("").size() == subjects.size()));
+    });
+
+    delete_file("vol.fts");
+}
+
+void unit_test_save_load()
+{
+    delete_file("vol.fts");
+
+    // the rows are far apart so that the deltas take more than one byte.
+    const auto subject = [](std::uint32_t row) {
+        return "article " + std::to_string(row % 7) + " part" + std::to_string(row % 3);
+    };
+    {
+        nf::text_index idx;
+        for (std::uint32_t i=0; i<1000; ++i)
+            idx.add(i * 1000, subject(i * 1000));
+        idx.save("vol.fts");
+    }
+
+    // the index is good for a volume that has at least as many rows.
+    {
+        nf::text_index idx;
+        BOOST_REQUIRE(!idx.load("vol.fts", 999 * 1000));
+        BOOST_REQUIRE(idx.rows() == 0);
+        BOOST_REQUIRE(idx.load("vol.fts", 999 * 1000 + 1));
+        BOOST_REQUIRE(idx.rows() == 999 * 1000 + 1);
+        BOOST_REQUIRE(idx.load("vol.fts", 2000000));
+
+        // add more rows to the loaded index
+        for (std::uint32_t i=1000; i<2000; ++i)
+            idx.add(i * 1000, subject(i * 1000));
+        idx.save("vol.fts");
+    }
+
+    with_view("vol.fts", [&](const nf::text_view& view) {
+        BOOST_REQUIRE(view.rows() == 1999 * 1000 + 1);
+
+        rowset expected;
+        for (std::uint32_t i=0; i<2000; ++i)
+        {
+            if ((i * 1000) % 7 == 3)
+                expected.push_back(i * 1000);
+        }
+        BOOST_REQUIRE(view.find_word("3") == expected);
+
+        expected.clear();
+        for (std::uint32_t i=0; i<2000; ++i)
+        {
+            if ((i * 1000) % 7 == 3 && (i * 1000) % 3 == 1)
+                expected.push_back(i * 1000);
+        }
+        BOOST_REQUIRE(view.query("3 part1") == expected);
+        BOOST_REQUIRE(view.find_word("article").size() == 2000);
+    });
+
+    // not an index
+    {
+        std::ofstream out("vol.fts", std::ios::binary | std::ios::trunc);
+        out << "foobar";
+    }
+    {
+        nf::text_index idx;
+        BOOST_REQUIRE(!idx.load("vol.fts", 100));
+    }
+    with_view("vol.fts", [&](const nf::text_view& view) {
+        BOOST_REQUIRE(view.rows() == 0);
+        BOOST_REQUIRE(view.find_word("foobar").empty());
+        BOOST_REQUIRE(view.query("-foobar").empty());
+    });
+
+    // truncated index
+    {
+        nf::text_index idx;
+        for (std::uint32_t i=0; i<100; ++i)
+            idx.add(i, subject(i));
+        idx.save("vol.fts");
+        nf::bigfile::resize("vol.fts", 1000);
+        BOOST_REQUIRE(!idx.load("vol.fts", 100));
+    }
+    with_view("vol.fts", [&](const nf::text_view& view) {
+        BOOST_REQUIRE(view.rows() == 0);
+    });
+
+    BOOST_REQUIRE(!nf::bigfile::exists("vol.fts.tmp"));
+    delete_file("vol.fts");
+}
+
+int test_main(int, char*[])
+{
+    unit_test_queries();
+    unit_test_save_load();
+    return 0;
+}
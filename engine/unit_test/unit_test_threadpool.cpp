@@ -22,6 +22,8 @@
 #include <boost/test/minimal.hpp>
 #include <atomic>
 #include <thread>
+#include <chrono>
+#include <vector>
 #include "../threadpool.h"
 #include "../action.h"
 
@@ -128,10 +130,184 @@ void unit_test_private_thread()
     BOOST_REQUIRE(private_counter == 10000);
 }
 
+// a long running action must not hold up the actions queued after it
+// since the idle workers steal them.
+void unit_test_work_stealing()
+{
+    std::atomic_int counter {0};
+    std::atomic_bool release {false};
+
+    struct blocking_action : public newsflash::action
+    {
+    public:
+        blocking_action(std::atomic_bool& r) : release_(r)
+        {}
+
+        virtual void xperform()
+        {
+            while (!release_)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    private:
+        std::atomic_bool& release_;
+    };
+
+    struct counter_action : public newsflash::action
+    {
+    public:
+        counter_action(std::atomic_int& c) : counter_(c)
+        {}
+
+        virtual void xperform()
+        {
+            counter_++;
+        }
+    private:
+        std::atomic_int& counter_;
+    };
+
+    newsflash::threadpool threads(2);
+    threads.on_complete = [](newsflash::action* a) { delete a; };
+
+    auto* block = new blocking_action(release);
+    block->set_affinity(newsflash::action::affinity::any_thread);
+    threads.submit(block);
+
+    for (int i=0; i<1000; ++i)
+    {
+        auto* a = new counter_action(counter);
+        a->set_affinity(newsflash::action::affinity::any_thread);
+        threads.submit(a);
+    }
+
+    for (int i=0; i<5000 && counter != 1000; ++i)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    BOOST_REQUIRE(counter == 1000);
+    BOOST_REQUIRE(threads.num_pending_actions() == 1);
+
+    release = true;
+    threads.wait_all_actions();
+    threads.shutdown();
+}
+
+// actions with single thread affinity are performed in the
+// submission order for each owner.
+void unit_test_owner_ordering()
+{
+    const int num_owners  = 7;
+    const int num_actions = 2000;
+
+    std::vector<int> sequence(num_owners);
+    std::atomic_int errors {0};
+
+    struct ordered_action : public newsflash::action
+    {
+    public:
+        ordered_action(int& seq, int expected, std::atomic_int& errors) : seq_(seq), expected_(expected), errors_(errors)
+        {}
+
+        virtual void xperform()
+        {
+            if (seq_ != expected_)
+                errors_++;
+            seq_ = expected_ + 1;
+        }
+    private:
+        int& seq_;
+        int expected_;
+        std::atomic_int& errors_;
+    };
+
+    newsflash::threadpool threads(4);
+    threads.on_complete = [](newsflash::action* a) { delete a; };
+
+    for (int i=0; i<num_actions; ++i)
+    {
+        for (int owner=0; owner<num_owners; ++owner)
+        {
+            auto* a = new ordered_action(sequence[owner], i, errors);
+            a->set_affinity(newsflash::action::affinity::single_thread);
+            a->set_owner(owner);
+            threads.submit(a);
+        }
+    }
+    threads.wait_all_actions();
+    threads.shutdown();
+
+    BOOST_REQUIRE(errors == 0);
+    for (int owner=0; owner<num_owners; ++owner)
+        BOOST_REQUIRE(sequence[owner] == num_actions);
+}
+
+// single_thread actions with the same owner but different shards 
+// are spread over the threads, and are still ordered within the shard.
+void unit_test_shard_ordering()
+{
+    const int num_shards  = 4;
+    const int num_actions = 1000;
+
+    std::vector<int> sequence(num_shards);
+    std::vector<std::thread::id> threads_used(num_shards);
+    std::atomic_int errors {0};
+
+    struct ordered_action : public newsflash::action
+    {
+    public:
+        ordered_action(int& seq, int expected, std::thread::id& thread, std::atomic_int& errors) 
+           : seq_(seq), expected_(expected), thread_(thread), errors_(errors)
+        {}
+
+        virtual void xperform()
+        {
+            if (seq_ != expected_)
+                errors_++;
+            if (expected_ == 0)
+                thread_ = std::this_thread::get_id();
+            else if (thread_ != std::this_thread::get_id())
+                errors_++;
+            seq_ = expected_ + 1;
+        }
+    private:
+        int& seq_;
+        int expected_;
+        std::thread::id& thread_;
+        std::atomic_int& errors_;
+    };
+
+    newsflash::threadpool threads(num_shards);
+    threads.on_complete = [](newsflash::action* a) { delete a; };
+
+    for (int i=0; i<num_actions; ++i)
+    {
+        for (int shard=0; shard<num_shards; ++shard)
+        {
+            auto* a = new ordered_action(sequence[shard], i, threads_used[shard], errors);
+            a->set_affinity(newsflash::action::affinity::single_thread);
+            a->set_owner(123);
+            a->set_shard(shard);
+            threads.submit(a);
+        }
+    }
+    threads.wait_all_actions();
+    threads.shutdown();
+
+    BOOST_REQUIRE(errors == 0);
+    for (int shard=0; shard<num_shards; ++shard)
+    {
+        BOOST_REQUIRE(sequence[shard] == num_actions);
+        for (int other=shard+1; other<num_shards; ++other)
+            BOOST_REQUIRE(threads_used[shard] != threads_used[other]);
+    }
+}
+
 int test_main(int, char*[])
 {
     unit_test_pool();
     unit_test_private_thread();
+    unit_test_work_stealing();
+    unit_test_owner_ordering();
+    unit_test_shard_ordering();
 
     return 0;
 }
\ No newline at end of file
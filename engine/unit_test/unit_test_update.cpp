@@ -31,6 +31,8 @@
 #include "../filemap.h"
 #include "../catalog.h"
 #include "../index.h"
+#include "../columns.h"
+#include "../text_index.h"
 #include "../idlist.h"
 #include "unit_test_common.h"
 
@@ -158,6 +160,9 @@ void unit_test_data()
 
     fs::createpath("alt.binaries.test");
     delete_file("alt.binaries.test/vol000000000000000.dat");
+    delete_file("alt.binaries.test/vol000000000000000.idx");
+    delete_file("alt.binaries.test/vol000000000000000.col");
+    delete_file("alt.binaries.test/vol000000000000000.fts");
     delete_file("alt.binaries.test/alt.binaries.test.nfo");
     delete_file("alt.binaries.test/alt.binaries.test.idb");
 
@@ -414,6 +419,25 @@ void unit_test_data()
         BOOST_REQUIRE(a.is_broken());
         BOOST_REQUIRE(idb[a.idbkey() + 2] + a.number() == 102);
 
+        // the columns have the same data in the same order.
+        newsflash::filemap cols;
+        cols.open("alt.binaries.test/vol000000000000000.col");
+        newsflash::column_view view(cols.map_ptr(0, cols.size()), cols.size());
+        BOOST_REQUIRE(view.rows() == 6);
+        BOOST_REQUIRE(view.subject(0) == "Metallica - Enter Sandman yEnc (01/10).mp3");
+        BOOST_REQUIRE(view.author(0) == "ensi@gmail.com");
+        BOOST_REQUIRE(view.bytes(0) == 1024 + 568 + 100);
+        BOOST_REQUIRE(view.num_parts_avail(0) == 3);
+        BOOST_REQUIRE(view.num_parts_total(0) == 10);
+        BOOST_REQUIRE(view.test(0, newsflash::fileflag::broken));
+        BOOST_REQUIRE(view.test(0, newsflash::fileflag::binary));
+        BOOST_REQUIRE(view.slot(0) == db.load(catalog::offset_t(0)).index());
+        BOOST_REQUIRE(view.subject(1) == ".net and COM interoperability");
+        BOOST_REQUIRE(view.bytes(1) == 512);
+        BOOST_REQUIRE(view.test(2, newsflash::fileflag::broken));
+        BOOST_REQUIRE(view.test(3, newsflash::fileflag::broken) == false);
+        BOOST_REQUIRE(view.author(5) == "foo@acme.com");
+        BOOST_REQUIRE(view.pubdate(5) == a.pubdate());
     }
 
     // update with more data
@@ -611,7 +635,42 @@ void unit_test_data()
         BOOST_REQUIRE(a.num_parts_avail() == 1);
         BOOST_REQUIRE(a.is_broken() == false);
         BOOST_REQUIRE(a.bytes() == 2430);
+
+        // the text index has the subject lines of both updates.
+        newsflash::filemap fts;
+        fts.open("alt.binaries.test/vol000000000000000.fts");
+        newsflash::text_view text(fts.map_ptr(0, fts.size()), fts.size());
+        using rowset = newsflash::text_view::rowset;
+        BOOST_REQUIRE(text.rows() == 8);
+        BOOST_REQUIRE((text.query("girls jpg") == rowset{3, 4, 5}));
+        BOOST_REQUIRE((text.query("seinfeld OR metallica") == rowset{0, 2}));
+        BOOST_REQUIRE((text.query("kelli") == rowset{6}));
+        BOOST_REQUIRE((text.query("summer 2015") == rowset{7}));
+    }
+
+    // columns that are missing rows are built again from the volume
+    // and the text index that refers to the old rows is removed.
+    {
+        delete_file("alt.binaries.test/vol000000000000000.col");
+        BOOST_REQUIRE(newsflash::update::build_columns("alt.binaries.test/vol000000000000000.dat"));
+        BOOST_REQUIRE(!boost::filesystem::exists("alt.binaries.test/vol000000000000000.fts"));
+        BOOST_REQUIRE(!newsflash::update::build_columns("alt.binaries.test/vol000000000000000.dat"));
+
+        newsflash::catalog<newsflash::filemap> db;
+        db.open("alt.binaries.test/vol000000000000000.dat");
+        newsflash::filemap cols;
+        cols.open("alt.binaries.test/vol000000000000000.col");
+        newsflash::column_view view(cols.map_ptr(0, cols.size()), cols.size());
+        BOOST_REQUIRE(view.rows() == db.size());
+        BOOST_REQUIRE(view.subject(7) == "summer 2015 - File 63 of 73 - 1000034.jpg (1/1)");
     }
+
+    delete_file("alt.binaries.test/vol000000000000000.dat");
+    delete_file("alt.binaries.test/vol000000000000000.idx");
+    delete_file("alt.binaries.test/vol000000000000000.col");
+    delete_file("alt.binaries.test/vol000000000000000.fts");
+    delete_file("alt.binaries.test/alt.binaries.test.nfo");
+    delete_file("alt.binaries.test/alt.binaries.test.idb");
 }
 
 
@@ -621,7 +680,13 @@ void unit_test_index()
 
     fs::createpath("alt.binaries.test");
     delete_file("alt.binaries.test/vol000000000033653.dat");
+    delete_file("alt.binaries.test/vol000000000033653.idx");
+    delete_file("alt.binaries.test/vol000000000033653.col");
+    delete_file("alt.binaries.test/vol000000000033653.fts");
     delete_file("alt.binaries.test/vol000000000033654.dat");
+    delete_file("alt.binaries.test/vol000000000033654.idx");
+    delete_file("alt.binaries.test/vol000000000033654.col");
+    delete_file("alt.binaries.test/vol000000000033654.fts");
     delete_file("alt.binaries.test/alt.binaries.test.nfo");
     delete_file("alt.binaries.test/alt.binaries.test.idb");
 
@@ -655,11 +720,15 @@ void unit_test_index()
 
         u.complete(*a, actions);
 
-        a = std::move(actions[0]);
-        a->perform();
-        BOOST_REQUIRE(!a->has_exception());
-        actions.clear();
-        u.complete(*a, actions);
+        // the data goes into 2 volumes which are stored separately.
+        BOOST_REQUIRE(actions.size() == 2);
+        auto stores = std::move(actions);
+        for (auto& store : stores)
+        {
+            store->perform();
+            BOOST_REQUIRE(!store->has_exception());
+            u.complete(*store, actions);
+        }
         u.commit();
     }
 
@@ -714,9 +783,16 @@ void unit_test_index()
         }
     }
 
-    delete_file("alt.binaries.test/vol33653.dat");
-    delete_file("alt.binaries.test/vol33654.dat");
-    delete_file("alt.binaries.test.nfo");
+    delete_file("alt.binaries.test/vol000000000033653.dat");
+    delete_file("alt.binaries.test/vol000000000033653.idx");
+    delete_file("alt.binaries.test/vol000000000033653.col");
+    delete_file("alt.binaries.test/vol000000000033653.fts");
+    delete_file("alt.binaries.test/vol000000000033654.dat");
+    delete_file("alt.binaries.test/vol000000000033654.idx");
+    delete_file("alt.binaries.test/vol000000000033654.col");
+    delete_file("alt.binaries.test/vol000000000033654.fts");
+    delete_file("alt.binaries.test/alt.binaries.test.nfo");
+    delete_file("alt.binaries.test/alt.binaries.test.idb");
 }
 
 
@@ -0,0 +1,447 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+#include <newsflash/warnpush.h>
+#  include <boost/test/minimal.hpp>
+#include <newsflash/warnpop.h>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include "../xover.h"
+#include "../article.h"
+#include "../filebuf.h"
+#include "../linebuffer.h"
+#include "../nntp.h"
+#include "../utf8.h"
+#include "../iso_8859_15.h"
+
+namespace nf = newsflash;
+
+using article = nf::article<nf::filebuf>;
+
+const nf::xover_parser::kernel kernels[] = {
+    nf::xover_parser::kernel::scalar, 
+    nf::xover_parser::kernel::sse2, 
+    nf::xover_parser::kernel::avx2
+};
+
+// the header parsed the way article::parse used to parse the line.
+bool reference_parse(const char* line, std::size_t len, nf::xover_header& header)
+{
+    const auto& pair = nntp::parse_overview(line, len);
+    if (!pair.first)
+        return false;
+
+    const auto& data = pair.second;
+    if (data.subject.len == 0 || data.subject.len > 512)
+        return false;
+    if (data.author.len == 0)
+        return false;
+
+    header.has_parts   = false;
+    header.partno      = 0;
+    header.parts_total = 0;
+    const auto& part = nntp::parse_part(data.subject.start, data.subject.len);
+    if (part.first)
+    {
+        if (part.second.numerator > part.second.denominator)
+            return false;
+        header.has_parts   = true;
+        header.partno      = part.second.numerator;
+        header.parts_total = part.second.denominator;
+    }
+    const auto date = nntp::parse_date(data.date.start, data.date.len);
+    if (!date.first)
+        return false;
+
+    std::string subject(data.subject.start, data.subject.len);
+    if (!utf8::is_well_formed(subject.begin(), subject.end()))
+        subject = nf::ISO_8859_15_to_utf8(subject);
+
+    header.subject     = data.subject;
+    header.author      = data.author;
+    header.pubdate     = nntp::timevalue(date.second);
+    header.number      = nntp::to_int<std::uint64_t>(data.number.start, data.number.len);
+    header.bytes       = nntp::to_int<std::uint32_t>(data.bytecount.start, data.bytecount.len);
+    header.hash        = nntp::hashvalue(data.subject.start, data.subject.len);
+    header.fingerprint = nntp::fingerprint(subject);
+    header.binary      = nntp::is_binary_post(data.subject.start, data.subject.len);
+    header.type        = nf::filetype::none;
+    if (header.binary)
+    {
+        const auto& filename = nntp::find_filename(data.subject.start, data.subject.len);
+        if (!filename.empty())
+            header.type = nf::find_filetype(filename);
+    }
+    return true;
+}
+
+bool operator==(const nf::xover_header& lhs, const nf::xover_header& rhs)
+{
+    return lhs.subject.start == rhs.subject.start &&
+           lhs.subject.len   == rhs.subject.len &&
+           lhs.author.start  == rhs.author.start &&
+           lhs.author.len    == rhs.author.len &&
+           lhs.number        == rhs.number &&
+           lhs.fingerprint   == rhs.fingerprint &&
+           lhs.pubdate       == rhs.pubdate &&
+           lhs.bytes         == rhs.bytes &&
+           lhs.hash          == rhs.hash &&
+           lhs.has_parts     == rhs.has_parts &&
+           lhs.partno        == rhs.partno &&
+           lhs.parts_total   == rhs.parts_total &&
+           lhs.binary        == rhs.binary &&
+           lhs.type          == rhs.type;
+}
+
+std::vector<nf::xover_header> reference_parse(const std::string& data)
+{
+    std::vector<nf::xover_header> ret;
+
+    nntp::linebuffer lines(data.data(), data.size());
+    for (auto it = lines.begin(); it != lines.end(); ++it)
+    {
+        nf::xover_header header;
+        if (reference_parse(it->start, it->length, header))
+            ret.push_back(header);
+    }
+    return ret;
+}
+
+std::string random_line()
+{
+    const char* subjects[] = {
+        "Metallica - Enter Sandman.mp3 (01/50)",
+        "[12/34] - \"foobar.part01.rar\" yEnc (13/200)",
+        "(cameltoe clips) [93/98] - \"CAMELTOE  CLIPS 6.vol076+32.PAR2\" yEnc (126/130)",
+        "just some text",
+        "broken part (5/4)",
+        "zero parts (0/0)",
+        "\xe4\xe4li\xf6 latin (1/2)",
+        "utf-8 \xc3\xa4\xc3\xa4li\xc3\xb6 (1/1)",
+        "",
+        "  !!! leading crap"
+    };
+    const char* authors[] = {
+        "foo@bar.com (foo)", "", "\xe4\xe4li\xf6"
+    };
+    const char* dates[] = {
+        "Thu, 26 Jul 2007 19:44:13 -0500",
+        "Wed, 30 Jun 2010 13:24:51 +0000 (UTC)",
+        "Thu, 26 Jul  2007  19:44:13",
+        "29 Jul 2007 11:25:26 GMT",
+        "29  Jul  2007 11:25:26 foobar",
+        "Wednesday, 24 Oct 2008 11:58:50 -0800",
+        "Wednesday, 24 Oct 2008 11:58:50 -0800 (PST)",
+        "Thu, 26 Jul  2007  1944 13",
+        "Tue, 15 Feb 2011 20:45:19 +0100",
+        "Tue, 15 Feb 11 20:45:19 +0130",
+        "Tue, 15 Foo 2011 20:45:19 +0100",
+        "Tue, 15 Feb 2011 25:45:19",
+        "22-4-2007",
+        ""
+    };
+
+    std::string line;
+    switch (std::rand() % 8)
+    {
+        case 0: line += " "; break;
+        case 1: line += "  "; break;
+        default: break;
+    }
+    if (std::rand() % 10)
+        line += std::to_string(std::rand());
+    line += "\t";
+    if (std::rand() % 4 == 0)
+        line += "\x01\x02 ";
+    line += subjects[std::rand() % (sizeof(subjects) / sizeof(subjects[0]))];
+    line += "\t";
+    line += authors[std::rand() % (sizeof(authors) / sizeof(authors[0]))];
+    line += "\t";
+    line += dates[std::rand() % (sizeof(dates) / sizeof(dates[0]))];
+    line += "\t<";
+    line += std::to_string(std::rand());
+    line += "@news.com>\t";
+    if (std::rand() % 2)
+        line += "<references>";
+    line += "\t";
+    line += std::to_string(std::rand() % 1000000);
+    line += "\t";
+    line += std::to_string(std::rand() % 10000);
+    // some of the lines are missing the last tab and are rejected.
+    if (std::rand() % 10)
+        line += "\t";
+    if (std::rand() % 2)
+        line += "Xref: news.com alt.binaries.foo:1234";
+
+    // throw in some long lines for the vector loops.
+    if (std::rand() % 10 == 0)
+        line.insert(line.find('\t') + 1, std::string(std::rand() % 600, 'x'));
+    line += std::rand() % 4 ? "\r\n" : "\n";
+    return line;
+}
+
+/*
+ * Synopsis: Parse XOVER data with each supported kernel and compare to the
+ * headers parsed with the line buffer and the nntp functions.
+ *
+ * Expected: Same headers, the incomplete line at the end is not parsed.
+ */
+void test_parse_buffer()
+{
+    std::srand(std::time(nullptr));
+
+    for (int i=0; i<200; ++i)
+    {
+        std::string data;
+        const auto lines = std::rand() % 50;
+        for (int j=0; j<lines; ++j)
+            data += random_line();
+
+        // cut the data at a random position.
+        const auto len = data.empty() ? 0 : std::rand() % (data.size() + 1);
+        const std::string cut(data, 0, len);
+        const auto& expected = reference_parse(cut);
+        const auto complete  = cut.rfind('\n') == std::string::npos ? 0 : cut.rfind('\n') + 1;
+
+        for (const auto k : kernels)
+        {
+            if (!nf::xover_parser::is_supported(k))
+                continue;
+
+            std::vector<nf::xover_header> headers;
+            nf::xover_parser parser(cut.data(), cut.size(), k);
+            nf::xover_header header;
+            while (parser.next(header))
+                headers.push_back(header);
+
+            BOOST_REQUIRE(headers.size() == expected.size());
+            for (std::size_t h=0; h<headers.size(); ++h)
+                BOOST_REQUIRE(headers[h] == expected[h]);
+            BOOST_REQUIRE(parser.pos() == complete);
+        }
+    }
+}
+
+// returns true if the local time is skipped or repeated when the clocks 
+// are turned. mktime can resolve these either way depending on the
+// previous calls.
+bool is_clock_change(int year, int month, int day, int hour, int minutes)
+{
+    int valid = 0;
+    for (int dst=0; dst<2; ++dst)
+    {
+        struct tm t = {};
+        t.tm_min   = minutes;
+        t.tm_hour  = hour;
+        t.tm_mday  = day;
+        t.tm_mon   = month;
+        t.tm_year  = year - 1900;
+        t.tm_isdst = dst;
+        const auto value = std::mktime(&t);
+        const auto* local = std::localtime(&value);
+        if (local->tm_isdst == dst && local->tm_hour == hour && local->tm_min == minutes)
+            ++valid;
+    }
+    return valid != 1;
+}
+
+/*
+ * Synopsis: Parse the dates through the fast path and compare to nntp::parse_date.
+ *
+ * Expected: The same dates are accepted and the time values are the same.
+ */
+void test_parse_date()
+{
+    const char* dates[] = {
+        "Thu, 26 Jul 2007 19:44:13 -0500",
+        "Thu,26 Jul 2007 19:44:13 -0500",
+        "Thu , 26Jul 2007 19 : 44 : 13 -0500",
+        "Wed, 30 Jun 2010 13:24:51 +0000 (UTC)",
+        "Wed, 30 Jun 2010 13:24:51 +0000 UTC",
+        "Wed, 30 Jun 2010 13:24:51 +0000 (UTC",
+        "Wed, 30 Jun 2010 13:24:51 +0000 UTC)",
+        "Wed, 30 Jun 2010 13:24:51 + 0000",
+        "Wed, 30 Jun 2010 13:24:51 0130",
+        "Wed, 30 Jun 2010 13:24:51 -12345",
+        "Thu, 26 Jul  2007  19:44:13",
+        "Thu, 26 Jul  2007  19:44:13 ",
+        " Thu, 26 Jul  2007  19:44:13",
+        "29 Jul 2007 11:25:26 GMT",
+        "29 Jul 2007 11:25:26 (GMT)",
+        "29  Jul  2007 11:25:26 foobar",
+        "29 jul 2007 11:25:26",
+        "29 JUL 2007 11:25:26",
+        "29 July 2007 11:25:26",
+        "29 Foo 2007 11:25:26",
+        "Wednesday, 24 Oct 2008 11:58:50 -0800",
+        "Wednesday, 24 Oct 2008 11:58:50 -0800 (PST)",
+        ", 24 Oct 2008 11:58:50 -0800",
+        "Thu, 26 Jul  2007  1944 13",
+        "Tue, 15 Feb 11 20:45:19 +0130",
+        "Tue, 15 Feb 2011 25:45:19",
+        "Tue, 15 Feb 2011 20:61:19",
+        "Tue, 31 Feb 2011 20:45:19",
+        "Tue, 0 Feb 2011 20:45:19",
+        "Tue, 123 Feb 2011 20:45:19",
+        "Tue, 15 Feb 12011 20:45:19",
+        "22-4-2007",
+        "foobar"
+    };
+
+    for (const auto* date : dates)
+    {
+        std::string line;
+        line += "1\tsubject\tauthor\t";
+        line += date;
+        line += "\t<id>\t\t100\t10\t\r\n";
+
+        nf::xover_header header;
+        const auto ret = nf::xover_parser::parse_line(line.data(), line.size(), header);
+        const auto& expected = nntp::parse_date(date, std::strlen(date));
+        BOOST_REQUIRE(ret == expected.first);
+        if (ret)
+            BOOST_REQUIRE(header.pubdate == nntp::timevalue(expected.second));
+    }
+
+    // all the hours in a couple of years to go through the local time 
+    // cache and the daylight saving time changes.
+    const char* months[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", 
+        "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+
+    struct expected_date {
+        std::time_t value;
+        bool clock_change;
+    };
+
+    std::string data;
+    std::vector<expected_date> expected;
+    for (int year=2013; year<2015; ++year)
+    {
+        for (int month=0; month<12; ++month)
+        {
+            for (int day=1; day<=31; ++day)
+            {
+                for (int hour=0; hour<24; ++hour)
+                {
+                    const auto minutes = std::rand() % 60;
+                    const auto seconds = std::rand() % 60;
+                    char date[64];
+                    std::sprintf(date, "%d %s %d %02d:%02d:%02d +0200", day, months[month], year, hour, minutes, seconds);
+                    const auto value = nntp::timevalue(nntp::parse_date(date, std::strlen(date)).second);
+                    expected.push_back({value, is_clock_change(year, month, day, hour, minutes)});
+
+                    data += "1\tsubject\tauthor\t";
+                    data += date;
+                    data += "\t<id>\t\t100\t10\t\r\n";
+                }
+            }
+        }
+    }
+
+    nf::xover_parser parser(data.data(), data.size());
+    nf::xover_header header;
+    for (const auto& date : expected)
+    {
+        BOOST_REQUIRE(parser.next(header));
+        BOOST_REQUIRE(header.pubdate == date.value || date.clock_change);
+    }
+    BOOST_REQUIRE(!parser.next(header));
+}
+
+/*
+ * Synopsis: Setup an article from the parsed header.
+ *
+ * Expected: The article has the data from the overview line.
+ */
+void test_article()
+{
+    {
+        const char* str = "25534\t(cameltoe clips) [93/98] - \"CAMELTOE  CLIPS 6.vol076+32.PAR2\" yEnc (126/130)\tlekkrstrak@hotmail.com (cameltoelover)\tTue, 15 Feb 2011 20:45:19 +0100\t<6d263$4d5ad7cf$d979c5b1$19427@news.lightningusenet.com>\t\t931\t3052\tXref: news-big.astraweb.com alt.binaries.pictures.cameltoes:25534\r\n";
+
+        nf::xover_header header;
+        BOOST_REQUIRE(nf::xover_parser::parse_line(str, std::strlen(str), header));
+        BOOST_REQUIRE(header.number == 25534);
+        BOOST_REQUIRE(header.bytes == 931);
+        BOOST_REQUIRE(header.has_parts);
+        BOOST_REQUIRE(header.partno == 126);
+        BOOST_REQUIRE(header.parts_total == 130);
+
+        article a;
+        a.parse(header);
+        BOOST_REQUIRE(a.subject() == "(cameltoe clips) [93/98] - \"CAMELTOE  CLIPS 6.vol076+32.PAR2\" yEnc (126/130)");
+        BOOST_REQUIRE(a.author() == "lekkrstrak@hotmail.com (cameltoelover)");
+        BOOST_REQUIRE(a.number() == 25534);
+        BOOST_REQUIRE(a.bytes() == 931);
+        BOOST_REQUIRE(a.partno() == 126);
+        BOOST_REQUIRE(a.num_parts_total() == 130);
+        BOOST_REQUIRE(a.num_parts_avail() == 1);
+        BOOST_REQUIRE(a.test(nf::fileflag::binary));
+        BOOST_REQUIRE(a.test(nf::fileflag::broken));
+        BOOST_REQUIRE(a.test(nf::fileflag::enable_utf8));
+        BOOST_REQUIRE(a.type() == nf::filetype::parity);
+        BOOST_REQUIRE(a.hash() == nntp::hashvalue(a.subject()));
+
+        article b;
+        BOOST_REQUIRE(b.parse(str, std::strlen(str)));
+        BOOST_REQUIRE(b.subject() == a.subject());
+        BOOST_REQUIRE(b.pubdate() == a.pubdate());
+    }
+
+    // latin subject and author are converted to utf-8
+    {
+        const char* str = "1\t\xe4\xe4li\xf6\t\xe4\xe4li\xf6\t29 Jul 2007 11:25:26 GMT\t<id>\t\t100\t10\t";
+
+        article a;
+        BOOST_REQUIRE(a.parse(str, std::strlen(str)));
+        BOOST_REQUIRE(a.subject() == "\xc3\xa4\xc3\xa4li\xc3\xb6");
+        BOOST_REQUIRE(a.author() == "\xc3\xa4\xc3\xa4li\xc3\xb6");
+        BOOST_REQUIRE(!a.test(nf::fileflag::binary));
+        BOOST_REQUIRE(!a.has_parts());
+    }
+
+    // invalid lines
+    {
+        article a;
+        const char* str = "1\t\tauthor\t29 Jul 2007 11:25:26 GMT\t<id>\t\t100\t10\t";
+        BOOST_REQUIRE(!a.parse(str, std::strlen(str)));
+        str = "1\tsubject\t\t29 Jul 2007 11:25:26 GMT\t<id>\t\t100\t10\t";
+        BOOST_REQUIRE(!a.parse(str, std::strlen(str)));
+        str = "1\tsubject (3/2)\tauthor\t29 Jul 2007 11:25:26 GMT\t<id>\t\t100\t10\t";
+        BOOST_REQUIRE(!a.parse(str, std::strlen(str)));
+        str = "1\tsubject\tauthor\t29-7-2007\t<id>\t\t100\t10\t";
+        BOOST_REQUIRE(!a.parse(str, std::strlen(str)));
+        str = "1\tsubject\tauthor\t29 Jul 2007 11:25:26 GMT\t<id>\t\t100\t10";
+        BOOST_REQUIRE(!a.parse(str, std::strlen(str)));
+        BOOST_REQUIRE(!a.parse(str, 0));
+    }
+}
+
+int test_main(int, char* [])
+{
+    test_parse_buffer();
+    test_parse_date();
+    test_article();
+    return 0;
+}
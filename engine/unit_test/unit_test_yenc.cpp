@@ -19,6 +19,7 @@
 // THE SOFTWARE.
 
 #include <boost/test/minimal.hpp>
+#include <boost/crc.hpp>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -417,6 +418,99 @@ void test_encode_special()
     }
 }
 
+/*
+ * Synopsis: Decode yEnc data with the contiguous buffer decoder using each supported kernel
+ * and compare to the output of the iterator based decoder.
+ *
+ * Expected: Decoded output and the number of bytes consumed match.
+ */
+void test_decode_buffer()
+{
+    const yenc::kernel kernels[] = {
+        yenc::kernel::scalar, yenc::kernel::sse2, yenc::kernel::ssse3, yenc::kernel::avx2
+    };
+
+    auto test = [&](const std::vector<char>& temp, std::size_t start) {
+        nntp::bodyiter beg(&temp[0], start, temp.size());
+        nntp::bodyiter end(&temp[0] + temp.size(), 0);
+
+        std::vector<char> ref;
+        yenc::decode(beg, end, std::back_inserter(ref));
+
+        for (const auto k : kernels)
+        {
+            if (!yenc::is_supported(k))
+                continue;
+
+            std::vector<char> out;
+            out.resize(temp.size() - start);
+            const auto ret = yenc::decode_buffer(temp.data() + start, temp.size() - start, out.data(), k);
+            out.resize(ret.written);
+
+            BOOST_REQUIRE(out == ref);
+            BOOST_REQUIRE(start + ret.consumed == beg.position());
+        }
+
+        // decode + crc
+        {
+            boost::crc_32_type crc;
+            crc.process_bytes(ref.data(), ref.size());
+
+            std::vector<char> out;
+            out.resize(temp.size() - start);
+            std::uint32_t value = 0;
+            const auto ret = yenc::decode_buffer(temp.data() + start, temp.size() - start, out.data(), value);
+            out.resize(ret.written);
+
+            BOOST_REQUIRE(out == ref);
+            BOOST_REQUIRE(start + ret.consumed == beg.position());
+            BOOST_REQUIRE(value == crc.checksum());
+        }
+    };
+
+    {
+        std::ifstream src;
+        src.open("test_data/vip.part4.yenc.txt", std::ios::binary);
+        BOOST_REQUIRE(src.is_open());
+
+        std::vector<char> temp;
+        std::copy(std::istreambuf_iterator<char>(src), std::istreambuf_iterator<char>(), std::back_inserter(temp));
+
+        auto it = temp.begin();
+        BOOST_REQUIRE(yenc::parse_header(it, temp.end()).first);
+        BOOST_REQUIRE(yenc::parse_part(it, temp.end()).first);
+        test(temp, std::distance(temp.begin(), it));
+    }
+
+    // random data with dot stuffing, escapes and line breaks
+    // at all the interesting positions.
+    std::srand(std::time(nullptr));
+
+    for (int i=0; i<1000; ++i)
+    {
+        const char alphabet[] = {'.', '.', '=', '\r', '\n', 'a', 'b', '}', 'y'};
+
+        std::vector<char> temp;
+        temp.push_back('=');
+        temp.push_back('y');
+        temp.push_back('\r');
+        temp.push_back('\n');
+        const auto len = std::rand() % 200;
+        for (int j=0; j<len; ++j)
+        {
+            if (std::rand() % 4)
+                temp.push_back(alphabet[std::rand() % sizeof(alphabet)]);
+            else temp.push_back(std::rand());
+        }
+        if (std::rand() % 2)
+        {
+            const std::string footer("\r\n=yend size=1234\r\n");
+            std::copy(footer.begin(), footer.end(), std::back_inserter(temp));
+        }
+        test(temp, 4);
+    }
+}
+
 int test_main(int, char* [])
 {
     test_parsing();
@@ -424,5 +518,6 @@ int test_main(int, char* [])
     test_encoding();
     test_decode_encode();
     test_encode_special();
+    test_decode_buffer();
     return 0;
 }
@@ -19,13 +19,13 @@
 // THE SOFTWARE.
 
 #include <newsflash/config.h>
+#include <algorithm>
 #include <limits>
 #include <fstream>
 #include <map>
 #include <set>
 #include <mutex>
 #include "filesys.h"
-#include "linebuffer.h"
 #include "filemap.h"
 #include "filebuf.h"
 #include "update.h"
@@ -36,7 +36,12 @@
 #include "logging.h"
 #include "cmdlist.h"
 #include "catalog.h"
+#include "catalog_index.h"
+#include "columns.h"
+#include "text_index.h"
+#include "xover.h"
 #include "idlist.h"
+#include "bigfile.h"
 #include "filesys.h"
 
 namespace newsflash
@@ -44,20 +49,65 @@ namespace newsflash
 
 using catalog_t   = catalog<filebuf>;
 using article_t   = article<filebuf>;
-using idlist_t = idlist<filebuf>;
+using idlist_t = idlist_writer<filebuf>;
+using columns_t   = columns<filebuf>;
+
+namespace {
+
+// the lock of each volume file that is open for writing. the updates
+// share the lock with update::build_columns so that the columns
+// of a volume are never written by both at the same time.
+std::mutex volume_locks_mutex;
+std::map<std::string, std::weak_ptr<std::mutex>> volume_locks;
+
+std::shared_ptr<std::mutex> volume_lock(const std::string& file)
+{
+    std::string key = file;
+    std::replace(key.begin(), key.end(), '\\', '/');
+
+    std::lock_guard<std::mutex> lock(volume_locks_mutex);
+    auto& weak = volume_locks[key];
+    auto ret = weak.lock();
+    if (!ret)
+    {
+        ret = std::make_shared<std::mutex>();
+        weak = ret;
+    }
+    return ret;
+}
+
+} // namespace
 
 struct update::state {
     std::string folder;
     std::string group;
 
-    // maps a volume index to a file.
-    std::map<std::uint32_t, std::unique_ptr<catalog_t>> files;
-
-    // maps a hash value to a volume index
+    // a catalog volume, its columns, the in memory index of the articles in it
+    // and the text index of the subject lines.
+    // the volume is written by a single store action at a time 
+    // (the stores are sharded by the volume) but commit may run
+    // concurrently with a store.
+    struct volume {
+        std::shared_ptr<std::mutex> mutex;
+        std::unique_ptr<catalog_t> db;
+        std::unique_ptr<columns_t> cols;
+        catalog_index index;
+        text_index text;
+        // the saved index goes stale when the volume is modified again.
+        bool index_saved = false;
+    };
+
+    // maps a volume index to a volume. 
+    // only accessed by the thread that owns the update task.
+    std::map<std::uint32_t, std::unique_ptr<volume>> volumes;
+
+    // maps a hash value to a volume index.
+    // only accessed by the thread that owns the update task.
     std::map<std::uint32_t, std::uint32_t> hashmap;
 
-    // message id db
+    // message id db, shared by all the volumes.
     idlist_t idb;
+    std::mutex idb_mutex;
 
     std::string file_volume_name(std::size_t index)
     {
@@ -75,157 +125,282 @@ struct update::state {
         const auto file = fs::joinpath(base, ss.str());
         return file;
     }
+
+    std::string index_file_name(std::size_t index)
+    {
+        auto file = file_volume_name(index);
+        file.replace(file.size() - 4, 4, ".idx");
+        return file;
+    }
+
+    std::string columns_file_name(std::size_t index)
+    {
+        auto file = file_volume_name(index);
+        file.replace(file.size() - 4, 4, ".col");
+        return file;
+    }
+
+    std::string text_file_name(std::size_t index)
+    {
+        auto file = file_volume_name(index);
+        file.replace(file.size() - 4, 4, ".fts");
+        return file;
+    }
+
+    // open the volume file and load the index of the volume or if 
+    // there's no valid index on the disk build it from the articles
+    // stored in the volume. the columns are rebuilt as well if they
+    // don't have all the articles in the volume and the text index
+    // gets the rows it's missing.
+    void open_volume(std::uint32_t index, volume& vol)
+    {
+        vol.db.reset(new catalog_t);
+        vol.db->open(file_volume_name(index));
+        vol.cols.reset(new columns_t);
+        vol.cols->open(columns_file_name(index));
+
+        auto& db   = *vol.db;
+        auto& cols = *vol.cols;
+        auto& idx  = vol.index;
+        auto& text = vol.text;
+
+        // the columns are written before the volume. if the volume
+        // didn't make it to the disk the extra rows are dropped.
+        const auto rebuild_columns = cols.rows() < db.size();
+        if (cols.rows() > db.size())
+            cols.truncate(db.size());
+
+        // the text index refers to the rows, so when the columns are 
+        // rebuilt so is the text index. the old file must go right away
+        // so that it's never paired with the new rows.
+        if (rebuild_columns)
+            bigfile::erase(text_file_name(index));
+        if (rebuild_columns || !text.load(text_file_name(index), db.size()))
+            text.clear();
+
+        const auto rebuild_index = rebuild_columns || 
+            !idx.load(index_file_name(index), db.size(), db.filebuf::size());
+        if (!rebuild_index && text.rows() == db.size())
+            return;
+
+        if (rebuild_index)
+            idx.clear();
+        if (rebuild_columns)
+            cols.clear();
+
+        // the rows are in the same order as the articles in the volume.
+        std::uint32_t row = 0;
+        for (auto it = db.begin(); it != db.end(); ++it, ++row)
+        {
+            const auto& a = *it;
+            if (rebuild_columns)
+                cols.append(a);
+            if (!rebuild_index && row < text.rows())
+                continue;
+
+            // old data has latin subject lines. the fingerprint and the
+            // text index are always over utf-8 so that they match what
+            // the user types in.
+            const auto& subject = a.is_utf8_enabled()
+                ? a.subject()
+                : ISO_8859_15_to_utf8(a.subject());
+            if (row >= text.rows())
+                text.add(row, subject);
+            if (!rebuild_index)
+                continue;
+
+            const auto fingerprint = nntp::fingerprint(subject);
+            if (idx.find(fingerprint))
+                continue;
+
+            auto& e = idx.insert(fingerprint);
+            e.number      = a.number();
+            e.hash        = a.hash();
+            e.slot        = a.index();
+            e.bytes       = a.bytes();
+            e.idbkey      = a.idbkey();
+            e.parts_avail = a.num_parts_avail();
+            e.parts_total = a.num_parts_total();
+            e.row         = row;
+        }
+        cols.flush();
+    }
 };
 
 // parse NNTP overview data
 class update::parse : public action
 {
 public:
-    parse(std::shared_ptr<state> s, buffer buff) : buffer_(std::move(buff))
+    parse(std::shared_ptr<state> s, buffer buff) : buffer_(std::make_shared<buffer>(std::move(buff)))
     {}
 
     virtual void xperform() override
     {
-        nntp::linebuffer lines(buffer_.content(), buffer_.content_length());
-        auto beg = lines.begin();
-        auto end = lines.end();
-        for (; beg != end; ++beg)
-        {
-            const auto& line = *beg;
-
-            article_t a;
-            if (!a.parse(line.start, line.length))
-                continue;
-
-            articles_.push_back(a);
-        }
+        // the headers refer to the buffer. they're a lot smaller than
+        // the overview lines so this is plenty.
+        headers_.reserve(buffer_->content_length() / 256);
+
+        xover_parser parser(buffer_->content(), buffer_->content_length());
+        xover_header header;
+        while (parser.next(header))
+            headers_.push_back(header);
     }
     virtual std::size_t size() const override
-    { return buffer_.content_length(); }
+    { return buffer_->content_length(); }
 
 	virtual std::string describe() const override
 	{ return "Parse XOVER"; }
 private:
     friend class update;
     std::shared_ptr<state> state_;
-    std::vector<article_t> articles_;
+    std::vector<xover_header> headers_;
 private:
-    buffer buffer_;
+    std::shared_ptr<buffer> buffer_;
 };
 
+// store the articles that go into one volume.
 class update::store : public action
 {
 public:
-    store(std::shared_ptr<state> s) : state_(s), first_(0), last_(0)
+    store(std::shared_ptr<state> s, state::volume* v, std::uint32_t index) 
+        : state_(s), volume_(v), index_(index), first_(0), last_(0)
     {}
 
     virtual void xperform() override
     {
         first_ = std::numeric_limits<decltype(first_)>::max();
 
-        auto& files = state_->files;
-        auto& hmap  = state_->hashmap;
-        auto& idb   = state_->idb;
+        std::lock_guard<std::mutex> lock(*volume_->mutex);
 
-        for (std::size_t i=0; i<articles_.size(); ++i)
+        if (!volume_->db)
+            state_->open_volume(index_, *volume_);
+        if (volume_->index_saved)
         {
-            auto& article = articles_[i];
+            bigfile::erase(state_->index_file_name(index_));
+            volume_->index_saved = false;
+        }
 
-            last_  = std::max(last_, article.number());
-            first_ = std::min(first_, article.number());
+        auto& db   = volume_->db;
+        auto& cols = volume_->cols;
+        auto& idx  = volume_->index;
+        auto& idb = state_->idb;
 
-            auto hit = hmap.find(article.hash());
-            if (hit == std::end(hmap))
-            {
-                const auto index = std::uint32_t(article.number() / CATALOG_SIZE);
-                hit = hmap.insert(std::make_pair(article.hash(), index)).first;
-            }
-            else
+        // the message id db is shared with the stores running for
+        // the other volumes. the new articles allocate their keys
+        // right away but the values are collected and written at the end.
+        std::vector<std::pair<std::size_t, std::int16_t>> ids;
+
+        for (const auto& header : headers_)
+        {
+            const auto fingerprint = header.fingerprint;
+
+            last_  = std::max(last_, header.number);
+            first_ = std::min(first_, header.number);
+
+            // the index tells whether the article belongs to a previously 
+            // stored article, so we only need to go to the disk to write.
+            if (auto* e = idx.find(fingerprint))
             {
-                // if we have a previous hash entry but the datafile
-                // is not to be found, it has propably been purged.
-                // in this case we're just going to ignore the entry and
-                // throw it away.
-                const auto file_index = hit->second;
-                const auto file_name  = state_->file_volume_name(file_index);
-                if (!fs::exists(file_name))
-                {
-                    hmap.erase(hit);
+                if (e->parts_total == 0)
                     continue;
-                }
+
+                const auto max_parts = e->parts_total;
+                const auto num_part  = header.partno;
+                if (max_parts == 1)
+                    continue;
+                if (num_part > max_parts)
+                    continue;
+
+                const auto base = e->number;
+                const auto num  = header.number;
+                std::int16_t diff = 0;
+                if (base > num)
+                    diff -= (std::int16_t)(base - num);
+                else diff = (std::int16_t)(num - base);
+                ids.push_back(std::make_pair(e->idbkey + num_part, diff));
+
+                const auto was_broken = e->parts_avail != e->parts_total;
+
+                e->bytes += header.bytes;
+                e->parts_avail++;
+
+                const auto is_broken = e->parts_avail != e->parts_total;
+
+                article_t a;
+                a.set_bytes(e->bytes);
+                a.set_idbkey(e->idbkey);
+                a.set_parts(e->parts_avail, e->parts_total);
+                a.set_bits(fileflag::broken, is_broken);
+
+                const auto index = catalog_t::index_t(e->slot);
+                db->update_parts(a, index, was_broken != is_broken);
+                cols->update_parts(e->row, a, was_broken != is_broken);
+                continue;
             }
 
-            const auto file_index  = hit->second;
+            // only the new articles need the whole article data.
+            article_t article;
+            article.parse(header);
+
             const auto file_bucket = article.hash() % CATALOG_SIZE;
-            auto it = files.find(file_index);
-            if (it == std::end(files))
-            {
-                std::unique_ptr<catalog_t> db(new catalog_t);
-                db->open(state_->file_volume_name(file_index));
-                it = files.insert(std::make_pair(file_index, std::move(db))).first;
-            }
-            auto& db = it->second;
 
             std::size_t slot;
             for (slot=0; slot<CATALOG_SIZE; ++slot)
             {
                 const auto index = catalog_t::index_t((slot * 3 + file_bucket) % CATALOG_SIZE);
-
                 if (!db->is_empty(index))
+                    continue;
+
+                article.set_index(index.value );
+                // we store one complete 64bit article number for the whole pack
+                // and then for the additional parts we store a 16 bit delta value.
+                // note that while yenc generally uses 1 based part indexing some
+                // posters use 0 based instead. Hence we just add + 1 to cater for
+                // both cases safely.
+                if (article.has_parts())
                 {
-                    auto a = db->load(index);
-                    if (!a.is_match(article))
-                        continue;
-
-                    if (!a.has_parts())
-                        break;
-
-                    const auto max_parts = a.num_parts_total();
-                    const auto num_part  = article.partno();
-                    if (max_parts == 1)
-                        break;
-                    if (num_part > max_parts)
-                        break;
-
-                    const auto base = a.number();
-                    const auto num  = article.number();
-                    std::int16_t diff = 0;
-                    if (base > num)
-                        diff -= (std::int16_t)(base - num);
-                    else diff = (std::int16_t)(num - base);
-                    idb[a.idbkey() + num_part] = diff;
-
-                    a.combine(article);
-                    db->update(a, index);
-                    break;
-                }
-                else
-                {
-                    article.set_index(index.value );
-                    // we store one complete 64bit article number for the whole pack
-                    // and then for the additional parts we store a 16 bit delta value.
-                    // note that while yenc generally uses 1 based part indexing some
-                    // posters use 0 based instead. Hence we just add + 1 to cater for
-                    // both cases safely.
-                    if (article.has_parts())
+                    std::size_t key;
                     {
-                        const auto key = idb.size();
-
-                        article.set_idbkey(key);
-                        idb.resize(idb.size() + article.num_parts_total() + 1);
-                        idb[key + article.partno()] = 0; // 0 difference to the message id stored with the article.
+                        std::lock_guard<std::mutex> lock(state_->idb_mutex);
+                        key = idb.size();
+                        idb.resize(key + article.num_parts_total() + 1);
                     }
-                    db->insert(article, index);
-                    break;
+                    article.set_idbkey(key);
+                    ids.push_back(std::make_pair(key + article.partno(), 0)); // 0 difference to the message id stored with the article.
                 }
+                db->insert(article, index);
+                const auto row = cols->append(article);
+                if (article.is_utf8_enabled())
+                    volume_->text.add(row, article.subject());
+                else volume_->text.add(row, ISO_8859_15_to_utf8(article.subject()));
+
+                auto& e = idx.insert(fingerprint);
+                e.number      = article.number();
+                e.hash        = article.hash();
+                e.slot        = std::uint32_t(index.value);
+                e.bytes       = article.bytes();
+                e.idbkey      = article.idbkey();
+                e.parts_avail = article.num_parts_avail();
+                e.parts_total = article.num_parts_total();
+                e.row         = row;
+                break;
             }
             if (slot == CATALOG_SIZE)
                 throw std::runtime_error("hashmap overflow");
+        }
 
-            updates_.insert(db.get());
+        // the catalogs refer to the idlist so it must be on the disk first.
+        {
+            std::lock_guard<std::mutex> lock(state_->idb_mutex);
+            for (const auto& id : ids)
+                idb.set(id.first, id.second);
+            idb.flush();
         }
-        for (auto* db : updates_)
-            db->flush();
+
+        // the readers only trust the columns up to the number of 
+        // articles in the volume so they go first.
+        cols->flush();
+        db->flush();
     }
 
     virtual std::string describe() const override
@@ -236,8 +411,11 @@ public:
 private:
     friend class update;
     std::shared_ptr<state> state_;
-    std::vector<article_t> articles_;
-    std::set<catalog_t*> updates_;
+    state::volume* volume_;
+    std::uint32_t index_;
+    std::vector<xover_header> headers_;
+    // the buffer that the headers refer to.
+    std::shared_ptr<buffer> buffer_;
 private:
     std::uint64_t first_;
     std::uint64_t last_;
@@ -245,7 +423,7 @@ private:
     std::size_t bytes_;
 };
 
-update::update(std::string path, std::string group) : local_last_(0), local_first_(0)
+update::update(std::string path, std::string group) : local_last_(0), local_first_(0), batch_size_(10)
 {
     const auto nfo = fs::joinpath(fs::joinpath(path, group), group + ".nfo");
     const auto idb = fs::joinpath(fs::joinpath(path, group), group + ".idb");
@@ -320,7 +498,7 @@ std::shared_ptr<cmdlist> update::create_commands()
         // commands to retrieve the newer messages starting at the current
         // newest message on the local machine and progressing towards the newest
         // on the remote host.
-        for (int i=0; i<10; ++i)
+        for (std::size_t i=0; i<batch_size_; ++i)
         {
             const auto first = xover_last_ + 1;
             const auto last  = std::min(first + 999, remote_last_);
@@ -344,7 +522,7 @@ std::shared_ptr<cmdlist> update::create_commands()
         // commands to retrieve the older messges starting at the current oldest
         // message on the local machine and progressing towards the oldest on the
         // remote server.
-        for (int i=0; i<10; ++i)
+        for (std::size_t i=0; i<batch_size_; ++i)
         {
             const auto last  = xover_first_ - 1;
             const auto first = last - remote_first_ >= 999 ?  last - 999 : remote_first_;
@@ -392,11 +570,27 @@ void update::commit()
     out.write((const char*)&local_first_, sizeof(local_first_));
     out.write((const char*)&local_last_, sizeof(local_last_));
 
-    auto& files = state_->files;
-    for (auto& p : files)
+    // the stores might still be running when we're canceled.
+    for (auto& p : state_->volumes)
     {
-        auto& db = p.second;
-        db->flush();
+        auto& vol = p.second;
+        std::lock_guard<std::mutex> lock(*vol->mutex);
+        if (!vol->db)
+            continue;
+
+        // checkpoint the catalog so that the header is complete
+        // and the volume can be opened without going through the log.
+        auto& db = vol->db;
+        db->checkpoint();
+
+        // the index is saved after the volume so that it's
+        // valid for what is on the disk.
+        vol->index.save(state_->index_file_name(p.first), db->size(), db->filebuf::size());
+        vol->index_saved = true;
+
+        // the text index stays valid when the volume grows so it
+        // doesn't need to be removed like the catalog index.
+        vol->text.save(state_->text_file_name(p.first));
     }
 
     std::vector<std::uint32_t> vec;
@@ -454,14 +648,63 @@ void update::complete(action& a, std::vector<std::unique_ptr<action>>& next)
 {
     if (auto* p = dynamic_cast<parse*>(&a))
     {
-        std::unique_ptr<store> s(new store(state_));
-        s->articles_ = std::move(p->articles_);
-        s->bytes_ = p->size();
-        //s->buffer_ = std::move(p->buffer_);
-
-        //s->set_affinity(action::affinity::single_thread);
-        s->set_affinity(action::affinity::gui_thread);
-        next.push_back(std::move(s));
+        auto& hmap    = state_->hashmap;
+        auto& volumes = state_->volumes;
+        auto& headers = p->headers_;
+
+        // shard the articles by the volume they go into so that 
+        // the volumes can be written concurrently.
+        std::map<std::uint32_t, std::unique_ptr<store>> shards;
+
+        for (const auto& header : headers)
+        {
+            auto hit = hmap.find(header.hash);
+            if (hit == std::end(hmap))
+            {
+                const auto index = std::uint32_t(header.number / CATALOG_SIZE);
+                hit = hmap.insert(std::make_pair(header.hash, index)).first;
+            }
+            else if (volumes.find(hit->second) == std::end(volumes))
+            {
+                // if we have a previous hash entry but the datafile
+                // is not to be found, it has propably been purged.
+                // in this case we're just going to ignore the entry and
+                // throw it away.
+                const auto file_index = hit->second;
+                const auto file_name  = state_->file_volume_name(file_index);
+                if (!fs::exists(file_name))
+                {
+                    hmap.erase(hit);
+                    continue;
+                }
+            }
+
+            const auto file_index = hit->second;
+            auto& vol = volumes[file_index];
+            if (!vol)
+            {
+                vol.reset(new state::volume);
+                vol->mutex = volume_lock(state_->file_volume_name(file_index));
+            }
+
+            auto& shard = shards[file_index];
+            if (!shard)
+            {
+                shard.reset(new store(state_, vol.get(), file_index));
+                shard->buffer_ = p->buffer_;
+            }
+            shard->headers_.push_back(header);
+        }
+
+        for (auto& pair : shards)
+        {
+            auto& s = pair.second;
+            s->bytes_ = headers.empty() ? 0 : 
+                p->size() * s->headers_.size() / headers.size();
+            s->set_affinity(action::affinity::single_thread);
+            s->set_shard(pair.first);
+            next.push_back(std::move(s));
+        }
     }
     if (auto* p = dynamic_cast<store*>(&a))
     {
@@ -481,16 +724,18 @@ void update::complete(action& a, std::vector<std::unique_ptr<action>>& next)
         {
             // remember that db might be accessed at the same time through
             // another thread via another store task
-            for (auto* file : p->updates_)
-            {
-                const auto& groupname = state_->group;
-                const auto& filename  = file->filename();
-                on_write(groupname, filename);
-            }
+            const auto& groupname = state_->group;
+            const auto& filename  = state_->file_volume_name(p->index_);
+            on_write(groupname, filename);
         }
     }
 }
 
+void update::set_batch_size(std::size_t num_commands)
+{
+    batch_size_ = std::max<std::size_t>(num_commands, 1);
+}
+
 bool update::has_commands() const
 {
     if (remote_first_ == 0 && remote_last_  == 0)
@@ -532,5 +777,33 @@ std::uint64_t update::num_remote_articles() const
     return num_remote;
 }
 
+// static
+bool update::build_columns(const std::string& volume_file)
+{
+    const auto mutex = volume_lock(volume_file);
+    std::lock_guard<std::mutex> lock(*mutex);
+
+    auto columns_file = volume_file;
+    columns_file.replace(columns_file.size() - 4, 4, ".col");
+    auto text_file = volume_file;
+    text_file.replace(text_file.size() - 4, 4, ".fts");
+
+    catalog_t db;
+    db.open(volume_file);
+    columns_t cols;
+    cols.open(columns_file);
+    if (cols.rows() >= db.size())
+        return false;
+
+    // the text index refers to the rows of the old columns.
+    bigfile::erase(text_file);
+
+    cols.clear();
+    for (auto it = db.begin(); it != db.end(); ++it)
+        cols.append(*it);
+    cols.flush();
+    return true;
+}
+
 } // newsflash
 
@@ -56,6 +56,8 @@ namespace newsflash
         virtual void complete(action& a, 
             std::vector<std::unique_ptr<action>>& next) override;
 
+        virtual void set_batch_size(std::size_t num_commands) override;
+
         virtual bool has_commands() const override;
 
         virtual std::size_t max_num_actions() const override;
@@ -67,6 +69,14 @@ namespace newsflash
         std::uint64_t num_local_articles() const;
 
         std::uint64_t num_remote_articles() const;
+
+        // build the columns of the catalog volume in the given file if 
+        // they have fewer rows than there are articles in the volume.
+        // the columns are only written by the update storing into the 
+        // volume and here, under the same lock, so this never runs 
+        // concurrently with a store. the text index of the volume is
+        // removed with the old rows. returns true if the columns were built.
+        static bool build_columns(const std::string& volume_file);
     private:
         class parse;
         class store;
@@ -80,6 +90,7 @@ namespace newsflash
         std::uint64_t local_first_;
         std::uint64_t xover_last_;
         std::uint64_t xover_first_;
+        std::size_t batch_size_;
     };
 
 } // newsflash
@@ -70,6 +70,12 @@ namespace newsflash
             return read();
         }
 
+        // get the underlying OS handle. 
+        native_handle_t native_handle() const 
+        {
+            return handle_;
+        }
+
 
         // wait indefinitely for the listed handles.
         // returns when any handle becomes signaled. 
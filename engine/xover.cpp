@@ -0,0 +1,508 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <cstring>
+#include <cassert>
+#include <string>
+
+#include "cpu.h"
+#include "xover.h"
+#include "subject.h"
+#include "utf8.h"
+#include "iso_8859_15.h"
+
+#if defined(NEWSFLASH_X86)
+#  if defined(__MSVC__)
+#    include <intrin.h>
+#  endif
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+using newsflash::xover_parser;
+
+// find the first tab or line feed in the range or return end.
+const char* find_separator_scalar(const char* p, const char* end)
+{
+    for (; p != end; ++p)
+    {
+        if (*p == '\t' || *p == '\n')
+            break;
+    }
+    return p;
+}
+
+#if defined(NEWSFLASH_X86)
+
+#if defined(__MSVC__)
+inline unsigned count_trailing_zeros(unsigned value)
+{
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return index;
+}
+#else
+inline unsigned count_trailing_zeros(unsigned value)
+{
+    return __builtin_ctz(value);
+}
+#endif
+
+NEWSFLASH_TARGET("sse2")
+const char* find_separator_sse2(const char* p, const char* end)
+{
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i lf  = _mm_set1_epi8('\n');
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)p);
+        const __m128i m = _mm_or_si128(_mm_cmpeq_epi8(v, tab), _mm_cmpeq_epi8(v, lf));
+        const unsigned mask = _mm_movemask_epi8(m);
+        if (mask)
+            return p + count_trailing_zeros(mask);
+    }
+    return find_separator_scalar(p, end);
+}
+
+NEWSFLASH_TARGET("avx2")
+const char* find_separator_avx2(const char* p, const char* end)
+{
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i lf  = _mm256_set1_epi8('\n');
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i v = _mm256_loadu_si256((const __m256i*)p);
+        const __m256i m = _mm256_or_si256(_mm256_cmpeq_epi8(v, tab), _mm256_cmpeq_epi8(v, lf));
+        const unsigned mask = _mm256_movemask_epi8(m);
+        if (mask)
+            return p + count_trailing_zeros(mask);
+    }
+    return find_separator_sse2(p, end);
+}
+
+#endif // NEWSFLASH_X86
+
+xover_parser::find_func get_find_func(xover_parser::kernel k)
+{
+    switch (k)
+    {
+#if defined(NEWSFLASH_X86)
+        case xover_parser::kernel::sse2: return &find_separator_sse2;
+        case xover_parser::kernel::avx2: return &find_separator_avx2;
+#endif
+        default: break;
+    }
+    return &find_separator_scalar;
+}
+
+// the tab separated fields of the line. the fields are read up 
+// to the line count, the rest of the line (Xref etc.) is skipped.
+struct tokenizer {
+    const char* pos;
+    const char* end;
+    xover_parser::find_func find;
+};
+
+// read the next tab terminated field. an empty field has a null start
+// like with nntp::parse_overview. returns false if the line ends first.
+bool next_field(tokenizer& t, nntp::overview::field& field)
+{
+    const char* sep = t.find(t.pos, t.end);
+    if (sep == t.end || *sep == '\n')
+        return false;
+
+    field.start = sep == t.pos ? nullptr : t.pos;
+    field.len   = sep - t.pos;
+    t.pos = sep + 1;
+    return true;
+}
+
+bool is_space(char c)
+{ return c == ' '; }
+
+bool is_digit(char c)
+{ return c >= '0' && c <= '9'; }
+
+bool is_alpha(char c)
+{ return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+
+// the broken down date from the fast path.
+struct date_fields {
+    int day;
+    int month;
+    int year;
+    int hours;
+    int minutes;
+    int seconds;
+    int tzoffset;
+};
+
+struct date_scanner {
+    const char* pos;
+    const char* end;
+
+    void skip_space()
+    {
+        while (pos != end && is_space(*pos))
+            ++pos;
+    }
+    bool uint(int max_digits, int& value)
+    {
+        skip_space();
+        int digits = 0;
+        value = 0;
+        while (pos != end && is_digit(*pos))
+        {
+            if (++digits > max_digits)
+                return false;
+            value = value * 10 + (*pos++ - '0');
+        }
+        return digits != 0;
+    }
+    bool ch(char c)
+    {
+        skip_space();
+        if (pos == end || *pos != c)
+            return false;
+        ++pos;
+        return true;
+    }
+    int alpha()
+    {
+        skip_space();
+        int count = 0;
+        while (pos != end && is_alpha(*pos))
+        {
+            ++pos;
+            ++count;
+        }
+        return count;
+    }
+};
+
+// parse the common date formats, i.e. the formats that nntp::parse_date
+// accepts written out the usual way. 
+//
+// Thu, 26 Jul 2007 19:44:13 -0500 (CDT)
+// 29 Jul 2007 11:25:26 GMT
+// Wednesday, 24 Oct 2008 11:58:50 -0800
+//
+// returns false for anything else and then the date needs to go
+// through the general parser.
+bool parse_date_fast(const char* str, std::size_t len, date_fields& date)
+{
+    date_scanner s {str, str + len};
+    s.skip_space();
+
+    // the day of week is optional. the time zone name in parentheses
+    // is only accepted by nntp::parse_date after a 3 letter day.
+    int weekday = 0;
+    if (s.pos != s.end && !is_digit(*s.pos))
+    {
+        weekday = s.alpha();
+        if (!s.ch(','))
+            return false;
+    }
+    if (!s.uint(2, date.day))
+        return false;
+
+    s.skip_space();
+    if (s.end - s.pos < 4)
+        return false;
+    const char* mon = s.pos;
+    if (!is_alpha(mon[0]) || !is_alpha(mon[1]) || !is_alpha(mon[2]) || is_alpha(mon[3]))
+        return false;
+
+    static const char* months[] = {
+        "jan", "feb", "mar", "apr", "may", "jun",
+        "jul", "aug", "sep", "oct", "nov", "dec"
+    };
+    date.month = -1;
+    for (int i=0; i<12; ++i)
+    {
+        if ((mon[0] | 0x20) == months[i][0] &&
+            (mon[1] | 0x20) == months[i][1] &&
+            (mon[2] | 0x20) == months[i][2])
+        {
+            date.month = i;
+            break;
+        }
+    }
+    if (date.month == -1)
+        return false;
+    s.pos += 3;
+
+    if (!s.uint(4, date.year))
+        return false;
+    if (!s.uint(2, date.hours) || !s.ch(':'))
+        return false;
+    if (!s.uint(2, date.minutes) || !s.ch(':'))
+        return false;
+    if (!s.uint(2, date.seconds))
+        return false;
+    if (date.day < 1 || date.day > 31)
+        return false;
+    if (date.hours > 23 || date.minutes > 59 || date.seconds > 59)
+        return false;
+
+    s.skip_space();
+    date.tzoffset = 0;
+    if (s.pos != s.end && (*s.pos == '+' || *s.pos == '-' || is_digit(*s.pos)))
+    {
+        const bool negative = *s.pos == '-';
+        if (!is_digit(*s.pos))
+            ++s.pos;
+        // int_p doesn't allow space after the sign.
+        if (s.pos == s.end || !is_digit(*s.pos))
+            return false;
+        int offset = 0;
+        if (!s.uint(4, offset))
+            return false;
+        date.tzoffset = negative ? -offset : offset;
+    }
+
+    s.skip_space();
+    if (s.pos != s.end && *s.pos == '(')
+    {
+        if (weekday != 3)
+            return false;
+        ++s.pos;
+        s.alpha();
+        if (!s.ch(')'))
+            return false;
+    }
+    else s.alpha();
+
+    if (date.year < 100)
+        date.year += 2000;
+
+    return s.pos == s.end;
+}
+
+// same as nntp::timevalue before the time zone adjustment.
+std::time_t make_time(int year, int month, int day, int hour, int minutes, int seconds)
+{
+    enum { USE_SYSTEM_DAYLIGHT_SAVING_INFO = -1 };
+
+    struct tm t = {};
+    t.tm_sec   = seconds;
+    t.tm_min   = minutes;
+    t.tm_hour  = hour;
+    t.tm_mday  = day;
+    t.tm_mon   = month;
+    t.tm_year  = year - 1900;
+    t.tm_isdst = USE_SYSTEM_DAYLIGHT_SAVING_INFO;
+    return std::mktime(&t);
+}
+
+} // namespace
+
+namespace newsflash
+{
+
+xover_parser::xover_parser(const char* data, std::size_t len) : xover_parser(data, len, best_kernel())
+{}
+
+xover_parser::xover_parser(const char* data, std::size_t len, kernel k)
+    : data_(data), end_(data + len), pos_(0)
+{
+    assert(is_supported(k));
+
+    now_  = std::time(nullptr);
+    find_ = get_find_func(k);
+    for (auto& entry : cache_)
+    {
+        entry.key     = 0;
+        entry.value   = 0;
+        entry.regular = false;
+    }
+}
+
+bool xover_parser::next(xover_header& header)
+{
+    while (data_ + pos_ != end_)
+    {
+        const char* line = data_ + pos_;
+        const char* eol  = nullptr;
+        const bool ok = parse(line, end_, eol, header);
+        // the last line is incomplete, leave it for later.
+        if (eol[-1] != '\n')
+            return false;
+
+        pos_ = eol - data_;
+        if (ok)
+            return true;
+    }
+    return false;
+}
+
+// static
+bool xover_parser::parse_line(const char* line, std::size_t len, xover_header& header)
+{
+    if (len == 0)
+        return false;
+    xover_parser parser(line, len);
+    const char* eol = nullptr;
+    return parser.parse(line, line + len, eol, header);
+}
+
+// static
+bool xover_parser::is_supported(kernel k)
+{
+    switch (k)
+    {
+        case kernel::scalar: return true;
+        case kernel::sse2:   return has_cpu_feature(cpu_feature::sse2);
+        case kernel::avx2:   return has_cpu_feature(cpu_feature::avx2);
+    }
+    return false;
+}
+
+// static
+xover_parser::kernel xover_parser::best_kernel()
+{
+    static const kernel best =
+        is_supported(kernel::avx2) ? kernel::avx2 :
+        is_supported(kernel::sse2) ? kernel::sse2 : kernel::scalar;
+    return best;
+}
+
+bool xover_parser::parse(const char* data, const char* end, const char*& eol, xover_header& header)
+{
+    tokenizer t {data, end, find_};
+
+    // same as nntp::parse_overview
+    while (t.pos != end && *t.pos == ' ')
+        ++t.pos;
+
+    nntp::overview ov;
+
+    bool ok = t.pos != end && next_field(t, ov.number);
+    if (ok)
+    {
+        while (t.pos != end && (unsigned char)*t.pos < 0x22 && *t.pos != '\t' && *t.pos != '\n')
+            ++t.pos;
+        ok = next_field(t, ov.subject) &&
+             next_field(t, ov.author) &&
+             next_field(t, ov.date) &&
+             next_field(t, ov.messageid) &&
+             next_field(t, ov.references) &&
+             next_field(t, ov.bytecount) &&
+             next_field(t, ov.linecount);
+    }
+
+    // skip the rest of the line.
+    if (t.pos != end && *t.pos == '\n')
+        eol = t.pos + 1;
+    else 
+    {
+        const void* lf = std::memchr(t.pos, '\n', end - t.pos);
+        eol = lf ? (const char*)lf + 1 : end;
+    }
+    if (!ok)
+        return false;
+
+    // same checks as article::parse
+    if (ov.subject.len == 0 || ov.subject.len > 512)
+        return false;
+    if (ov.author.len == 0)
+        return false;
+
+    const auto& subject = nntp::analyse_subject(ov.subject.start, ov.subject.len);
+
+    header.has_parts   = false;
+    header.partno      = 0;
+    header.parts_total = 0;
+    if (subject.has_part)
+    {
+        if (subject.numerator > subject.denominator)
+            return false;
+        header.has_parts   = true;
+        header.partno      = std::uint16_t(subject.numerator);
+        header.parts_total = std::uint16_t(subject.denominator);
+    }
+
+    if (ov.date.len == 0)
+        return false;
+
+    date_fields date;
+    if (parse_date_fast(ov.date.start, ov.date.len, date))
+    {
+        auto ret = local_time(date.year, date.month, date.day, date.hours, date.minutes, date.seconds);
+        if (date.tzoffset)
+        {
+            ret += ((date.tzoffset / 100) * -3600);
+            ret += ((date.tzoffset % 100) * -60);
+        }
+        header.pubdate = ret > now_ ? now_ : ret;
+    }
+    else
+    {
+        const auto& date = nntp::parse_date(ov.date.start, ov.date.len);
+        if (!date.first)
+            return false;
+        header.pubdate = nntp::timevalue(date.second);
+    }
+
+    header.subject = ov.subject;
+    header.author  = ov.author;
+    header.number  = nntp::to_int<std::uint64_t>(ov.number.start, ov.number.len);
+    header.bytes   = nntp::to_int<std::uint32_t>(ov.bytecount.start, ov.bytecount.len);
+    header.hash    = subject.hash;
+    header.binary  = subject.binary;
+    header.type    = filetype::none;
+    if (subject.binary && subject.filename_len)
+        header.type = find_filetype(subject.filename, subject.filename_len);
+
+    // the fingerprint is over the subject line as it's stored, i.e. in utf-8.
+    const auto* str = ov.subject.start;
+    if (utf8::is_well_formed(str, str + ov.subject.len))
+        header.fingerprint = subject.fingerprint;
+    else header.fingerprint = nntp::fingerprint(ISO_8859_15_to_utf8(str, ov.subject.len));
+    return true;
+}
+
+std::time_t xover_parser::local_time(int year, int month, int day, int hour, int minutes, int seconds)
+{
+    // the dates in a batch of headers are mostly within a few days
+    // so remember the start of the last days seen.
+    const std::uint32_t key = (std::uint32_t(year) << 9) | (month << 5) | day;
+    auto& entry = cache_[(month * 31 + day) % CACHE_SIZE];
+    if (entry.key != key)
+    {
+        const auto prev  = make_time(year, month, day - 1, 0, 0, 0);
+        const auto start = make_time(year, month, day, 0, 0, 0);
+        const auto next  = make_time(year, month, day + 1, 0, 0, 0);
+        entry.key     = key;
+        entry.value   = start;
+        // the days when the clocks are turned go through mktime for
+        // every header since the local time can be skipped or repeated.
+        entry.regular = start - prev == 86400 && next - start == 86400;
+    }
+    if (entry.regular)
+        return entry.value + hour * 3600 + minutes * 60 + seconds;
+
+    return make_time(year, month, day, hour, minutes, seconds);
+}
+
+} // newsflash
@@ -0,0 +1,119 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+
+#include <newsflash/config.h>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include "nntp.h"
+#include "filetype.h"
+
+namespace newsflash
+{
+    // the fields of an XOVER line that the header import needs. the
+    // subject and the author refer to the buffer that was parsed so 
+    // the header is only valid as long as the buffer is.
+    struct xover_header {
+        nntp::overview::field subject;
+        nntp::overview::field author;
+        // the article number on the server.
+        std::uint64_t number;
+        // nntp::fingerprint of the subject line in utf-8.
+        std::uint64_t fingerprint;
+        // the publish date as with nntp::timevalue
+        std::time_t pubdate;
+        std::uint32_t bytes;
+        // nntp::hashvalue of the subject line as is.
+        std::uint32_t hash;
+        // the part information from the subject line if has_parts is set.
+        std::uint16_t partno;
+        std::uint16_t parts_total;
+        bool has_parts;
+        // nntp::is_binary_post of the subject line.
+        bool binary;
+        // the type of the file named in the subject line if the post is binary.
+        filetype type;
+    };
+
+    // tokenize XOVER response data into headers without copying. 
+    // the lines are validated the same way as article::parse validates 
+    // them and the invalid lines are skipped.
+    class xover_parser
+    {
+    public:
+        // the implementation of the tab/line feed scanning.
+        enum class kernel {
+            scalar, sse2, avx2
+        };
+
+        // parse the data with the best kernel for the current CPU.
+        xover_parser(const char* data, std::size_t len);
+
+        // parse the data with a specific kernel. The kernel must be 
+        // supported by the current CPU.
+        xover_parser(const char* data, std::size_t len, kernel k);
+
+        // parse the next valid header. returns false when there are no more 
+        // complete lines in the data. 
+        bool next(xover_header& header);
+
+        // the offset of the first line that hasn't been parsed yet.
+        std::size_t pos() const
+        { return pos_; }
+
+        // parse a single overview line. the line doesn't need to end
+        // with a line feed. returns false if the line is not valid.
+        static bool parse_line(const char* line, std::size_t len, xover_header& header);
+
+        // returns true if the given kernel can be used on the current CPU.
+        static bool is_supported(kernel k);
+
+        // returns the kernel that is used by default.
+        static kernel best_kernel();
+
+        using find_func = const char* (*)(const char*, const char*);
+    private:
+        enum { CACHE_SIZE = 64 };
+
+        struct date_cache {
+            std::uint32_t key;
+            std::time_t value;
+            bool regular;
+        };
+
+        // parse the line starting at the data. sets eol to point past the 
+        // line feed that ends the line or to the end of the data.
+        bool parse(const char* data, const char* end, const char*& eol, xover_header& header);
+
+        // convert the local date and time into a time value like mktime.
+        std::time_t local_time(int year, int month, int day, int hour, int minutes, int seconds);
+
+    private:
+        const char* data_;
+        const char* end_;
+        std::size_t pos_;
+        std::time_t now_;
+        find_func find_;
+        date_cache cache_[CACHE_SIZE];
+    };
+
+} // newsflash
@@ -0,0 +1,442 @@
+// Copyright (c) 2010-2015 Sami Väisänen, Ensisoft 
+//
+// http://www.ensisoft.com
+// 
+// This software is copyrighted software. Unauthorized hacking, cracking, distribution
+// and general assing around is prohibited.
+// Redistribution and use in source and binary forms, with or without modification,
+// without permission are prohibited.
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include <newsflash/config.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cassert>
+
+#include "cpu.h"
+#include "crc32.h"
+#include "yenc.h"
+
+#if defined(NEWSFLASH_X86)
+#  if defined(__MSVC__)
+#    include <intrin.h>
+#  endif
+#  include <immintrin.h>
+#endif
+
+namespace {
+
+// returns true if the byte at data[i] is a dot added by the NNTP
+// dot stuffing at the start of a line and needs to be dropped.
+// the data is expected to begin at the start of a line, i.e.
+// it's implicitly preceded by \r\n
+inline
+bool is_stuffed_dot(const char* data, std::size_t i)
+{
+    if (data[i] != '.' || i == 0)
+        return false;
+    if (data[i-1] != '.')
+        return false;
+    if (i == 1)
+        return true;
+    if (i == 2)
+        return false;
+    return data[i-2] == '\n' && data[i-3] == '\r';
+}
+
+// decode the byte at data[i]. returns false if the end
+// of the yEnc data was found.
+inline
+bool decode_next(const char* data, std::size_t len, std::size_t& i, char* out, std::size_t& o)
+{
+    const unsigned char c = data[i];
+    if (c == '\r' || c == '\n')
+    {
+        ++i;
+        return true;
+    }
+    else if (c == '.')
+    {
+        if (!is_stuffed_dot(data, i))
+            out[o++] = c - 42;
+        ++i;
+        return true;
+    }
+    else if (c == '=')
+    {
+        std::size_t next = i + 1;
+        if (next < len && is_stuffed_dot(data, next))
+            ++next;
+
+        if (next == len)
+        {
+            out[o++] = c - 42;
+            i = len;
+            return false;
+        }
+        else if (data[next] == 'y')
+            return false;
+
+        out[o++] = (unsigned char)data[next] - 64 - 42;
+        i = next + 1;
+        return true;
+    }
+    out[o++] = c - 42;
+    ++i;
+    return true;
+}
+
+// decoding state shared by the kernels. the kernels copy the positions
+// to locals while decoding since any store through the char* output
+// would otherwise force them to be reloaded from memory.
+struct decoder {
+    const char* data;
+    std::size_t len;
+    char* out;
+    std::size_t i; // input position
+    std::size_t o; // output position
+    bool done;     // end of the yEnc data was found
+};
+
+void decode_end(decoder& d, std::size_t i, std::size_t o)
+{
+    d.i = i;
+    d.o = o;
+    d.done = true;
+}
+
+// decode with the scalar code until the input position reaches stop.
+void decode_tail(decoder& d, std::size_t i, std::size_t o, std::size_t stop)
+{
+    while (i < stop)
+    {
+        if (!decode_next(d.data, d.len, i, d.out, o))
+            return decode_end(d, i, o);
+    }
+    d.i = i;
+    d.o = o;
+    d.done = i == d.len;
+}
+
+// the kernels decode until the input position reaches stop (possibly
+// going over by a few bytes) or the end of the data is found.
+void decode_scalar(decoder& d, std::size_t stop)
+{
+    decode_tail(d, d.i, d.o, stop);
+}
+
+#if defined(NEWSFLASH_X86)
+
+#if defined(__MSVC__)
+inline unsigned count_trailing_zeros(unsigned value)
+{
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return index;
+}
+#else
+inline unsigned count_trailing_zeros(unsigned value)
+{
+    return __builtin_ctz(value);
+}
+#endif
+
+// the vector kernels decode a full vector of data and then commit the
+// output up to the first byte that needs special treatment. the output
+// never grows faster than the input so the vector stores stay within
+// the len bytes of output.
+
+NEWSFLASH_TARGET("sse2")
+void decode_sse2(decoder& d, std::size_t stop)
+{
+    const char* data = d.data;
+    const std::size_t len = d.len;
+    char* out = d.out;
+
+    const __m128i cr  = _mm_set1_epi8('\r');
+    const __m128i lf  = _mm_set1_epi8('\n');
+    const __m128i eq  = _mm_set1_epi8('=');
+    const __m128i dot = _mm_set1_epi8('.');
+    const __m128i off = _mm_set1_epi8(42);
+
+    std::size_t i = d.i;
+    std::size_t o = d.o;
+    while (i + 16 <= len && i < stop)
+    {
+        const __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        const __m128i s = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, cr), _mm_cmpeq_epi8(v, lf)),
+            _mm_or_si128(_mm_cmpeq_epi8(v, eq), _mm_cmpeq_epi8(v, dot)));
+        const unsigned mask = _mm_movemask_epi8(s);
+
+        _mm_storeu_si128((__m128i*)(out + o), _mm_sub_epi8(v, off));
+        if (mask == 0)
+        {
+            i += 16;
+            o += 16;
+            continue;
+        }
+        const auto n = count_trailing_zeros(mask);
+        i += n;
+        o += n;
+        if (!decode_next(data, len, i, out, o))
+            return decode_end(d, i, o);
+    }
+    decode_tail(d, i, o, stop);
+}
+
+// lookup table for compacting 8 bytes with pshufb. for each 8 bit mask
+// the shuffle moves the bytes with the corresponding bit set to the front.
+struct compact_table {
+    std::uint8_t shuffle[256][8];
+    std::uint8_t count[256];
+
+    compact_table()
+    {
+        for (unsigned mask=0; mask<256; ++mask)
+        {
+            unsigned n = 0;
+            for (unsigned bit=0; bit<8; ++bit)
+            {
+                if (mask & (1 << bit))
+                    shuffle[mask][n++] = bit;
+            }
+            count[mask] = n;
+            for (; n<8; ++n)
+                shuffle[mask][n] = 0x80;
+        }
+    }
+} compact;
+
+// the compacting kernels remove line feeds and the escape characters
+// with a shuffle and adjust the escaped bytes in place. only dots and
+// escapes that can't be resolved within the vector (at the end of the
+// vector, before a dot, line feed or another escape or =y) stop the vector
+// processing and are handled by the scalar code.
+
+NEWSFLASH_TARGET("ssse3")
+inline bool decode_step_ssse3(const char* data, std::size_t len, std::size_t& i, char* out, std::size_t& o)
+{
+    const __m128i v   = _mm_loadu_si128((const __m128i*)(data + i));
+    const __m128i eqv = _mm_cmpeq_epi8(v, _mm_set1_epi8('='));
+    const unsigned eq   = _mm_movemask_epi8(eqv);
+    const unsigned dot  = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('.')));
+    const unsigned y    = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('y')));
+    const unsigned crlf = _mm_movemask_epi8(_mm_or_si128(
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))));
+
+    const unsigned stop = dot | (eq & ((dot | crlf | eq | y) >> 1)) | (eq & 0x8000);
+    const unsigned n    = stop ? count_trailing_zeros(stop) : 16;
+    const unsigned keep = ~(crlf | eq) & ((1u << n) - 1);
+    const unsigned lo   = keep & 0xff;
+    const unsigned hi   = (keep >> 8) & 0xff;
+
+    // the bytes following an escape character have additional offset of 64
+    const __m128i esc = _mm_and_si128(_mm_slli_si128(eqv, 1), _mm_set1_epi8(64));
+    const __m128i dec = _mm_sub_epi8(_mm_sub_epi8(v, _mm_set1_epi8(42)), esc);
+
+    const __m128i shuffle = _mm_unpacklo_epi64(
+        _mm_loadl_epi64((const __m128i*)compact.shuffle[lo]),
+        _mm_add_epi8(_mm_loadl_epi64((const __m128i*)compact.shuffle[hi]), _mm_set1_epi8(8)));
+    const __m128i r = _mm_shuffle_epi8(dec, shuffle);
+
+    _mm_storel_epi64((__m128i*)(out + o), r);
+    o += compact.count[lo];
+    _mm_storel_epi64((__m128i*)(out + o), _mm_unpackhi_epi64(r, r));
+    o += compact.count[hi];
+    i += n;
+    if (n == 16)
+        return true;
+
+    return decode_next(data, len, i, out, o);
+}
+
+NEWSFLASH_TARGET("ssse3")
+void decode_ssse3(decoder& d, std::size_t stop)
+{
+    const char* data = d.data;
+    const std::size_t len = d.len;
+    char* out = d.out;
+
+    std::size_t i = d.i;
+    std::size_t o = d.o;
+    while (i + 16 <= len && i < stop)
+    {
+        if (!decode_step_ssse3(data, len, i, out, o))
+            return decode_end(d, i, o);
+    }
+    decode_tail(d, i, o, stop);
+}
+
+NEWSFLASH_TARGET("avx2")
+void decode_avx2(decoder& d, std::size_t stop)
+{
+    const char* data = d.data;
+    const std::size_t len = d.len;
+    char* out = d.out;
+
+    std::size_t i = d.i;
+    std::size_t o = d.o;
+    while (i + 32 <= len && i < stop)
+    {
+        const __m256i v   = _mm256_loadu_si256((const __m256i*)(data + i));
+        const __m256i eqv = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('='));
+        const unsigned eq   = _mm256_movemask_epi8(eqv);
+        const unsigned dot  = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('.')));
+        const unsigned crlf = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))));
+        const __m256i dec = _mm256_sub_epi8(v, _mm256_set1_epi8(42));
+
+        if ((eq | dot | crlf) == 0)
+        {
+            _mm256_storeu_si256((__m256i*)(out + o), dec);
+            i += 32;
+            o += 32;
+            continue;
+        }
+
+        const unsigned y    = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('y')));
+        const unsigned stop = dot | (eq & ((dot | crlf | eq | y) >> 1)) | (eq & 0x80000000);
+        const unsigned n    = stop ? count_trailing_zeros(stop) : 32;
+        const unsigned keep = ~(crlf | eq) & (n == 32 ? ~0u : (1u << n) - 1);
+        const unsigned k0   = (keep >>  0) & 0xff;
+        const unsigned k1   = (keep >>  8) & 0xff;
+        const unsigned k2   = (keep >> 16) & 0xff;
+        const unsigned k3   = (keep >> 24) & 0xff;
+
+        // shift the escape mask by one byte across the 128 bit lanes
+        const __m256i prev = _mm256_alignr_epi8(eqv, _mm256_permute2x128_si256(eqv, eqv, 0x08), 15);
+        const __m256i esc  = _mm256_and_si256(prev, _mm256_set1_epi8(64));
+
+        const __m128i eight = _mm_set1_epi8(8);
+        const __m128i lane0 = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i*)compact.shuffle[k0]),
+            _mm_add_epi8(_mm_loadl_epi64((const __m128i*)compact.shuffle[k1]), eight));
+        const __m128i lane1 = _mm_unpacklo_epi64(
+            _mm_loadl_epi64((const __m128i*)compact.shuffle[k2]),
+            _mm_add_epi8(_mm_loadl_epi64((const __m128i*)compact.shuffle[k3]), eight));
+        const __m256i shuffle = _mm256_inserti128_si256(_mm256_castsi128_si256(lane0), lane1, 1);
+        const __m256i r = _mm256_shuffle_epi8(_mm256_sub_epi8(dec, esc), shuffle);
+        const __m128i r0 = _mm256_castsi256_si128(r);
+        const __m128i r1 = _mm256_extracti128_si256(r, 1);
+
+        _mm_storel_epi64((__m128i*)(out + o), r0);
+        o += compact.count[k0];
+        _mm_storel_epi64((__m128i*)(out + o), _mm_unpackhi_epi64(r0, r0));
+        o += compact.count[k1];
+        _mm_storel_epi64((__m128i*)(out + o), r1);
+        o += compact.count[k2];
+        _mm_storel_epi64((__m128i*)(out + o), _mm_unpackhi_epi64(r1, r1));
+        o += compact.count[k3];
+        i += n;
+        if (n == 32)
+            continue;
+
+        if (!decode_next(data, len, i, out, o))
+            return decode_end(d, i, o);
+    }
+    while (i + 16 <= len && i < stop)
+    {
+        if (!decode_step_ssse3(data, len, i, out, o))
+            return decode_end(d, i, o);
+    }
+    decode_tail(d, i, o, stop);
+}
+
+#endif // NEWSFLASH_X86
+
+using decode_func = void (*)(decoder&, std::size_t);
+
+decode_func get_decode_func(yenc::kernel k)
+{
+    switch (k)
+    {
+#if defined(NEWSFLASH_X86)
+        case yenc::kernel::sse2:  return &decode_sse2;
+        case yenc::kernel::ssse3: return &decode_ssse3;
+        case yenc::kernel::avx2:  return &decode_avx2;
+#endif
+        default: break;
+    }
+    return &decode_scalar;
+}
+
+yenc::decode_result decode(decode_func func, const char* data, std::size_t len, char* out)
+{
+    decoder d = {data, len, out, 0, 0, false};
+    func(d, len);
+    return {d.i, d.o};
+}
+
+} // namespace
+
+namespace yenc
+{
+
+decode_result decode_buffer(const char* data, std::size_t len, char* out)
+{
+    static const decode_func func = get_decode_func(best_kernel());
+
+    return decode(func, data, len, out);
+}
+
+decode_result decode_buffer(const char* data, std::size_t len, char* out, kernel k)
+{
+    assert(is_supported(k));
+
+    return decode(get_decode_func(k), data, len, out);
+}
+
+decode_result decode_buffer(const char* data, std::size_t len, char* out, std::uint32_t& crc)
+{
+    static const decode_func func = get_decode_func(best_kernel());
+
+    // decode in blocks small enough for the decoded data to still be
+    // in the cache when the crc is computed.
+    const std::size_t block = 16 * 1024;
+
+    decoder d = {data, len, out, 0, 0, false};
+    while (!d.done)
+    {
+        const auto o = d.o;
+        func(d, std::min(d.i + block, len));
+        crc = newsflash::crc32(crc, out + o, d.o - o);
+    }
+    return {d.i, d.o};
+}
+
+bool is_supported(kernel k)
+{
+    switch (k)
+    {
+        case kernel::scalar: return true;
+        case kernel::sse2:   return newsflash::has_cpu_feature(newsflash::cpu_feature::sse2);
+        case kernel::ssse3:  return newsflash::has_cpu_feature(newsflash::cpu_feature::ssse3);
+        case kernel::avx2:   return newsflash::has_cpu_feature(newsflash::cpu_feature::avx2);
+    }
+    return false;
+}
+
+kernel best_kernel()
+{
+    static const kernel best =
+        is_supported(kernel::avx2)  ? kernel::avx2  :
+        is_supported(kernel::ssse3) ? kernel::ssse3 :
+        is_supported(kernel::sse2)  ? kernel::sse2  : kernel::scalar;
+    return best;
+}
+
+} // yenc
@@ -27,6 +27,8 @@
 #include <newsflash/warnpop.h>
 #include <string>
 #include <iterator>
+#include <cstddef>
+#include <cstdint>
 
 // yEnc decoder/encoder implementation.
 // http://www.yenc.org/
@@ -124,6 +126,7 @@ namespace yenc
            str_p("=yend") >>
            (str_p("size=") >> uint_p[assign(footer.size)]) >>
            !(str_p("part=") >> uint_p[assign(footer.part)]) >>
+           !(str_p("total=") >> uint_p) >> // yEnc 1.2, ignored
            !(str_p("pcrc32=") >> hex_p[assign(footer.pcrc32)]) >>
            !(str_p("crc32=") >> hex_p[assign(footer.crc32)]) >> 
            !eol_p
@@ -170,6 +173,36 @@ namespace yenc
         return true;
     }
 
+    // decoder implementation for the contiguous buffer decoding.
+    enum class kernel {
+        scalar, sse2, ssse3, avx2
+    };
+
+    struct decode_result {
+        std::size_t consumed; // number of input bytes consumed
+        std::size_t written;  // number of output bytes written
+    };
+
+    // Decode yEnc encoded NNTP body data from a contiguous buffer in a single pass.
+    // This is equivalent to decoding through nntp::bodyiter, i.e. line feeds are
+    // dropped and double dots at the start of a line are collapsed.
+    // The data is expected to begin at the start of a line (right after the
+    // =ybegin or =ypart line) and decoding stops at the start of the =yend line
+    // or at the end of the data. The output buffer must have room for at least len bytes.
+    decode_result decode_buffer(const char* data, std::size_t len, char* out);
+
+    // Decode with a specific kernel. The kernel must be supported by the current CPU.
+    decode_result decode_buffer(const char* data, std::size_t len, char* out, kernel k);
+
+    // Decode and update the crc with the decoded data in the same pass.
+    decode_result decode_buffer(const char* data, std::size_t len, char* out, std::uint32_t& crc);
+
+    // Returns true if the given kernel can be used on the current CPU.
+    bool is_supported(kernel k);
+
+    // Returns the kernel that is used by decode_buffer.
+    kernel best_kernel();
+
     // Encode data into yEnc. Line should be the preferred
     // line length after wich a new line (\r\n) is written into the output stream.
     template<typename InputIterator, typename OutputIterator>
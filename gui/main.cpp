@@ -75,7 +75,7 @@
 #include "app/repairer.h"
 #include "app/unpacker.h"
 #include "app/files.h"
-#include "app/par2.h"
+#include "app/par2library.h"
 #include "app/unrar.h"
 #include "app/arcman.h"
 #include "app/webengine.h"
@@ -202,8 +202,7 @@ int run(QtSingleApplication& qtinstance)
         &files, SLOT(packCompleted(const app::FilePackInfo&)));
 
     // repair component
-    std::unique_ptr<app::ParityChecker> parityEngine(new app::Par2(
-        app::distdir::file("par2")));
+    std::unique_ptr<app::ParityChecker> parityEngine(new app::Par2Library);
     app::Repairer repairer(std::move(parityEngine));
     QObject::connect(&repairer, SIGNAL(repairEnqueue(const app::Archive&)),
         &power, SLOT(repairEnqueue()));
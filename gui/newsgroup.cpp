@@ -115,6 +115,14 @@ NewsGroup::NewsGroup(quint32 acc, QString path, QString name) : account_(acc), p
         ui_.btnLoadMore->setText(
             tr("Load more headers ... (%1/%2)").arg(numLoaded).arg(numTotal));
     };
+    model_.onFilterProgress = [this](std::size_t curItem, std::size_t numItems) {
+        ui_.loader->setVisible(true);
+        ui_.loader->setMaximum(numItems);
+        ui_.loader->setValue(curItem);
+    };
+    model_.onFilterComplete = [this] {
+        ui_.loader->setVisible(false);
+    };
     model_.onKilled = [this] {
         ui_.actionStop->setEnabled(false);
         ui_.progressBar->setVisible(false);
@@ -231,6 +239,10 @@ Finder* NewsGroup::getFinder()
 
 bool NewsGroup::isMatch(const QString& str, std::size_t index, bool caseSensitive)
 {
+    // the text index rules out most of the items without loading them.
+    if (!model_.mayContain(str, index))
+        return false;
+
     const auto& article = model_.getArticle(index);
     const auto& subject = article.subject();
     const auto& latin   = QString::fromLatin1(subject.c_str(), subject.size());
@@ -122,11 +122,14 @@ void Repair::loadState(app::Settings& settings)
 
     const auto writeLogs = settings.get("repair", "write_log_files", true);
     const auto purgePars = settings.get("repair", "purge_recovery_files_on_success", true);
+    const auto numThreads = settings.get("repair", "num_threads", 0);
     ui_.chkWriteLogs->setChecked(writeLogs);
     ui_.chkPurgePars->setChecked(purgePars);
+    ui_.spinThreads->setValue(numThreads);
 
     model_.setPurgePars(purgePars);
     model_.setWriteLogs(writeLogs);
+    model_.setNumThreads(numThreads);
 }
 
 void Repair::saveState(app::Settings& settings)
@@ -138,6 +141,7 @@ void Repair::saveState(app::Settings& settings)
     const auto purgePars = ui_.chkPurgePars->isChecked();
     settings.set("repair", "write_log_files", writeLogs);
     settings.set("repair", "purge_recovery_files_on_success", purgePars);
+    settings.set("repair", "num_threads", ui_.spinThreads->value());
 }
 
 void Repair::shutdown()
@@ -278,6 +282,11 @@ void Repair::on_chkPurgePars_stateChanged(int)
     model_.setPurgePars(value);
 }
 
+void Repair::on_spinThreads_valueChanged(int value)
+{
+    model_.setNumThreads(value);
+}
+
 void Repair::repairList_selectionChanged()
 {
     auto indices = ui_.repairList->selectionModel()->selectedRows();
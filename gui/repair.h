@@ -74,6 +74,7 @@ namespace gui
         void on_actionDetails_triggered();
         void on_chkWriteLogs_stateChanged(int);
         void on_chkPurgePars_stateChanged(int);
+        void on_spinThreads_valueChanged(int value);
         void repairStart(const app::Archive& arc);
         void repairReady(const app::Archive& arc);
         void repairProgress(const QString& step, int done);        
@@ -73,6 +73,7 @@ CommandLine::CommandLine(void)
 , totalsourcesize(0)
 , largestsourcesize(0)
 , memorylimit(0)
+, threadcount(0)
 , purgefiles(false)
 , recursive(false)
 {
@@ -127,6 +128,7 @@ void CommandLine::usage(void)
     "  -l       : Limit size of recovery files (Don't use both -u and -l)\n"
     "  -n<n>    : Number of recovery files (Don't use both -n and -l)\n"
     "  -m<n>    : Memory (in MB) to use\n"
+    "  -t<n>    : Number of threads to use (default is one per processor)\n"
     "  -v [-v]  : Be more verbose\n"
     "  -q [-q]  : Be more quiet (-q -q gives silence)\n"
     "  -p       : Purge backup files and par files on successful recovery or\n"
@@ -578,6 +580,28 @@ bool CommandLine::Parse(int argc, char *argv[])
           }
           break;
 
+        case 't':  // Specify how many threads to use
+          {
+            if (threadcount > 0)
+            {
+              cerr << "Cannot specify thread count twice." << endl;
+              return false;
+            }
+
+            char *p = &argv[0][2];
+            while (threadcount <= 1000 && *p && isdigit(*p))
+            {
+              threadcount = threadcount * 10 + (*p - '0');
+              p++;
+            }
+            if (threadcount == 0 || threadcount > 1000 || *p)
+            {
+              cerr << "Invalid thread count option: " << argv[0] << endl;
+              return false;
+            }
+          }
+          break;
+
         case 'v':
           {
             switch (noiselevel)
@@ -877,6 +901,14 @@ bool CommandLine::Parse(int argc, char *argv[])
   }
   memorylimit *= 1048576;
 
+  // Use one thread per processor if not specified.
+  if (threadcount == 0)
+  {
+    threadcount = thread::hardware_concurrency();
+    if (threadcount == 0)
+      threadcount = 1;
+  }
+
   return true;
 }
 
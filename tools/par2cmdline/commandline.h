@@ -103,6 +103,7 @@ public:
   u32                    GetRecoveryBlockCount(void) const {return recoveryblockcount;}
   CommandLine::Scheme    GetRecoveryFileScheme(void) const {return recoveryfilescheme;}
   size_t                 GetMemoryLimit(void) const        {return memorylimit;}
+  u32                    GetThreadCount(void) const        {return threadcount;}
   u64                    GetLargestSourceSize(void) const  {return largestsourcesize;}
   u64                    GetTotalSourceSize(void) const    {return totalsourcesize;}
   CommandLine::NoiseLevel GetNoiseLevel(void) const        {return noiselevel;}
@@ -162,6 +163,9 @@ protected:
                                // for the output buffer when creating
                                // or repairing.
 
+  u32 threadcount;             // How many threads to use for verifying
+                               // and repairing.
+
   bool purgefiles;             // purge backup and par files on successfull
                                // recovery
   bool recursive;              // recurse into subdirectories
@@ -43,6 +43,7 @@ FileCheckSummer::FileCheckSummer(DiskFile   *_diskfile,
   filesize = diskfile->FileSize();
 
   currentoffset = 0;
+  hashoffset = ~(u64)0;
 }
 
 FileCheckSummer::~FileCheckSummer(void)
@@ -54,6 +55,7 @@ FileCheckSummer::~FileCheckSummer(void)
 bool FileCheckSummer::Start(void)
 {
   currentoffset = readoffset = 0;
+  hashoffset = ~(u64)0;
 
   tailpointer = outpointer = buffer;
   inpointer = &buffer[blocksize];
@@ -213,11 +215,14 @@ void FileCheckSummer::GetFileHashes(MD5Hash &hashfull, MD5Hash &hash16k) const
 // Compute and return the current hash
 MD5Hash FileCheckSummer::Hash(void)
 {
-  MD5Context context;
-  context.Update(outpointer, (size_t)blocksize);
+  if (hashoffset != currentoffset)
+  {
+    MD5Context context;
+    context.Update(outpointer, (size_t)blocksize);
+    context.Final(hash);
 
-  MD5Hash hash;
-  context.Final(hash);
+    hashoffset = currentoffset;
+  }
 
   return hash;
 }
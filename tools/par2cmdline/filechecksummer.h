@@ -54,7 +54,8 @@ public:
   // Return the current checksum
   u32 Checksum(void) const;
 
-  // Compute and return the current hash
+  // Compute and return the current hash. The result is remembered so
+  // asking again at the same offset does not compute it twice.
   MD5Hash Hash(void);
 
   // Compute short values of checksum and hash
@@ -94,6 +95,10 @@ protected:
   // The current checksum
   u32         checksum;
 
+  // The last hash returned by Hash() and the offset it was computed at
+  MD5Hash     hash;
+  u64         hashoffset;
+
   // MD5 hash of whole file and of first 16k
   MD5Context  contextfull;
   MD5Context  context16k;
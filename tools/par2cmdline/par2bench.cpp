@@ -0,0 +1,137 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+// par2bench measures the throughput of the Reed Solomon computation that
+// dominates par2 creation and repair, for each of the Galois16 kernels
+// available on this processor. Before timing anything it checks that all
+// the kernels produce exactly the same recovery data as the scalar one.
+//
+// usage: par2bench [blocksize [sourceblocks]]
+
+#include "par2cmdline.h"
+
+#include <time.h>
+
+static const char *kernelnames[] = { "scalar", "ssse3", "avx2" };
+
+// Compute "recoveryblocks" recovery blocks from the source blocks and
+// return the number of cpu seconds it took.
+static double Compute(size_t blocksize,
+                      u32 sourceblocks,
+                      u32 recoveryblocks,
+                      const vector<u8> &input,
+                      vector<u8> &output)
+{
+  ReedSolomon<Galois16> rs;
+  if (!rs.SetInput(sourceblocks) ||
+      !rs.SetOutput(false, 0, (u16)(recoveryblocks - 1)) ||
+      !rs.Compute(CommandLine::nlSilent))
+  {
+    cerr << "Failed to compute the Reed Solomon matrix." << endl;
+    exit(1);
+  }
+
+  output.assign(blocksize * recoveryblocks, 0);
+
+  clock_t start = clock();
+  for (u32 inputindex=0; inputindex<sourceblocks; inputindex++)
+  {
+    for (u32 outputindex=0; outputindex<recoveryblocks; outputindex++)
+    {
+      rs.Process(blocksize,
+                 inputindex, &input[inputindex * blocksize],
+                 outputindex, &output[outputindex * blocksize]);
+    }
+  }
+  return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(int argc, char *argv[])
+{
+  // The odd default block size makes sure the scalar tail is exercised too.
+  size_t blocksize = argc > 1 ? (size_t)atol(argv[1]) : 384000 + 36;
+  u32 sourceblocks = argc > 2 ? (u32)atol(argv[2]) : 64;
+
+  if (blocksize == 0 || blocksize % 4 != 0 || sourceblocks == 0)
+  {
+    cerr << "usage: par2bench [blocksize [sourceblocks]]" << endl
+         << "The block size must be a non zero multiple of 4." << endl;
+    return 1;
+  }
+
+  vector<u8> input(blocksize * sourceblocks);
+  u32 seed = 0x12345678;
+  for (size_t i=0; i<input.size(); i++)
+  {
+    seed = seed * 1103515245 + 12345;
+    input[i] = (u8)(seed >> 16);
+  }
+
+  const GF16Kernel best = GF16GetKernel();
+
+  // Verify that every available kernel matches the scalar one
+  vector<u8> reference, output;
+  GF16SetKernel(gf16Scalar);
+  Compute(blocksize, sourceblocks, 3, input, reference);
+
+  for (int kernel=gf16SSSE3; kernel<=gf16AVX2; kernel++)
+  {
+    if (!GF16SetKernel((GF16Kernel)kernel))
+      continue;
+
+    Compute(blocksize, sourceblocks, 3, input, output);
+    if (output != reference)
+    {
+      cerr << "The " << kernelnames[kernel] << " kernel produced different results!" << endl;
+      return 1;
+    }
+  }
+
+  cout << "block size " << blocksize << ", " << sourceblocks << " source blocks, "
+       << "default kernel " << kernelnames[best] << endl
+       << "MB/s is source data times recovery blocks per cpu second" << endl
+       << endl;
+
+  cout << "recovery";
+  for (int kernel=gf16Scalar; kernel<=gf16AVX2; kernel++)
+  {
+    if (GF16KernelSupported((GF16Kernel)kernel))
+      cout << "\t" << kernelnames[kernel];
+  }
+  cout << endl;
+
+  const u32 counts[] = { 1, 2, 4, 8, 16, 32 };
+  for (size_t i=0; i<sizeof(counts)/sizeof(counts[0]); i++)
+  {
+    cout << counts[i];
+    for (int kernel=gf16Scalar; kernel<=gf16AVX2; kernel++)
+    {
+      if (!GF16SetKernel((GF16Kernel)kernel))
+        continue;
+
+      double seconds = Compute(blocksize, sourceblocks, counts[i], input, output);
+      double megabytes = (double)blocksize * sourceblocks * counts[i] / (1024.0 * 1024.0);
+      cout << "\t" << (int)(megabytes / (seconds > 0 ? seconds : 1e-9));
+    }
+    cout << endl;
+  }
+
+  return 0;
+}
@@ -245,6 +245,12 @@ typedef enum Result
 #include <vector>
 #include <map>
 #include <algorithm>
+#include <functional>
+
+// C++11 threading
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include <ctype.h>
 #include <iostream>
@@ -268,6 +274,7 @@ using namespace std;
 #include "par2fileformat.h"
 #include "commandline.h"
 #include "reedsolomon.h"
+#include "workerpool.h"
 
 #include "diskfile.h"
 #include "datablock.h"
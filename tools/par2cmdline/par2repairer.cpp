@@ -47,16 +47,23 @@ Par2Repairer::Par2Repairer(void)
   missingfilecount = 0;
 
   inputbuffer = 0;
+  readaheadbuffer = 0;
   outputbuffer = 0;
 
   noiselevel = CommandLine::nlNormal;
+  listener = 0;
+
+  workerpool = 0;
 }
 
 Par2Repairer::~Par2Repairer(void)
 {
   delete [] (u8*)inputbuffer;
+  delete [] (u8*)readaheadbuffer;
   delete [] (u8*)outputbuffer;
 
+  delete workerpool;
+
   map<u32,RecoveryPacket*>::iterator rp = recoverypacketmap.begin();
   while (rp != recoverypacketmap.end())
   {
@@ -83,6 +90,9 @@ Result Par2Repairer::Process(const CommandLine &commandline, bool dorepair)
   // What noiselevel are we using
   noiselevel = commandline.GetNoiseLevel();
 
+  // Start the threads used for verifying and repairing
+  workerpool = new WorkerPool(commandline.GetThreadCount());
+
   // do we want to purge par files on success ?
   bool purgefiles = commandline.GetPurgeFiles();
 
@@ -298,6 +308,8 @@ bool Par2Repairer::LoadPacketsFromFile(string filename)
     //DiskFile::SplitFilename(filename, path, name);
     cout << "Loading: \"" << name << "\"." << endl;
   }
+  if (listener)
+    listener->LoadingFile(name);
 
   // How many useable packets have we found
   u32 packets = 0;
@@ -329,14 +341,17 @@ bool Par2Repairer::LoadPacketsFromFile(string filename)
     // Continue as long as there is at least enough for the packet header
     while (offset + sizeof(PACKET_HEADER) <= filesize)
     {
-      if (noiselevel > CommandLine::nlQuiet)
+      if (noiselevel > CommandLine::nlQuiet || listener)
       {
         // Update a progress indicator
         u32 oldfraction = (u32)(1000 * progress / filesize);
         u32 newfraction = (u32)(1000 * offset / filesize);
         if (oldfraction != newfraction)
         {
-          cout << "Loading: \"" << name << "\": " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
+          if (noiselevel > CommandLine::nlQuiet)
+            cout << "Loading: \"" << name << "\": " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
+          if (listener)
+            listener->ScanProgress(name, newfraction);
           progress = offset;
         }
       }
@@ -495,6 +510,9 @@ bool Par2Repairer::LoadPacketsFromFile(string filename)
   // We have finished with the file for now
   diskfile->Close();
 
+  if (listener)
+    listener->LoadedFile(name, packets, recoverypackets);
+
   // Did we actually find any interesting packets
   if (packets > 0)
   {
@@ -1130,7 +1148,10 @@ bool Par2Repairer::VerifySourceFiles(const std::string& basepath, std::list<Comm
 
   sort(sortedfiles.begin(), sortedfiles.end(), SortSourceFilesByFileName);
 
-  // Start verifying the files
+  // The files which exist, these are verified in parallel once they have all been found
+  vector<pair<DiskFile*, Par2RepairerSourceFile*> > files;
+
+  // Start looking for the files
   sf = sortedfiles.begin();
   while (sf != sortedfiles.end())
   {
@@ -1179,12 +1200,11 @@ bool Par2Repairer::VerifySourceFiles(const std::string& basepath, std::list<Comm
         // Remember that we have processed this file
         bool success = diskFileMap.Insert(diskfile);
         assert(success);
-        // Do the actual verification
-        if (!VerifyDataFile(diskfile, sourcefile, basepath))
-          finalresult = false;
 
         // We have finished with the file for now
         diskfile->Close();
+
+        files.push_back(make_pair(diskfile, sourcefile));
       }
       else
       {
@@ -1195,12 +1215,18 @@ bool Par2Repairer::VerifySourceFiles(const std::string& basepath, std::list<Comm
         {
           cout << "Target: \"" << name << "\" - missing." << endl;
         }
+        if (listener)
+          listener->TargetVerified(name, Par2RepairerListener::tsMissing, 0, sourcefile->BlockCount());
       }
     }
 
     ++sf;
   }
 
+  // Do the actual verification
+  if (!VerifyDataFiles(files, basepath))
+    finalresult = false;
+
   // Find out how much data we have found
   UpdateVerificationResults();
 
@@ -1210,6 +1236,8 @@ bool Par2Repairer::VerifySourceFiles(const std::string& basepath, std::list<Comm
 // Scan any extra files specified on the command line
 bool Par2Repairer::VerifyExtraFiles(const list<CommandLine::ExtraFile> &extrafiles, string basepath)
 {
+  vector<pair<DiskFile*, Par2RepairerSourceFile*> > files;
+
   for (ExtraFileIterator i=extrafiles.begin(); 
        i!=extrafiles.end() && completefilecount<mainpacket->RecoverableFileCount(); 
        ++i)
@@ -1238,23 +1266,56 @@ bool Par2Repairer::VerifyExtraFiles(const list<CommandLine::ExtraFile> &extrafil
         bool success = diskFileMap.Insert(diskfile);
         assert(success);
 
-        // Do the actual verification
-        VerifyDataFile(diskfile, 0, basepath);
-        // Ignore errors
-
         // We have finished with the file for now
         diskfile->Close();
+
+        files.push_back(make_pair(diskfile, (Par2RepairerSourceFile*)0));
       }
     }
   }
 
+  // Do the actual verification
+  VerifyDataFiles(files, basepath);
+  // Ignore errors
+
   // Find out how much data we have found
   UpdateVerificationResults();
 
   return true;
 }
 
-// Attempt to match the data in the DiskFile with the source file
+// Verify each of the DiskFiles against its source file using all of the
+// worker threads. The files are started in the order they are listed.
+bool Par2Repairer::VerifyDataFiles(const vector<pair<DiskFile*, Par2RepairerSourceFile*> > &files, string basepath)
+{
+  bool finalresult = true;
+
+  workerpool->Run((u32)files.size(), [&](u32 index)
+  {
+    DiskFile *diskfile = files[index].first;
+
+    bool result = false;
+    if (!Cancelled() && diskfile->Open())
+    {
+      result = VerifyDataFile(diskfile, files[index].second, basepath);
+
+      // We have finished with the file for now
+      diskfile->Close();
+    }
+
+    if (!result)
+    {
+      lock_guard<mutex> guard(verifylock);
+      finalresult = false;
+    }
+  });
+
+  return finalresult;
+}
+
+// Attempt to match the data in the DiskFile with the source file.
+// This may be called for several files at the same time, anything
+// shared between the files is only accessed whilst holding verifylock.
 bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *sourcefile, string basepath)
 {
   MatchType matchtype; // What type of match was made
@@ -1295,6 +1356,7 @@ bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *so
     case eFullMatch:
       {
         // We found a perfect match.
+        lock_guard<mutex> guard(verifylock);
 
         sourcefile->SetCompleteFile(diskfile);
 
@@ -1372,6 +1434,8 @@ bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *so
       }
     }
 
+    lock_guard<mutex> guard(verifylock);
+
     list<Par2RepairerSourceFile*>::iterator sf = unverifiablesourcefiles.begin();
 
     // Compare the hash values of each source file for a match
@@ -1387,6 +1451,13 @@ bool Par2Repairer::VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *so
       {
         if (noiselevel > CommandLine::nlSilent)
           cout << diskfile->FileName() << " is a perfect match for " << sourcefile->GetDescriptionPacket()->FileName() << endl;
+        if (listener)
+        {
+          string name, targetname;
+          DiskFile::SplitRelativeFilename(diskfile->FileName(), basepath, name);
+          DiskFile::SplitRelativeFilename(sourcefile->TargetFileName(), basepath, targetname);
+          listener->DataFound(name, targetname, true);
+        }
 
         // Record that we have a perfect match for this source file
         sourcefile->SetCompleteFile(diskfile);
@@ -1450,6 +1521,8 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
     // If the file is empty, then just return
     if (noiselevel > CommandLine::nlSilent)
     {
+      lock_guard<mutex> guard(verifylock);
+
       if (originalsourcefile != 0)
       {
         cout << "Target: \"" << name << "\" - empty." << endl;
@@ -1459,6 +1532,11 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
         cout << "File: \"" << name << "\" - empty." << endl;
       }
     }
+    if (listener && originalsourcefile != 0)
+    {
+      lock_guard<mutex> guard(verifylock);
+      listener->TargetVerified(name, Par2RepairerListener::tsEmpty, 0, originalsourcefile->BlockCount());
+    }
     return true;
   }
 
@@ -1500,14 +1578,22 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   // Whilst we have not reached the end of the file
   while (filechecksummer.Offset() < diskfile->FileSize())
   {
-    if (noiselevel > CommandLine::nlQuiet)
+    if (noiselevel > CommandLine::nlQuiet || listener)
     {
       // Update a progress indicator
       u32 oldfraction = (u32)(1000 * progress / diskfile->FileSize());
       u32 newfraction = (u32)(1000 * (progress = filechecksummer.Offset()) / diskfile->FileSize());
       if (oldfraction != newfraction)
       {
-        cout << "Scanning: \"" << shortname << "\": " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
+        lock_guard<mutex> guard(verifylock);
+        if (noiselevel > CommandLine::nlQuiet)
+          cout << "Scanning: \"" << shortname << "\": " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
+        if (listener)
+        {
+          listener->ScanProgress(name, newfraction);
+          if (listener->Cancelled())
+            return false;
+        }
       }
     }
 
@@ -1515,8 +1601,24 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
     // that we have already found.
     bool duplicate;
 
-    // Look for a match
-    const VerificationHashEntry *currententry = verificationhashtable.FindMatch(nextentry, sourcefile, filechecksummer, duplicate);
+    // If the checksum is that of any block then the hash will be needed
+    // to confirm the match. Compute it before taking the lock.
+    if (verificationhashtable.Lookup(filechecksummer.Checksum()) != 0)
+      filechecksummer.Hash();
+
+    const VerificationHashEntry *currententry;
+    {
+      lock_guard<mutex> guard(verifylock);
+
+      // Look for a match
+      currententry = verificationhashtable.FindMatch(nextentry, sourcefile, filechecksummer, duplicate);
+
+      if (currententry != 0 && blocksallocated)
+      {
+        // Record the match
+        currententry->SetBlock(diskfile, filechecksummer.Offset());
+      }
+    }
 
     // Did we find a match
     if (currententry != 0)
@@ -1552,12 +1654,6 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
         }
       }
 
-      if (blocksallocated)
-      {
-        // Record the match
-        currententry->SetBlock(diskfile, filechecksummer.Offset());
-      }
-
       // Update the number of matches found
       count++;
 
@@ -1611,6 +1707,8 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
   // Get the Full and 16k hash values of the file
   filechecksummer.GetFileHashes(hashfull, hash16k);
 
+  lock_guard<mutex> guard(verifylock);
+
   if (noiselevel >= CommandLine::nlDebug)
   {
     cout << "duplicates: " << duplicatecount << endl;
@@ -1769,6 +1867,31 @@ bool Par2Repairer::ScanDataFile(DiskFile                *diskfile,    // [in]
     }
   }
 
+  if (listener)
+  {
+    if (count > 0 && originalsourcefile == sourcefile)
+    {
+      listener->TargetVerified(name,
+                               matchtype == eFullMatch ? Par2RepairerListener::tsComplete : Par2RepairerListener::tsDamaged,
+                               count,
+                               sourcefile->BlockCount());
+    }
+    else
+    {
+      // None of the data in the file belongs to the target it was scanned for
+      if (originalsourcefile != 0)
+        listener->TargetVerified(name, Par2RepairerListener::tsDamaged, 0, originalsourcefile->BlockCount());
+
+      if (count > 0)
+      {
+        string targetname;
+        DiskFile::SplitRelativeFilename(sourcefile->TargetFileName(), basepath, targetname);
+
+        listener->DataFound(name, targetname, matchtype == eFullMatch);
+      }
+    }
+  }
+
   return true;
 }
 
@@ -2164,11 +2287,12 @@ bool Par2Repairer::AllocateBuffers(size_t memorylimit)
     chunksize = (size_t)blocksize;
   }
 
-  // Allocate the two buffers
+  // Allocate the buffers
   inputbuffer = new u8[(size_t)chunksize];
+  readaheadbuffer = new u8[(size_t)chunksize];
   outputbuffer = new u8[(size_t)chunksize * missingblockcount];
 
-  if (inputbuffer == NULL || outputbuffer == NULL)
+  if (inputbuffer == NULL || readaheadbuffer == NULL || outputbuffer == NULL)
   {
     cerr << "Could not allocate buffer memory." << endl;
     return false;
@@ -2194,11 +2318,18 @@ bool Par2Repairer::ProcessData(u64 blockoffset, size_t blocklength)
   // Are there any blocks which need to be reconstructed
   if (missingblockcount > 0)
   {
-    // For each input block
-    while (inputblock != inputblocks.end())       
+    // Each thread processes a different range of the data for all of
+    // the output blocks. The ranges are a multiple of 64 bytes so that
+    // the Reed Solomon code can work on whole vectors.
+    const u32 threadcount = workerpool->ThreadCount();
+    const size_t slicelength = ((blocklength + threadcount - 1) / threadcount + 63) & ~(size_t)63;
+    const u32 slicecount = (u32)((blocklength + slicelength - 1) / slicelength);
+
+    // Read data from an input block into the specified buffer
+    auto readblock = [&](DataBlock *datablock, void *buffer) -> bool
     {
       // Are we reading from a new file?
-      if (lastopenfile != (*inputblock)->GetDiskFile())
+      if (lastopenfile != datablock->GetDiskFile())
       {
         // Close the last file
         if (lastopenfile != NULL)
@@ -2207,16 +2338,43 @@ bool Par2Repairer::ProcessData(u64 blockoffset, size_t blocklength)
         }
 
         // Open the new file
-        lastopenfile = (*inputblock)->GetDiskFile();
+        lastopenfile = datablock->GetDiskFile();
         if (!lastopenfile->Open())
         {
           return false;
         }
       }
 
-      // Read data from the current input block
-      if (!(*inputblock)->ReadData(blockoffset, blocklength, inputbuffer))
-        return false;
+      return datablock->ReadData(blockoffset, blocklength, buffer);
+    };
+
+    // Read data from the first input block
+    if (!readblock(*inputblock, inputbuffer))
+      return false;
+
+    // For each input block
+    while (inputblock != inputblocks.end())       
+    {
+      const void *inbuf = inputbuffer;
+      const u32 currentindex = inputindex;
+
+      // Process the data for each output block on the worker threads
+      workerpool->Start(slicecount, [&, inbuf, currentindex](u32 slice)
+      {
+        size_t offset = slice * slicelength;
+        size_t length = min(slicelength, blocklength - offset);
+
+        for (u32 outputindex=0; outputindex<missingblockcount; outputindex++)
+        {
+          // Select the appropriate part of the output buffer
+          void *outbuf = &((u8*)outputbuffer)[chunksize * outputindex + offset];
+
+          rs.Process(length, currentindex, &((const u8*)inbuf)[offset], outputindex, outbuf);
+        }
+      });
+
+      // In the meantime copy the data to disk and read the next input block
+      bool success = true;
 
       // Have we reached the last source data block
       if (copyblock != copyblocks.end())
@@ -2224,42 +2382,46 @@ bool Par2Repairer::ProcessData(u64 blockoffset, size_t blocklength)
         // Does this block need to be copied to the target file
         if ((*copyblock)->IsSet())
         {
-          size_t wrote;
+          size_t wrote = 0;
 
           // Write the block back to disk in the new target file
-          if (!(*copyblock)->WriteData(blockoffset, blocklength, inputbuffer, wrote))
-            return false;
+          success = (*copyblock)->WriteData(blockoffset, blocklength, inputbuffer, wrote);
 
           totalwritten += wrote;
         }
         ++copyblock;
       }
 
-      // For each output block
-      for (u32 outputindex=0; outputindex<missingblockcount; outputindex++)
+      ++inputblock;
+      ++inputindex;
+
+      if (success && inputblock != inputblocks.end())
       {
-        // Select the appropriate part of the output buffer
-        void *outbuf = &((u8*)outputbuffer)[chunksize * outputindex];
+        success = readblock(*inputblock, readaheadbuffer);
+      }
 
-        // Process the data
-        rs.Process(blocklength, inputindex, inputbuffer, outputindex, outbuf);
+      workerpool->Wait();
 
-        if (noiselevel > CommandLine::nlQuiet)
-        {
-          // Update a progress indicator
-          u32 oldfraction = (u32)(1000 * progress / totaldata);
-          progress += blocklength;
-          u32 newfraction = (u32)(1000 * progress / totaldata);
+      if (!success)
+        return false;
 
-          if (oldfraction != newfraction)
-          {
-            cout << "Repairing: " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
-          }
-        }
+      swap(inputbuffer, readaheadbuffer);
+
+      // Update a progress indicator
+      u32 oldfraction = (u32)(1000 * progress / totaldata);
+      progress += (u64)blocklength * missingblockcount;
+      u32 newfraction = (u32)(1000 * progress / totaldata);
+
+      if (oldfraction != newfraction)
+      {
+        if (noiselevel > CommandLine::nlQuiet)
+          cout << "Repairing: " << newfraction/10 << '.' << newfraction%10 << "%\r" << flush;
+        if (listener)
+          listener->RepairProgress("Repairing", newfraction);
       }
 
-      ++inputblock;
-      ++inputindex;
+      if (Cancelled())
+        return false;
     }
   }
   else
@@ -2356,6 +2518,8 @@ bool Par2Repairer::VerifyTargetFiles(string basepath)
   // Verify the target files in alphabetical order
   sort(verifylist.begin(), verifylist.end(), SortSourceFilesByFileName);
 
+  vector<pair<DiskFile*, Par2RepairerSourceFile*> > files;
+
   // Iterate through each file in the verification list
   for (vector<Par2RepairerSourceFile*>::iterator sf = verifylist.begin();
        sf != verifylist.end();
@@ -2379,21 +2543,13 @@ bool Par2Repairer::VerifyTargetFiles(string basepath)
     // Say we don't have a complete version of the file
     sourcefile->SetCompleteFile(0);
 
-    // Re-open the target file
-    if (!targetfile->Open())
-    {
-      finalresult = false;
-      continue;
-    }
-
-    // Verify the file again
-    if (!VerifyDataFile(targetfile, sourcefile, basepath))
-      finalresult = false;
-
-    // Close the file again
-    targetfile->Close();
+    files.push_back(make_pair(targetfile, sourcefile));
   }
 
+  // Verify the files again
+  if (!VerifyDataFiles(files, basepath))
+    finalresult = false;
+
   // Find out how much data we have found
   UpdateVerificationResults();
 
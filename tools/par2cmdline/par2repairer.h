@@ -20,12 +20,55 @@
 #ifndef __PAR2REPAIRER_H__
 #define __PAR2REPAIRER_H__
 
+// A program that links in the repair code can give a Par2RepairerListener
+// to the Par2Repairer to follow its progress without having to parse the
+// screen output, and to cancel it. The calls are made from the threads
+// doing the work but never more than one at a time. File names are
+// relative to the base path.
+
+class Par2RepairerListener
+{
+public:
+  virtual ~Par2RepairerListener(void) {}
+
+  typedef enum
+  {
+    tsMissing = 0,   // The target file does not exist
+    tsEmpty,         // The target file is empty
+    tsComplete,      // The target file is complete
+    tsDamaged        // Some or all of the data blocks of the target file are missing
+  } TargetStatus;
+
+  // A PAR2 file is being loaded, and it has been loaded
+  virtual void LoadingFile(const string &name) {}
+  virtual void LoadedFile(const string &name, u32 packets, u32 recoverypackets) {}
+
+  // Progress of scanning a target or an extra file, in tenths of a percent
+  virtual void ScanProgress(const string &name, u32 fraction) {}
+
+  // A target file has been verified
+  virtual void TargetVerified(const string &name, TargetStatus status, u32 blocksfound, u32 blockcount) {}
+
+  // Data belonging to a target file was found in some other file
+  virtual void DataFound(const string &name, const string &targetname, bool complete) {}
+
+  // Progress of the repair, in tenths of a percent
+  virtual void RepairProgress(const string &step, u32 fraction) {}
+
+  // Polled regularly. Once it returns true the repairer stops as soon
+  // as it can and Process() returns an error.
+  virtual bool Cancelled(void) {return false;}
+};
+
 class Par2Repairer
 {
 public:
   Par2Repairer(void);
   ~Par2Repairer(void);
 
+  // Set the listener (if any) to notify during Process()
+  void SetListener(Par2RepairerListener *_listener) {listener = _listener;}
+
   Result Process(const CommandLine &commandline, bool dorepair);
 
 protected:
@@ -75,6 +118,10 @@ protected:
   // Scan any extra files specified on the command line
   bool VerifyExtraFiles(const list<CommandLine::ExtraFile> &extrafiles, string basepath);
 
+  // Verify each of the (closed) DiskFiles against its source file (if any)
+  // using all of the worker threads
+  bool VerifyDataFiles(const vector<pair<DiskFile*, Par2RepairerSourceFile*> > &files, string basepath);
+
   // Attempt to match the data in the DiskFile with the source file
   bool VerifyDataFile(DiskFile *diskfile, Par2RepairerSourceFile *sourcefile, string basepath);
 
@@ -121,12 +168,20 @@ protected:
   // Delete all of the partly reconstructed files
   bool DeleteIncompleteTargetFiles(void);
 
+  // Has the listener asked to stop
+  bool Cancelled(void) const {return listener != 0 && listener->Cancelled();}
+
   // list the files needing verification
   bool RemoveBackupFiles(void);
   bool RemoveParFiles(void);
 
 protected:
   CommandLine::NoiseLevel   noiselevel;              // OnScreen display
+  Par2RepairerListener     *listener;                // Progress notifications (optional)
+
+  WorkerPool               *workerpool;              // Threads used for verification and repair
+  mutex                     verifylock;              // Protects the verification results and the
+                                                     // screen output while files are scanned in parallel
 
   string                    searchpath;              // Where to find files on disk
 
@@ -174,6 +229,8 @@ protected:
   ReedSolomon<Galois16>     rs;                      // The Reed Solomon matrix.
 
   void                     *inputbuffer;             // Buffer for reading DataBlocks (chunksize)
+  void                     *readaheadbuffer;         // Buffer for reading the next DataBlock whilst
+                                                     // the current one is being processed (chunksize)
   void                     *outputbuffer;            // Buffer for writing DataBlocks (chunksize * missingblockcount)
 
   u64                       progress;                // How much data has been processed.
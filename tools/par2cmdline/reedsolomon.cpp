@@ -27,6 +27,195 @@ static char THIS_FILE[]=__FILE__;
 #endif
 #endif
 
+// Vectorised Galois16 multiply-accumulate.
+//
+// A 16-bit source value s is split into four nibbles n0..n3, so that
+// factor*s = factor*n0 ^ factor*(n1<<4) ^ factor*(n2<<8) ^ factor*(n3<<12).
+// Each of those products only has 16 possible values, so the low and the
+// high byte of each of them fit into a 16 entry table that a single pshufb
+// can look up for 16 (or 32 with AVX2) nibbles at once. The source words
+// are first split into a vector of low bytes and a vector of high bytes,
+// and the two result vectors are interleaved again before the xor into the
+// output buffer. The kernels only handle whole vectors; the remaining tail
+// is done by the scalar loop so the result is identical either way.
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define GF16_SIMD
+#endif
+
+#ifdef GF16_SIMD
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#include <immintrin.h>
+#define GF16_TARGET(isa)
+#else
+#include <immintrin.h>
+#define GF16_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+// tables[2*i+0][v] and tables[2*i+1][v] are the low and high bytes of factor*(v << 4*i)
+typedef u8 GF16NibbleTables[8][16];
+
+GF16_TARGET("ssse3")
+static size_t GF16MultiplyAddSSSE3(const GF16NibbleTables &tables, size_t size, const u8 *src, u8 *dst)
+{
+  const __m128i mask   = _mm_set1_epi8(0x0f);
+  const __m128i deint  = _mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15);
+
+  const __m128i t0l = _mm_loadu_si128((const __m128i*)tables[0]);
+  const __m128i t0h = _mm_loadu_si128((const __m128i*)tables[1]);
+  const __m128i t1l = _mm_loadu_si128((const __m128i*)tables[2]);
+  const __m128i t1h = _mm_loadu_si128((const __m128i*)tables[3]);
+  const __m128i t2l = _mm_loadu_si128((const __m128i*)tables[4]);
+  const __m128i t2h = _mm_loadu_si128((const __m128i*)tables[5]);
+  const __m128i t3l = _mm_loadu_si128((const __m128i*)tables[6]);
+  const __m128i t3h = _mm_loadu_si128((const __m128i*)tables[7]);
+
+  size_t done = 0;
+  for (; done + 32 <= size; done += 32)
+  {
+    // Separate the low and the high bytes of 16 source words
+    __m128i a = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[done +  0]), deint);
+    __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)&src[done + 16]), deint);
+    __m128i lo = _mm_unpacklo_epi64(a, b);
+    __m128i hi = _mm_unpackhi_epi64(a, b);
+
+    __m128i n0 = _mm_and_si128(lo, mask);
+    __m128i n1 = _mm_and_si128(_mm_srli_epi16(lo, 4), mask);
+    __m128i n2 = _mm_and_si128(hi, mask);
+    __m128i n3 = _mm_and_si128(_mm_srli_epi16(hi, 4), mask);
+
+    __m128i rl = _mm_xor_si128(_mm_xor_si128(_mm_shuffle_epi8(t0l, n0), _mm_shuffle_epi8(t1l, n1)),
+                               _mm_xor_si128(_mm_shuffle_epi8(t2l, n2), _mm_shuffle_epi8(t3l, n3)));
+    __m128i rh = _mm_xor_si128(_mm_xor_si128(_mm_shuffle_epi8(t0h, n0), _mm_shuffle_epi8(t1h, n1)),
+                               _mm_xor_si128(_mm_shuffle_epi8(t2h, n2), _mm_shuffle_epi8(t3h, n3)));
+
+    // Interleave the result bytes back into words
+    __m128i d0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&dst[done +  0]), _mm_unpacklo_epi8(rl, rh));
+    __m128i d1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&dst[done + 16]), _mm_unpackhi_epi8(rl, rh));
+    _mm_storeu_si128((__m128i*)&dst[done +  0], d0);
+    _mm_storeu_si128((__m128i*)&dst[done + 16], d1);
+  }
+  return done;
+}
+
+// The same as the SSSE3 kernel, but each 128-bit lane of the 256-bit
+// vectors works on its own 16 words. Because unpack works within lanes
+// too, the interleaved result comes out in the original order.
+GF16_TARGET("avx2")
+static size_t GF16MultiplyAddAVX2(const GF16NibbleTables &tables, size_t size, const u8 *src, u8 *dst)
+{
+  const __m256i mask   = _mm256_set1_epi8(0x0f);
+  const __m256i deint  = _mm256_broadcastsi128_si256(_mm_setr_epi8(0, 2, 4, 6, 8, 10, 12, 14, 1, 3, 5, 7, 9, 11, 13, 15));
+
+  const __m256i t0l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[0]));
+  const __m256i t0h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[1]));
+  const __m256i t1l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[2]));
+  const __m256i t1h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[3]));
+  const __m256i t2l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[4]));
+  const __m256i t2h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[5]));
+  const __m256i t3l = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[6]));
+  const __m256i t3h = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)tables[7]));
+
+  size_t done = 0;
+  for (; done + 64 <= size; done += 64)
+  {
+    __m256i a = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[done +  0]), deint);
+    __m256i b = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)&src[done + 32]), deint);
+    __m256i lo = _mm256_unpacklo_epi64(a, b);
+    __m256i hi = _mm256_unpackhi_epi64(a, b);
+
+    __m256i n0 = _mm256_and_si256(lo, mask);
+    __m256i n1 = _mm256_and_si256(_mm256_srli_epi16(lo, 4), mask);
+    __m256i n2 = _mm256_and_si256(hi, mask);
+    __m256i n3 = _mm256_and_si256(_mm256_srli_epi16(hi, 4), mask);
+
+    __m256i rl = _mm256_xor_si256(_mm256_xor_si256(_mm256_shuffle_epi8(t0l, n0), _mm256_shuffle_epi8(t1l, n1)),
+                                  _mm256_xor_si256(_mm256_shuffle_epi8(t2l, n2), _mm256_shuffle_epi8(t3l, n3)));
+    __m256i rh = _mm256_xor_si256(_mm256_xor_si256(_mm256_shuffle_epi8(t0h, n0), _mm256_shuffle_epi8(t1h, n1)),
+                                  _mm256_xor_si256(_mm256_shuffle_epi8(t2h, n2), _mm256_shuffle_epi8(t3h, n3)));
+
+    __m256i d0 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&dst[done +  0]), _mm256_unpacklo_epi8(rl, rh));
+    __m256i d1 = _mm256_xor_si256(_mm256_loadu_si256((const __m256i*)&dst[done + 32]), _mm256_unpackhi_epi8(rl, rh));
+    _mm256_storeu_si256((__m256i*)&dst[done +  0], d0);
+    _mm256_storeu_si256((__m256i*)&dst[done + 32], d1);
+  }
+  return done;
+}
+
+static bool GF16CpuHasSSSE3(void)
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  return (info[2] & (1 << 9)) != 0;
+#else
+  return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+static bool GF16CpuHasAVX2(void)
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info, 1);
+  // The OS must save the ymm registers (OSXSAVE and XCR0 bits 1 and 2)
+  if ((info[2] & (1 << 27)) == 0 || (_xgetbv(0) & 6) != 6)
+    return false;
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+#endif // GF16_SIMD
+
+bool GF16KernelSupported(GF16Kernel kernel)
+{
+  switch (kernel)
+  {
+  case gf16Scalar:
+    return true;
+#ifdef GF16_SIMD
+  case gf16SSSE3:
+    return GF16CpuHasSSSE3();
+  case gf16AVX2:
+    return GF16CpuHasAVX2();
+#endif
+  default:
+    return false;
+  }
+}
+
+static GF16Kernel GF16BestKernel(void)
+{
+  if (GF16KernelSupported(gf16AVX2))
+    return gf16AVX2;
+  if (GF16KernelSupported(gf16SSSE3))
+    return gf16SSSE3;
+  return gf16Scalar;
+}
+
+// The selection is a plain value computed during static initialisation,
+// which happens before any thread can call Process().
+static GF16Kernel gf16kernel = GF16BestKernel();
+
+GF16Kernel GF16GetKernel(void)
+{
+  return gf16kernel;
+}
+
+bool GF16SetKernel(GF16Kernel kernel)
+{
+  if (!GF16KernelSupported(kernel))
+    return false;
+
+  gf16kernel = kernel;
+  return true;
+}
+
 u32 gcd(u32 a, u32 b)
 {
   if (a && b)
@@ -313,10 +502,35 @@ template<> bool ReedSolomon<Galois16>::InternalProcess(const Galois16 &factor, s
     HH++;
   }
 
-  // Treat the buffers as arrays of 32-bit unsigned ints.
-  u32 *src = (u32 *)inputbuffer;
+  size_t done = 0;
+
+#ifdef GF16_SIMD
+  if (gf16kernel != gf16Scalar && size >= 64)
+  {
+    // Split the two combined tables into the nibble tables.
+    // L[v] is factor * v and H[v] is factor * (v << 8).
+    GF16NibbleTables tables;
+    for (unsigned int v=0; v<16; v++)
+    {
+      const unsigned int products[4] = { L[v], L[v << 4], H[v], H[v << 4] };
+      for (unsigned int i=0; i<4; i++)
+      {
+        tables[2*i+0][v] = (u8)(products[i] >> 0);
+        tables[2*i+1][v] = (u8)(products[i] >> 8);
+      }
+    }
+
+    if (gf16kernel == gf16AVX2)
+      done = GF16MultiplyAddAVX2(tables, size, (const u8*)inputbuffer, (u8*)outputbuffer);
+    else
+      done = GF16MultiplyAddSSSE3(tables, size, (const u8*)inputbuffer, (u8*)outputbuffer);
+  }
+#endif
+
+  // Treat the (rest of the) buffers as arrays of 32-bit unsigned ints.
+  u32 *src = (u32 *)&((u8*)inputbuffer)[done];
   u32 *end = (u32 *)&((u8*)inputbuffer)[size];
-  u32 *dst = (u32 *)outputbuffer;
+  u32 *dst = (u32 *)&((u8*)outputbuffer)[done];
   
   // Process the data
   while (src < end)
@@ -38,6 +38,24 @@ public:
   u16 exponent;
 };
 
+// The Galois16 multiply-accumulate used by ReedSolomon<Galois16>::Process
+// is done by one of several kernels. The fastest one that the processor
+// supports is picked the first time it is needed.
+
+enum GF16Kernel
+{
+  gf16Scalar = 0,  // 32-bit words using two 256 entry lookup tables
+  gf16SSSE3,       // 128-bit vectors using eight 16 entry nibble tables (pshufb)
+  gf16AVX2         // 256-bit vectors using the same nibble tables (vpshufb)
+};
+
+// Is the kernel available on this processor
+bool GF16KernelSupported(GF16Kernel kernel);
+
+// Get the kernel in use, or force a specific one (for testing and benchmarks)
+GF16Kernel GF16GetKernel(void);
+bool GF16SetKernel(GF16Kernel kernel);
+
 template<class g>
 class ReedSolomon
 {
@@ -0,0 +1,108 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#include "par2cmdline.h"
+
+#ifdef _MSC_VER
+#ifdef _DEBUG
+#undef THIS_FILE
+static char THIS_FILE[]=__FILE__;
+#define new DEBUG_NEW
+#endif
+#endif
+
+WorkerPool::WorkerPool(u32 threadcount)
+: slicecount(0)
+, nextslice(0)
+, slicesdone(0)
+, stopping(false)
+{
+  if (threadcount == 0)
+    threadcount = 1;
+
+  for (u32 i=0; i<threadcount; i++)
+  {
+    threads.push_back(thread(&WorkerPool::WorkerThread, this));
+  }
+}
+
+WorkerPool::~WorkerPool(void)
+{
+  {
+    unique_lock<mutex> guard(lock);
+    stopping = true;
+  }
+  jobready.notify_all();
+
+  for (size_t i=0; i<threads.size(); i++)
+  {
+    threads[i].join();
+  }
+}
+
+void WorkerPool::Start(u32 _slicecount, const Job &_job)
+{
+  {
+    unique_lock<mutex> guard(lock);
+    assert(slicesdone == slicecount);
+
+    job        = _job;
+    slicecount = _slicecount;
+    nextslice  = 0;
+    slicesdone = 0;
+  }
+  jobready.notify_all();
+}
+
+void WorkerPool::Wait(void)
+{
+  unique_lock<mutex> guard(lock);
+  while (slicesdone < slicecount)
+  {
+    jobdone.wait(guard);
+  }
+}
+
+void WorkerPool::WorkerThread(void)
+{
+  unique_lock<mutex> guard(lock);
+
+  for (;;)
+  {
+    // Wait for a slice to become available
+    while (nextslice == slicecount && !stopping)
+    {
+      jobready.wait(guard);
+    }
+    if (nextslice == slicecount)
+      return;
+
+    u32 slice = nextslice++;
+
+    // Process the slice without holding the lock
+    guard.unlock();
+    job(slice);
+    guard.lock();
+
+    if (++slicesdone == slicecount)
+    {
+      jobdone.notify_all();
+    }
+  }
+}
@@ -0,0 +1,75 @@
+//  This file is part of par2cmdline (a PAR 2.0 compatible file verification and
+//  repair tool). See http://parchive.sourceforge.net for details of PAR 2.0.
+//
+//  Copyright (c) 2003 Peter Brian Clements
+//
+//  par2cmdline is free software; you can redistribute it and/or modify
+//  it under the terms of the GNU General Public License as published by
+//  the Free Software Foundation; either version 2 of the License, or
+//  (at your option) any later version.
+//
+//  par2cmdline is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+#ifndef __WORKERPOOL_H__
+#define __WORKERPOOL_H__
+
+// A WorkerPool owns a fixed number of threads which are used to run
+// a job that has been split into a number of independent slices.
+// Each thread keeps taking the next slice until all of them have been
+// processed.
+//
+// Start() returns as soon as the job has been handed to the threads so
+// that the caller can do something else in the meantime (such as read
+// the next block of data from disk). Wait() returns when all of the
+// slices are done. Only one job can be running at a time.
+
+class WorkerPool
+{
+public:
+  typedef function<void (u32 slice)> Job;
+
+  WorkerPool(u32 threadcount);
+  ~WorkerPool(void);
+
+  // Start running the job on all of the slices
+  void Start(u32 slicecount, const Job &job);
+
+  // Wait until the job started last has been completed
+  void Wait(void);
+
+  // Start the job and wait for it to complete
+  void Run(u32 slicecount, const Job &job);
+
+  u32 ThreadCount(void) const {return (u32)threads.size();}
+
+protected:
+  void WorkerThread(void);
+
+protected:
+  vector<thread>     threads;
+
+  mutex              lock;       // Protects everything below
+  condition_variable jobready;   // Signalled when a job is started or the pool is stopped
+  condition_variable jobdone;    // Signalled when the last slice has been completed
+
+  Job                job;        // The current job
+  u32                slicecount; // How many slices the current job has
+  u32                nextslice;  // The next slice to be handed to a thread
+  u32                slicesdone; // How many slices have been completed
+  bool               stopping;   // Set when the threads should exit
+};
+
+inline void WorkerPool::Run(u32 slicecount, const Job &job)
+{
+  Start(slicecount, job);
+  Wait();
+}
+
+#endif // __WORKERPOOL_H__